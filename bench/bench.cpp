@@ -0,0 +1,323 @@
+/**
+ * @file bench.cpp
+ * @brief Structured benchmark suite of the library (`make bench`).
+ *
+ * For every matrix listed in `data/data.json` and for both storage orders, this program times:
+ * - the reader of the Matrix Market file, and the pipelined loader (loader.hpp);
+ * - the conversions between formats: compress, compress_parallel, compress_mod and uncompress;
+ * - the matrix-vector product (SpMV) and the matrix-matrix product (SpGEMM) of Matrix and SquareMatrix
+ *   in every format (COO, CSR/CSC, MSR/MSC) and, for the CSR/CSC format, with every kernel;
+ * - the One, Infinity and Frobenius norms in every format;
+ * - the SpMV and SpGEMM of TransposeView and DiagonalView in every format of the underlying matrix.
+ *
+ * Every operation is timed with warmup runs and repetitions (see algebra::Benchmark) and placed on
+ * the memory roofline, i.e. compared with the bandwidth of the STREAM triad measured at startup (see
+ * roofline.hpp). The allocations and the bytes allocated by every run are counted by the global operator
+ * new interposed by allocation_hooks.hpp, and the increase of the peak RSS is measured as well, to catch
+ * temporary vectors and copies of whole matrices. The results are saved in `data/benchmark.json` (or in the file given as first argument)
+ * following the schema documented in benchmark.hpp.
+ *
+ * When a baseline is given (`make regression`), every operation is repeated at least `min_repetitions`
+ * times, unless these repetitions are expected to take more than `max_time_ms` (ten budgets by default):
+ * such slow operations (e.g. the uncompressed SpGEMM of the largest matrices) stop at the budget and are
+ * reported as inconclusive, so that they do not dominate the time of the gate. The results are compared
+ * with the baseline (see regression.hpp): the program exits with status 1 if an operation is significantly
+ * slower than in the baseline by more than the threshold or is missing from the current run, and with
+ * status 2 if the baseline cannot be read. The baseline itself is saved by `make baseline`.
+ *
+ * When compiled with `-DALGEBRA_ENABLE_PROFILING` (`make counters`), the hardware performance counters
+ * accumulated per kernel (see profiling.hpp) are printed at the end.
+ *
+ * Usage: `./bench/bench [output.json] [warmup] [repetitions] [budget_ms] [min_repetitions] [baseline.json] [threshold] [max_time_ms]`
+ */
+#include "matrix.hpp"
+#include "square_matrix.hpp"
+#include "matrix_views.hpp"
+#include "loader.hpp"
+#include "json_utility.hpp"
+#include "benchmark.hpp"
+#include "roofline.hpp"
+#include "tuning_cache.hpp"
+#include "regression.hpp"
+#include "allocation_hooks.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <complex>
+#include <utility>
+
+using namespace algebra;
+using namespace json_utility;
+
+/// @brief print a result as a row of the summary table
+/// @param result result to print
+void print_row(const BenchmarkResult &result)
+{
+    const RooflinePoint point = roofline(result.cost, result.time.median * 1e-9);
+    std::cout << std::left << std::setw(18) << result.operation
+              << std::setw(14) << result.matrix_class
+              << std::setw(5) << result.format
+              << std::setw(10) << result.kernel
+              << std::right << std::setw(14) << std::fixed << std::setprecision(0) << result.time.median
+              << std::setw(10) << std::setprecision(3) << point.gflops
+              << std::setw(10) << point.gbs
+              << std::setw(8) << std::setprecision(1) << 100 * point.bandwidth_fraction
+              << std::setw(10) << std::setprecision(1) << result.time.memory.allocations
+              << std::setw(12) << std::setprecision(1) << result.time.memory.bytes / 1024
+              << std::setw(10) << std::setprecision(0) << result.time.memory.peak_rss_delta / 1024
+              << std::endl;
+}
+
+/// @brief benchmark all the operations on a matrix
+/// @tparam T type of the matrix elements
+/// @tparam S storage order
+/// @param name name of the matrix file in the data folder
+/// @param benchmark benchmark settings
+/// @param results vector where the results are appended
+template <AddMulType T, StorageOrder S>
+void bench_matrix(const std::string &name, const Benchmark &benchmark, std::vector<BenchmarkResult> &results)
+{
+    constexpr bool column_major = (S == StorageOrder::ColumnMajor);
+    const std::string filename = "data/" + name;
+    const std::string csr = column_major ? "CSC" : "CSR";
+    const std::string msr = column_major ? "MSC" : "MSR";
+
+    // reference matrices, in uncompressed format
+    Matrix<T, S> general(0, 0);
+    general.reader(filename);
+    const size_t rows = general.get_rows();
+    const size_t cols = general.get_cols();
+    const size_t nnz = general.get_nnz();
+    const size_t major_size = column_major ? cols : rows;
+    const bool square = (rows == cols);
+
+    // costs of the representations and of the products
+    Matrix<T, S> compressed(general);
+    compressed.compress();
+    size_t diagonal_nnz = 0;
+    for (size_t i = 0; i < std::min(rows, cols); i++)
+    {
+        // const access, so that the matrix is not uncompressed
+        diagonal_nnz += (std::as_const(compressed)(i, i) != T(0));
+    }
+    const size_t mod_entries = rows + nnz - diagonal_nnz;
+    const double coo_bytes = storage_bytes<T>("COO", major_size, nnz);
+    const double csr_bytes = storage_bytes<T>(csr, major_size, nnz);
+    const double msr_bytes = storage_bytes<T>(msr, major_size, mod_entries);
+    auto bytes_of = [&](const std::string &format)
+    { return format == "COO" ? coo_bytes : (format == msr ? msr_bytes : csr_bytes); };
+
+    auto record = [&](const std::string &operation, const std::string &matrix_class, const std::string &format,
+                      const std::string &kernel, const BenchmarkStatistics &time, const OperationCost &cost)
+    {
+        BenchmarkResult result{name, operation, matrix_class, format, kernel,
+                               column_major ? "ColumnMajor" : "RowMajor", value_type_name<T>(),
+                               rows, cols, nnz, time, cost};
+        print_row(result);
+        results.push_back(result);
+    };
+
+    // READER
+    {
+        Matrix<T, S> m(0, 0);
+        const double file_bytes = static_cast<double>(std::filesystem::file_size(filename));
+        record("reader", "Matrix", "COO", "Serial", benchmark.run([&]()
+                                                                  { m.reader(filename); }),
+               {0, file_bytes + coo_bytes});
+        record("load", "Matrix", csr, "Pipelined", benchmark.run([&]()
+                                                                 { load_matrix<Matrix<T, S>>(filename); }),
+               {0, file_bytes + csr_bytes});
+    }
+
+    // CONVERSIONS
+    {
+        Matrix<T, S> m(general);
+        record("compress", "Matrix", csr, "Serial",
+               benchmark.run([&]()
+                             { m.compress(); },
+                             [&]()
+                             { m.uncompress(); }),
+               {0, coo_bytes + csr_bytes});
+        record("compress_parallel", "Matrix", csr, "Parallel",
+               benchmark.run([&]()
+                             { m.compress_parallel(); },
+                             [&]()
+                             { m.uncompress(); }),
+               {0, coo_bytes + csr_bytes});
+        record("uncompress", "Matrix", "COO", "Serial",
+               benchmark.run([&]()
+                             { m.uncompress(); },
+                             [&]()
+                             { m.compress(); }),
+               {0, coo_bytes + csr_bytes});
+    }
+    if (square)
+    {
+        SquareMatrix<T, S> m(general);
+        record("compress_mod", "SquareMatrix", msr, "Serial",
+               benchmark.run([&]()
+                             { m.compress_mod(); },
+                             [&]()
+                             { m.uncompress(); }),
+               {0, coo_bytes + msr_bytes});
+    }
+
+    // PRODUCTS AND NORMS
+    std::vector<T> v(cols, T(1));
+    const size_t multiplications = square ? count_multiplications(compressed, compressed) : 0;
+
+    auto bench_norms = [&](const auto &m, const std::string &matrix_class, const std::string &format)
+    {
+        const OperationCost cost{flops_per_norm_element<T> * nnz, bytes_of(format)};
+        record("norm_one", matrix_class, format, "Serial", benchmark.run([&]()
+                                                                        { do_not_optimize(m.template norm<NormType::One>()); }),
+               cost);
+        record("norm_infinity", matrix_class, format, "Serial", benchmark.run([&]()
+                                                                             { do_not_optimize(m.template norm<NormType::Infinity>()); }),
+               cost);
+        record("norm_frobenius", matrix_class, format, "Serial", benchmark.run([&]()
+                                                                              { do_not_optimize(m.template norm<NormType::Frobenius>()); }),
+               cost);
+    };
+
+    auto bench_products = [&](const auto &m, const std::string &matrix_class, const std::string &format,
+                              const std::string &kernel, size_t spmv_multiplications, size_t spgemm_multiplications)
+    {
+        const double bytes = bytes_of(format);
+        record("spmv", matrix_class, format, kernel, benchmark.run([&]()
+                                                                   { do_not_optimize(m * v); }),
+               spmv_cost<T>(bytes, rows, cols, spmv_multiplications));
+        if (square)
+        {
+            // the size of the result is measured once, outside of the timed runs; as in spgemm_cost, the
+            // result is modelled in the compressed format of the storage order
+            const auto product = m * m;
+            const double result_bytes = storage_bytes<T>(format_name(S, true), major_size, product.get_nnz());
+            record("spgemm", matrix_class, format, kernel, benchmark.run([&]()
+                                                                         { do_not_optimize(m * m); }),
+                   spgemm_cost<T>(bytes, bytes, result_bytes, spgemm_multiplications));
+        }
+    };
+
+    // Matrix in COO and CSR/CSC format, with every kernel
+    {
+        Matrix<T, S> m(general);
+        bench_norms(m, "Matrix", "COO");
+        bench_products(m, "Matrix", "COO", "Serial", nnz, multiplications);
+        TransposeView<T, S> t(m);
+        bench_products(t, "TransposeView", "COO", "Serial", nnz, multiplications);
+
+        m.compress();
+        bench_norms(m, "Matrix", csr);
+        for (const auto &[kernel, kernel_name] : {std::pair{Kernel::Serial, "Serial"}, std::pair{Kernel::Parallel, "Parallel"}})
+        {
+            m.set_kernel(kernel);
+            bench_products(m, "Matrix", csr, kernel_name, nnz, multiplications);
+        }
+        m.set_kernel(Kernel::Serial);
+        bench_products(t, "TransposeView", csr, "Serial", nnz, multiplications);
+    }
+
+    // SquareMatrix in MSR/MSC format, DiagonalView in every format
+    if (square)
+    {
+        SquareMatrix<T, S> m(general);
+        DiagonalView<T, S> d(m);
+        bench_products(d, "DiagonalView", "COO", "Serial", diagonal_nnz, diagonal_nnz);
+        m.compress();
+        bench_products(d, "DiagonalView", csr, "Serial", diagonal_nnz, diagonal_nnz);
+
+        m.compress_mod();
+        bench_norms(m, "SquareMatrix", msr);
+        bench_products(m, "SquareMatrix", msr, "Serial", nnz, multiplications);
+        TransposeView<T, S> t(m);
+        bench_products(t, "TransposeView", msr, "Serial", nnz, multiplications);
+
+        // the products with a vector have a parallel kernel also in the modified compressed format
+        m.set_kernel(Kernel::Parallel);
+        const auto msr_spmv_cost = spmv_cost<T>(bytes_of(msr), rows, cols, nnz);
+        record("spmv", "SquareMatrix", msr, "Parallel", benchmark.run([&]()
+                                                                      { do_not_optimize(m * v); }),
+               msr_spmv_cost);
+        record("spmv", "TransposeView", msr, "Parallel", benchmark.run([&]()
+                                                                       { do_not_optimize(t * v); }),
+               msr_spmv_cost);
+        m.set_kernel(Kernel::Serial);
+        bench_products(d, "DiagonalView", msr, "Serial", diagonal_nnz, diagonal_nnz);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const std::string output = argc > 1 ? argv[1] : "data/benchmark.json";
+    const size_t warmup = argc > 2 ? std::stoul(argv[2]) : 2;
+    const size_t repetitions = argc > 3 ? std::stoul(argv[3]) : 20;
+    const auto budget = std::chrono::milliseconds(argc > 4 ? std::stoul(argv[4]) : 1000);
+    const size_t min_repetitions = argc > 5 ? std::stoul(argv[5]) : 1;
+    const std::string baseline = argc > 6 ? argv[6] : "";
+    RegressionSettings settings;
+    settings.threshold = argc > 7 ? std::stod(argv[7]) : settings.threshold;
+    // the minimum number of repetitions may take up to ten budgets: slower operations are inconclusive
+    const auto max_time = argc > 8 ? std::chrono::milliseconds(std::stoul(argv[8])) : 10 * budget;
+    const Benchmark benchmark(warmup, repetitions, budget, min_repetitions, max_time);
+
+    const StreamBandwidth &bandwidth = machine_bandwidth();
+    std::cout << "STREAM bandwidth [GB/s]: copy " << bandwidth.copy << ", scale " << bandwidth.scale
+              << ", add " << bandwidth.add << ", triad " << bandwidth.triad << std::endl;
+
+    json data = read_json("data/data.json");
+    const std::vector<std::string> matrix_names = data["matrix_name"];
+
+    std::vector<BenchmarkResult> results;
+    for (const auto &name : matrix_names)
+    {
+        for (const auto &order : {"RowMajor", "ColumnMajor"})
+        {
+            std::cout << std::endl;
+            std::cout << "Benchmark of " << name << " (" << order << ")" << std::endl;
+            std::cout << std::left << std::setw(18) << "operation" << std::setw(14) << "class" << std::setw(5) << "fmt"
+                      << std::setw(10) << "kernel" << std::right << std::setw(14) << "median [ns]"
+                      << std::setw(10) << "GFLOP/s" << std::setw(10) << "GB/s" << std::setw(8) << "%triad"
+                      << std::setw(10) << "allocs" << std::setw(12) << "alloc [KiB]" << std::setw(10) << "RSS [KiB]" << std::endl;
+            if (std::string(order) == "RowMajor")
+            {
+                bench_matrix<double, StorageOrder::RowMajor>(name, benchmark, results);
+            }
+            else
+            {
+                bench_matrix<double, StorageOrder::ColumnMajor>(name, benchmark, results);
+            }
+        }
+    }
+
+    const json current = benchmark_json(TuningCache::machine_key(), benchmark, bandwidth, results);
+    save_json(output, current);
+    std::cout << std::endl;
+    std::cout << "Results saved in " << output << std::endl;
+
+#ifdef ALGEBRA_ENABLE_PROFILING
+    std::cout << std::endl;
+    std::cout << "Hardware counters per kernel (all the runs, including warmup and setup)" << std::endl;
+    Profiler::instance().print(std::cout);
+#endif
+
+    if (not baseline.empty())
+    {
+        // as in bench/compare.cpp, a baseline that cannot be read is not a regression
+        try
+        {
+            const RegressionReport report = compare_benchmarks(read_json(baseline), current, settings);
+            std::cout << std::endl;
+            print_report(std::cout, report);
+            return report.passed() ? 0 : 1;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+/**
+ * @file compare.cpp
+ * @brief Compares two result files of the benchmark suite and fails on performance regressions.
+ *
+ * The operations of the current results are matched with the ones of the baseline, and the confidence
+ * interval of the relative change of their mean execution time is computed from the repetitions of both
+ * runs (see regression.hpp). Every operation that is significantly slower than in the baseline by more
+ * than the threshold is reported as a regression, and the program exits with status 1, as it does when an
+ * operation of the baseline is missing from the current results; it exits with status 2 if a file cannot
+ * be read.
+ *
+ * The files must be written by `./bench/bench` (schema of benchmark.hpp) with enough repetitions for the
+ * confidence intervals, e.g. `make baseline` before a change and `./bench/bench data/benchmark.json 2 20 1000 10`
+ * after it (`make regression` runs the benchmark and the comparison at once).
+ *
+ * Usage: `./bench/compare baseline.json current.json [threshold] [confidence] [all]`
+ */
+#include "json_utility.hpp"
+#include "regression.hpp"
+
+#include <iostream>
+#include <string>
+
+using namespace algebra;
+using namespace json_utility;
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " baseline.json current.json [threshold] [confidence] [all]" << std::endl;
+        return 2;
+    }
+    RegressionSettings settings;
+    settings.threshold = argc > 3 ? std::stod(argv[3]) : settings.threshold;
+    settings.confidence = argc > 4 ? std::stod(argv[4]) : settings.confidence;
+    const bool all = argc > 5 and std::string(argv[5]) == "all";
+
+    try
+    {
+        const RegressionReport report = compare_benchmarks(read_json(argv[1]), read_json(argv[2]), settings);
+        print_report(std::cout, report, all);
+        return report.passed() ? 0 : 1;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+}
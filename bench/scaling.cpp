@@ -0,0 +1,288 @@
+/**
+ * @file scaling.cpp
+ * @brief Thread-scaling benchmark of the parallel kernels of the library (`make scaling`).
+ *
+ * For two synthetic matrices (the 7-point Laplacian on a grid^3 grid and a random matrix of the same size
+ * with 7 non-zero elements per row) and for both storage orders, this program times compress_parallel and
+ * the matrix-vector product (SpMV) with the Parallel kernel for every number of threads 1, 2, 4, ... up to
+ * the number of available CPUs (limited with `tbb::global_control`) and for every pinning policy of
+ * topology.hpp (none, compact, scatter).
+ *
+ * The matrix-matrix product (SpGEMM) and the One, Infinity and Frobenius norms of the compressed format
+ * are serial: they are timed once, with one thread and no pinning, as reference for the other operations.
+ *
+ * The speedup and the parallel efficiency of every run are computed with respect to the run with one
+ * thread and the same pinning policy, and the achieved memory bandwidth follows the cost model of
+ * roofline.hpp (and is compared with the STREAM triad bandwidth with all the threads). The results are saved in:
+ * - `data/scaling.json`, with the entries of the schema of benchmark.hpp extended with the fields
+ *   "threads", "pinning", "speedup" and "efficiency" (schema "sparse-matrix-scaling", version 1), including
+ *   the allocations of every run counted by allocation_hooks.hpp;
+ * - `data/scaling.csv`, one row per run, ready to be plotted.
+ *
+ * Usage: `./bench/scaling [grid] [repetitions] [budget_ms] [output.json] [output.csv]`
+ */
+#include "matrix.hpp"
+#include "square_matrix.hpp"
+#include "generators.hpp"
+#include "benchmark.hpp"
+#include "roofline.hpp"
+#include "tuning_cache.hpp"
+#include "topology.hpp"
+#include "allocation_hooks.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <map>
+
+#include <tbb/global_control.h>
+
+using namespace algebra;
+
+/// @brief result of a run with a given number of threads and pinning policy
+struct ScalingResult
+{
+    BenchmarkResult result; /// result of the benchmark
+    size_t threads = 1;     /// maximum number of threads
+    Pinning pinning;        /// pinning policy
+    double speedup = 1;     /// speedup with respect to one thread
+    double efficiency = 1;  /// speedup divided by the number of threads
+};
+
+/// @brief print a result as a row of the summary table
+/// @param scaling result to print
+void print_row(const ScalingResult &scaling)
+{
+    const auto &result = scaling.result;
+    const RooflinePoint point = roofline(result.cost, result.time.median * 1e-9);
+    std::cout << std::left << std::setw(18) << result.operation
+              << std::setw(10) << pinning_name(scaling.pinning)
+              << std::right << std::setw(8) << scaling.threads
+              << std::setw(14) << std::fixed << std::setprecision(0) << result.time.median
+              << std::setw(10) << std::setprecision(2) << scaling.speedup
+              << std::setw(10) << scaling.efficiency
+              << std::setw(10) << std::setprecision(3) << point.gbs
+              << std::endl;
+}
+
+/// @brief numbers of threads of the sweep
+/// @param max_threads number of available CPUs
+/// @return 1, 2, 4, ... and max_threads
+std::vector<size_t> thread_counts(size_t max_threads)
+{
+    std::vector<size_t> counts;
+    for (size_t p = 1; p < max_threads; p *= 2)
+    {
+        counts.push_back(p);
+    }
+    counts.push_back(max_threads);
+    return counts;
+}
+
+/// @brief benchmark the parallel kernels on a matrix for every number of threads and pinning policy, and the serial operations once
+/// @tparam T type of the matrix elements
+/// @tparam S storage order
+/// @param name name of the matrix
+/// @param general matrix in compressed format
+/// @param topology topology of the machine
+/// @param benchmark benchmark settings
+/// @param results vector where the results are appended
+template <AddMulType T, StorageOrder S>
+void scale_matrix(const std::string &name, const Matrix<T, S> &general, const CpuTopology &topology,
+                  const Benchmark &benchmark, std::vector<ScalingResult> &results)
+{
+    constexpr bool column_major = (S == StorageOrder::ColumnMajor);
+    const std::string csr = column_major ? "CSC" : "CSR";
+    const size_t rows = general.get_rows();
+    const size_t cols = general.get_cols();
+    const size_t nnz = general.get_nnz();
+    const size_t major_size = column_major ? cols : rows;
+
+    std::vector<T> v(cols, T(1));
+    Matrix<T, S> m(general);
+    m.set_kernel(Kernel::Parallel);
+    Matrix<T, S> uncompressed(general);
+    uncompressed.uncompress();
+
+    // costs of the representations and of the operations
+    const double coo_bytes = storage_bytes(uncompressed);
+    const double csr_bytes = storage_bytes(general);
+    const size_t multiplications = count_multiplications(general, general);
+    const double product_bytes = storage_bytes<T>(csr, major_size, (general * general).get_nnz());
+
+    for (const auto &pinning : {Pinning::None, Pinning::Compact, Pinning::Scatter})
+    {
+        PinningObserver observer(topology, pinning);
+        std::map<std::string, double> serial_time; // time with one thread of every operation
+        for (const auto &threads : thread_counts(topology.size()))
+        {
+            tbb::global_control control(tbb::global_control::max_allowed_parallelism, threads);
+
+            auto record = [&](const std::string &operation, const std::string &format,
+                              const BenchmarkStatistics &time, const OperationCost &cost)
+            {
+                ScalingResult scaling{{name, operation, "Matrix", format, "Parallel",
+                                       column_major ? "ColumnMajor" : "RowMajor", value_type_name<T>(),
+                                       rows, cols, nnz, time, cost},
+                                      threads, pinning};
+                if (threads == 1)
+                {
+                    serial_time[operation] = time.median;
+                }
+                scaling.speedup = time.median > 0 ? serial_time[operation] / time.median : 0;
+                scaling.efficiency = scaling.speedup / threads;
+                print_row(scaling);
+                results.push_back(scaling);
+            };
+
+            // the setup restores the uncompressed matrix, without timing the copy
+            Matrix<T, S> c(0, 0);
+            record("compress_parallel", csr,
+                   benchmark.run([&]()
+                                 { c.compress_parallel(); },
+                                 [&]()
+                                 { c = Matrix<T, S>(uncompressed); }),
+                   {0, coo_bytes + csr_bytes});
+
+            record("spmv", csr, benchmark.run([&]()
+                                              { do_not_optimize(m * v); }),
+                   spmv_cost(m));
+        }
+    }
+
+    // the serial operations are not swept over the number of threads
+    tbb::global_control control(tbb::global_control::max_allowed_parallelism, 1);
+    auto record_serial = [&](const std::string &operation, const BenchmarkStatistics &time, const OperationCost &cost)
+    {
+        ScalingResult scaling{{name, operation, "Matrix", csr, "Serial",
+                               column_major ? "ColumnMajor" : "RowMajor", value_type_name<T>(),
+                               rows, cols, nnz, time, cost},
+                              1, Pinning::None};
+        print_row(scaling);
+        results.push_back(scaling);
+    };
+    record_serial("spgemm", benchmark.run([&]()
+                                          { do_not_optimize(m * m); }),
+                  spgemm_cost<T>(csr_bytes, csr_bytes, product_bytes, multiplications));
+
+    const OperationCost norm = norm_cost(m);
+    record_serial("norm_one", benchmark.run([&]()
+                                            { do_not_optimize(m.template norm<NormType::One>()); }),
+                  norm);
+    record_serial("norm_infinity", benchmark.run([&]()
+                                                 { do_not_optimize(m.template norm<NormType::Infinity>()); }),
+                  norm);
+    record_serial("norm_frobenius", benchmark.run([&]()
+                                                  { do_not_optimize(m.template norm<NormType::Frobenius>()); }),
+                  norm);
+}
+
+/// @brief run the sweep on a matrix in both storage orders
+/// @tparam Generator type of the callable generating the matrix
+/// @param name name of the matrix
+/// @param generate callable returning the matrix in the given storage order
+/// @param topology topology of the machine
+/// @param benchmark benchmark settings
+/// @param results vector where the results are appended
+template <typename Generator>
+void scale_generated(const std::string &name, Generator &&generate, const CpuTopology &topology,
+                     const Benchmark &benchmark, std::vector<ScalingResult> &results)
+{
+    for (const auto &order : {StorageOrder::RowMajor, StorageOrder::ColumnMajor})
+    {
+        std::cout << std::endl;
+        std::cout << "Scaling of " << name << " (" << (order == StorageOrder::RowMajor ? "RowMajor" : "ColumnMajor") << ")" << std::endl;
+        std::cout << std::left << std::setw(18) << "operation" << std::setw(10) << "pinning" << std::right
+                  << std::setw(8) << "threads" << std::setw(14) << "median [ns]" << std::setw(10) << "speedup"
+                  << std::setw(10) << "effic." << std::setw(10) << "GB/s" << std::endl;
+        if (order == StorageOrder::RowMajor)
+        {
+            const Matrix<double, StorageOrder::RowMajor> m = generate(std::integral_constant<StorageOrder, StorageOrder::RowMajor>());
+            scale_matrix(name, m, topology, benchmark, results);
+        }
+        else
+        {
+            const Matrix<double, StorageOrder::ColumnMajor> m = generate(std::integral_constant<StorageOrder, StorageOrder::ColumnMajor>());
+            scale_matrix(name, m, topology, benchmark, results);
+        }
+    }
+}
+
+/// @brief save the results in JSON format
+/// @param filename output file
+/// @param topology topology of the machine
+/// @param benchmark benchmark settings
+/// @param results results to save
+void save_scaling_json(const std::string &filename, const CpuTopology &topology, const Benchmark &benchmark,
+                       const std::vector<ScalingResult> &results)
+{
+    json_utility::json data = {{"schema", "sparse-matrix-scaling"},
+                               {"version", 1},
+                               {"machine", TuningCache::machine_key()},
+                               {"numa_nodes", topology.nodes},
+                               {"settings", benchmark.settings()},
+                               {"stream_gbs", to_json(machine_bandwidth())},
+                               {"results", json_utility::json::array()}};
+    for (const auto &scaling : results)
+    {
+        auto entry = to_json(scaling.result, machine_bandwidth().triad);
+        entry["threads"] = scaling.threads;
+        entry["pinning"] = pinning_name(scaling.pinning);
+        entry["speedup"] = scaling.speedup;
+        entry["efficiency"] = scaling.efficiency;
+        data["results"].push_back(entry);
+    }
+    json_utility::save_json(filename, data);
+}
+
+/// @brief save the results in CSV format, one row per run
+/// @param filename output file
+/// @param results results to save
+void save_scaling_csv(const std::string &filename, const std::vector<ScalingResult> &results)
+{
+    std::ofstream file(filename);
+    if (not file.is_open())
+    {
+        throw std::runtime_error("Unable to open file '" + filename + "'");
+    }
+    file << "matrix,storage_order,operation,format,pinning,threads,median_ns,speedup,efficiency,gflops,gbs,bandwidth_fraction" << std::endl;
+    for (const auto &scaling : results)
+    {
+        const auto &result = scaling.result;
+        const RooflinePoint point = roofline(result.cost, result.time.median * 1e-9);
+        file << result.matrix << ',' << result.storage_order << ',' << result.operation << ',' << result.format << ','
+             << pinning_name(scaling.pinning) << ',' << scaling.threads << ',' << result.time.median << ','
+             << scaling.speedup << ',' << scaling.efficiency << ','
+             << point.gflops << ',' << point.gbs << ',' << point.bandwidth_fraction << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const size_t grid = argc > 1 ? std::stoul(argv[1]) : 48;
+    const size_t repetitions = argc > 2 ? std::stoul(argv[2]) : 10;
+    const auto budget = std::chrono::milliseconds(argc > 3 ? std::stoul(argv[3]) : 1000);
+    const std::string json_output = argc > 4 ? argv[4] : "data/scaling.json";
+    const std::string csv_output = argc > 5 ? argv[5] : "data/scaling.csv";
+    const Benchmark benchmark(1, repetitions, budget);
+
+    const CpuTopology topology = CpuTopology::detect();
+    std::cout << "Machine: " << TuningCache::machine_key() << ", " << topology.nodes.size() << " NUMA node(s), "
+              << "STREAM triad " << machine_bandwidth().triad << " GB/s" << std::endl;
+
+    std::vector<ScalingResult> results;
+    const std::string size = std::to_string(grid);
+    scale_generated("poisson_3d(" + size + "^3)", [&](auto order)
+                    { return Matrix<double, decltype(order)::value>(poisson_3d<double, decltype(order)::value>(grid, grid, grid)); },
+                    topology, benchmark, results);
+    scale_generated("random_uniform(" + size + "^3, 7)", [&](auto order)
+                    { return random_uniform<double, decltype(order)::value>(grid * grid * grid, grid * grid * grid, 7); },
+                    topology, benchmark, results);
+
+    save_scaling_json(json_output, topology, benchmark, results);
+    save_scaling_csv(csv_output, results);
+    std::cout << std::endl;
+    std::cout << "Results saved in " << json_output << " and " << csv_output << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file differential.cpp
+ * @brief Randomized differential tester of the formats and kernels of the library (`make fuzz`).
+ *
+ * Every case is decoded from a buffer of pseudo-random bytes by differential.hpp, which generates the
+ * matrices, runs every product, norm and conversion in every format, storage order and kernel, and
+ * compares the results with a dense reference (one case in ten thousand is a large matrix, whose parallel
+ * conversions are compared with the serial ones). The program stops at the first failing case, prints the
+ * mismatches and the bytes of the case (to reproduce it), and exits with status 1.
+ *
+ * When compiled with `-DALGEBRA_LIBFUZZER -fsanitize=fuzzer` (`make fuzz-libfuzzer`, with clang), the file
+ * defines the entry point of libFuzzer instead of the main function, and a mismatch aborts the process.
+ *
+ * Usage: `./fuzz/differential [cases] [seed]`
+ */
+#include "differential.hpp"
+#include "generators.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+using namespace algebra;
+
+#ifdef ALGEBRA_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    DifferentialChecker checker;
+    run_differential(data, size, checker);
+    if (not checker.failures.empty())
+    {
+        for (const auto &failure : checker.failures)
+        {
+            std::cerr << failure << std::endl;
+        }
+        std::abort();
+    }
+    return 0;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+    const size_t cases = argc > 1 ? std::stoul(argv[1]) : 100000;
+    const uint64_t seed = argc > 2 ? std::stoull(argv[2]) : 42;
+
+    const auto start = std::chrono::steady_clock::now();
+    DifferentialChecker checker;
+    std::vector<uint8_t> bytes;
+    for (size_t i = 0; i < cases; i++)
+    {
+        // the length of the input varies, so that also the cases with exhausted bytes are generated; one
+        // case in ten thousand (starting from the first) is a large matrix, whose conversions split their
+        // work among the threads
+        SplitMix64 generator(seed, i);
+        bytes.resize(i % 10000 == 0 ? 8 * large_input_bytes : generator() % 1024);
+        for (auto &byte : bytes)
+        {
+            byte = static_cast<uint8_t>(generator());
+        }
+        run_differential(bytes.data(), bytes.size(), checker);
+        if (not checker.failures.empty())
+        {
+            std::cout << "Case " << i << " (seed " << seed << ") failed:" << std::endl;
+            for (const auto &failure : checker.failures)
+            {
+                std::cout << "  " << failure << std::endl;
+            }
+            if (bytes.size() >= large_input_bytes)
+            {
+                // the bytes of a large case are not printed: it is reproduced by the case number and the seed
+                std::cout << "Input bytes: " << bytes.size() << " (large case)" << std::endl;
+                return 1;
+            }
+            std::cout << "Input bytes:";
+            for (const auto &byte : bytes)
+            {
+                std::cout << " " << static_cast<int>(byte);
+            }
+            std::cout << std::endl;
+            return 1;
+        }
+        if ((i + 1) % 10000 == 0)
+        {
+            std::cout << i + 1 << " cases passed" << std::endl;
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << cases << " cases (" << checker.checks << " checks) passed in " << std::fixed << std::setprecision(1)
+              << seconds << " s" << std::endl;
+    return 0;
+}
+
+#endif
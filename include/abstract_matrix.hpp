@@ -150,6 +150,10 @@ namespace algebra
         /// @brief get the number of non-zero elements
         /// @return number of non-zero elements
         virtual size_t get_nnz() const = 0;
+
+        /// @brief get the bytes used by each component of the storage
+        /// @return memory usage of the storage (of the underlying matrix, for the views)
+        virtual MemoryUsage memory_usage() const = 0;
     };
 }
 #endif // ABSTRACT_MATRIX_HPP
\ No newline at end of file
@@ -0,0 +1,129 @@
+/**
+ * @file allocation_hooks.hpp
+ * @brief Replaces the global operator new and operator delete to count the heap allocations.
+ *
+ * The replacement functions allocate with malloc (or aligned_alloc) and update the counters of
+ * heap_profile.hpp with relaxed atomic operations, so that they can be used by all the threads.
+ * Every allocation of the program is counted: the ones of the standard containers, of TBB and of the
+ * library alike.
+ *
+ * The replacement functions are never inlined, so that the compiler does not match the malloc and free
+ * calls in their bodies against the new and delete expressions of the callers.
+ *
+ * @warning This header defines non-inline functions: it must be included in exactly one translation
+ *          unit of a program (the benchmarks include it in their main file).
+ *
+ * @see heap_profile.hpp
+ */
+#ifndef ALLOCATION_HOOKS_HPP
+#define ALLOCATION_HOOKS_HPP
+
+#include "heap_profile.hpp"
+
+#include <new>
+#include <cstdlib>
+
+namespace algebra
+{
+    /// @brief count an allocation
+    /// @param pointer allocated memory (nullptr if the allocation failed)
+    /// @param size requested bytes
+    /// @return the pointer
+    inline void *count_allocation(void *pointer, size_t size)
+    {
+        if (pointer)
+        {
+            HeapCounters::allocations.fetch_add(1, std::memory_order_relaxed);
+            HeapCounters::bytes.fetch_add(size, std::memory_order_relaxed);
+        }
+        return pointer;
+    }
+
+    /// @brief count a deallocation
+    /// @param pointer memory to free
+    inline void count_deallocation(void *pointer)
+    {
+        if (pointer)
+        {
+            HeapCounters::deallocations.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief mark the counters as active before main is called
+    static const bool allocation_hooks_installed = (HeapCounters::interposed = true);
+}
+
+[[gnu::noinline]] void *operator new(size_t size)
+{
+    void *pointer = algebra::count_allocation(std::malloc(size ? size : 1), size);
+    if (not pointer)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+[[gnu::noinline]] void *operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+
+[[gnu::noinline]] void *operator new(size_t size, std::align_val_t alignment)
+{
+    const size_t align = static_cast<size_t>(alignment);
+    // aligned_alloc requires a size multiple of the alignment
+    void *pointer = algebra::count_allocation(std::aligned_alloc(align, (size + align - 1) / align * align), size);
+    if (not pointer)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+[[gnu::noinline]] void *operator new[](size_t size, std::align_val_t alignment)
+{
+    return ::operator new(size, alignment);
+}
+
+[[gnu::noinline]] void operator delete(void *pointer) noexcept
+{
+    algebra::count_deallocation(pointer);
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void *pointer) noexcept
+{
+    ::operator delete(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void *pointer, size_t) noexcept
+{
+    ::operator delete(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void *pointer, size_t) noexcept
+{
+    ::operator delete(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void *pointer, std::align_val_t) noexcept
+{
+    ::operator delete(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void *pointer, std::align_val_t) noexcept
+{
+    ::operator delete(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void *pointer, size_t, std::align_val_t) noexcept
+{
+    ::operator delete(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void *pointer, size_t, std::align_val_t) noexcept
+{
+    ::operator delete(pointer);
+}
+
+#endif // ALLOCATION_HOOKS_HPP
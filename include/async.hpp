@@ -0,0 +1,418 @@
+/**
+ * @file async.hpp
+ * @brief Defines the asynchronous operations: futures whose continuations run on the TBB worker threads.
+ *
+ * An algebra::Future holds the result of an operation running in the background. Instead of waiting for
+ * it, a continuation is attached with then(): when the result is ready the continuation is enqueued in
+ * the task arena (the shared one, or the one of an algebra::ExecutionContext), so that no thread is
+ * blocked while the dependencies of an operation are not ready. Independent pipelines run concurrently
+ * on the worker threads, and the exceptions are propagated along the chain to get().
+ *
+ * The asynchronous variants of the operations of the matrices work on `std::shared_ptr` of matrices, so
+ * that every step of a pipeline modifies the same matrix in place and no copy is made:
+ * @code{.cpp}
+ * using M = SquareMatrix<double, StorageOrder::RowMajor>;
+ * auto a = compress_mod_async(read_async(std::make_shared<M>(0), "data/lnsp_131.mtx"));
+ * auto b = compress_async(read_async(std::make_shared<M>(0), "data/lns_131.mtx"));
+ * Future<std::vector<double>> y = multiply_async(a, x);  // read -> compress_mod -> SpMV
+ * Future<std::shared_ptr<M>> c = multiply_async(a, b);   // waits for both pipelines
+ * std::cout << y.get()[0] << ' ' << c.get()->get_nnz() << std::endl;
+ * @endcode
+ *
+ * @note A future can have more than one continuation, which run concurrently: the continuations of a
+ *       matrix may read it together (products, norms), but only one of them may modify it.
+ * @note get() and wait() block the calling thread: call them from the main thread, not from a continuation.
+ * @note The enqueued tasks are not waited for at the end of the program: get() the last futures of every
+ *       pipeline before returning from main.
+ *
+ * @see execution_context.hpp
+ */
+#ifndef ASYNC_HPP
+#define ASYNC_HPP
+
+#include "execution_context.hpp"
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <functional>
+#include <exception>
+#include <stdexcept>
+#include <atomic>
+#include <tuple>
+#include <string>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+#include <tbb/task_arena.h>
+
+namespace algebra
+{
+    /// @brief run a task in the background, without waiting for it
+    /// @param task task to run
+    /// @param context execution context of the task (nullptr for the shared task arena)
+    inline void enqueue_task(std::function<void()> task, const std::shared_ptr<ExecutionContext> &context)
+    {
+        if (context)
+        {
+            context->enqueue(std::move(task));
+            return;
+        }
+        static tbb::task_arena shared;
+        shared.enqueue(std::move(task));
+    }
+
+    template <typename R>
+    class Future;
+
+    /// @brief type of the future returned by an asynchronous function
+    template <typename F, typename... Args>
+    using FutureOf = Future<std::decay_t<std::invoke_result_t<F, Args...>>>;
+
+    template <typename F>
+    FutureOf<F> async(F &&function, std::shared_ptr<ExecutionContext> context = nullptr);
+
+    template <typename F, typename... Rs>
+    FutureOf<F, Rs &...> when_all(F &&function, std::shared_ptr<ExecutionContext> context, const Future<Rs> &...futures);
+
+    /**
+     * @brief Result of an asynchronous operation, available when the operation completes.
+     *
+     * The copies of a future share the same result.
+     *
+     * @tparam R type of the result
+     */
+    template <typename R>
+    class Future
+    {
+        static_assert(not std::is_void_v<R> and not std::is_reference_v<R>, "The result must be a value");
+
+    public:
+        /// @brief default constructor, the future is not valid
+        Future() = default;
+
+        /// @brief future of a value that is already available
+        /// @param value result
+        /// @return a ready future
+        static Future ready(R value)
+        {
+            Future future(std::make_shared<State>());
+            future.set_value(std::move(value));
+            return future;
+        }
+
+        /// @brief check if the future refers to an operation
+        /// @return true if the future is valid
+        bool valid() const { return state != nullptr; };
+
+        /// @brief check if the operation has completed
+        /// @return true if the result or an exception is available
+        bool is_ready() const
+        {
+            require_valid();
+            std::lock_guard lock(state->mutex);
+            return state->ready;
+        }
+
+        /// @brief block the calling thread until the operation completes
+        void wait() const
+        {
+            require_valid();
+            std::unique_lock lock(state->mutex);
+            state->condition.wait(lock, [this]()
+                                  { return state->ready; });
+        }
+
+        /// @brief get the result, blocking the calling thread until the operation completes
+        /// @return reference to the result, shared by all the copies of the future
+        /// @throws the exception thrown by the operation or by one of its dependencies
+        R &get() const
+        {
+            wait();
+            if (state->error)
+            {
+                std::rethrow_exception(state->error);
+            }
+            return *state->value;
+        }
+
+        /// @brief run a function on the result when it is available, without blocking
+        /// @tparam F callable with a reference to the result
+        /// @param function continuation
+        /// @param context execution context of the continuation (nullptr for the shared task arena)
+        /// @return future of the value returned by the continuation
+        template <typename F>
+        FutureOf<F, R &> then(F &&function, std::shared_ptr<ExecutionContext> context = nullptr) const
+        {
+            return when_all(std::forward<F>(function), std::move(context), *this);
+        }
+
+        template <typename F>
+        friend FutureOf<F> async(F &&function, std::shared_ptr<ExecutionContext> context);
+
+        template <typename F, typename... Rs>
+        friend FutureOf<F, Rs &...> when_all(F &&function, std::shared_ptr<ExecutionContext> context, const Future<Rs> &...futures);
+
+        template <typename U>
+        friend class Future;
+
+    private:
+        /**
+         * @brief State shared by the copies of a future and by the task that completes it.
+         */
+        struct State
+        {
+            std::mutex mutex;                                 /// protects the other members
+            std::condition_variable condition;                /// notified when the operation completes
+            bool ready = false;                               /// true when the result or the error is set
+            std::optional<R> value;                           /// result of the operation
+            std::exception_ptr error;                         /// exception thrown by the operation
+            std::vector<std::function<void()>> continuations; /// functions to call when the operation completes
+        };
+
+        std::shared_ptr<State> state; /// shared state
+
+        /// @brief constructor
+        /// @param state shared state
+        explicit Future(std::shared_ptr<State> state) : state(std::move(state)){};
+
+        /// @brief check that the future is valid
+        /// @throws std::logic_error if the future does not refer to an operation
+        void require_valid() const
+        {
+            if (not state)
+            {
+                throw std::logic_error("The future does not refer to an operation");
+            }
+        }
+
+        /// @brief complete the operation with a result
+        /// @param result result of the operation
+        void set_value(R result) const
+        {
+            {
+                std::lock_guard lock(state->mutex);
+                state->value.emplace(std::move(result));
+            }
+            complete();
+        }
+
+        /// @brief complete the operation with an exception
+        /// @param exception exception thrown by the operation
+        void set_error(std::exception_ptr exception) const
+        {
+            {
+                std::lock_guard lock(state->mutex);
+                state->error = std::move(exception);
+            }
+            complete();
+        }
+
+        /// @brief mark the operation as completed, wake the waiting threads and call the continuations
+        void complete() const
+        {
+            std::vector<std::function<void()>> continuations;
+            {
+                std::lock_guard lock(state->mutex);
+                state->ready = true;
+                continuations.swap(state->continuations);
+            }
+            state->condition.notify_all();
+            for (auto &continuation : continuations)
+            {
+                continuation();
+            }
+        }
+
+        /// @brief call a function when the operation completes (immediately if it has already completed)
+        /// @param callback function to call, it must not block
+        void on_ready(std::function<void()> callback) const
+        {
+            {
+                std::lock_guard lock(state->mutex);
+                if (not state->ready)
+                {
+                    state->continuations.push_back(std::move(callback));
+                    return;
+                }
+            }
+            callback();
+        }
+
+        /// @brief get the exception of a completed operation
+        /// @return the exception, nullptr if the operation succeeded
+        std::exception_ptr error() const
+        {
+            std::lock_guard lock(state->mutex);
+            return state->error;
+        }
+
+        /// @brief complete the operation with the value returned by a function, or with its exception
+        /// @param function function computing the result
+        template <typename F>
+        void fulfill(F &function) const
+        {
+            try
+            {
+                set_value(function());
+            }
+            catch (...)
+            {
+                set_error(std::current_exception());
+            }
+        }
+    };
+
+    /// @brief run a function in the background
+    /// @tparam F callable without arguments
+    /// @param function function to run
+    /// @param context execution context of the function (nullptr for the shared task arena)
+    /// @return future of the value returned by the function
+    template <typename F>
+    FutureOf<F> async(F &&function, std::shared_ptr<ExecutionContext> context)
+    {
+        using Result = FutureOf<F>;
+        const Result future(std::make_shared<typename Result::State>());
+        enqueue_task([future, function = std::forward<F>(function)]() mutable
+                     { future.fulfill(function); },
+                     context);
+        return future;
+    }
+
+    /// @brief run a function on the results of several futures when they are all available, without blocking
+    /// @tparam F callable with references to the results
+    /// @param function continuation
+    /// @param context execution context of the continuation (nullptr for the shared task arena)
+    /// @param futures dependencies
+    /// @return future of the value returned by the continuation (or of the first exception of the dependencies)
+    template <typename F, typename... Rs>
+    FutureOf<F, Rs &...> when_all(F &&function, std::shared_ptr<ExecutionContext> context, const Future<Rs> &...futures)
+    {
+        static_assert(sizeof...(Rs) > 0, "At least one dependency is required");
+        using Result = FutureOf<F, Rs &...>;
+        (futures.require_valid(), ...);
+        const Result future(std::make_shared<typename Result::State>());
+
+        // the last dependency to complete enqueues the continuation
+        auto pending = std::make_shared<std::atomic<size_t>>(sizeof...(Rs));
+        auto launch = [future, pending, context, function = std::forward<F>(function), futures...]() mutable
+        {
+            if (pending->fetch_sub(1, std::memory_order_acq_rel) != 1)
+            {
+                return;
+            }
+            enqueue_task(
+                [future, function = std::move(function), futures...]() mutable
+                {
+                    for (const auto &error : {futures.error()...})
+                    {
+                        if (error)
+                        {
+                            future.set_error(error);
+                            return;
+                        }
+                    }
+                    auto call = [&]()
+                    { return function(*futures.state->value...); };
+                    future.fulfill(call);
+                },
+                context);
+        };
+        auto shared_launch = std::make_shared<decltype(launch)>(std::move(launch));
+        (futures.on_ready([shared_launch]()
+                          { (*shared_launch)(); }),
+         ...);
+        return future;
+    }
+
+    /// @brief type of the future of a matrix
+    /// @tparam M type of the matrix
+    template <typename M>
+    using MatrixFuture = Future<std::shared_ptr<M>>;
+
+    /// @brief trait to detect the futures
+    template <typename T>
+    struct is_future : std::false_type
+    {
+    };
+
+    /// @brief specialization for the futures
+    template <typename R>
+    struct is_future<Future<R>> : std::true_type
+    {
+    };
+
+    /// @brief make a future of a value, ready if it is not already a future
+    /// @param value value or future
+    /// @return the future (the same one if the value is a future)
+    template <typename R>
+    auto as_future(R &&value)
+    {
+        if constexpr (is_future<std::decay_t<R>>::value)
+        {
+            return std::decay_t<R>(std::forward<R>(value));
+        }
+        else
+        {
+            return Future<std::decay_t<R>>::ready(std::forward<R>(value));
+        }
+    }
+
+    /// @brief read a matrix from a Matrix Market file in the background
+    /// @tparam M type of the matrix
+    /// @param matrix matrix to read into (or future of it)
+    /// @param filename name of the file
+    /// @return future of the matrix, available when it is read
+    template <typename M>
+    auto read_async(M &&matrix, std::string filename)
+    {
+        return as_future(std::forward<M>(matrix)).then([filename = std::move(filename)](auto &m)
+                                                       { m->reader(filename); return m; });
+    }
+
+    /// @brief compress a matrix in the background, when it is available
+    /// @param matrix matrix (or future of it)
+    /// @return future of the matrix, available when it is compressed
+    template <typename M>
+    auto compress_async(M &&matrix)
+    {
+        return as_future(std::forward<M>(matrix)).then([](auto &m)
+                                                       { m->compress(); return m; });
+    }
+
+    /// @brief compress a square matrix in the modified compressed format in the background, when it is available
+    /// @param matrix matrix (or future of it)
+    /// @return future of the matrix, available when it is compressed
+    template <typename M>
+    auto compress_mod_async(M &&matrix)
+    {
+        return as_future(std::forward<M>(matrix)).then([](auto &m)
+                                                       { m->compress_mod(); return m; });
+    }
+
+    /// @brief multiply a matrix by a vector (SpMV) or by a matrix (SpGEMM) in the background, when both are available
+    /// @param left matrix (or future of it)
+    /// @param right vector or matrix (or future of it)
+    /// @return future of the product: a vector, or a shared pointer to the product matrix
+    template <typename M, typename V>
+    auto multiply_async(M &&left, V &&right)
+    {
+        return when_all(
+            [](auto &m, auto &x)
+            {
+                if constexpr (requires { *m * *x; })
+                {
+                    return std::make_shared<std::decay_t<decltype(*m * *x)>>(*m * *x);
+                }
+                else
+                {
+                    return *m * x;
+                }
+            },
+            nullptr, as_future(std::forward<M>(left)), as_future(std::forward<V>(right)));
+    }
+}
+
+#endif // ASYNC_HPP
@@ -0,0 +1,173 @@
+/**
+ * @file auto_tuner.hpp
+ * @brief Defines the automatic selection of the compressed format and of the product kernel of a matrix.
+ *
+ * This header provides the algebra::AutoTuner class, which briefly benchmarks the matrix-vector product
+ * of a matrix for every candidate combination of compressed format (CSR/CSC and, for square matrices,
+ * MSR/MSC) and kernel (serial or parallel) on the actual matrix and machine, and the algebra::compress_auto
+ * function, which compresses a matrix in the fastest representation found by the tuner.
+ *
+ * The candidates are pruned with the features computed by algebra::analyze_pattern: the parallel kernel is
+ * benchmarked only when the matrix is large enough to amortize the cost of spawning the tasks and more
+ * than one thread is available.
+ *
+ * @see pattern_analyzer.hpp
+ * @see Matrix
+ * @see SquareMatrix
+ */
+#ifndef AUTO_TUNER_HPP
+#define AUTO_TUNER_HPP
+
+#include "storage.hpp"
+#include "matrix.hpp"
+#include "square_matrix.hpp"
+#include "pattern_analyzer.hpp"
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <tbb/task_arena.h>
+
+namespace algebra
+{
+    /**
+     * @brief Timing of one candidate representation of a matrix.
+     */
+    struct TuningCandidate
+    {
+        CompressedFormat format; /// compressed format of the candidate
+        Kernel kernel;           /// kernel of the candidate
+        double spmv_time_ns;     /// median execution time of the matrix-vector product in nanoseconds
+    };
+
+    /**
+     * @brief Representation of a matrix chosen by the AutoTuner.
+     */
+    struct TuningDecision
+    {
+        CompressedFormat format = CompressedFormat::Compressed; /// fastest compressed format
+        Kernel kernel = Kernel::Serial;                         /// fastest kernel
+        SparsityPattern pattern;                                /// features of the sparsity pattern of the matrix
+        std::vector<TuningCandidate> candidates;                /// timings of all the benchmarked candidates
+    };
+
+    /**
+     * @brief Benchmarks the candidate representations of a matrix and chooses the fastest one.
+     *
+     * Every candidate is timed on a copy of the matrix, so the tuned matrix is never modified. Each
+     * matrix-vector product is repeated until either the number of repetitions or the time budget of
+     * the candidate is exhausted, after one warmup run, and the median time is compared.
+     */
+    class AutoTuner
+    {
+    public:
+        /// @brief constructor
+        /// @param repetitions maximum number of timed products per candidate
+        /// @param budget maximum time spent on the timed products of each candidate
+        /// @param parallel_threshold minimum number of non-zero elements to benchmark the parallel kernel
+        AutoTuner(size_t repetitions = 10,
+                  std::chrono::nanoseconds budget = std::chrono::milliseconds(50),
+                  size_t parallel_threshold = 20000)
+            : repetitions(repetitions), budget(budget), parallel_threshold(parallel_threshold) {};
+
+        /// @brief benchmark the candidate representations of a matrix
+        /// @tparam T type of the matrix elements
+        /// @tparam S storage order of the matrix
+        /// @param m matrix to tune (in any format)
+        /// @return the fastest representation and the timings of all candidates
+        template <AddMulType T, StorageOrder S>
+        TuningDecision tune(const Matrix<T, S> &m) const
+        {
+            TuningDecision decision;
+
+            // work on a copy of the matrix (keeping its dynamic type)
+            auto copy = m.clone();
+            auto &work = static_cast<Matrix<T, S> &>(*copy);
+            const auto *square = dynamic_cast<const SquareMatrix<T, S> *>(&work);
+
+            work.compress(CompressedFormat::Compressed);
+            decision.pattern = analyze_pattern(work);
+
+            std::vector<CompressedFormat> formats = {CompressedFormat::Compressed};
+            if (square)
+            {
+                formats.push_back(CompressedFormat::ModifiedCompressed);
+            }
+            std::vector<Kernel> kernels = {Kernel::Serial};
+            if (decision.pattern.nnz >= parallel_threshold and tbb::this_task_arena::max_concurrency() > 1)
+            {
+                kernels.push_back(Kernel::Parallel);
+            }
+
+            const std::vector<T> v(work.get_cols(), T(1));
+            for (const auto &format : formats)
+            {
+                work.compress(format);
+                for (const auto &kernel : kernels)
+                {
+                    work.set_kernel(kernel);
+                    double time = square ? time_product(*square, v) : time_product(work, v);
+                    decision.candidates.push_back({format, kernel, time});
+                }
+            }
+
+            const auto fastest = std::min_element(decision.candidates.begin(), decision.candidates.end(),
+                                                  [](const TuningCandidate &a, const TuningCandidate &b)
+                                                  { return a.spmv_time_ns < b.spmv_time_ns; });
+            decision.format = fastest->format;
+            decision.kernel = fastest->kernel;
+            return decision;
+        }
+
+    private:
+        size_t repetitions;              /// maximum number of timed products per candidate
+        std::chrono::nanoseconds budget; /// maximum time spent on the timed products of each candidate
+        size_t parallel_threshold;       /// minimum number of non-zero elements to benchmark the parallel kernel
+
+        /// @brief median execution time of the product between a matrix and a vector
+        /// @tparam M type of the matrix
+        /// @tparam T type of the vector elements
+        /// @param m matrix
+        /// @param v vector
+        /// @return median time in nanoseconds
+        template <typename M, AddMulType T>
+        double time_product(const M &m, const std::vector<T> &v) const
+        {
+            using Clock = std::chrono::steady_clock;
+
+            // warmup
+            auto result = m * v;
+
+            std::vector<double> times;
+            const auto deadline = Clock::now() + budget;
+            do
+            {
+                const auto start = Clock::now();
+                result = m * v;
+                const auto stop = Clock::now();
+                times.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+            } while (times.size() < repetitions and Clock::now() < deadline);
+
+            std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+            return times[times.size() / 2];
+        }
+    };
+
+    /// @brief compress a matrix in the fastest representation found by the tuner
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order of the matrix
+    /// @param m matrix to compress
+    /// @param tuner tuner used to benchmark the candidate representations
+    /// @return the decision applied to the matrix
+    template <AddMulType T, StorageOrder S>
+    TuningDecision compress_auto(Matrix<T, S> &m, const AutoTuner &tuner = AutoTuner())
+    {
+        TuningDecision decision = tuner.tune(m);
+        m.compress(decision.format);
+        m.set_kernel(decision.kernel);
+        return decision;
+    }
+}
+
+#endif // AUTO_TUNER_HPP
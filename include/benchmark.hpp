@@ -0,0 +1,417 @@
+/**
+ * @file benchmark.hpp
+ * @brief Defines the utilities of the structured benchmark suite (`make bench`).
+ *
+ * This header provides:
+ * - algebra::Benchmark, which times an operation with warmup runs, a number of repetitions and a time
+ *   budget, optionally running an untimed setup before every repetition;
+ * - algebra::BenchmarkStatistics, the order statistics (min, percentiles, median, max, mean, standard
+ *   deviation) of the measured times, together with the allocations and the peak RSS delta of the runs
+ *   (see heap_profile.hpp: the allocations are counted only if allocation_hooks.hpp is linked);
+ * - algebra::BenchmarkResult and algebra::save_benchmark, which serialize the results in a stable JSON schema,
+ *   together with their position on the memory roofline (see roofline.hpp for the cost model).
+ *
+ * Two files with this schema can be compared with regression.hpp, which flags the operations that are
+ * significantly slower than in a stored baseline.
+ *
+ * The JSON file written by algebra::save_benchmark has the following schema (version 3):
+ * @code{.json}
+ * {
+ *     "schema": "sparse-matrix-benchmark",
+ *     "version": 3,
+ *     "machine": "<cpu model> (<threads> threads)",
+ *     "settings": { "warmup": 2, "repetitions": 20, "min_repetitions": 1, "budget_ms": 1000, "max_time_ms": null, "huge_pages": "transparent" },
+ *     "stream_gbs": { "copy": ..., "scale": ..., "add": ..., "triad": ..., "elements": ..., "threads": ... },
+ *     "results": [
+ *         {
+ *             "matrix": "lnsp_131.mtx",        // name of the matrix file
+ *             "operation": "spmv",             // reader, compress, compress_parallel, compress_mod, uncompress,
+ *                                              // spmv, spgemm, norm_one, norm_infinity, norm_frobenius
+ *             "class": "SquareMatrix",         // Matrix, SquareMatrix, TransposeView, DiagonalView
+ *             "format": "MSR",                 // COO, CSR, CSC, MSR, MSC (format of the operand(s))
+ *             "kernel": "Serial",              // Serial, Parallel
+ *             "storage_order": "RowMajor",     // RowMajor, ColumnMajor
+ *             "value_type": "double",
+ *             "rows": 131, "cols": 131, "nnz": 536,
+ *             "repetitions": 20,               // number of timed repetitions
+ *             "time_ns": { "min": ..., "p10": ..., "median": ..., "p90": ..., "max": ..., "mean": ..., "stddev": ... },
+ *             "memory": {                      // per timed repetition (allocations are null if not counted)
+ *                 "allocations": ..., "deallocations": ..., "bytes_allocated": ..., "peak_rss_delta": ...
+ *             },
+ *             "flops": ...,                    // floating point operations of one repetition
+ *             "bytes": ...,                    // compulsory memory traffic of one repetition
+ *             "gflops": ...,                   // flops / median time
+ *             "gbs": ...,                      // bytes / median time
+ *             "arithmetic_intensity": ...,     // flops / bytes
+ *             "attainable_gflops": ...,        // arithmetic_intensity * stream_gbs.triad
+ *             "bandwidth_fraction": ...        // gbs / stream_gbs.triad
+ *         }
+ *     ]
+ * }
+ * @endcode
+ *
+ * @see bench/bench.cpp
+ * @see roofline.hpp
+ * @see regression.hpp
+ * @see json_utility.hpp
+ */
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include "storage.hpp"
+#include "matrix.hpp"
+#include "roofline.hpp"
+#include "json_utility.hpp"
+#include "heap_profile.hpp"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+
+namespace algebra
+{
+    /**
+     * @brief Order statistics of the execution times of an operation (in nanoseconds), and its memory statistics.
+     */
+    struct BenchmarkStatistics
+    {
+        size_t repetitions = 0;  /// number of timed repetitions
+        double min = 0;          /// minimum time
+        double p10 = 0;          /// 10th percentile
+        double median = 0;       /// median time
+        double p90 = 0;          /// 90th percentile
+        double max = 0;          /// maximum time
+        double mean = 0;         /// mean time
+        double stddev = 0;       /// standard deviation
+        MemoryStatistics memory; /// allocations and peak RSS delta of the timed runs
+    };
+
+    /**
+     * @brief Result of the benchmark of an operation (one entry of the "results" array of the JSON schema).
+     */
+    struct BenchmarkResult
+    {
+        std::string matrix;        /// name of the matrix file
+        std::string operation;     /// benchmarked operation
+        std::string matrix_class;  /// class of the operand(s)
+        std::string format;        /// format of the operand(s)
+        std::string kernel;        /// kernel of the product
+        std::string storage_order; /// storage order of the operand(s)
+        std::string value_type;    /// type of the matrix elements
+        size_t rows = 0;           /// number of rows of the (first) operand
+        size_t cols = 0;           /// number of columns of the (first) operand
+        size_t nnz = 0;            /// number of non-zero elements of the (first) operand
+        BenchmarkStatistics time;  /// statistics of the execution times
+        OperationCost cost;        /// cost of one execution
+    };
+
+    /// @brief prevent the compiler from optimizing away the computation of a value
+    /// @tparam V type of the value
+    /// @param value value to keep
+    template <typename V>
+    inline void do_not_optimize(const V &value)
+    {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+
+    /// @brief compute the percentile of sorted samples (with linear interpolation)
+    /// @param sorted samples in ascending order
+    /// @param p percentile in [0, 100]
+    /// @return the percentile
+    inline double percentile(const std::vector<double> &sorted, double p)
+    {
+        if (sorted.empty())
+        {
+            return 0;
+        }
+        const double position = p / 100.0 * (sorted.size() - 1);
+        const size_t below = static_cast<size_t>(std::floor(position));
+        const size_t above = std::min(below + 1, sorted.size() - 1);
+        return sorted[below] + (position - below) * (sorted[above] - sorted[below]);
+    }
+
+    /// @brief compute the statistics of a set of samples
+    /// @param samples execution times in nanoseconds
+    /// @return the statistics of the samples
+    inline BenchmarkStatistics compute_statistics(std::vector<double> samples)
+    {
+        BenchmarkStatistics stats;
+        stats.repetitions = samples.size();
+        if (samples.empty())
+        {
+            return stats;
+        }
+        std::sort(samples.begin(), samples.end());
+        stats.min = samples.front();
+        stats.p10 = percentile(samples, 10);
+        stats.median = percentile(samples, 50);
+        stats.p90 = percentile(samples, 90);
+        stats.max = samples.back();
+        stats.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+        double variance = 0;
+        for (const auto &sample : samples)
+        {
+            variance += (sample - stats.mean) * (sample - stats.mean);
+        }
+        stats.stddev = samples.size() > 1 ? std::sqrt(variance / (samples.size() - 1)) : 0;
+        return stats;
+    }
+
+    /**
+     * @brief Times an operation with warmup runs, repetitions and a time budget.
+     *
+     * Each operation is run `warmup` times without being timed, then it is timed until either
+     * `repetitions` samples have been collected or the time budget is exhausted. At least
+     * `min_repetitions` samples are collected beyond the budget, as long as they are expected to take
+     * no more than `max_time` (estimated from the samples collected so far): slower operations stop at
+     * the budget, and regression.hpp reports them as inconclusive instead of stalling the gate. With the
+     * default minimum of one sample, an operation whose warmup run alone exceeds the budget is not
+     * repeated, and the warmup run is taken as its only sample; a larger minimum (needed by the confidence
+     * intervals of regression.hpp) skips the remaining warmup runs instead, unless the operation is too
+     * slow for the minimum within `max_time`.
+     */
+    class Benchmark
+    {
+    public:
+        /// @brief constructor
+        /// @param warmup number of untimed runs before the timed ones
+        /// @param repetitions maximum number of timed runs
+        /// @param budget maximum time spent on the timed runs of each operation
+        /// @param min_repetitions minimum number of timed runs, collected even beyond the budget
+        /// @param max_time maximum time of the minimum number of timed runs of each operation (no limit by default)
+        Benchmark(size_t warmup = 2, size_t repetitions = 20,
+                  std::chrono::nanoseconds budget = std::chrono::seconds(1), size_t min_repetitions = 1,
+                  std::chrono::nanoseconds max_time = std::chrono::nanoseconds::max())
+            : warmup(warmup), repetitions(std::max(repetitions, min_repetitions)), budget(budget),
+              min_repetitions(std::max<size_t>(min_repetitions, 1)), max_time(max_time) {};
+
+        /// @brief time an operation
+        /// @tparam Operation type of the callable to time
+        /// @tparam Setup type of the callable to run before every run (not timed)
+        /// @param operation callable to time
+        /// @param setup callable that restores the state required by the operation
+        /// @return the statistics of the execution times
+        template <typename Operation, typename Setup>
+        BenchmarkStatistics run(Operation &&operation, Setup &&setup) const
+        {
+            using Clock = std::chrono::steady_clock;
+
+            std::vector<double> samples;
+            samples.reserve(repetitions);
+
+            auto deadline = Clock::now() + budget;
+            for (size_t i = 0; i < warmup; i++)
+            {
+                setup();
+                MemoryProbe probe;
+                probe.start();
+                const auto start = Clock::now();
+                operation();
+                const auto stop = Clock::now();
+                probe.stop();
+                if (stop > deadline)
+                {
+                    if (min_repetitions > 1 and affordable(std::chrono::duration<double, std::nano>(stop - start).count()))
+                    {
+                        // the samples are collected anyway: the remaining warmup runs are skipped
+                        break;
+                    }
+                    // an operation slower than the whole budget is not repeated: the warmup run is its only sample
+                    samples.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+                    BenchmarkStatistics stats = compute_statistics(std::move(samples));
+                    stats.memory = probe.statistics();
+                    return stats;
+                }
+            }
+
+            // the probe runs outside the timed region, after the setup
+            MemoryProbe probe;
+            deadline = Clock::now() + budget;
+            double total = 0;
+            do
+            {
+                setup();
+                probe.start();
+                const auto start = Clock::now();
+                operation();
+                const auto stop = Clock::now();
+                probe.stop();
+                samples.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+                total += samples.back();
+            } while ((samples.size() < min_repetitions and affordable(total / samples.size())) or
+                     (samples.size() < repetitions and Clock::now() < deadline));
+
+            BenchmarkStatistics stats = compute_statistics(std::move(samples));
+            stats.memory = probe.statistics();
+            return stats;
+        }
+
+        /// @brief time an operation that does not need a setup
+        /// @tparam Operation type of the callable to time
+        /// @param operation callable to time
+        /// @return the statistics of the execution times
+        template <typename Operation>
+        BenchmarkStatistics run(Operation &&operation) const
+        {
+            return run(std::forward<Operation>(operation), []() {});
+        }
+
+        /// @brief get the settings of the benchmark
+        /// @return JSON object with the settings
+        json_utility::json settings() const
+        {
+            return {{"warmup", warmup},
+                    {"repetitions", repetitions},
+                    {"min_repetitions", min_repetitions},
+                    {"budget_ms", std::chrono::duration<double, std::milli>(budget).count()},
+                    {"max_time_ms", max_time == std::chrono::nanoseconds::max()
+                                        ? json_utility::json(nullptr)
+                                        : json_utility::json(std::chrono::duration<double, std::milli>(max_time).count())},
+                    {"huge_pages", huge_pages_name(HugePageSettings::instance().get_policy())}};
+        }
+
+    private:
+        size_t warmup;                     /// number of untimed runs before the timed ones
+        size_t repetitions;                /// maximum number of timed runs
+        std::chrono::nanoseconds budget;   /// maximum time spent on the timed runs of each operation
+        size_t min_repetitions;            /// minimum number of timed runs
+        std::chrono::nanoseconds max_time; /// maximum time of the minimum number of timed runs
+
+        /// @brief check if the minimum number of timed runs fits in the maximum time
+        /// @param sample expected time of a run in nanoseconds
+        /// @return true if min_repetitions runs are expected to take at most max_time
+        bool affordable(double sample) const
+        {
+            return sample * min_repetitions <= std::chrono::duration<double, std::nano>(max_time).count();
+        }
+    };
+
+    /// @brief name of a value type in the benchmark results
+    /// @tparam T type of the matrix elements
+    /// @return name of the type
+    template <AddMulType T>
+    std::string value_type_name()
+    {
+        if constexpr (is_complex<T>::value)
+        {
+            return "complex<" + value_type_name<typename T::value_type>() + ">";
+        }
+        else if constexpr (std::is_same_v<T, float>)
+        {
+            return "float";
+        }
+        else if constexpr (std::is_same_v<T, double>)
+        {
+            return "double";
+        }
+        else if constexpr (std::is_same_v<T, long double>)
+        {
+            return "long double";
+        }
+        else
+        {
+            return (std::is_integral_v<T> ? "int" : "real") + std::to_string(8 * sizeof(T));
+        }
+    }
+
+    /// @brief serialize the bandwidth measured by the STREAM probe
+    /// @param bandwidth bandwidth to serialize
+    /// @return JSON object following the schema of this file
+    inline json_utility::json to_json(const StreamBandwidth &bandwidth)
+    {
+        return {{"copy", bandwidth.copy},
+                {"scale", bandwidth.scale},
+                {"add", bandwidth.add},
+                {"triad", bandwidth.triad},
+                {"elements", bandwidth.elements},
+                {"threads", bandwidth.threads}};
+    }
+
+    /// @brief serialize the allocations and the peak RSS delta of an operation
+    /// @param memory statistics to serialize
+    /// @return JSON object following the schema of this file
+    inline json_utility::json to_json(const MemoryStatistics &memory)
+    {
+        json_utility::json data = {{"allocations", nullptr},
+                                   {"deallocations", nullptr},
+                                   {"bytes_allocated", nullptr},
+                                   {"peak_rss_delta", memory.peak_rss_delta}};
+        if (memory.counted)
+        {
+            data["allocations"] = memory.allocations;
+            data["deallocations"] = memory.deallocations;
+            data["bytes_allocated"] = memory.bytes;
+        }
+        return data;
+    }
+
+    /// @brief serialize a benchmark result
+    /// @param result result to serialize
+    /// @param peak_gbs sustainable memory bandwidth of the machine
+    /// @return JSON object following the schema of this file
+    inline json_utility::json to_json(const BenchmarkResult &result, double peak_gbs)
+    {
+        const RooflinePoint point = roofline(result.cost, result.time.median * 1e-9, peak_gbs);
+        return {{"matrix", result.matrix},
+                {"operation", result.operation},
+                {"class", result.matrix_class},
+                {"format", result.format},
+                {"kernel", result.kernel},
+                {"storage_order", result.storage_order},
+                {"value_type", result.value_type},
+                {"rows", result.rows},
+                {"cols", result.cols},
+                {"nnz", result.nnz},
+                {"repetitions", result.time.repetitions},
+                {"time_ns", {{"min", result.time.min}, {"p10", result.time.p10}, {"median", result.time.median}, {"p90", result.time.p90}, {"max", result.time.max}, {"mean", result.time.mean}, {"stddev", result.time.stddev}}},
+                {"memory", to_json(result.time.memory)},
+                {"flops", result.cost.flops},
+                {"bytes", result.cost.bytes},
+                {"gflops", point.gflops},
+                {"gbs", point.gbs},
+                {"arithmetic_intensity", point.arithmetic_intensity},
+                {"attainable_gflops", point.attainable_gflops},
+                {"bandwidth_fraction", point.bandwidth_fraction}};
+    }
+
+    /// @brief serialize the results of a benchmark
+    /// @param machine description of the machine
+    /// @param benchmark benchmark used to collect the results
+    /// @param bandwidth sustainable memory bandwidth of the machine
+    /// @param results results to serialize
+    /// @return JSON object following the schema of this file
+    inline json_utility::json benchmark_json(const std::string &machine, const Benchmark &benchmark,
+                                             const StreamBandwidth &bandwidth, const std::vector<BenchmarkResult> &results)
+    {
+        json_utility::json data = {{"schema", "sparse-matrix-benchmark"},
+                                   {"version", 3},
+                                   {"machine", machine},
+                                   {"settings", benchmark.settings()},
+                                   {"stream_gbs", to_json(bandwidth)},
+                                   {"results", json_utility::json::array()}};
+        for (const auto &result : results)
+        {
+            data["results"].push_back(to_json(result, bandwidth.triad));
+        }
+        return data;
+    }
+
+    /// @brief save the results of a benchmark
+    /// @param filename output JSON file
+    /// @param machine description of the machine
+    /// @param benchmark benchmark used to collect the results
+    /// @param bandwidth sustainable memory bandwidth of the machine
+    /// @param results results to save
+    inline void save_benchmark(const std::string &filename, const std::string &machine, const Benchmark &benchmark,
+                               const StreamBandwidth &bandwidth, const std::vector<BenchmarkResult> &results)
+    {
+        json_utility::save_json(filename, benchmark_json(machine, benchmark, bandwidth, results));
+    }
+}
+
+#endif // BENCHMARK_HPP
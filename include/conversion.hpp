@@ -0,0 +1,174 @@
+/**
+ * @file conversion.hpp
+ * @brief Defines the counters of the implicit conversions between the formats of the matrices.
+ *
+ * Writing an element of a compressed matrix (Matrix::set or the non-const call operator) used to
+ * uncompress the whole matrix and print a message on the console. The behaviour is now chosen by a
+ * algebra::ConversionPolicy (see storage.hpp): every matrix takes the default policy of the process
+ * when it is constructed, and can change it with Matrix::set_conversion_policy.
+ *
+ * Every implicit conversion, in-place write and buffered write is counted both by the matrix where it
+ * happens and by the process-wide algebra::ConversionMonitor, together with the time spent and the bytes
+ * converted:
+ * @code{.cpp}
+ * ConversionMonitor::instance().set_default_policy(ConversionPolicy::Buffer);
+ * m.compress();
+ * m.set(0, 0, 1.0);  // written in place, or buffered
+ * m.flush();         // the buffered writes are merged in the compressed arrays
+ * std::cout << m.conversion_statistics().buffered_writes << std::endl;
+ * std::cout << ConversionMonitor::instance().statistics().time_ns << std::endl;
+ * @endcode
+ *
+ * @see matrix.hpp
+ */
+#ifndef CONVERSION_HPP
+#define CONVERSION_HPP
+
+#include "storage.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+namespace algebra
+{
+    /// @brief name of a conversion policy
+    /// @param policy conversion policy
+    /// @return Allow, WarnOnce, Throw or Buffer
+    inline const char *conversion_policy_name(ConversionPolicy policy)
+    {
+        switch (policy)
+        {
+        case ConversionPolicy::Allow:
+            return "Allow";
+        case ConversionPolicy::WarnOnce:
+            return "WarnOnce";
+        case ConversionPolicy::Throw:
+            return "Throw";
+        default:
+            return "Buffer";
+        }
+    }
+
+    /**
+     * @brief Counters of the implicit conversions and of the writes to compressed matrices.
+     */
+    struct ConversionStatistics
+    {
+        size_t uncompressions = 0;  /// implicit uncompressions (write to a compressed matrix, flush)
+        size_t compressions = 0;    /// implicit compressions (flush)
+        size_t in_place_writes = 0; /// writes to existing elements of a compressed matrix
+        size_t buffered_writes = 0; /// writes buffered until the next flush or uncompression
+        uint64_t time_ns = 0;       /// time spent in the implicit conversions
+        size_t bytes = 0;           /// bytes read and written by the implicit conversions
+
+        /// @brief accumulate other counters
+        /// @param other counters to add
+        /// @return reference to the accumulated counters
+        ConversionStatistics &operator+=(const ConversionStatistics &other)
+        {
+            uncompressions += other.uncompressions;
+            compressions += other.compressions;
+            in_place_writes += other.in_place_writes;
+            buffered_writes += other.buffered_writes;
+            time_ns += other.time_ns;
+            bytes += other.bytes;
+            return *this;
+        }
+    };
+
+    /**
+     * @brief Process-wide counters of the implicit conversions and default conversion policy.
+     */
+    class ConversionMonitor
+    {
+    public:
+        /// @brief get the monitor
+        /// @return reference to the monitor of the process
+        static ConversionMonitor &instance()
+        {
+            static ConversionMonitor monitor;
+            return monitor;
+        }
+
+        /// @brief set the policy of the matrices constructed from now on
+        /// @param policy conversion policy
+        void set_default_policy(ConversionPolicy policy) { default_policy.store(policy, std::memory_order_relaxed); };
+
+        /// @brief get the policy of the matrices constructed from now on
+        /// @return conversion policy (WarnOnce, unless changed)
+        ConversionPolicy get_default_policy() const { return default_policy.load(std::memory_order_relaxed); };
+
+        /// @brief accumulate the counters of a conversion or of a write
+        /// @param statistics counters to add
+        /// @note every counter is a relaxed atomic: the writes of different threads never wait on a lock
+        void record(const ConversionStatistics &statistics)
+        {
+            add(uncompressions, statistics.uncompressions);
+            add(compressions, statistics.compressions);
+            add(in_place_writes, statistics.in_place_writes);
+            add(buffered_writes, statistics.buffered_writes);
+            add(time_ns, statistics.time_ns);
+            add(bytes, statistics.bytes);
+        }
+
+        /// @brief get the counters of all the matrices
+        /// @return accumulated counters (every counter is read separately, while other threads may record)
+        ConversionStatistics statistics() const
+        {
+            ConversionStatistics total;
+            total.uncompressions = uncompressions.load(std::memory_order_relaxed);
+            total.compressions = compressions.load(std::memory_order_relaxed);
+            total.in_place_writes = in_place_writes.load(std::memory_order_relaxed);
+            total.buffered_writes = buffered_writes.load(std::memory_order_relaxed);
+            total.time_ns = time_ns.load(std::memory_order_relaxed);
+            total.bytes = bytes.load(std::memory_order_relaxed);
+            return total;
+        }
+
+        /// @brief reset the counters of all the matrices (the counters of every matrix are kept)
+        void reset()
+        {
+            uncompressions.store(0, std::memory_order_relaxed);
+            compressions.store(0, std::memory_order_relaxed);
+            in_place_writes.store(0, std::memory_order_relaxed);
+            buffered_writes.store(0, std::memory_order_relaxed);
+            time_ns.store(0, std::memory_order_relaxed);
+            bytes.store(0, std::memory_order_relaxed);
+        }
+
+        /// @brief print a warning the first time it is called in the process
+        /// @param format name of the format of the matrix being uncompressed
+        void warn_once(const char *format)
+        {
+            if (not warned.exchange(true, std::memory_order_relaxed))
+            {
+                std::cerr << "Warning: implicit uncompression of a matrix in " << format
+                          << " format (further warnings are suppressed, see ConversionPolicy)" << std::endl;
+            }
+        }
+
+    private:
+        std::atomic<ConversionPolicy> default_policy = ConversionPolicy::WarnOnce; /// policy of the new matrices
+        std::atomic<bool> warned = false;                                          /// true after the first warning
+        std::atomic<size_t> uncompressions = 0;                                    /// implicit uncompressions of all the matrices
+        std::atomic<size_t> compressions = 0;                                      /// implicit compressions of all the matrices
+        std::atomic<size_t> in_place_writes = 0;                                   /// in-place writes of all the matrices
+        std::atomic<size_t> buffered_writes = 0;                                   /// buffered writes of all the matrices
+        std::atomic<uint64_t> time_ns = 0;                                         /// time spent in the implicit conversions
+        std::atomic<size_t> bytes = 0;                                             /// bytes read and written by the implicit conversions
+
+        /// @brief add to a counter, skipping the zero increments (a write changes a single counter)
+        template <typename Counter>
+        static void add(std::atomic<Counter> &counter, Counter increment)
+        {
+            if (increment != 0)
+                counter.fetch_add(increment, std::memory_order_relaxed);
+        }
+
+        /// @brief default constructor
+        ConversionMonitor() = default;
+    };
+}
+
+#endif // CONVERSION_HPP
@@ -0,0 +1,742 @@
+/**
+ * @file differential.hpp
+ * @brief Defines the randomized differential tester of the formats and kernels (`make fuzz`).
+ *
+ * A test case is decoded from a sequence of bytes (see algebra::FuzzInput), so that the same harness runs
+ * both with a pseudo-random generator (fuzz/differential.cpp, hundreds of thousands of cases) and as a
+ * libFuzzer target built with clang (`make fuzz-libfuzzer`), which mutates the bytes to maximize the coverage.
+ *
+ * Every case generates a matrix A and a matrix B with compatible sizes (including the 0x0 and 1x1 shapes,
+ * with square matrices in half of the cases), whose rows are empty, full or random, and whose diagonal can
+ * be zeroed, together with explicit zeros written over existing elements. Then, for both storage orders,
+ * for the real and the complex value type and with one TBB thread (all of them in one case in four), it
+ * checks against a dense reference:
+ * - the elements and the number of non-zero elements after compress, compress_parallel, compress_mod and uncompress;
+ * - the matrix-vector and matrix-matrix products of Matrix (COO, CSR/CSC with every kernel), SquareMatrix
+ *   (COO, CSR/CSC, MSR/MSC with every kernel), TransposeView and DiagonalView, including the mixed products with DiagonalView;
+ * - the One, Infinity and Frobenius norms of all of them;
+ * - chains of products of temporary matrices, multiply_into with a scratch matrix and the recycling of the
+ *   compressed arrays across uncompress and compress;
+ * - the elements and the converted bytes reported by the flush of a buffered write (ConversionPolicy::Buffer).
+ *
+ * The inputs of at least algebra::large_input_bytes are decoded as a large square matrix, with tens of thousands
+ * of non-zero elements, whose conversions are checked in a context of one thread and in a context of four,
+ * so that the partitioned conversions between COO, CSR/CSC and MSR/MSC, and the parallel uncompression,
+ * which splits the work only above 32768 non-zero elements, run on several parts (also on a machine with
+ * fewer cores) and are compared with the serial ones.
+ *
+ * The values are multiples of 1/4 in [-2, 2], so the products are exact and the results of the different
+ * formats and kernels can only differ by the order of the sums of the norms: they are compared with a
+ * relative tolerance. Every mismatch and every unexpected exception is reported with a description of the case.
+ *
+ * @see fuzz/differential.cpp
+ */
+#ifndef DIFFERENTIAL_HPP
+#define DIFFERENTIAL_HPP
+
+#include "storage.hpp"
+#include "matrix.hpp"
+#include "square_matrix.hpp"
+#include "matrix_views.hpp"
+#include "execution_context.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <complex>
+#include <sstream>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <exception>
+
+#include <tbb/global_control.h>
+#include <tbb/info.h>
+
+namespace algebra
+{
+    /**
+     * @brief Decodes the choices of a test case from a sequence of bytes.
+     *
+     * When the bytes are exhausted every choice is zero, so that any input (also the empty one) is a valid case.
+     */
+    class FuzzInput
+    {
+    public:
+        /// @brief constructor
+        /// @param data bytes of the input
+        /// @param size number of bytes
+        FuzzInput(const uint8_t *data, size_t size) : data(data), size(size) {};
+
+        /// @brief consume a byte
+        /// @return the next byte, 0 if the input is exhausted
+        uint8_t byte() { return position < size ? data[position++] : 0; };
+
+        /// @brief consume a bounded choice
+        /// @param bound number of alternatives
+        /// @return a value in [0, bound)
+        size_t choice(size_t bound) { return bound > 1 ? byte() % bound : 0; };
+
+        /// @brief consume a non-zero value
+        /// @return a multiple of 1/4 in [-2, 2], different from zero
+        double value()
+        {
+            const int v = static_cast<int>(byte() % 16) - 8; // in [-8, 7]
+            return (v >= 0 ? v + 1 : v) / 4.0;
+        }
+
+    private:
+        const uint8_t *data; /// bytes of the input
+        size_t size;         /// number of bytes
+        size_t position = 0; /// next byte to consume
+    };
+
+    /**
+     * @brief Dense row-major matrix used as reference.
+     * @tparam T type of the matrix elements
+     */
+    template <AddMulType T>
+    struct DenseMatrix
+    {
+        size_t rows = 0;       /// number of rows
+        size_t cols = 0;       /// number of columns
+        std::vector<T> values; /// elements, row by row
+
+        /// @brief constructor
+        /// @param rows number of rows
+        /// @param cols number of columns
+        DenseMatrix(size_t rows = 0, size_t cols = 0) : rows(rows), cols(cols), values(rows * cols, T(0)) {};
+
+        /// @brief access an element
+        T &operator()(size_t row, size_t col) { return values[row * cols + col]; };
+
+        /// @brief read an element
+        const T &operator()(size_t row, size_t col) const { return values[row * cols + col]; };
+
+        /// @brief number of non-zero elements
+        size_t nnz() const { return values.size() - std::count(values.begin(), values.end(), T(0)); };
+
+        /// @brief transpose
+        DenseMatrix transpose() const
+        {
+            DenseMatrix result(cols, rows);
+            for (size_t i = 0; i < rows; i++)
+                for (size_t j = 0; j < cols; j++)
+                    result(j, i) = (*this)(i, j);
+            return result;
+        }
+
+        /// @brief diagonal part (of a square matrix)
+        DenseMatrix diagonal() const
+        {
+            DenseMatrix result(rows, cols);
+            for (size_t i = 0; i < std::min(rows, cols); i++)
+                result(i, i) = (*this)(i, i);
+            return result;
+        }
+
+        /// @brief matrix-matrix product
+        DenseMatrix operator*(const DenseMatrix &other) const
+        {
+            DenseMatrix result(rows, other.cols);
+            for (size_t i = 0; i < rows; i++)
+                for (size_t k = 0; k < cols; k++)
+                    for (size_t j = 0; j < other.cols; j++)
+                        result(i, j) += (*this)(i, k) * other(k, j);
+            return result;
+        }
+
+        /// @brief matrix-vector product
+        std::vector<T> operator*(const std::vector<T> &v) const
+        {
+            std::vector<T> result(rows, T(0));
+            for (size_t i = 0; i < rows; i++)
+                for (size_t j = 0; j < cols; j++)
+                    result[i] += (*this)(i, j) * v[j];
+            return result;
+        }
+
+        /// @brief norm of the matrix
+        template <NormType N>
+        double norm() const
+        {
+            std::vector<double> sums(N == NormType::One ? cols : rows, 0);
+            double frobenius = 0;
+            for (size_t i = 0; i < rows; i++)
+            {
+                for (size_t j = 0; j < cols; j++)
+                {
+                    const double a = std::abs((*this)(i, j));
+                    sums[N == NormType::One ? j : i] += a;
+                    frobenius += a * a;
+                }
+            }
+            if constexpr (N == NormType::Frobenius)
+                return std::sqrt(frobenius);
+            else
+                return sums.empty() ? 0 : *std::max_element(sums.begin(), sums.end());
+        }
+    };
+
+    /**
+     * @brief Matrices and vectors of a test case, decoded from the input.
+     * @tparam T type of the matrix elements
+     */
+    template <AddMulType T>
+    struct FuzzCase
+    {
+        DenseMatrix<T> a;            /// first operand (rows x cols)
+        DenseMatrix<T> b;            /// second operand (cols x k)
+        std::vector<T> x;            /// vector of size cols
+        std::vector<T> y;            /// vector of size rows
+        std::vector<size_t> order;   /// insertion order of the elements of a (indices in a.values)
+        std::vector<size_t> zeros;   /// elements of a overwritten with zero after the insertion
+        std::string description;     /// description of the case in the reports
+        bool large = false;          /// true for a large case, whose conversions are checked (see fuzz_large_case)
+    };
+
+    /// @brief kinds of rows of the generated matrices
+    enum class RowPattern
+    {
+        Empty,
+        Full,
+        Random,
+        Single
+    };
+
+    /// @brief decode a matrix from the input
+    /// @tparam T type of the matrix elements
+    /// @param input input to consume
+    /// @param rows number of rows
+    /// @param cols number of columns
+    /// @param zero_diagonal true if the diagonal must be zero
+    /// @return the dense matrix
+    template <AddMulType T>
+    DenseMatrix<T> fuzz_matrix(FuzzInput &input, size_t rows, size_t cols, bool zero_diagonal)
+    {
+        DenseMatrix<T> m(rows, cols);
+        for (size_t i = 0; i < rows; i++)
+        {
+            const auto pattern = static_cast<RowPattern>(input.choice(4));
+            const uint8_t mask = input.byte();
+            const size_t single = input.choice(cols);
+            for (size_t j = 0; j < cols; j++)
+            {
+                bool nonzero = (pattern == RowPattern::Full) or
+                               (pattern == RowPattern::Random and (mask >> (j % 8)) & 1) or
+                               (pattern == RowPattern::Single and j == single);
+                if (not nonzero or (zero_diagonal and i == j))
+                    continue;
+                const double real = input.value();
+                if constexpr (is_complex<T>::value)
+                    m(i, j) = T(real, input.choice(2) ? input.value() : 0);
+                else
+                    m(i, j) = T(real);
+            }
+        }
+        return m;
+    }
+
+    /// @brief decode the insertion order of the elements of the first operand and the explicit zeros
+    /// @tparam T type of the matrix elements
+    /// @param input input to consume
+    /// @param c test case whose first operand is generated (its overwritten elements become zero)
+    template <AddMulType T>
+    void fuzz_insertion(FuzzInput &input, FuzzCase<T> &c)
+    {
+        // insertion order: row by row, column by column or shuffled
+        const size_t cols = c.a.cols;
+        for (size_t i = 0; i < c.a.values.size(); i++)
+            if (c.a.values[i] != T(0))
+                c.order.push_back(i);
+        const size_t insertion = input.choice(3);
+        if (insertion == 1)
+            std::sort(c.order.begin(), c.order.end(), [&](size_t p, size_t q)
+                      { return std::pair(p % cols, p / cols) < std::pair(q % cols, q / cols); });
+        else if (insertion == 2)
+            for (size_t i = c.order.size(); i > 1; i--)
+                std::swap(c.order[i - 1], c.order[input.choice(i)]);
+
+        // explicit zeros written over some elements
+        for (size_t i = 0; i < c.order.size(); i++)
+            if (input.choice(8) == 0)
+                c.zeros.push_back(c.order[i]);
+        for (const auto &p : c.zeros)
+            c.a.values[p] = T(0);
+    }
+
+    /// @brief decode a test case from the input
+    /// @tparam T type of the matrix elements
+    /// @param input input to consume
+    /// @param max_size maximum number of rows and columns
+    /// @return the test case
+    template <AddMulType T>
+    FuzzCase<T> fuzz_case(FuzzInput &input, size_t max_size = 12)
+    {
+        FuzzCase<T> c;
+        const size_t shape = input.choice(8);
+        size_t rows, cols;
+        if (shape == 0)
+            rows = cols = 0;
+        else if (shape == 1)
+            rows = cols = 1;
+        else if (shape < 5)
+            rows = cols = 2 + input.choice(max_size - 1);
+        else
+        {
+            rows = 1 + input.choice(max_size);
+            cols = 1 + input.choice(max_size);
+        }
+        const size_t k = input.choice(max_size + 1);
+        const bool zero_diagonal = input.choice(4) == 0;
+
+        c.a = fuzz_matrix<T>(input, rows, cols, zero_diagonal);
+        c.b = fuzz_matrix<T>(input, cols, k, false);
+        for (size_t j = 0; j < cols; j++)
+            c.x.push_back(T(input.value()));
+        for (size_t i = 0; i < rows; i++)
+            c.y.push_back(T(input.value()));
+
+        fuzz_insertion(input, c);
+
+        std::ostringstream os;
+        os << rows << "x" << cols << " (nnz " << c.a.nnz() << (zero_diagonal ? ", zero diagonal" : "") << ") times "
+           << cols << "x" << k << " (nnz " << c.b.nnz() << ")";
+        c.description = os.str();
+        return c;
+    }
+
+    /// @brief size of the inputs decoded as a large test case (see fuzz_large_case)
+    inline constexpr size_t large_input_bytes = size_t(1) << 16;
+
+    /// @brief decode a large test case from the input: a square matrix with tens of thousands of non-zero elements
+    /// @tparam T type of the matrix elements
+    /// @param input input to consume
+    /// @return the test case (without the second operand)
+    /// @note the matrix is above the size from which the conversions split their work among the threads
+    template <AddMulType T>
+    FuzzCase<T> fuzz_large_case(FuzzInput &input)
+    {
+        FuzzCase<T> c;
+        c.large = true;
+        const size_t size = 384 + input.choice(128);
+        const bool zero_diagonal = input.choice(4) == 0;
+        c.a = fuzz_matrix<T>(input, size, size, zero_diagonal);
+        c.b = DenseMatrix<T>(size, 0);
+        for (size_t j = 0; j < size; j++)
+            c.x.push_back(T(input.value()));
+        c.y = c.x;
+        fuzz_insertion(input, c);
+
+        std::ostringstream os;
+        os << "large " << size << "x" << size << " (nnz " << c.a.nnz() << (zero_diagonal ? ", zero diagonal" : "") << ")";
+        c.description = os.str();
+        return c;
+    }
+
+    /**
+     * @brief Compares the results of the library with the reference and collects the mismatches.
+     */
+    class DifferentialChecker
+    {
+    public:
+        size_t checks = 0;                 /// number of comparisons
+        std::vector<std::string> failures; /// description of the mismatches
+        std::string context;               /// case, type, order and number of threads being checked
+
+        /// @brief compare two scalars
+        template <typename V>
+        bool close(const V &expected, const V &actual) const
+        {
+            return std::abs(expected - actual) <= 1e-9 * (1 + std::abs(expected));
+        }
+
+        /// @brief compare a vector with the reference
+        template <AddMulType T>
+        void check(const std::string &what, const std::vector<T> &expected, const std::vector<T> &actual)
+        {
+            checks++;
+            bool equal = expected.size() == actual.size();
+            for (size_t i = 0; equal and i < expected.size(); i++)
+                equal = close(expected[i], actual[i]);
+            if (not equal)
+                fail(what, "vectors differ");
+        }
+
+        /// @brief compare a matrix with the reference, element by element
+        template <AddMulType T, StorageOrder S>
+        void check(const std::string &what, const DenseMatrix<T> &expected, const AbstractMatrix<T, S> &actual)
+        {
+            checks++;
+            if (expected.rows != actual.get_rows() or expected.cols != actual.get_cols())
+            {
+                fail(what, "sizes differ");
+                return;
+            }
+            for (size_t i = 0; i < expected.rows; i++)
+            {
+                for (size_t j = 0; j < expected.cols; j++)
+                {
+                    if (not close(expected(i, j), actual(i, j)))
+                    {
+                        std::ostringstream os;
+                        os << "element (" << i << ", " << j << "): expected " << expected(i, j) << ", got " << actual(i, j);
+                        fail(what, os.str());
+                        return;
+                    }
+                }
+            }
+        }
+
+        /// @brief compare the norms and the number of non-zero elements of a matrix with the reference
+        template <AddMulType T, typename M>
+        void check_norms(const std::string &what, const DenseMatrix<T> &expected, const M &actual)
+        {
+            checks++;
+            if (not close(expected.template norm<NormType::One>(), actual.template norm<NormType::One>()))
+                fail(what, "norm One differs");
+            if (not close(expected.template norm<NormType::Infinity>(), actual.template norm<NormType::Infinity>()))
+                fail(what, "norm Infinity differs");
+            if (not close(expected.template norm<NormType::Frobenius>(), actual.template norm<NormType::Frobenius>()))
+                fail(what, "norm Frobenius differs");
+        }
+
+        /// @brief run a check, reporting the exceptions as failures
+        template <typename Check>
+        void run(const std::string &what, Check &&check)
+        {
+            try
+            {
+                check();
+            }
+            catch (const std::exception &e)
+            {
+                fail(what, std::string("exception: ") + e.what());
+            }
+        }
+
+        /// @brief record a mismatch
+        void fail(const std::string &what, const std::string &message)
+        {
+            failures.push_back(context + ": " + what + ": " + message);
+        }
+    };
+
+    /// @brief build a matrix of the library from the reference, in the insertion order of the case
+    /// @note the reads must not convert the matrix: implicit conversions throw (see ConversionPolicy)
+    template <AddMulType T, StorageOrder S, typename M>
+    void fill(M &m, const FuzzCase<T> &c, const DenseMatrix<T> &values)
+    {
+        m.set_conversion_policy(ConversionPolicy::Throw);
+        for (const auto &p : c.order)
+            m.set(p / c.a.cols, p % c.a.cols, values.values[p] != T(0) ? values.values[p] : T(1));
+        for (const auto &p : c.zeros)
+            m.set(p / c.a.cols, p % c.a.cols, T(0));
+    }
+
+    /// @brief check the operations of Matrix, TransposeView and of their products
+    template <AddMulType T, StorageOrder S>
+    void check_matrix(const FuzzCase<T> &c, DifferentialChecker &checker)
+    {
+        const auto &a = c.a;
+        Matrix<T, S> m(a.rows, a.cols);
+        fill<T, S>(m, c, a);
+        Matrix<T, S> b(c.b.rows, c.b.cols);
+        b.set_conversion_policy(ConversionPolicy::Throw);
+        for (size_t i = 0; i < c.b.rows; i++)
+            for (size_t j = 0; j < c.b.cols; j++)
+                if (c.b(i, j) != T(0))
+                    b.set(i, j, c.b(i, j));
+        const auto bt_dense = c.b.transpose();
+        Matrix<T, S> bt(bt_dense.rows, bt_dense.cols);
+        bt.set_conversion_policy(ConversionPolicy::Throw);
+        for (size_t i = 0; i < bt_dense.rows; i++)
+            for (size_t j = 0; j < bt_dense.cols; j++)
+                if (bt_dense(i, j) != T(0))
+                    bt.set(i, j, bt_dense(i, j));
+        const auto ab = a * c.b;
+        const auto ta = a.transpose();
+        const auto btb = bt_dense * c.b;
+
+        auto check_all = [&](const std::string &format)
+        {
+            checker.run("Matrix " + format + " elements", [&]()
+                        { checker.check("Matrix " + format + " elements", a, m);
+                          if (m.get_nnz() != a.nnz()) checker.fail("Matrix " + format, "nnz differs"); });
+            checker.run("Matrix " + format + " norms", [&]()
+                        { checker.check_norms("Matrix " + format, a, m); });
+            checker.run("Matrix " + format + " spmv", [&]()
+                        { checker.check("Matrix " + format + " spmv", a * c.x, m * c.x); });
+            checker.run("Matrix " + format + " spgemm", [&]()
+                        { checker.check("Matrix " + format + " spgemm", ab, m * b); });
+            TransposeView<T, S> t(m);
+            TransposeView<T, S> tb(b);
+            checker.run("TransposeView " + format + " elements", [&]()
+                        { checker.check("TransposeView " + format + " elements", ta, t); });
+            checker.run("TransposeView " + format + " norms", [&]()
+                        { checker.check_norms("TransposeView " + format, ta, t); });
+            checker.run("TransposeView " + format + " spmv", [&]()
+                        { checker.check("TransposeView " + format + " spmv", ta * c.y, t * c.y); });
+            checker.run("TransposeView " + format + " spgemm", [&]()
+                        { checker.check("TransposeView " + format + " spgemm", ab.transpose(), tb * t); });
+
+            // chains of products whose temporaries are recycled (see operator*(Matrix &&, const Matrix &))
+            checker.run("Matrix " + format + " (A * B) * Bt", [&]()
+                        { checker.check("Matrix " + format + " (A * B) * Bt", ab * bt_dense, (m * b) * bt); });
+            checker.run("Matrix " + format + " A * (B * Bt)", [&]()
+                        { checker.check("Matrix " + format + " A * (B * Bt)", a * (c.b * bt_dense), m * (b * bt)); });
+            checker.run("Matrix " + format + " (A * B) * (Bt * B)", [&]()
+                        { checker.check("Matrix " + format + " (A * B) * (Bt * B)", ab * btb, (m * b) * (bt * b)); });
+            checker.run("Matrix " + format + " copy(A) * B", [&]()
+                        { checker.check("Matrix " + format + " copy(A) * B", ab, Matrix<T, S>(m) * b); });
+
+            // a scratch matrix with stale contents is overwritten by products of different sizes
+            checker.run("Matrix " + format + " multiply_into", [&]()
+                        {
+                Matrix<T, S> scratch(1, 1);
+                scratch.set(0, 0, T(5));
+                scratch.set_buffer_recycling(true);
+                multiply_into(m, b, scratch);
+                checker.check("Matrix " + format + " multiply_into A * B", ab, scratch);
+                multiply_into(bt, b, scratch);
+                checker.check("Matrix " + format + " multiply_into Bt * B", btb, scratch);
+                multiply_into(m, b, scratch);
+                checker.check("Matrix " + format + " multiply_into A * B again", ab, scratch); });
+        };
+
+        check_all("COO");
+        m.compress();
+        b.compress();
+        bt.compress();
+        for (const auto kernel : {Kernel::Serial, Kernel::Parallel})
+        {
+            m.set_kernel(kernel);
+            check_all(kernel == Kernel::Serial ? "CSR" : "CSR Parallel");
+        }
+        m.set_kernel(Kernel::Serial);
+
+        // the recycled arrays are reused by compressions of fewer and of more elements
+        checker.run("Matrix buffer recycling", [&]()
+                    {
+            Matrix<T, S> r(m);
+            r.set_buffer_recycling(true);
+            r.set_conversion_policy(ConversionPolicy::Allow);
+            auto expected = a;
+            for (size_t cycle = 0; cycle < 3; cycle++)
+            {
+                r.uncompress();
+                if (cycle == 1 and not c.order.empty())
+                {
+                    // fewer elements
+                    const size_t p = c.order.front();
+                    r.set(p / a.cols, p % a.cols, T(0));
+                    expected.values[p] = T(0);
+                }
+                if (cycle == 2 and a.rows > 0 and a.cols > 0)
+                {
+                    // more elements
+                    for (size_t j = 0; j < a.cols; j++)
+                    {
+                        r.set(0, j, T(j + 1));
+                        expected(0, j) = T(j + 1);
+                    }
+                }
+                r.compress();
+                checker.check("Matrix buffer recycling elements", expected, r);
+                checker.check("Matrix buffer recycling spmv", expected * c.x, r * c.x);
+            } });
+        checker.run("Matrix uncompress", [&]()
+                    { m.uncompress(); checker.check("Matrix uncompress", a, m); });
+        checker.run("Matrix compress_parallel", [&]()
+                    { m.compress_parallel(); checker.check("Matrix compress_parallel", a, m);
+                      checker.check("Matrix compress_parallel spmv", a * c.x, m * c.x); });
+        // a write of a new element is buffered, then merged by the flush (an existing element is written in place)
+        const auto zero = std::find(a.values.begin(), a.values.end(), T(0));
+        if (zero != a.values.end())
+        {
+            checker.run("Matrix flush", [&]()
+                        {
+                const size_t row = (zero - a.values.begin()) / a.cols;
+                const size_t col = (zero - a.values.begin()) % a.cols;
+                auto expected = a;
+                expected(row, col) = T(3);
+                const size_t major = (S == StorageOrder::RowMajor ? a.rows : a.cols) + 1;
+                const size_t before = a.nnz() * (sizeof(T) + sizeof(size_t)) + major * sizeof(size_t);
+                const size_t after = expected.nnz() * (sizeof(T) + sizeof(size_t)) + major * sizeof(size_t);
+                const size_t map = expected.nnz() * (sizeof(T) + 2 * sizeof(size_t));
+                m.set_conversion_policy(ConversionPolicy::Buffer);
+                m.reset_conversion_statistics();
+                m.set(row, col, T(3));
+                m.flush();
+                m.set_conversion_policy(ConversionPolicy::Throw);
+                checker.check("Matrix flush", expected, m);
+                if (m.conversion_statistics().bytes != before + after + 2 * map)
+                    checker.fail("Matrix flush", "converted bytes differ"); });
+        }
+    }
+
+    /// @brief check the operations of SquareMatrix, TransposeView and DiagonalView and of their products
+    template <AddMulType T, StorageOrder S>
+    void check_square_matrix(const FuzzCase<T> &c, DifferentialChecker &checker)
+    {
+        const auto &a = c.a;
+        SquareMatrix<T, S> m(a.rows);
+        fill<T, S>(m, c, a);
+        Matrix<T, S> general(a.rows, a.cols);
+        fill<T, S>(general, c, a);
+        const auto aa = a * a;
+        const auto ta = a.transpose();
+        const auto da = a.diagonal();
+
+        auto check_all = [&](const std::string &format)
+        {
+            checker.run("SquareMatrix " + format + " elements", [&]()
+                        { checker.check("SquareMatrix " + format + " elements", a, m);
+                          if (m.get_nnz() != a.nnz()) checker.fail("SquareMatrix " + format, "nnz differs"); });
+            checker.run("SquareMatrix " + format + " norms", [&]()
+                        { checker.check_norms("SquareMatrix " + format, a, m); });
+            checker.run("SquareMatrix " + format + " spmv", [&]()
+                        { checker.check("SquareMatrix " + format + " spmv", a * c.x, m * c.x); });
+            checker.run("SquareMatrix " + format + " spgemm", [&]()
+                        { checker.check("SquareMatrix " + format + " spgemm", aa, m * m); });
+
+            TransposeView<T, S> t(m);
+            checker.run("TransposeView of SquareMatrix " + format + " spmv", [&]()
+                        { checker.check("TransposeView of SquareMatrix " + format + " spmv", ta * c.x, t * c.x); });
+            checker.run("TransposeView of SquareMatrix " + format + " spgemm", [&]()
+                        { checker.check("TransposeView of SquareMatrix " + format + " spgemm", ta * ta, t * t); });
+            checker.run("TransposeView of SquareMatrix " + format + " norms", [&]()
+                        { checker.check_norms("TransposeView of SquareMatrix " + format, ta, t); });
+
+            DiagonalView<T, S> d(m);
+            checker.run("DiagonalView " + format + " elements", [&]()
+                        { checker.check("DiagonalView " + format + " elements", da, d); });
+            checker.run("DiagonalView " + format + " norms", [&]()
+                        { checker.check_norms("DiagonalView " + format, da, d); });
+            checker.run("DiagonalView " + format + " spmv", [&]()
+                        { checker.check("DiagonalView " + format + " spmv", da * c.x, d * c.x); });
+            checker.run("DiagonalView " + format + " spgemm", [&]()
+                        { checker.check("DiagonalView " + format + " spgemm", da * da, d * d); });
+            checker.run("SquareMatrix * DiagonalView " + format, [&]()
+                        { checker.check("SquareMatrix * DiagonalView " + format, a * da, static_cast<const Matrix<T, S> &>(m) * d); });
+            checker.run("DiagonalView * SquareMatrix " + format, [&]()
+                        { checker.check("DiagonalView * SquareMatrix " + format, da * a, d * static_cast<const Matrix<T, S> &>(m)); });
+            if (format.rfind("MSR", 0) != 0)
+            {
+                checker.run("Matrix * DiagonalView " + format, [&]()
+                            { checker.check("Matrix * DiagonalView " + format, a * da, general * d); });
+                checker.run("DiagonalView * Matrix " + format, [&]()
+                            { checker.check("DiagonalView * Matrix " + format, da * a, d * general); });
+            }
+        };
+
+        check_all("COO");
+        m.compress();
+        general.compress();
+        check_all("CSR");
+        checker.run("SquareMatrix compress_mod", [&]()
+                    { m.compress_mod(); });
+        // the parallel kernel splits the rows of the fused MSR product, and the columns of the product of the
+        // TransposeView (MSC product of a RowMajor matrix, and vice versa) are scattered into partial results
+        for (const auto kernel : {Kernel::Serial, Kernel::Parallel})
+        {
+            m.set_kernel(kernel);
+            check_all(kernel == Kernel::Serial ? "MSR" : "MSR Parallel");
+        }
+        m.set_kernel(Kernel::Serial);
+        checker.run("SquareMatrix uncompress MSR", [&]()
+                    { m.uncompress(); checker.check("SquareMatrix uncompress MSR", a, m); });
+    }
+
+    /// @brief check the conversions of a large matrix in one part (serial) and in four parts (partitioned)
+    /// @note the SquareMatrix goes through every conversion from and to the modified formats in a round trip
+    /// @note the contexts fix the number of parts of the conversions, also on a machine with fewer cores
+    template <AddMulType T, StorageOrder S>
+    void check_large_matrix(const FuzzCase<T> &c, DifferentialChecker &checker)
+    {
+        const auto &a = c.a;
+        const auto serial = std::make_shared<ExecutionContext>(1);
+        const auto partitioned = std::make_shared<ExecutionContext>(4);
+        for (const auto &context : {serial, partitioned})
+        {
+            const std::string parts = context == serial ? " (1 part)" : " (4 parts)";
+            Matrix<T, S> m(a.rows, a.cols);
+            m.set_execution_context(context);
+            fill<T, S>(m, c, a);
+            m.compress();
+            checker.run("Matrix uncompress" + parts, [&]()
+                        { m.uncompress(); checker.check("Matrix uncompress" + parts, a, m);
+                          if (m.get_nnz() != a.nnz()) checker.fail("Matrix uncompress" + parts, "nnz differs"); });
+
+            // round trip COO -> MSR -> CSR -> MSR -> COO, through the partitioned conversions
+            SquareMatrix<T, S> square(a.rows);
+            square.set_execution_context(context);
+            fill<T, S>(square, c, a);
+            const auto check_square = [&](const std::string &what)
+            {
+                checker.check(what, a, square);
+                checker.check(what + " spmv", a * c.x, square * c.x);
+                if (square.get_nnz() != a.nnz())
+                    checker.fail(what, "nnz differs");
+            };
+            checker.run("SquareMatrix compress_mod from COO" + parts, [&]()
+                        { square.compress_mod(); check_square("SquareMatrix compress_mod from COO" + parts); });
+            checker.run("SquareMatrix compress from MSR" + parts, [&]()
+                        { square.compress(); check_square("SquareMatrix compress from MSR" + parts); });
+            checker.run("SquareMatrix compress_mod from CSR" + parts, [&]()
+                        { square.compress_mod(); check_square("SquareMatrix compress_mod from CSR" + parts); });
+            checker.run("SquareMatrix uncompress MSR" + parts, [&]()
+                        { square.uncompress(); check_square("SquareMatrix uncompress MSR" + parts); });
+        }
+    }
+
+    /// @brief run a test case for a value type and a storage order
+    template <AddMulType T, StorageOrder S>
+    void check_case(const FuzzCase<T> &c, DifferentialChecker &checker)
+    {
+        if (c.large)
+        {
+            check_large_matrix<T, S>(c, checker);
+            return;
+        }
+        check_matrix<T, S>(c, checker);
+        if (c.a.rows == c.a.cols)
+            check_square_matrix<T, S>(c, checker);
+    }
+
+    /// @brief decode a test case from the input and run it for both storage orders
+    /// @param data bytes of the input (a large case if there are at least large_input_bytes)
+    /// @param size number of bytes
+    /// @param checker checker collecting the mismatches
+    inline void run_differential(const uint8_t *data, size_t size, DifferentialChecker &checker)
+    {
+        FuzzInput input(data, size);
+        const bool large = size >= large_input_bytes;
+        const bool complex = input.choice(4) == 0;
+        // the large cases set the number of threads of their contexts (see check_large_matrix); one small case
+        // in four runs with all the threads, which is slower on many cores and only changes the partitions
+        const bool serial = input.choice(4) != 0 and not large;
+        // the number of threads changes the partition of the parallel kernels
+        tbb::global_control threads(tbb::global_control::max_allowed_parallelism,
+                                    serial ? 1 : std::max(tbb::info::default_concurrency(), large ? 4 : 2));
+        auto run = [&](auto c, const std::string &type)
+        {
+            for (const auto order : {StorageOrder::RowMajor, StorageOrder::ColumnMajor})
+            {
+                checker.context = c.description + ", " + type + ", " +
+                                  (order == StorageOrder::RowMajor ? "RowMajor" : "ColumnMajor") + ", " +
+                                  (large ? "1 and 4 threads" : serial ? "1 thread" : "all threads");
+                if (order == StorageOrder::RowMajor)
+                    check_case<typename decltype(c.x)::value_type, StorageOrder::RowMajor>(c, checker);
+                else
+                    check_case<typename decltype(c.x)::value_type, StorageOrder::ColumnMajor>(c, checker);
+            }
+        };
+        if (complex)
+            run(large ? fuzz_large_case<std::complex<double>>(input) : fuzz_case<std::complex<double>>(input), "complex<double>");
+        else
+            run(large ? fuzz_large_case<double>(input) : fuzz_case<double>(input), "double");
+    }
+}
+
+#endif // DIFFERENTIAL_HPP
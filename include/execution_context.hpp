@@ -0,0 +1,178 @@
+/**
+ * @file execution_context.hpp
+ * @brief Defines the execution context of the parallel operations: a TBB task arena with its own limits.
+ *
+ * By default the parallel operations of the library (`std::execution::par` and `par_unseq` algorithms,
+ * whose backend is TBB, and the TBB loops of the parallel kernels) run in the global task arena, shared
+ * by all the threads of the process. An algebra::ExecutionContext owns a separate `tbb::task_arena`, with
+ * a maximum number of threads and a priority, so that independent computations running at the same
+ * time can be capped and isolated from each other.
+ *
+ * A context is attached to a matrix with `set_execution_context()`: every operation of the matrix with
+ * a parallel part (compression and conversion, norms and products) then runs in the arena of the context.
+ * The products of two matrices run in the context of the left operand, and the views in the context of
+ * the viewed matrix:
+ * @code{.cpp}
+ * auto context = std::make_shared<ExecutionContext>(4, ExecutionContext::Priority::High);
+ * m.set_execution_context(context);
+ * m.set_kernel(Kernel::Parallel);
+ * m.compress_parallel();          // at most 4 threads
+ * std::vector<double> y = m * x; // at most 4 threads
+ * @endcode
+ *
+ * Any other code, including the generators of generators.hpp, runs in a context with execute():
+ * @code{.cpp}
+ * auto a = context->execute([&]() { return random_matrix<double, StorageOrder::RowMajor>(1000, 1000, 0.01, 42); });
+ * @endcode
+ *
+ * @see matrix.hpp
+ */
+#ifndef EXECUTION_CONTEXT_HPP
+#define EXECUTION_CONTEXT_HPP
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <tbb/task_arena.h>
+
+namespace algebra
+{
+    /**
+     * @brief Task arena in which the parallel operations run, with a maximum number of threads and a priority.
+     */
+    class ExecutionContext
+    {
+    public:
+        /**
+         * @brief Enum class to specify the priority of the work of a context over the other task arenas.
+         */
+        enum class Priority
+        {
+            Low,    /// the threads serve the other arenas first
+            Normal, /// same priority as the global arena
+            High    /// the threads serve this arena first
+        };
+
+        /// @brief constructor
+        /// @param max_concurrency maximum number of threads working in the context at the same time, including
+        ///        the calling thread (all the threads of the machine by default)
+        /// @param priority priority of the context over the other task arenas
+        explicit ExecutionContext(int max_concurrency = tbb::task_arena::automatic, Priority priority = Priority::Normal)
+            : arena(max_concurrency, 1, tbb_priority(priority)), priority(priority){};
+
+        /// @brief the context cannot be copied: the copies would not share the arena
+        ExecutionContext(const ExecutionContext &) = delete;
+
+        /// @brief the context cannot be copied: the copies would not share the arena
+        ExecutionContext &operator=(const ExecutionContext &) = delete;
+
+        /// @brief run a function in the task arena of the context, and wait for it
+        /// @tparam Function callable without arguments
+        /// @param function function to run
+        /// @return the value returned by the function
+        template <typename Function>
+        decltype(auto) execute(Function &&function)
+        {
+            return arena.execute(
+                [&]() -> decltype(auto)
+                {
+                    // the calling thread is in the context while the function runs
+                    const Enter enter(this);
+                    return function();
+                });
+        }
+
+        /// @brief run a function in the task arena of the context, without waiting for it
+        /// @tparam Function callable without arguments
+        /// @param function function to run (copied or moved into the task)
+        template <typename Function>
+        void enqueue(Function &&function)
+        {
+            arena.enqueue(
+                [this, function = std::forward<Function>(function)]()
+                {
+                    // the worker thread is in the context while the function runs
+                    const Enter enter(this);
+                    function();
+                });
+        }
+
+        /// @brief check if the calling thread is running a function of the context
+        /// @return true if the calling thread entered the context with execute()
+        bool is_current() const { return current_context == this; };
+
+        /// @brief get the maximum number of threads of the context
+        /// @return maximum number of threads working in the context at the same time
+        int max_concurrency() { return arena.max_concurrency(); };
+
+        /// @brief get the priority of the context
+        /// @return priority over the other task arenas
+        Priority get_priority() const { return priority; };
+
+    private:
+        tbb::task_arena arena; /// arena of the threads of the context
+        Priority priority;     /// priority over the other task arenas
+
+        static inline thread_local const ExecutionContext *current_context = nullptr; /// context entered by the thread
+
+        /**
+         * @brief Enters a context in the calling thread, and restores the previous one when destroyed (also
+         *        when the function run in the context throws).
+         */
+        struct Enter
+        {
+            const ExecutionContext *previous; /// context of the thread before entering
+
+            /// @brief enter a context
+            /// @param context context to enter
+            explicit Enter(const ExecutionContext *context) : previous(std::exchange(current_context, context)) {};
+
+            /// @brief restore the previous context
+            ~Enter() { current_context = previous; };
+        };
+
+        /// @brief priority of the TBB task arena
+        /// @param priority priority of the context
+        /// @return corresponding priority of tbb::task_arena
+        static tbb::task_arena::priority tbb_priority(Priority priority)
+        {
+            switch (priority)
+            {
+            case Priority::Low:
+                return tbb::task_arena::priority::low;
+            case Priority::High:
+                return tbb::task_arena::priority::high;
+            default:
+                return tbb::task_arena::priority::normal;
+            }
+        }
+    };
+
+    /// @brief name of a priority
+    /// @param priority priority of a context
+    /// @return name of the priority
+    inline std::string priority_name(ExecutionContext::Priority priority)
+    {
+        switch (priority)
+        {
+        case ExecutionContext::Priority::Low:
+            return "low";
+        case ExecutionContext::Priority::High:
+            return "high";
+        default:
+            return "normal";
+        }
+    }
+
+    /// @brief check if an operation must move to the execution context of a matrix before running
+    /// @param context execution context of the matrix (nullptr for the global task arena)
+    /// @return true if the matrix has a context that the calling thread has not entered
+    inline bool outside_context(const std::shared_ptr<ExecutionContext> &context)
+    {
+        return context and not context->is_current();
+    }
+}
+
+#endif // EXECUTION_CONTEXT_HPP
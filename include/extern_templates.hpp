@@ -0,0 +1,88 @@
+/**
+ * @file extern_templates.hpp
+ * @brief Declares the explicit instantiations of the prebuilt library (`lib/libalgebra.a`).
+ *
+ * The library is header-only: every translation unit that includes matrix.hpp compiles all the templates of
+ * matrix.tpp, square_matrix.tpp and view_products.tpp for the types it uses. The static library built with
+ * `make lib` (see lib/instantiations.cpp) contains the explicit instantiations of the classes and of the
+ * products for the combinations of ALGEBRA_FOR_EACH_INSTANTIATION, i.e. `double`, `float` and
+ * `std::complex<double>` in both storage orders.
+ *
+ * When the translation units are compiled with `-DALGEBRA_PREBUILT`, this header declares the same
+ * instantiations as `extern template`, so that they are not compiled again, and the program is linked with
+ * `lib/libalgebra.a`:
+ * @code{.sh}
+ * make lib
+ * g++ -std=c++20 -O3 -DALGEBRA_PREBUILT -I include -I include/impl program.cpp lib/libalgebra.a -ltbb
+ * @endcode
+ * The other types and the inline functions are still instantiated in every translation unit.
+ *
+ * @note The library and the programs must be compiled with the same `ALGEBRA_*` macros (e.g.
+ *       `ALGEBRA_TRACK_ALLOCATIONS` changes the allocators of the storage, and so the layout of the classes),
+ *       and with the same NDEBUG, that selects the default of `ALGEBRA_BOUNDS_CHECK`.
+ * @note This header is included at the end of matrix.hpp, square_matrix.hpp and matrix_views.hpp: the
+ *       declarations are made once, when the three headers (that include each other) are complete.
+ *
+ * @see matrix.hpp
+ */
+#ifndef ALGEBRA_INSTANTIATION_MACROS
+#define ALGEBRA_INSTANTIATION_MACROS
+
+#include <complex>
+#include <vector>
+
+/// @brief apply a macro to the element types and storage orders instantiated in the prebuilt library
+#define ALGEBRA_FOR_EACH_INSTANTIATION(MACRO)                        \
+    MACRO(double, ::algebra::StorageOrder::RowMajor)                 \
+    MACRO(double, ::algebra::StorageOrder::ColumnMajor)              \
+    MACRO(float, ::algebra::StorageOrder::RowMajor)                  \
+    MACRO(float, ::algebra::StorageOrder::ColumnMajor)               \
+    MACRO(std::complex<double>, ::algebra::StorageOrder::RowMajor)   \
+    MACRO(std::complex<double>, ::algebra::StorageOrder::ColumnMajor)
+
+/// @brief instantiations of the classes, of the norms and of the products for an element type and a storage order
+/// @param PREFIX `template` (definition) or `extern template` (declaration)
+#define ALGEBRA_INSTANTIATIONS(PREFIX, T, S)                                                                          \
+    PREFIX class Matrix<T, S>;                                                                                        \
+    PREFIX class SquareMatrix<T, S>;                                                                                  \
+    PREFIX class TransposeView<T, S>;                                                                                 \
+    PREFIX class DiagonalView<T, S>;                                                                                  \
+    PREFIX double Matrix<T, S>::norm<NormType::One>() const;                                                         \
+    PREFIX double Matrix<T, S>::norm<NormType::Infinity>() const;                                                    \
+    PREFIX double Matrix<T, S>::norm<NormType::Frobenius>() const;                                                   \
+    PREFIX double SquareMatrix<T, S>::norm<NormType::One>() const;                                                   \
+    PREFIX double SquareMatrix<T, S>::norm<NormType::Infinity>() const;                                              \
+    PREFIX double SquareMatrix<T, S>::norm<NormType::Frobenius>() const;                                             \
+    PREFIX std::vector<T> operator*(const Matrix<T, S> &, const std::vector<T> &);                                    \
+    PREFIX Matrix<T, S> operator*(const Matrix<T, S> &, const Matrix<T, S> &);                                        \
+    PREFIX Matrix<T, S> operator*(Matrix<T, S> &&, const Matrix<T, S> &);                                             \
+    PREFIX Matrix<T, S> operator*(const Matrix<T, S> &, Matrix<T, S> &&);                                             \
+    PREFIX Matrix<T, S> operator*(Matrix<T, S> &&, Matrix<T, S> &&);                                                  \
+    PREFIX void multiply_into(const Matrix<T, S> &, const Matrix<T, S> &, Matrix<T, S> &);                            \
+    PREFIX std::vector<T> operator*(const SquareMatrix<T, S> &, const std::vector<T> &);                              \
+    PREFIX SquareMatrix<T, S> operator*(const SquareMatrix<T, S> &, const SquareMatrix<T, S> &);                      \
+    PREFIX std::vector<T> operator*(const TransposeView<T, S> &, const std::vector<T> &);                             \
+    PREFIX Matrix<T, S> operator*(const TransposeView<T, S> &, const TransposeView<T, S> &);                          \
+    PREFIX std::vector<T> operator*(const DiagonalView<T, S> &, const std::vector<T> &);                              \
+    PREFIX SquareMatrix<T, S> operator*(const DiagonalView<T, S> &, const DiagonalView<T, S> &);                      \
+    PREFIX Matrix<T, S> operator*(const Matrix<T, S> &, const DiagonalView<T, S> &);                                  \
+    PREFIX Matrix<T, S> operator*(const DiagonalView<T, S> &, const Matrix<T, S> &);
+
+/// @brief explicit instantiation definitions (lib/instantiations.cpp)
+#define ALGEBRA_DEFINE_INSTANTIATIONS(T, S) ALGEBRA_INSTANTIATIONS(template, T, S)
+
+/// @brief explicit instantiation declarations (ALGEBRA_PREBUILT)
+#define ALGEBRA_DECLARE_INSTANTIATIONS(T, S) ALGEBRA_INSTANTIATIONS(extern template, T, S)
+
+#endif // ALGEBRA_INSTANTIATION_MACROS
+
+#if defined(ALGEBRA_PREBUILT) && defined(ALGEBRA_MATRIX_COMPLETE) && defined(ALGEBRA_SQUARE_MATRIX_COMPLETE) && \
+    defined(ALGEBRA_MATRIX_VIEWS_COMPLETE) && not defined(EXTERN_TEMPLATES_HPP)
+#define EXTERN_TEMPLATES_HPP
+
+namespace algebra
+{
+    ALGEBRA_FOR_EACH_INSTANTIATION(ALGEBRA_DECLARE_INSTANTIATIONS)
+}
+
+#endif // EXTERN_TEMPLATES_HPP
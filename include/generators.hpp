@@ -0,0 +1,554 @@
+/**
+ * @file generators.hpp
+ * @brief Defines parallel generators of large synthetic sparse matrices.
+ *
+ * The matrices shipped in the data folder are too small to expose cache and threading effects, so this
+ * header provides generators of matrices of arbitrary size, to drive strong and weak scaling benchmarks:
+ * - algebra::poisson_2d and algebra::poisson_3d: 5-point and 7-point finite difference Laplacians;
+ * - algebra::random_uniform: matrices with a fixed number of uniformly distributed non-zero elements per row;
+ * - algebra::banded: symmetric, diagonally dominant matrices with a dense band;
+ * - algebra::rmat: adjacency matrices of power-law graphs (recursive matrix model);
+ * - algebra::block_fem: symmetric matrices with dense blocks, coupling the neighbouring nodes of a 2D grid
+ *   with several degrees of freedom per node, like the ones of a finite element discretization.
+ *
+ * The compressed arrays are built directly (the rows are counted, scanned and filled in parallel with TBB),
+ * without going through the uncompressed format, and the generated matrices are in compressed format.
+ * They can be written to a Matrix Market file with Matrix::writer.
+ *
+ * The random values are a function of the seed and of the position of each element only (counter-based
+ * generation), so that a matrix is reproducible independently of the number of threads and the same
+ * matrix is generated in both storage orders.
+ *
+ * @see Matrix
+ * @see SquareMatrix
+ * @see bench/bench.cpp
+ */
+#ifndef GENERATORS_HPP
+#define GENERATORS_HPP
+
+#include "storage.hpp"
+#include "matrix.hpp"
+#include "square_matrix.hpp"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <execution>
+#include <random>
+#include <limits>
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+#include <tbb/blocked_range.h>
+
+namespace algebra
+{
+    /**
+     * @brief Small counter-based pseudo-random generator (SplitMix64).
+     *
+     * It satisfies the UniformRandomBitGenerator requirements, so it can be used with the standard
+     * distributions; its state is a single 64-bit word, so a generator can be created for every row
+     * (or element) without any cost, which makes the generation independent of the scheduling.
+     */
+    class SplitMix64
+    {
+    public:
+        using result_type = uint64_t;
+
+        /// @brief constructor
+        /// @param seed initial state
+        explicit SplitMix64(uint64_t seed) : state(seed) {};
+
+        /// @brief constructor combining a seed and a counter (e.g. the index of a row)
+        /// @param seed seed of the matrix
+        /// @param counter index of the stream
+        SplitMix64(uint64_t seed, uint64_t counter) : state(mix(seed ^ mix(counter + 0x9e3779b97f4a7c15ULL))) {};
+
+        /// @brief minimum value returned by the generator
+        static constexpr result_type min() { return 0; }
+
+        /// @brief maximum value returned by the generator
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        /// @brief generate the next value
+        /// @return a pseudo-random 64-bit value
+        result_type operator()()
+        {
+            state += 0x9e3779b97f4a7c15ULL;
+            return mix(state);
+        }
+
+        /// @brief finalizer of SplitMix64, also used as a hash function
+        /// @param z value to mix
+        /// @return mixed value
+        static constexpr uint64_t mix(uint64_t z)
+        {
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+    private:
+        uint64_t state; /// current state
+    };
+
+    /// @brief draw a non-zero random value in [low, high) (both parts are drawn for complex types)
+    /// @tparam T type of the value
+    /// @param gen random generator
+    /// @param low lower bound
+    /// @param high upper bound (excluded)
+    /// @return the random value, never zero, so that it can be stored in the compressed arrays
+    /// @throws std::invalid_argument for an integral type, if [low, high) contains no non-zero integer
+    template <AddMulType T>
+    T random_value(SplitMix64 &gen, double low, double high)
+    {
+        if constexpr (is_complex<T>::value)
+        {
+            using RealType = typename T::value_type;
+            std::uniform_real_distribution<RealType> distr(low, high);
+            T value;
+            do
+            {
+                RealType real = distr(gen);
+                value = T(real, distr(gen));
+            } while (value == T(0));
+            return value;
+        }
+        else if constexpr (std::is_floating_point<T>::value)
+        {
+            std::uniform_real_distribution<T> distr(low, high);
+            T value;
+            do
+            {
+                value = distr(gen);
+            } while (value == T(0));
+            return value;
+        }
+        else
+        {
+            // the integers in [low, high), without zero: the draws from zero on are shifted by one
+            const auto first = static_cast<long long>(std::ceil(low));
+            const auto last = static_cast<long long>(std::ceil(high)) - 1;
+            const bool zero = first <= 0 and last >= 0;
+            if (last - first + 1 - zero <= 0)
+            {
+                throw std::invalid_argument("The range of the random values contains no non-zero integer");
+            }
+            std::uniform_int_distribution<long long> distr(first, last - zero);
+            const long long value = distr(gen);
+            return static_cast<T>(zero and value >= 0 ? value + 1 : value);
+        }
+    }
+
+    /// @brief random value of the symmetric pair of elements (row, col) and (col, row)
+    /// @tparam T type of the value
+    /// @param seed seed of the matrix
+    /// @param row row index
+    /// @param col column index
+    /// @return a value in [-1, 0), equal for (row, col) and (col, row)
+    template <AddMulType T>
+    T symmetric_value(uint64_t seed, size_t row, size_t col)
+    {
+        SplitMix64 gen(seed, SplitMix64::mix(std::min(row, col)) ^ std::max(row, col));
+        return random_value<T>(gen, -1.0, 0.0);
+    }
+
+    /// @brief build the compressed arrays of a matrix from the number of elements of each row and a row filler
+    /// @tparam T type of the matrix elements
+    /// @tparam Length callable with signature size_t(size_t row)
+    /// @tparam Fill callable with signature void(size_t row, size_t *cols, T *values)
+    /// @param rows number of rows
+    /// @param row_length callable returning the number of non-zero elements of a row
+    /// @param fill callable writing the sorted column indices and the values of a row
+    /// @return the CSR arrays
+    template <AddMulType T, typename Length, typename Fill>
+    CompressedStorage<T> build_rows(size_t rows, Length &&row_length, Fill &&fill)
+    {
+        CompressedStorage<T> storage;
+        storage.inner.resize(rows + 1);
+        storage.inner[0] = 0;
+
+        // count
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, rows), [&](const tbb::blocked_range<size_t> &range)
+                          {
+                              for (size_t row = range.begin(); row != range.end(); ++row)
+                              {
+                                  storage.inner[row + 1] = row_length(row);
+                              } });
+
+        // scan
+        std::inclusive_scan(std::execution::par, storage.inner.begin(), storage.inner.end(), storage.inner.begin());
+
+        // fill (the arrays are written by the thread that fills the row)
+        storage.outer.resize(storage.inner.back());
+        storage.values.resize(storage.inner.back());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, rows), [&](const tbb::blocked_range<size_t> &range)
+                          {
+                              for (size_t row = range.begin(); row != range.end(); ++row)
+                              {
+                                  fill(row, storage.outer.data() + storage.inner[row], storage.values.data() + storage.inner[row]);
+                              } });
+        return storage;
+    }
+
+    /// @brief transpose compressed arrays (CSR of a matrix to CSC of the same matrix, and vice versa)
+    /// @tparam T type of the matrix elements
+    /// @param storage arrays to transpose
+    /// @param minor_size number of columns (for CSR arrays) or rows (for CSC arrays)
+    /// @return the transposed arrays, with sorted indices
+    /// @note the counting sort is serial: it is only needed by the generators of non-symmetric matrices in ColumnMajor order
+    template <AddMulType T>
+    CompressedStorage<T> transpose_storage(const CompressedStorage<T> &storage, size_t minor_size)
+    {
+        const size_t major_size = storage.inner.size() - 1;
+        CompressedStorage<T> transposed;
+        transposed.inner.assign(minor_size + 1, 0);
+        transposed.outer.resize(storage.outer.size());
+        transposed.values.resize(storage.values.size());
+
+        // counting sort on the minor index
+        for (const auto &idx : storage.outer)
+        {
+            transposed.inner[idx + 1]++;
+        }
+        std::inclusive_scan(transposed.inner.begin(), transposed.inner.end(), transposed.inner.begin());
+        std::vector<size_t> position(transposed.inner.begin(), transposed.inner.end() - 1);
+        for (size_t major = 0; major < major_size; major++)
+        {
+            for (size_t j = storage.inner[major]; j < storage.inner[major + 1]; j++)
+            {
+                const size_t p = position[storage.outer[j]]++;
+                transposed.outer[p] = major;
+                transposed.values[p] = storage.values[j];
+            }
+        }
+        return transposed;
+    }
+
+    /// @brief arrays of a matrix in the given storage order, from its CSR arrays
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order
+    /// @param csr CSR arrays of the matrix
+    /// @param cols number of columns
+    /// @param symmetric true if the pattern and the values are symmetric (the CSR arrays are also the CSC ones)
+    /// @return the arrays in the given storage order
+    template <AddMulType T, StorageOrder S>
+    CompressedStorage<T> in_storage_order(CompressedStorage<T> &&csr, size_t cols, bool symmetric)
+    {
+        if constexpr (S == StorageOrder::ColumnMajor)
+        {
+            if (not symmetric)
+            {
+                return transpose_storage(csr, cols);
+            }
+        }
+        return std::move(csr);
+    }
+
+    /// @brief generate the 5-point finite difference Laplacian on a 2D grid
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order
+    /// @param nx number of grid points along x
+    /// @param ny number of grid points along y
+    /// @return the (nx*ny) x (nx*ny) matrix with 4 on the diagonal and -1 for every neighbour, in compressed format
+    template <AddMulType T, StorageOrder S = StorageOrder::RowMajor>
+    SquareMatrix<T, S> poisson_2d(size_t nx, size_t ny)
+    {
+        const size_t n = nx * ny;
+        auto length = [=](size_t row)
+        {
+            const size_t x = row % nx, y = row / nx;
+            return size_t(1) + (x > 0) + (x + 1 < nx) + (y > 0) + (y + 1 < ny);
+        };
+        auto fill = [=](size_t row, size_t *cols, T *values)
+        {
+            const size_t x = row % nx, y = row / nx;
+            size_t k = 0;
+            // neighbours in increasing column order
+            if (y > 0)
+            {
+                cols[k] = row - nx, values[k++] = T(-1);
+            }
+            if (x > 0)
+            {
+                cols[k] = row - 1, values[k++] = T(-1);
+            }
+            cols[k] = row, values[k++] = T(4);
+            if (x + 1 < nx)
+            {
+                cols[k] = row + 1, values[k++] = T(-1);
+            }
+            if (y + 1 < ny)
+            {
+                cols[k] = row + nx, values[k++] = T(-1);
+            }
+        };
+        return SquareMatrix<T, S>(n, in_storage_order<T, S>(build_rows<T>(n, length, fill), n, true));
+    }
+
+    /// @brief generate the 7-point finite difference Laplacian on a 3D grid
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order
+    /// @param nx number of grid points along x
+    /// @param ny number of grid points along y
+    /// @param nz number of grid points along z
+    /// @return the (nx*ny*nz) x (nx*ny*nz) matrix with 6 on the diagonal and -1 for every neighbour, in compressed format
+    template <AddMulType T, StorageOrder S = StorageOrder::RowMajor>
+    SquareMatrix<T, S> poisson_3d(size_t nx, size_t ny, size_t nz)
+    {
+        const size_t n = nx * ny * nz;
+        const size_t plane = nx * ny;
+        auto length = [=](size_t row)
+        {
+            const size_t x = row % nx, y = (row / nx) % ny, z = row / plane;
+            return size_t(1) + (x > 0) + (x + 1 < nx) + (y > 0) + (y + 1 < ny) + (z > 0) + (z + 1 < nz);
+        };
+        auto fill = [=](size_t row, size_t *cols, T *values)
+        {
+            const size_t x = row % nx, y = (row / nx) % ny, z = row / plane;
+            size_t k = 0;
+            // neighbours in increasing column order
+            if (z > 0)
+            {
+                cols[k] = row - plane, values[k++] = T(-1);
+            }
+            if (y > 0)
+            {
+                cols[k] = row - nx, values[k++] = T(-1);
+            }
+            if (x > 0)
+            {
+                cols[k] = row - 1, values[k++] = T(-1);
+            }
+            cols[k] = row, values[k++] = T(6);
+            if (x + 1 < nx)
+            {
+                cols[k] = row + 1, values[k++] = T(-1);
+            }
+            if (y + 1 < ny)
+            {
+                cols[k] = row + nx, values[k++] = T(-1);
+            }
+            if (z + 1 < nz)
+            {
+                cols[k] = row + plane, values[k++] = T(-1);
+            }
+        };
+        return SquareMatrix<T, S>(n, in_storage_order<T, S>(build_rows<T>(n, length, fill), n, true));
+    }
+
+    /// @brief generate a matrix with uniformly distributed non-zero elements
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order
+    /// @param rows number of rows
+    /// @param cols number of columns
+    /// @param nnz_per_row number of non-zero elements of every row (at distinct, uniformly random columns)
+    /// @param seed seed of the generator
+    /// @return the matrix, with values in [-1, 1), in compressed format
+    template <AddMulType T, StorageOrder S = StorageOrder::RowMajor>
+    Matrix<T, S> random_uniform(size_t rows, size_t cols, size_t nnz_per_row, uint64_t seed = 0)
+    {
+        if (nnz_per_row > cols)
+        {
+            throw std::invalid_argument("The number of non-zero elements per row exceeds the number of columns");
+        }
+        auto length = [=](size_t)
+        { return nnz_per_row; };
+        auto fill = [=](size_t row, size_t *row_cols, T *values)
+        {
+            SplitMix64 gen(seed, row);
+            std::uniform_int_distribution<size_t> distr(0, cols - 1);
+
+            // draw distinct columns: draw the missing ones, sort and remove the duplicates until enough
+            size_t found = 0;
+            while (found < nnz_per_row)
+            {
+                for (size_t k = found; k < nnz_per_row; k++)
+                {
+                    row_cols[k] = distr(gen);
+                }
+                std::sort(row_cols, row_cols + nnz_per_row);
+                found = std::unique(row_cols, row_cols + nnz_per_row) - row_cols;
+            }
+            for (size_t k = 0; k < nnz_per_row; k++)
+            {
+                values[k] = random_value<T>(gen, -1.0, 1.0);
+            }
+        };
+        return Matrix<T, S>(rows, cols, in_storage_order<T, S>(build_rows<T>(rows, length, fill), cols, false));
+    }
+
+    /// @brief generate a symmetric, diagonally dominant banded matrix
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order
+    /// @param n number of rows and columns
+    /// @param bandwidth number of (dense) diagonals above and below the main diagonal
+    /// @param seed seed of the generator
+    /// @return the matrix, with off-diagonal values in [-1, 0), in compressed format
+    template <AddMulType T, StorageOrder S = StorageOrder::RowMajor>
+    SquareMatrix<T, S> banded(size_t n, size_t bandwidth, uint64_t seed = 0)
+    {
+        auto first = [=](size_t row)
+        { return row > bandwidth ? row - bandwidth : 0; };
+        auto last = [=](size_t row)
+        { return std::min(n - 1, row + bandwidth); };
+        auto length = [=](size_t row)
+        { return last(row) - first(row) + 1; };
+        auto fill = [=](size_t row, size_t *cols, T *values)
+        {
+            AbsReturnType_t<T> off_diagonal = 0;
+            size_t diagonal = 0;
+            for (size_t col = first(row), k = 0; col <= last(row); col++, k++)
+            {
+                cols[k] = col;
+                if (col == row)
+                {
+                    diagonal = k;
+                }
+                else
+                {
+                    values[k] = symmetric_value<T>(seed, row, col);
+                    off_diagonal += std::abs(values[k]);
+                }
+            }
+            values[diagonal] = T(off_diagonal + 1);
+        };
+        return SquareMatrix<T, S>(n, in_storage_order<T, S>(build_rows<T>(n, length, fill), n, true));
+    }
+
+    /// @brief generate the adjacency matrix of a power-law graph with the recursive matrix (R-MAT) model
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order
+    /// @param scale logarithm in base 2 of the number of vertices
+    /// @param edge_factor average number of edges per vertex (before removing the duplicates)
+    /// @param seed seed of the generator
+    /// @param a probability of the top-left quadrant
+    /// @param b probability of the top-right quadrant
+    /// @param c probability of the bottom-left quadrant (the bottom-right one has probability 1 - a - b - c)
+    /// @return the (2^scale) x (2^scale) matrix, with values in [0, 1), in compressed format
+    template <AddMulType T, StorageOrder S = StorageOrder::RowMajor>
+    SquareMatrix<T, S> rmat(size_t scale, size_t edge_factor = 16, uint64_t seed = 0,
+                            double a = 0.57, double b = 0.19, double c = 0.19)
+    {
+        if (a < 0 or b < 0 or c < 0 or a + b + c > 1)
+        {
+            throw std::invalid_argument("Invalid R-MAT probabilities");
+        }
+        const size_t n = size_t(1) << scale;
+        const size_t edges = edge_factor * n;
+        constexpr size_t chunk = size_t(1) << 16; // edges generated by the same stream
+
+        // generate the edges, chunk by chunk
+        std::vector<Index> coordinates(edges);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, (edges + chunk - 1) / chunk), [&](const tbb::blocked_range<size_t> &range)
+                          {
+                              for (size_t id = range.begin(); id != range.end(); ++id)
+                              {
+                                  SplitMix64 gen(seed, id);
+                                  std::uniform_real_distribution<double> distr(0, 1);
+                                  for (size_t e = id * chunk; e < std::min(edges, (id + 1) * chunk); e++)
+                                  {
+                                      size_t row = 0, col = 0;
+                                      for (size_t level = 0; level < scale; level++)
+                                      {
+                                          const double p = distr(gen);
+                                          const size_t half = n >> (level + 1);
+                                          row += (p >= a + b) ? half : 0;
+                                          col += (p >= a and p < a + b) or (p >= a + b + c) ? half : 0;
+                                      }
+                                      coordinates[e] = {row, col};
+                                  }
+                              } });
+
+        // sort in the storage order and remove the duplicates
+        tbb::parallel_sort(coordinates.begin(), coordinates.end(), typename ComparatorSelector<S>::type());
+        coordinates.erase(std::unique(coordinates.begin(), coordinates.end(), [](const Index &x, const Index &y)
+                                      { return x.row == y.row and x.col == y.col; }),
+                          coordinates.end());
+
+        // build the compressed arrays: the start of each major index is found by binary search
+        CompressedStorage<T> storage;
+        storage.inner.resize(n + 1);
+        storage.outer.resize(coordinates.size());
+        storage.values.resize(coordinates.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, n + 1), [&](const tbb::blocked_range<size_t> &range)
+                          {
+                              for (size_t major = range.begin(); major != range.end(); ++major)
+                              {
+                                  storage.inner[major] = std::partition_point(coordinates.begin(), coordinates.end(), [major](const Index &x)
+                                                                              { return (S == StorageOrder::ColumnMajor ? x.col : x.row) < major; }) -
+                                                         coordinates.begin();
+                              } });
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, coordinates.size()), [&](const tbb::blocked_range<size_t> &range)
+                          {
+                              for (size_t j = range.begin(); j != range.end(); ++j)
+                              {
+                                  const auto &x = coordinates[j];
+                                  storage.outer[j] = (S == StorageOrder::ColumnMajor) ? x.row : x.col;
+                                  SplitMix64 gen(seed, x.row * n + x.col);
+                                  // the weights of the edges are in (0, 1), or 1 for integral types
+                                  storage.values[j] = random_value<T>(gen, 0.0, std::is_integral_v<T> ? 2.0 : 1.0);
+                              } });
+        return SquareMatrix<T, S>(n, std::move(storage));
+    }
+
+    /// @brief generate a symmetric block-structured matrix like the ones of a finite element discretization
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order
+    /// @param nx number of nodes along x
+    /// @param ny number of nodes along y
+    /// @param block_size number of degrees of freedom per node (size of the dense blocks)
+    /// @param seed seed of the generator
+    /// @return the (nx*ny*block_size) x (nx*ny*block_size) matrix coupling every node with its (up to 8)
+    ///         neighbours by dense blocks, diagonally dominant, in compressed format
+    template <AddMulType T, StorageOrder S = StorageOrder::RowMajor>
+    SquareMatrix<T, S> block_fem(size_t nx, size_t ny, size_t block_size, uint64_t seed = 0)
+    {
+        const size_t n = nx * ny * block_size;
+        // range of the neighbouring nodes along one direction
+        auto neighbours = [](size_t i, size_t size)
+        { return std::array<size_t, 2>{i > 0 ? i - 1 : 0, std::min(size - 1, i + 1)}; };
+        auto length = [=](size_t row)
+        {
+            const size_t node = row / block_size;
+            const auto x = neighbours(node % nx, nx), y = neighbours(node / nx, ny);
+            return (x[1] - x[0] + 1) * (y[1] - y[0] + 1) * block_size;
+        };
+        auto fill = [=](size_t row, size_t *cols, T *values)
+        {
+            const size_t node = row / block_size;
+            const auto x = neighbours(node % nx, nx), y = neighbours(node / nx, ny);
+            AbsReturnType_t<T> off_diagonal = 0;
+            size_t diagonal = 0, k = 0;
+            // neighbouring nodes in increasing order, all the degrees of freedom of each node
+            for (size_t j = y[0]; j <= y[1]; j++)
+            {
+                for (size_t i = x[0]; i <= x[1]; i++)
+                {
+                    for (size_t dof = 0; dof < block_size; dof++, k++)
+                    {
+                        const size_t col = (j * nx + i) * block_size + dof;
+                        cols[k] = col;
+                        if (col == row)
+                        {
+                            diagonal = k;
+                        }
+                        else
+                        {
+                            values[k] = symmetric_value<T>(seed, row, col);
+                            off_diagonal += std::abs(values[k]);
+                        }
+                    }
+                }
+            }
+            values[diagonal] = T(off_diagonal + 1);
+        };
+        return SquareMatrix<T, S>(n, in_storage_order<T, S>(build_rows<T>(n, length, fill), n, true));
+    }
+}
+
+#endif // GENERATORS_HPP
@@ -0,0 +1,182 @@
+/**
+ * @file heap_profile.hpp
+ * @brief Defines the measurement of the heap allocations and of the resident memory of an operation.
+ *
+ * The number of allocations and the bytes allocated are counted by the global operator new and
+ * operator delete interposed by allocation_hooks.hpp, which must be included in exactly one translation
+ * unit of the program (the benchmarks include it in their main file). Without the hooks the counters
+ * stay at zero and algebra::HeapCounters::interposed is false.
+ *
+ * The peak resident set size (RSS) is read from `/proc/self/status` (VmHWM), and is reset to the
+ * current RSS before every measurement by writing to `/proc/self/clear_refs` (Linux 4.0 or later). If
+ * the reset is not available, the increase of the maximum RSS of the process (getrusage) is measured
+ * instead, which is zero unless the operation exceeds the peak of all the previous ones.
+ *
+ * @code{.cpp}
+ * MemoryProbe probe;
+ * probe.start();
+ * auto v = m * x;
+ * probe.stop();
+ * MemoryStatistics memory = probe.statistics(); // allocations, bytes allocated and peak RSS delta
+ * @endcode
+ *
+ * @see allocation_hooks.hpp
+ * @see benchmark.hpp
+ */
+#ifndef HEAP_PROFILE_HPP
+#define HEAP_PROFILE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <algorithm>
+
+#include <sys/resource.h>
+
+namespace algebra
+{
+    /**
+     * @brief Process-wide counters of the heap allocations, updated by allocation_hooks.hpp.
+     */
+    struct HeapCounters
+    {
+        static inline std::atomic<size_t> allocations = 0;   /// number of calls to operator new
+        static inline std::atomic<size_t> deallocations = 0; /// number of calls to operator delete (non-null)
+        static inline std::atomic<size_t> bytes = 0;         /// bytes requested to operator new
+        static inline std::atomic<bool> interposed = false;  /// true if the hooks are linked in the program
+    };
+
+    /**
+     * @brief Values of the heap counters at a point of the execution.
+     */
+    struct HeapSnapshot
+    {
+        size_t allocations = 0;   /// number of allocations
+        size_t deallocations = 0; /// number of deallocations
+        size_t bytes = 0;         /// bytes allocated
+
+        /// @brief read the counters
+        /// @return the current values of the counters
+        static HeapSnapshot now()
+        {
+            return {HeapCounters::allocations.load(std::memory_order_relaxed),
+                    HeapCounters::deallocations.load(std::memory_order_relaxed),
+                    HeapCounters::bytes.load(std::memory_order_relaxed)};
+        }
+    };
+
+    /// @brief read a field of `/proc/self/status`
+    /// @param field name of the field (e.g. "VmRSS")
+    /// @return value of the field in bytes, 0 if it is not available
+    inline size_t proc_status_bytes(const std::string &field)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.compare(0, field.size() + 1, field + ":") == 0)
+            {
+                return std::stoul(line.substr(field.size() + 1)) * 1024; // the values are in kB
+            }
+        }
+        return 0;
+    }
+
+    /// @brief get the maximum resident set size of the process
+    /// @return peak RSS in bytes since the start of the process or the last reset
+    inline size_t peak_rss()
+    {
+        const size_t hwm = proc_status_bytes("VmHWM");
+        if (hwm > 0)
+        {
+            return hwm;
+        }
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+    }
+
+    /// @brief get the resident set size of the process
+    /// @return current RSS in bytes
+    inline size_t current_rss() { return proc_status_bytes("VmRSS"); }
+
+    /// @brief reset the peak resident set size of the process to the current one
+    /// @return true if the peak has been reset
+    inline bool reset_peak_rss()
+    {
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        return static_cast<bool>(clear_refs << "5" << std::flush);
+    }
+
+    /**
+     * @brief Allocations and resident memory of an operation (per run, averaged over the runs).
+     */
+    struct MemoryStatistics
+    {
+        bool counted = false;     /// true if the allocations are counted (allocation_hooks.hpp is linked)
+        double allocations = 0;   /// number of allocations per run
+        double deallocations = 0; /// number of deallocations per run
+        double bytes = 0;         /// bytes allocated per run
+        size_t peak_rss_delta = 0; /// maximum increase of the peak RSS over the current RSS, over the runs
+    };
+
+    /**
+     * @brief Measures the allocations and the peak RSS of the runs of an operation.
+     *
+     * The probe is started before and stopped after every run (outside the timed region), and
+     * accumulates the measurements of all the runs.
+     */
+    class MemoryProbe
+    {
+    public:
+        /// @brief start the measurement of a run
+        void start()
+        {
+            // the peak of the previous runs (and of the setup) is discarded
+            rss_reset = reset_peak_rss();
+            rss_before = rss_reset ? current_rss() : peak_rss();
+            before = HeapSnapshot::now();
+        }
+
+        /// @brief stop the measurement of a run
+        void stop()
+        {
+            const HeapSnapshot after = HeapSnapshot::now();
+            const size_t rss_after = peak_rss();
+            runs++;
+            allocations += after.allocations - before.allocations;
+            deallocations += after.deallocations - before.deallocations;
+            bytes += after.bytes - before.bytes;
+            peak_rss_delta = std::max(peak_rss_delta, rss_after > rss_before ? rss_after - rss_before : 0);
+        }
+
+        /// @brief get the measurements of the runs
+        /// @return allocations per run and maximum peak RSS delta
+        MemoryStatistics statistics() const
+        {
+            MemoryStatistics stats;
+            stats.counted = HeapCounters::interposed.load(std::memory_order_relaxed);
+            if (runs > 0)
+            {
+                stats.allocations = static_cast<double>(allocations) / runs;
+                stats.deallocations = static_cast<double>(deallocations) / runs;
+                stats.bytes = static_cast<double>(bytes) / runs;
+            }
+            stats.peak_rss_delta = peak_rss_delta;
+            return stats;
+        }
+
+    private:
+        HeapSnapshot before;       /// counters at the start of the current run
+        size_t rss_before = 0;     /// RSS at the start of the current run
+        bool rss_reset = false;    /// true if the peak RSS has been reset at the start of the current run
+        size_t runs = 0;           /// number of measured runs
+        size_t allocations = 0;    /// allocations of all the runs
+        size_t deallocations = 0;  /// deallocations of all the runs
+        size_t bytes = 0;          /// bytes allocated by all the runs
+        size_t peak_rss_delta = 0; /// maximum peak RSS delta of the runs
+    };
+}
+
+#endif // HEAP_PROFILE_HPP
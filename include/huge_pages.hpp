@@ -0,0 +1,269 @@
+/**
+ * @file huge_pages.hpp
+ * @brief Defines the aligned allocator of the compressed arrays, backed by huge pages for the large ones.
+ *
+ * Every vector of the compressed formats (see algebra::StorageVector) allocates its memory through
+ * algebra::AlignedAllocator:
+ * - the arrays smaller than a huge page (2 MB) are aligned to a cache line (64 bytes), so that the
+ *   vectorized loops start their loads at the beginning of a line;
+ * - the larger ones are mapped directly with `mmap`, aligned to a huge page, and backed by huge pages
+ *   according to the policy of algebra::HugePageSettings, to reduce the TLB misses of the products of
+ *   the large matrices:
+ *   - HugePages::None: normal pages (the default of the system still applies);
+ *   - HugePages::Transparent (default): the pages are marked with `madvise(MADV_HUGEPAGE)`, so that
+ *     the kernel backs them with transparent huge pages when `/sys/kernel/mm/transparent_hugepage/enabled`
+ *     is `always` or `madvise`;
+ *   - HugePages::Explicit: the pages are taken from the pool of the explicit huge pages with `MAP_HUGETLB`
+ *     (see `/proc/sys/vm/nr_hugepages`); when the pool is exhausted the allocation falls back to
+ *     transparent huge pages, and the fallback is counted.
+ *
+ * @code{.cpp}
+ * HugePageSettings::instance().set_policy(HugePages::Explicit);
+ * m.compress();
+ * std::cout << HugePageSettings::instance().fallbacks() << " fallbacks" << std::endl;
+ * @endcode
+ *
+ * The mapped memory is not touched by the allocation (the kernel zeroes the pages at the first write), so
+ * the placement on the NUMA nodes by the first touch is preserved (see numa.hpp). The mappings are counted
+ * as heap allocations by the hooks of allocation_hooks.hpp.
+ *
+ * @note The mappings are available only on Linux; on the other systems the large arrays are only aligned.
+ *
+ * @see memory_usage.hpp
+ * @see numa.hpp
+ */
+#ifndef HUGE_PAGES_HPP
+#define HUGE_PAGES_HPP
+
+#include "heap_profile.hpp"
+
+#include <new>
+#include <atomic>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace algebra
+{
+    /// @brief alignment of the compressed arrays (a cache line)
+    constexpr size_t storage_alignment = 64;
+
+    /// @brief size of a huge page, and minimum size of the arrays mapped directly
+    constexpr size_t huge_page_size = size_t(2) << 20;
+
+    /**
+     * @brief Enum class to specify the pages backing the large compressed arrays.
+     */
+    enum class HugePages
+    {
+        None,        /// normal pages
+        Transparent, /// transparent huge pages (madvise)
+        Explicit     /// explicit huge pages (MAP_HUGETLB), with fallback to transparent huge pages
+    };
+
+    /// @brief name of a huge page policy
+    /// @param policy huge page policy
+    /// @return name of the policy
+    inline std::string huge_pages_name(HugePages policy)
+    {
+        switch (policy)
+        {
+        case HugePages::None:
+            return "none";
+        case HugePages::Explicit:
+            return "explicit";
+        default:
+            return "transparent";
+        }
+    }
+
+    /**
+     * @brief Process-wide policy and counters of the huge pages of the compressed arrays.
+     */
+    class HugePageSettings
+    {
+    public:
+        /// @brief get the settings
+        /// @return reference to the settings of the process
+        static HugePageSettings &instance()
+        {
+            static HugePageSettings settings;
+            return settings;
+        }
+
+        /// @brief set the pages backing the arrays allocated from now on
+        /// @param policy huge page policy (None, Transparent or Explicit)
+        void set_policy(HugePages policy) { this->policy.store(policy, std::memory_order_relaxed); };
+
+        /// @brief get the pages backing the arrays allocated from now on
+        /// @return huge page policy in use
+        HugePages get_policy() const { return policy.load(std::memory_order_relaxed); };
+
+        /// @brief get the number of arrays mapped directly
+        /// @return number of mappings since the start of the process
+        size_t mappings() const { return mapping_count.load(std::memory_order_relaxed); };
+
+        /// @brief get the number of arrays mapped with explicit huge pages
+        /// @return number of MAP_HUGETLB mappings since the start of the process
+        size_t explicit_mappings() const { return explicit_count.load(std::memory_order_relaxed); };
+
+        /// @brief get the number of explicit huge page mappings that fell back to transparent huge pages
+        /// @return number of fallbacks since the start of the process
+        size_t fallbacks() const { return fallback_count.load(std::memory_order_relaxed); };
+
+        /// @brief map memory for a large array
+        /// @param bytes size of the array (at least huge_page_size)
+        /// @return memory aligned to a huge page, of bytes rounded up to a multiple of huge_page_size
+        /// @throws std::bad_alloc if the memory cannot be mapped
+        void *map(size_t bytes)
+        {
+            const size_t length = mapped_length(bytes);
+            void *pointer = nullptr;
+#ifdef __linux__
+            const HugePages current = get_policy();
+            if (current == HugePages::Explicit)
+            {
+                pointer = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (pointer == MAP_FAILED)
+                {
+                    pointer = nullptr;
+                    fallback_count.fetch_add(1, std::memory_order_relaxed);
+                }
+                else
+                {
+                    explicit_count.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            if (not pointer)
+            {
+                // map one huge page more and trim the ends, to align the mapping to a huge page
+                void *mapping = mmap(nullptr, length + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (mapping == MAP_FAILED)
+                {
+                    throw std::bad_alloc();
+                }
+                const uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+                const uintptr_t aligned = (start + huge_page_size - 1) / huge_page_size * huge_page_size;
+                if (aligned > start)
+                {
+                    munmap(mapping, aligned - start);
+                }
+                munmap(reinterpret_cast<void *>(aligned + length), start + huge_page_size - aligned);
+                pointer = reinterpret_cast<void *>(aligned);
+                if (current != HugePages::None)
+                {
+                    madvise(pointer, length, MADV_HUGEPAGE);
+                }
+            }
+            // the mappings bypass operator new: count them as heap allocations
+            if (HeapCounters::interposed)
+            {
+                HeapCounters::allocations.fetch_add(1, std::memory_order_relaxed);
+                HeapCounters::bytes.fetch_add(bytes, std::memory_order_relaxed);
+            }
+#else
+            pointer = ::operator new(length, std::align_val_t(storage_alignment));
+#endif
+            mapping_count.fetch_add(1, std::memory_order_relaxed);
+            return pointer;
+        }
+
+        /// @brief unmap the memory of a large array
+        /// @param pointer memory returned by map
+        /// @param bytes size of the array
+        void unmap(void *pointer, size_t bytes) noexcept
+        {
+#ifdef __linux__
+            if (HeapCounters::interposed)
+            {
+                HeapCounters::deallocations.fetch_add(1, std::memory_order_relaxed);
+            }
+            munmap(pointer, mapped_length(bytes));
+#else
+            ::operator delete(pointer, std::align_val_t(storage_alignment));
+#endif
+        }
+
+    private:
+        std::atomic<HugePages> policy = HugePages::Transparent; /// pages of the arrays allocated from now on
+        std::atomic<size_t> mapping_count = 0;                  /// number of arrays mapped directly
+        std::atomic<size_t> explicit_count = 0;                 /// number of arrays mapped with explicit huge pages
+        std::atomic<size_t> fallback_count = 0;                 /// number of fallbacks to transparent huge pages
+
+        /// @brief default constructor
+        HugePageSettings() = default;
+
+        /// @brief length of the mapping of an array
+        /// @param bytes size of the array
+        /// @return bytes rounded up to a multiple of huge_page_size
+        static size_t mapped_length(size_t bytes) { return (bytes + huge_page_size - 1) / huge_page_size * huge_page_size; };
+    };
+
+    /**
+     * @brief Allocator of the compressed arrays: aligned to a cache line, mapped on huge pages if large.
+     *
+     * The allocator is stateless: the kind of memory is decided by the size of the allocation only, so
+     * that the memory is released in the same way even if the policy changes in the meantime.
+     *
+     * @tparam T type of the allocated elements
+     */
+    template <typename T>
+    struct AlignedAllocator
+    {
+        using value_type = T;
+
+        /// @brief default constructor
+        AlignedAllocator() = default;
+
+        /// @brief converting constructor
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U> &) noexcept {};
+
+        /// @brief allocate memory for n elements
+        /// @param n number of elements
+        /// @return pointer to memory aligned to storage_alignment
+        T *allocate(size_t n)
+        {
+            if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+            {
+                throw std::bad_array_new_length();
+            }
+            const size_t bytes = n * sizeof(T);
+            if (bytes >= huge_page_size)
+            {
+                return static_cast<T *>(HugePageSettings::instance().map(bytes));
+            }
+            return static_cast<T *>(::operator new(bytes, std::align_val_t(alignment())));
+        }
+
+        /// @brief deallocate the memory of n elements
+        /// @param pointer pointer to the memory
+        /// @param n number of elements
+        void deallocate(T *pointer, size_t n) noexcept
+        {
+            const size_t bytes = n * sizeof(T);
+            if (bytes >= huge_page_size)
+            {
+                HugePageSettings::instance().unmap(pointer, bytes);
+                return;
+            }
+            ::operator delete(pointer, std::align_val_t(alignment()));
+        }
+
+        /// @brief all the instances are equal
+        template <typename U>
+        bool operator==(const AlignedAllocator<U> &) const noexcept { return true; };
+
+    private:
+        /// @brief alignment of the allocations
+        /// @return the larger of storage_alignment and the alignment of T
+        static constexpr size_t alignment() { return alignof(T) > storage_alignment ? alignof(T) : storage_alignment; };
+    };
+}
+
+#endif // HUGE_PAGES_HPP
@@ -8,6 +8,17 @@
 #include <cstring> // for strerror
 #include <cerrno>  // for errno
 #include <cassert>
+#include <iomanip>
+#include <limits>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+#include <typeinfo>
+
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
 
 namespace algebra
 {
@@ -17,7 +28,7 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     Matrix<T, S>::Matrix(const TransposeView<T, S> &view)
     {
-        auto matrix = view.matrix;
+        const auto &matrix = view.matrix;
 
         // set the number of rows and columns
         this->rows = matrix.get_cols();
@@ -73,7 +84,7 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     Matrix<T, S>::Matrix(const DiagonalView<T, S> &view)
     {
-        auto matrix = view.matrix;
+        const auto &matrix = view.matrix;
 
         // set the number of rows and columns
         this->rows = matrix.get_rows();
@@ -131,13 +142,44 @@ namespace algebra
         }
     }
 
+    /// @brief constructor from arrays in compressed format
+    /// @note the constructed matrix is in compressed format and takes ownership of the arrays
+    /// @param rows number of rows
+    /// @param cols number of columns
+    /// @param storage CSR (RowMajor) or CSC (ColumnMajor) arrays, with sorted indices in each row (column)
+    template <AddMulType T, StorageOrder S>
+    Matrix<T, S>::Matrix(size_t rows, size_t cols, CompressedStorage<T> &&storage)
+        : rows(rows), cols(cols), compressed(true), compressed_format(std::move(storage))
+    {
+        const size_t major_size = (S == StorageOrder::ColumnMajor) ? cols : rows;
+        const size_t minor_size = (S == StorageOrder::ColumnMajor) ? rows : cols;
+
+        // check the consistency of the arrays
+        if (compressed_format.inner.size() != major_size + 1 or compressed_format.inner.front() != 0 or
+            compressed_format.inner.back() != compressed_format.outer.size() or
+            compressed_format.outer.size() != compressed_format.values.size())
+        {
+            throw std::invalid_argument("Compressed arrays do not match the matrix dimensions");
+        }
+        if (not std::is_sorted(compressed_format.inner.begin(), compressed_format.inner.end()) or
+            std::any_of(compressed_format.outer.begin(), compressed_format.outer.end(),
+                        [minor_size](size_t idx)
+                        { return idx >= minor_size; }))
+        {
+            throw std::invalid_argument("Compressed arrays contain invalid indices");
+        }
+    }
+
     /// @brief move constructor
     /// @param other matrix to move
     template <AddMulType T, StorageOrder S>
     Matrix<T, S>::Matrix(Matrix &&other) noexcept
-        : rows(other.rows), cols(other.cols), compressed(other.compressed),
+        : rows(other.rows), cols(other.cols), compressed(other.compressed), kernel(other.kernel), placement(other.placement), context(std::move(other.context)),
+          recycle_buffers(other.recycle_buffers),
           uncompressed_format(std::move(other.uncompressed_format)),
-          compressed_format(std::move(other.compressed_format))
+          compressed_format(std::move(other.compressed_format)),
+          conversion_policy(other.conversion_policy), conversions(other.conversions),
+          pending_writes(std::move(other.pending_writes)), peak_memory(other.peak_memory)
     {
         other.rows = 0;
         other.cols = 0;
@@ -154,8 +196,16 @@ namespace algebra
             rows = other.rows;
             cols = other.cols;
             compressed = other.compressed;
+            kernel = other.kernel;
+            placement = other.placement;
+            context = std::move(other.context);
+            recycle_buffers = other.recycle_buffers;
             uncompressed_format = std::move(other.uncompressed_format);
             compressed_format = std::move(other.compressed_format);
+            conversion_policy = other.conversion_policy;
+            conversions = other.conversions;
+            pending_writes = std::move(other.pending_writes);
+            peak_memory = other.peak_memory;
             other.rows = 0;
             other.cols = 0;
             other.compressed = false;
@@ -170,15 +220,25 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     void Matrix<T, S>::set(size_t row, size_t col, const T &value)
     {
-        // check if the index is out of range
-        if (row >= rows or col >= cols)
-        {
-            throw std::out_of_range("Index out of range");
-        }
-        if (compressed)
+        check_bounds(row, col);
+        set_unchecked(row, col, value);
+    }
+
+    /// @brief set an element in the matrix, without checking the indices
+    /// @param row row index
+    /// @param col column index
+    /// @param value value to set
+    template <AddMulType T, StorageOrder S>
+    void Matrix<T, S>::set_unchecked(size_t row, size_t col, const T &value)
+    {
+        if (in_compressed_format())
         {
-            std::cout << "Matrix is compressed, uncompressing..." << std::endl;
-            uncompress();
+            if (conversion_policy == ConversionPolicy::Buffer)
+            {
+                buffer_write(row, col, value);
+                return;
+            }
+            implicit_uncompress();
         }
         if (value != T(0))
         {
@@ -200,13 +260,18 @@ namespace algebra
     {
         if (compressed)
             return;
+        if (outside_context(context))
+        {
+            return context->execute([this]()
+                                    { compress(); });
+        }
+        ALGEBRA_PROFILE(profile_name("compress", S, true));
+        ALGEBRA_TRACE(profile_name("compress", S, true));
 
-        // clear the compressed matrix
+        // size the compressed matrix exactly (the capacity of recycled vectors is reused)
         compressed_format.inner.clear();
-        compressed_format.outer.clear();
-        compressed_format.values.clear();
-
-        // reserve space for the compressed matrix
+        compressed_format.outer.resize(uncompressed_format.size());
+        compressed_format.values.resize(uncompressed_format.size());
         if constexpr (S == StorageOrder::ColumnMajor)
         {
             compressed_format.inner.resize(cols + 1);
@@ -223,6 +288,7 @@ namespace algebra
          */
         // fill the compressed matrix
         size_t index = 0;
+        size_t position = 0;
         for (const auto &it : uncompressed_format)
         {
             if constexpr (S == StorageOrder::ColumnMajor)
@@ -233,11 +299,11 @@ namespace algebra
                     // increment the index
                     index++;
 
-                    // set the inner index to the size of the outer vector
-                    compressed_format.inner[index] = compressed_format.outer.size();
+                    // set the inner index to the number of elements stored so far
+                    compressed_format.inner[index] = position;
                 }
                 // add the row index to the outer vector
-                compressed_format.outer.push_back(it.first.row);
+                compressed_format.outer[position] = it.first.row;
             }
             else
             {
@@ -247,14 +313,14 @@ namespace algebra
                     // increment the index
                     index++;
 
-                    // set the inner index to the size of the outer vector
-                    compressed_format.inner[index] = compressed_format.outer.size();
+                    // set the inner index to the number of elements stored so far
+                    compressed_format.inner[index] = position;
                 }
                 // add the column index to the outer vector
-                compressed_format.outer.push_back(it.first.col);
+                compressed_format.outer[position] = it.first.col;
             }
             // add the value to the values vector
-            compressed_format.values.push_back(it.second);
+            compressed_format.values[position++] = it.second;
         }
         if constexpr (S == StorageOrder::ColumnMajor)
         {
@@ -264,8 +330,8 @@ namespace algebra
                 // until the index reaches the value of the column index
                 index++;
 
-                // set the inner index to the size of the outer vector
-                compressed_format.inner[index] = compressed_format.outer.size();
+                // set the inner index to the number of elements stored so far
+                compressed_format.inner[index] = position;
             }
         }
         else
@@ -276,16 +342,22 @@ namespace algebra
                 // until the index reaches the value of the row index
                 index++;
 
-                // set the inner index to the size of the outer vector
-                compressed_format.inner[index] = compressed_format.outer.size();
+                // set the inner index to the number of elements stored so far
+                compressed_format.inner[index] = position;
             }
         }
 
+        // both formats are stored at this point
+        track_memory();
+
         // clear the uncompressed matrix
         uncompressed_format.clear();
 
         // update the compressed flag
         compressed = true;
+
+        // release the capacity of the vectors beyond their size, unless it is recycled
+        compact();
     };
 
     /// @brief compress the matrix in parallel if it is in an uncompressed format
@@ -294,162 +366,183 @@ namespace algebra
     {
         if (compressed)
             return;
-
-        // clear the compressed matrix
-        compressed_format.inner.clear();
-        compressed_format.outer.clear();
-        compressed_format.values.clear();
-
-        // reserve space for the compressed matrix
-        if constexpr (S == StorageOrder::ColumnMajor)
-        {
-            compressed_format.inner.resize(cols + 1);
-        }
-        else
-        {
-            compressed_format.inner.resize(rows + 1);
-        }
-        std::fill(std::execution::par_unseq, compressed_format.inner.begin(), compressed_format.inner.end(), 0);
-        const size_t nnz = get_nnz();
-        compressed_format.outer.resize(nnz);
-        compressed_format.values.resize(nnz);
-
-        // count non‑zeros per major index
-        std::vector<size_t> counts;
-        if constexpr (S == StorageOrder::ColumnMajor)
-        {
-            // resize the counts vector to the number of columns
-            counts.resize(cols, 0);
-
-            // count non-zeros per column using atomic operations
-            std::for_each(
-                std::execution::par,
-                uncompressed_format.begin(), uncompressed_format.end(),
-                [&](auto const &entry)
-                {
-                    size_t idx = entry.first.col;
-                    __atomic_fetch_add(&counts[idx], 1, __ATOMIC_RELAXED);
-                });
-        }
-        else
+        if (outside_context(context))
         {
-            // resize the counts vector to the number of rows
-            counts.resize(rows, 0);
-
-            // count non-zeros per row using atomic operations
-            std::for_each(
-                std::execution::par,
-                uncompressed_format.begin(), uncompressed_format.end(),
-                [&](auto const &entry)
-                {
-                    size_t idx = entry.first.row;
-                    __atomic_fetch_add(&counts[idx], 1, __ATOMIC_RELAXED);
-                });
+            return context->execute([this]()
+                                    { compress_parallel(); });
         }
+        ALGEBRA_PROFILE(profile_name("compress_parallel", S, true));
+        ALGEBRA_TRACE(profile_name("compress_parallel", S, true));
 
-        // exclusive prefix‐sum to build the "inner" index array
-        compressed_format.inner[0] = 0;
-        // Create a temporary vector to hold non-atomic values for the scan
-        std::vector<size_t> temp_counts(counts.size());
-        std::transform(std::execution::par, counts.begin(), counts.end(), temp_counts.begin(),
-                       [](const std::atomic<size_t> &atomic_val)
-                       { return atomic_val.load(); });
+        // count non‑zeros per major index: the count of a major index is stored after it
+        const size_t major_size = (S == StorageOrder::ColumnMajor) ? cols : rows;
+        std::vector<size_t> starts(major_size + 1, 0);
+        std::for_each(
+            std::execution::par,
+            uncompressed_format.begin(), uncompressed_format.end(),
+            [&](auto const &entry)
+            {
+                size_t idx = (S == StorageOrder::ColumnMajor) ? entry.first.col : entry.first.row;
+                __atomic_fetch_add(&starts[idx + 1], 1, __ATOMIC_RELAXED);
+            });
 
-        // Perform the inclusive scan on the temporary vector
-        std::inclusive_scan(std::execution::par, temp_counts.begin(), temp_counts.end(), compressed_format.inner.begin() + 1);
+        // prefix‐sum in place: starts[major] becomes the first index of the major index
+        std::inclusive_scan(std::execution::par, starts.begin(), starts.end(), starts.begin());
 
-        // allocate storage for the "outer" indices and values
-        compressed_format.outer.resize(nnz);
-        compressed_format.values.resize(nnz);
+        // the compressed arrays are allocated without initialization (see DefaultInitAllocator): every
+        // part is written first by the thread that processes it in the parallel products, so that its
+        // pages are placed on the NUMA node of that thread
+        compressed_format.inner.clear();
+        compressed_format.outer.clear();
+        compressed_format.values.clear();
+        compressed_format.inner.resize(major_size + 1);
+        compressed_format.outer.resize(starts.back());
+        compressed_format.values.resize(starts.back());
 
-        // fill the "outer" indices and values
-        std::vector<size_t> indices(uncompressed_format.size());
-        std::iota(indices.begin(), indices.end(), 0);
-        std::for_each(
-            std::execution::par,
-            indices.begin(), indices.end(),
-            [&](size_t index)
+        // fill the "inner" pointers, the "outer" indices and the values: every major index is located
+        // once in the map, then its entries are copied sequentially to their final position
+        const RowPartition partition(starts);
+        partition.for_each(
+            [&](size_t first_major, size_t end_major)
             {
-                auto it = std::next(uncompressed_format.begin(), index);
-                if constexpr (S == StorageOrder::ColumnMajor)
+                for (size_t major = first_major; major < end_major; major++)
                 {
-                    compressed_format.outer[index] = it->first.row;
+                    size_t index = starts[major];
+                    const size_t end = starts[major + 1];
+                    compressed_format.inner[major] = index;
+                    if (index == end)
+                    {
+                        continue;
+                    }
+                    Index first;
+                    if constexpr (S == StorageOrder::ColumnMajor)
+                    {
+                        first = {0, major};
+                    }
+                    else
+                    {
+                        first = {major, 0};
+                    }
+                    for (auto it = uncompressed_format.lower_bound(first); index < end; ++it, ++index)
+                    {
+                        if constexpr (S == StorageOrder::ColumnMajor)
+                        {
+                            compressed_format.outer[index] = it->first.row;
+                        }
+                        else
+                        {
+                            compressed_format.outer[index] = it->first.col;
+                        }
+                        compressed_format.values[index] = it->second;
+                    }
+                }
+                if (end_major == major_size)
+                {
+                    compressed_format.inner[major_size] = starts[major_size];
                 }
-                else
+                if (placement == Placement::Partitioned)
                 {
-                    compressed_format.outer[index] = it->first.col;
+                    const size_t offset = starts[first_major];
+                    const size_t count = starts[end_major] - offset;
+                    bind_pages_here(compressed_format.inner.data() + first_major, end_major - first_major);
+                    bind_pages_here(compressed_format.outer.data() + offset, count);
+                    bind_pages_here(compressed_format.values.data() + offset, count);
                 }
-                compressed_format.values[index] = it->second;
             });
+        if (placement == Placement::Interleaved)
+        {
+            interleave_pages(compressed_format.inner.data(), compressed_format.inner.size());
+            interleave_pages(compressed_format.outer.data(), compressed_format.outer.size());
+            interleave_pages(compressed_format.values.data(), compressed_format.values.size());
+        }
+
+        // both formats are stored at this point
+        track_memory();
 
-        // clear the compressed matrix
+        // clear the uncompressed matrix
         uncompressed_format.clear();
 
         // update the compressed flag
         compressed = true;
     }
 
+    /// @brief compress the matrix in the given compressed format
+    /// @param format compressed format (only CompressedFormat::Compressed is available for a general matrix)
+    template <AddMulType T, StorageOrder S>
+    void Matrix<T, S>::compress(CompressedFormat format)
+    {
+        if (format == CompressedFormat::ModifiedCompressed)
+        {
+            throw std::invalid_argument("Modified compressed format is available only for square matrices");
+        }
+        compress();
+    }
+
     /// @brief uncompress the matrix if it is in a compressed format
     template <AddMulType T, StorageOrder S>
     void Matrix<T, S>::uncompress()
     {
         if (not compressed)
             return;
+        ALGEBRA_PROFILE(profile_name("uncompress", S, true));
+        ALGEBRA_TRACE(profile_name("uncompress", S, true));
 
-        // clear the uncompressed matrix
-        uncompressed_format.clear();
-
-        // fill the uncompressed matrix
-        if constexpr (S == StorageOrder::ColumnMajor)
-        {
-            // iterate over columns of m
-            for (size_t col_idx = 0; col_idx < cols; col_idx++)
+        // fill the uncompressed matrix: the entries are in the order of the map, so that every one is
+        // inserted at the end in constant time
+        build_uncompressed(
+            compressed_format.inner,
+            [this](size_t first_major, size_t end_major, UncompressedStorage<T, S> &part)
             {
-                // iterate over rows of m that are non-zero in the column "col" of m
-                size_t start = compressed_format.inner[col_idx];
-                size_t end = compressed_format.inner[col_idx + 1];
-                for (size_t j = start; j < end; j++)
+                for (size_t major = first_major; major < end_major; major++)
                 {
-                    // get the row index of the non-zero element
-                    size_t row_idx = compressed_format.outer[j];
-
-                    // add the non-zero element to the uncompressed matrix
-                    uncompressed_format[{row_idx, col_idx}] = compressed_format.values[j];
-                }
-            }
-        }
-        else
-        {
-            // iterate over rows of m
-            for (size_t row_idx = 0; row_idx < rows; row_idx++)
-            {
-                // iterate over columns of m that are non-zero in the row "row" of m
-                size_t start = compressed_format.inner[row_idx];
-                size_t end = compressed_format.inner[row_idx + 1];
-                for (size_t j = start; j < end; j++)
-                {
-                    size_t col_idx = compressed_format.outer[j];
-                    uncompressed_format[{row_idx, col_idx}] = compressed_format.values[j];
+                    for (size_t j = compressed_format.inner[major]; j < compressed_format.inner[major + 1]; j++)
+                    {
+                        if constexpr (S == StorageOrder::ColumnMajor)
+                        {
+                            part.emplace_hint(part.end(), Index{compressed_format.outer[j], major}, compressed_format.values[j]);
+                        }
+                        else
+                        {
+                            part.emplace_hint(part.end(), Index{major, compressed_format.outer[j]}, compressed_format.values[j]);
+                        }
+                    }
                 }
-            }
-        }
+            });
 
-        // clear the compressed matrix
+        // both formats are stored at this point
+        track_memory();
+
+        // clear the compressed matrix and release its memory, unless it is recycled
         compressed_format.inner.clear();
         compressed_format.outer.clear();
         compressed_format.values.clear();
+        compact();
 
         // update the compressed flag
         compressed = false;
+
+        // merge the writes buffered while compressed
+        apply_pending_writes();
     };
 
     template <AddMulType T, StorageOrder S>
     T Matrix<T, S>::operator()(size_t row, size_t col) const
     {
-        // check if the index is in range
-        if (row >= rows or col >= cols)
+        check_bounds(row, col);
+        return get_unchecked(row, col);
+    };
+
+    template <AddMulType T, StorageOrder S>
+    T Matrix<T, S>::get_unchecked(size_t row, size_t col) const
+    {
+        // the buffered writes are more recent than the compressed format
+        if (not pending_writes.empty())
         {
-            throw std::out_of_range("Index out of range");
+            auto it = pending_writes.find({row, col});
+            if (it != pending_writes.end())
+            {
+                return it->second;
+            }
         }
         // check if the matrix is compressed
         if (not compressed)
@@ -494,14 +587,21 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     Proxy<T, S> Matrix<T, S>::operator()(size_t row, size_t col)
     {
-        if (row >= rows or col >= cols)
-        {
-            throw std::out_of_range("Index out of range");
-        }
-        if (compressed)
+        check_bounds(row, col);
+        return ref_unchecked(row, col);
+    }
+
+    template <AddMulType T, StorageOrder S>
+    Proxy<T, S> Matrix<T, S>::ref_unchecked(size_t row, size_t col)
+    {
+        if (in_compressed_format())
         {
-            std::cout << "Matrix is compressed, uncompressing...\n";
-            uncompress();
+            if (conversion_policy == ConversionPolicy::Buffer)
+            {
+                // every access is forwarded to the matrix, without uncompressing it
+                return Proxy<T, S>{*this, row, col};
+            }
+            implicit_uncompress();
         }
         return Proxy<T, S>{uncompressed_format, row, col};
     }
@@ -514,6 +614,7 @@ namespace algebra
 
         compressed = false; // default value
         uncompressed_format.clear();
+        pending_writes.clear();
         compressed_format.inner.clear();
         compressed_format.outer.clear();
         compressed_format.values.clear();
@@ -523,6 +624,12 @@ namespace algebra
     template <NormType N>
     double Matrix<T, S>::norm() const
     {
+        require_flushed();
+        if (outside_context(context))
+        {
+            return context->execute([this]()
+                                    { return norm<N>(); });
+        }
         if (typeid(*this) == typeid(SquareMatrix<T, S>))
         {
             auto *this_square = static_cast<const SquareMatrix<T, S> *>(this);
@@ -540,7 +647,7 @@ namespace algebra
                 {
                     col_sums[it.first.col] += std::abs(it.second);
                 }
-                return *std::max_element(std::execution::par_unseq, col_sums.begin(), col_sums.end());
+                return col_sums.empty() ? 0 : *std::max_element(std::execution::par_unseq, col_sums.begin(), col_sums.end());
             }
             else if constexpr (N == NormType::Infinity)
             {
@@ -549,7 +656,7 @@ namespace algebra
                 {
                     row_sums[it.first.row] += std::abs(it.second);
                 }
-                return *std::max_element(std::execution::par_unseq, row_sums.begin(), row_sums.end());
+                return row_sums.empty() ? 0 : *std::max_element(std::execution::par_unseq, row_sums.begin(), row_sums.end());
             }
             else
             {
@@ -575,7 +682,7 @@ namespace algebra
                         col_sums[col] += std::abs(compressed_format.values[j]);
                     }
                 }
-                return *std::max_element(std::execution::par_unseq, col_sums.begin(), col_sums.end());
+                return col_sums.empty() ? 0 : *std::max_element(std::execution::par_unseq, col_sums.begin(), col_sums.end());
             }
             else
             {
@@ -590,7 +697,7 @@ namespace algebra
                         col_sums[col] += std::abs(compressed_format.values[j]);
                     }
                 }
-                return *std::max_element(std::execution::par_unseq, col_sums.begin(), col_sums.end());
+                return col_sums.empty() ? 0 : *std::max_element(std::execution::par_unseq, col_sums.begin(), col_sums.end());
             }
         }
         else if constexpr (N == NormType::Infinity)
@@ -608,7 +715,7 @@ namespace algebra
                         row_sums[row] += std::abs(compressed_format.values[j]);
                     }
                 }
-                return *std::max_element(std::execution::par_unseq, row_sums.begin(), row_sums.end());
+                return row_sums.empty() ? 0 : *std::max_element(std::execution::par_unseq, row_sums.begin(), row_sums.end());
             }
             else
             {
@@ -622,7 +729,7 @@ namespace algebra
                         row_sums[row] += std::abs(compressed_format.values[j]);
                     }
                 }
-                return *std::max_element(std::execution::par_unseq, row_sums.begin(), row_sums.end());
+                return row_sums.empty() ? 0 : *std::max_element(std::execution::par_unseq, row_sums.begin(), row_sums.end());
             }
         }
         else
@@ -639,6 +746,8 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     void Matrix<T, S>::reader(const std::string &filename)
     {
+        ALGEBRA_PROFILE(profile_name("reader", S, false));
+        ALGEBRA_TRACE(profile_name("reader", S, false));
         std::ifstream file(filename);
         if (not file.is_open())
         {
@@ -698,13 +807,80 @@ namespace algebra
         file.close();
     };
 
+    template <AddMulType T, StorageOrder S>
+    void Matrix<T, S>::writer(const std::string &filename) const
+    {
+        require_flushed();
+        std::ofstream file(filename);
+        if (not file.is_open())
+        {
+            // more verbose error message
+            throw std::runtime_error("Unable to open file '" + filename + "': " + strerror(errno));
+        }
+
+        // write Matrix Market header and dimensions
+        file << "%%MatrixMarket matrix coordinate " << (is_complex<T>::value ? "complex" : "real") << " general\n";
+        file << rows << " " << cols << " " << get_nnz() << "\n";
+        file << std::setprecision(std::numeric_limits<AbsReturnType_t<T>>::max_digits10);
+
+        // write one element per line, with 1-based indices
+        auto write = [&file](size_t row, size_t col, const T &value)
+        {
+            file << row + 1 << " " << col + 1 << " ";
+            if constexpr (is_complex<T>::value)
+            {
+                file << value.real() << " " << value.imag() << "\n";
+            }
+            else
+            {
+                file << value << "\n";
+            }
+        };
+
+        if (compressed)
+        {
+            const size_t major_size = (S == StorageOrder::ColumnMajor) ? cols : rows;
+            for (size_t major = 0; major < major_size; major++)
+            {
+                for (size_t j = compressed_format.inner[major]; j < compressed_format.inner[major + 1]; j++)
+                {
+                    if constexpr (S == StorageOrder::ColumnMajor)
+                    {
+                        write(compressed_format.outer[j], major, compressed_format.values[j]);
+                    }
+                    else
+                    {
+                        write(major, compressed_format.outer[j], compressed_format.values[j]);
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (const auto &it : uncompressed_format)
+            {
+                write(it.first.row, it.first.col, it.second);
+            }
+        }
+
+        file.close();
+    };
+
     template <AddMulType T, StorageOrder S>
     std::vector<T> operator*(const Matrix<T, S> &m, const std::vector<T> &v)
     {
+        m.require_flushed();
         if (m.cols != v.size())
         {
             throw std::invalid_argument("Matrix and vector dimensions do not match for multiplication");
         }
+        if (outside_context(m.context))
+        {
+            return m.context->execute([&]()
+                                      { return m * v; });
+        }
+        ALGEBRA_PROFILE(profile_name("spmv", S, m.compressed, false, kernel_name(m.kernel)));
+        ALGEBRA_TRACE(profile_name("spmv", S, m.compressed, false, kernel_name(m.kernel)));
         std::vector<T> result(m.rows, T(0));
         if (not m.is_compressed())
         {
@@ -713,6 +889,59 @@ namespace algebra
                 result[it.first.row] += it.second * v[it.first.col];
             }
         }
+        else if (m.kernel == Kernel::Parallel)
+        {
+            // the parts are the ones written by each thread in compress_parallel (see numa.hpp)
+            const RowPartition partition(m.compressed_format.inner);
+            if constexpr (S == StorageOrder::ColumnMajor)
+            {
+                // each thread scatters a block of columns into its own partial result
+                tbb::enumerable_thread_specific<std::vector<T>> partial_results(m.rows, T(0));
+                partition.for_each(
+                    [&](size_t first_col, size_t end_col)
+                    {
+                        auto &partial = partial_results.local();
+                        for (size_t col = first_col; col < end_col; col++)
+                        {
+                            for (size_t j = m.compressed_format.inner[col]; j < m.compressed_format.inner[col + 1]; j++)
+                            {
+                                partial[m.compressed_format.outer[j]] += m.compressed_format.values[j] * v[col];
+                            }
+                        }
+                    });
+
+                // sum the partial results of the threads
+                tbb::parallel_for(
+                    tbb::blocked_range<size_t>(0, m.rows),
+                    [&](const tbb::blocked_range<size_t> &range)
+                    {
+                        for (const auto &partial : partial_results)
+                        {
+                            for (size_t row = range.begin(); row < range.end(); row++)
+                            {
+                                result[row] += partial[row];
+                            }
+                        }
+                    });
+            }
+            else
+            {
+                // rows are independent: each thread computes a block of entries of the result
+                partition.for_each(
+                    [&](size_t first_row, size_t end_row)
+                    {
+                        for (size_t row = first_row; row < end_row; row++)
+                        {
+                            T sum = T(0);
+                            for (size_t j = m.compressed_format.inner[row]; j < m.compressed_format.inner[row + 1]; j++)
+                            {
+                                sum += m.compressed_format.values[j] * v[m.compressed_format.outer[j]];
+                            }
+                            result[row] = sum;
+                        }
+                    });
+            }
+        }
         else
         {
             if constexpr (S == StorageOrder::ColumnMajor)
@@ -763,6 +992,8 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     Matrix<T, S> operator*(const Matrix<T, S> &m1, const Matrix<T, S> &m2)
     {
+        m1.require_flushed();
+        m2.require_flushed();
         if (m1.cols != m2.rows)
         {
             throw std::invalid_argument("Matrix dimensions do not match for multiplication");
@@ -771,6 +1002,8 @@ namespace algebra
         {
             throw std::invalid_argument("Matrix compression formats do not match");
         }
+        ALGEBRA_PROFILE(profile_name("spgemm", S, m1.compressed, false, kernel_name(m1.kernel)));
+        ALGEBRA_TRACE(profile_name("spgemm", S, m1.compressed, false, kernel_name(m1.kernel)));
 
         Matrix<T, S> result(m1.rows, m2.cols);
 
@@ -789,54 +1022,437 @@ namespace algebra
         }
         else
         {
-            if constexpr (S == StorageOrder::ColumnMajor)
+            // the product of two compressed matrices is built directly in compressed format
+            Matrix<T, S>::multiply_compressed(m1, m2, result.compressed_format);
+            result.compressed = true;
+        }
+        return result;
+    }
+
+    /// @brief multiply a temporary matrix with another matrix
+    /// @note for RowMajor matrices the rows of m1 are consumed in order, so the product is written in its compressed arrays
+    template <AddMulType T, StorageOrder S>
+    Matrix<T, S> operator*(Matrix<T, S> &&m1, const Matrix<T, S> &m2)
+    {
+        if constexpr (S == StorageOrder::RowMajor)
+        {
+            if (m1.compressed and m2.compressed and &m1 != &m2)
             {
-                // iterate over columns of m2
-                for (size_t col = 0; col < m2.cols; col++)
-                {
-                    // iterate over rows of m2 (and columns of m1) that are non-zero in the column "col" of m2
-                    for (size_t k = m2.compressed_format.inner[col]; k < m2.compressed_format.inner[col + 1]; k++)
-                    {
-                        // j = row of m2 (or column of m1) that we are currently processing
-                        size_t j = m2.compressed_format.outer[k];
+                return Matrix<T, S>::multiply_recycled(m1, m2, m1);
+            }
+        }
+        return std::as_const(m1) * m2;
+    }
 
-                        // iterate over rows of m1 that are non-zero in the column j of m1
-                        for (size_t i = m1.compressed_format.inner[j]; i < m1.compressed_format.inner[j + 1]; i++)
-                        {
-                            // row = row of m1 corresponding to the index i
-                            size_t row = m1.compressed_format.outer[i];
+    /// @brief multiply a matrix with a temporary matrix
+    /// @note for ColumnMajor matrices the columns of m2 are consumed in order, so the product is written in its compressed arrays
+    template <AddMulType T, StorageOrder S>
+    Matrix<T, S> operator*(const Matrix<T, S> &m1, Matrix<T, S> &&m2)
+    {
+        if constexpr (S == StorageOrder::ColumnMajor)
+        {
+            if (m1.compressed and m2.compressed and &m1 != &m2)
+            {
+                return Matrix<T, S>::multiply_recycled(m1, m2, m2);
+            }
+        }
+        return m1 * std::as_const(m2);
+    }
 
-                            // add the product of the non-zero elements to the "result" matrix
-                            result(row, col) += m1.compressed_format.values[i] * m2.compressed_format.values[k];
-                        }
+    /// @brief multiply two temporary matrices
+    template <AddMulType T, StorageOrder S>
+    Matrix<T, S> operator*(Matrix<T, S> &&m1, Matrix<T, S> &&m2)
+    {
+        if constexpr (S == StorageOrder::ColumnMajor)
+        {
+            return std::as_const(m1) * std::move(m2);
+        }
+        else
+        {
+            return std::move(m1) * std::as_const(m2);
+        }
+    }
+
+    /// @brief multiply two matrices, writing the product in a matrix provided by the caller
+    template <AddMulType T, StorageOrder S>
+    void multiply_into(const Matrix<T, S> &m1, const Matrix<T, S> &m2, Matrix<T, S> &result)
+    {
+        if (&result == &m1 or &result == &m2)
+        {
+            throw std::invalid_argument("The result of multiply_into must not be one of the operands");
+        }
+        if (typeid(result) != typeid(Matrix<T, S>))
+        {
+            throw std::invalid_argument("The result of multiply_into must be a Matrix");
+        }
+        m1.require_flushed();
+        m2.require_flushed();
+        if (not(m1.compressed and m2.compressed))
+        {
+            result = m1 * m2;
+            return;
+        }
+        if (m1.cols != m2.rows)
+        {
+            throw std::invalid_argument("Matrix dimensions do not match for multiplication");
+        }
+        ALGEBRA_PROFILE(profile_name("spgemm", S, true, false, kernel_name(m1.kernel)));
+        ALGEBRA_TRACE(profile_name("spgemm", S, true, false, kernel_name(m1.kernel)));
+
+        // the settings of the result are kept, its contents are replaced
+        result.uncompressed_format.clear();
+        result.pending_writes.clear();
+        Matrix<T, S>::multiply_compressed(m1, m2, result.compressed_format);
+        result.rows = m1.rows;
+        result.cols = m2.cols;
+        result.compressed = true;
+    }
+
+    /// @brief multiply two compressed matrices, recycling the compressed arrays of one of them for the product
+    /// @param m1 first matrix, compressed
+    /// @param m2 second matrix, compressed
+    /// @param recycled operand whose rows (RowMajor) or columns (ColumnMajor) are consumed in order, m1 or m2
+    /// @return the product in compressed format, with the settings of the recycled operand
+    template <AddMulType T, StorageOrder S>
+    Matrix<T, S> Matrix<T, S>::multiply_recycled(const Matrix &m1, const Matrix &m2, Matrix &recycled)
+    {
+        m1.require_flushed();
+        m2.require_flushed();
+        if (m1.cols != m2.rows)
+        {
+            throw std::invalid_argument("Matrix dimensions do not match for multiplication");
+        }
+        ALGEBRA_PROFILE(profile_name("spgemm", S, true, false, kernel_name(m1.kernel)));
+        ALGEBRA_TRACE(profile_name("spgemm", S, true, false, kernel_name(m1.kernel)));
+
+        const size_t rows = m1.rows;
+        const size_t cols = m2.cols;
+        multiply_compressed(m1, m2, recycled.compressed_format);
+        Matrix<T, S> result(std::move(recycled));
+        result.rows = rows;
+        result.cols = cols;
+        result.compressed = true;
+        return result;
+    }
+
+    /// @brief multiply two compressed matrices with a dense accumulator (Gustavson), in compressed format
+    /// @param m1 first matrix, compressed
+    /// @param m2 second matrix, compressed
+    /// @param product compressed arrays of the product: their capacity is reused, and they can be the arrays of the
+    ///        operand whose rows (RowMajor) or columns (ColumnMajor) are consumed in order, i.e. m1 (RowMajor) or m2 (ColumnMajor)
+    template <AddMulType T, StorageOrder S>
+    void Matrix<T, S>::multiply_compressed(const Matrix &m1, const Matrix &m2, CompressedStorage<T> &product)
+    {
+        // every major index of the product combines the entries of the same major index of "left"
+        // with the major indices of "right": rows of m1 and m2 (CSR), columns of m2 and m1 (CSC)
+        constexpr bool column_major = (S == StorageOrder::ColumnMajor);
+        const CompressedStorage<T> &left = column_major ? m2.compressed_format : m1.compressed_format;
+        const CompressedStorage<T> &right = column_major ? m1.compressed_format : m2.compressed_format;
+        const size_t major_size = column_major ? m2.cols : m1.rows;
+        const size_t minor_size = column_major ? m1.rows : m2.cols;
+        const bool in_place = (&left == &product);
+
+        // source of the entries of left not consumed yet: moved aside if the product outgrows them
+        const size_t *left_outer = left.outer.data();
+        const T *left_values = left.values.data();
+        size_t left_offset = 0;
+        std::vector<size_t> spilled_outer;
+        std::vector<T> spilled_values;
+        bool spilled = false;
+
+        // the capacity of the arrays of the product is reused (the allocator does not initialize them)
+        if (not in_place)
+        {
+            product.inner.resize(major_size + 1);
+            product.outer.resize(product.outer.capacity());
+            product.values.resize(product.values.capacity());
+        }
+
+        std::vector<T> accumulator(minor_size, T(0));
+        std::vector<bool> occupied(minor_size, false);
+        std::vector<size_t> touched;
+        std::vector<size_t> major_outer;
+        std::vector<T> major_values;
+
+        size_t begin = left.inner.empty() ? 0 : left.inner[0];
+        size_t written = 0;
+        for (size_t major = 0; major < major_size; major++)
+        {
+            const size_t end = left.inner[major + 1];
+
+            // copy the entries of the major index of left, which can be overwritten by the product
+            major_outer.assign(left_outer + (begin - left_offset), left_outer + (end - left_offset));
+            major_values.assign(left_values + (begin - left_offset), left_values + (end - left_offset));
+
+            // accumulate the products in the order of the entries, as the uncompressed product does
+            touched.clear();
+            for (size_t j = 0; j < major_outer.size(); j++)
+            {
+                const size_t k = major_outer[j];
+                for (size_t i = right.inner[k]; i < right.inner[k + 1]; i++)
+                {
+                    const size_t minor = right.outer[i];
+                    if (not occupied[minor])
+                    {
+                        occupied[minor] = true;
+                        touched.push_back(minor);
+                    }
+                    if constexpr (column_major)
+                    {
+                        accumulator[minor] += right.values[i] * major_values[j];
+                    }
+                    else
+                    {
+                        accumulator[minor] += major_values[j] * right.values[i];
                     }
                 }
             }
-            else
+            std::sort(touched.begin(), touched.end());
+
+            // the entries of the product must not overwrite the entries of left not consumed yet
+            const size_t needed = written + touched.size();
+            if (in_place and not spilled and needed > end)
+            {
+                spilled_outer.assign(left.outer.begin() + end, left.outer.end());
+                spilled_values.assign(left.values.begin() + end, left.values.end());
+                left_outer = spilled_outer.data();
+                left_values = spilled_values.data();
+                left_offset = end;
+                spilled = true;
+            }
+            if (needed > product.outer.size() and (not in_place or spilled))
+            {
+                product.outer.resize(std::max(needed, 2 * product.outer.size()));
+                product.values.resize(product.outer.size());
+            }
+
+            // store the non-zero elements (the cancellations are not stored, as for the uncompressed product)
+            for (const auto minor : touched)
             {
-                // iterate over rows of m1
-                for (size_t row = 0; row < m1.rows; row++)
+                if (accumulator[minor] != T(0))
                 {
-                    // iterate over columns of m1 (and rows of m2) that are non-zero in the row "row" of m1
-                    for (size_t j = m1.compressed_format.inner[row]; j < m1.compressed_format.inner[row + 1]; j++)
-                    {
-                        // k = column of m1 (or row of m2) that we are currently processing
-                        size_t k = m1.compressed_format.outer[j];
+                    product.outer[written] = minor;
+                    product.values[written] = accumulator[minor];
+                    written++;
+                }
+                accumulator[minor] = T(0);
+                occupied[minor] = false;
+            }
+            product.inner[major + 1] = written;
+            begin = end;
+        }
+        if (major_size + 1 != product.inner.size())
+        {
+            product.inner.resize(major_size + 1);
+        }
+        product.inner[0] = 0;
+        product.outer.resize(written);
+        product.values.resize(written);
+    }
 
-                        // iterate over columns of m2 that are non-zero in the row k of m2
-                        for (size_t i = m2.compressed_format.inner[k]; i < m2.compressed_format.inner[k + 1]; i++)
-                        {
-                            // col = column of m2 corresponding to the index i
-                            size_t col = m2.compressed_format.outer[i];
+    /// @brief merge the buffered writes in the compressed format the matrix is stored in
+    template <AddMulType T, StorageOrder S>
+    void Matrix<T, S>::flush()
+    {
+        if (pending_writes.empty())
+            return;
+        ALGEBRA_PROFILE(profile_name("flush", S, compressed, not compressed));
+        ALGEBRA_TRACE(profile_name("flush", S, compressed, not compressed));
+        const auto start = std::chrono::steady_clock::now();
+        const size_t bytes = compressed_bytes();
+        const bool modified = not compressed;
 
-                            // add the product of the non-zero elements to the "result" matrix
-                            result(row, col) += m1.compressed_format.values[j] * m2.compressed_format.values[i];
-                        }
-                    }
+        // uncompress (merging the buffered writes) and compress again in the same format
+        uncompress();
+        const size_t map_bytes = uncompressed_format.size() * (sizeof(T) + 2 * sizeof(size_t));
+        compress(modified ? CompressedFormat::ModifiedCompressed : CompressedFormat::Compressed);
+
+        ConversionStatistics statistics;
+        statistics.uncompressions = 1;
+        statistics.compressions = 1;
+        statistics.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        statistics.bytes = bytes + compressed_bytes() + 2 * map_bytes;
+        conversions += statistics;
+        ConversionMonitor::instance().record(statistics);
+    }
+
+    /// @brief get the size of the compressed format the matrix is stored in
+    /// @return bytes of the compressed arrays
+    template <AddMulType T, StorageOrder S>
+    size_t Matrix<T, S>::compressed_bytes() const
+    {
+        return compressed_format.values.size() * sizeof(T) +
+               (compressed_format.outer.size() + compressed_format.inner.size()) * sizeof(size_t);
+    }
+
+    /// @brief overwrite an existing element of the compressed format
+    /// @param row row index
+    /// @param col column index
+    /// @param value non-zero value to set
+    /// @return true if the element is stored in the compressed format (and has been overwritten)
+    template <AddMulType T, StorageOrder S>
+    bool Matrix<T, S>::write_in_place(size_t row, size_t col, const T &value)
+    {
+        if (not compressed or value == T(0))
+            return false;
+        const size_t major = (S == StorageOrder::ColumnMajor) ? col : row;
+        const size_t minor = (S == StorageOrder::ColumnMajor) ? row : col;
+
+        // the indices of every row (column) are sorted
+        const auto first = compressed_format.outer.begin() + compressed_format.inner[major];
+        const auto last = compressed_format.outer.begin() + compressed_format.inner[major + 1];
+        const auto it = std::lower_bound(first, last, minor);
+        if (it == last or *it != minor)
+            return false;
+        compressed_format.values[it - compressed_format.outer.begin()] = value;
+        return true;
+    }
+
+    /// @brief rebuild the uncompressed format from the entries of a compressed format
+    /// @param starts starting index of the entries of every major index (major size + 1 entries)
+    /// @param fill function appending the entries of the major indices in order, with the end of the map as hint
+    template <AddMulType T, StorageOrder S>
+    template <typename Vector, typename Fill>
+    void Matrix<T, S>::build_uncompressed(const Vector &starts, Fill &&fill)
+    {
+        // below this size, the parallel allocation of the nodes does not pay for the splice
+        constexpr size_t min_parallel_nnz = size_t(1) << 15;
+
+        uncompressed_format.clear();
+        const size_t major_size = starts.empty() ? 0 : starts.size() - 1;
+        const size_t nnz = starts.empty() ? 0 : starts[major_size] - starts[0];
+        const auto build = [&]()
+        {
+            const RowPartition partition(starts);
+            if (nnz < min_parallel_nnz or partition.size() < 2)
+            {
+                fill(size_t(0), major_size, uncompressed_format);
+                return;
+            }
+            // every part allocates and links its nodes in a separate map
+            std::vector<UncompressedStorage<T, S>> parts(partition.size());
+            tbb::parallel_for(size_t(0), partition.size(), [&](size_t part)
+                              { fill(partition.begin(part), partition.end(part), parts[part]); });
+
+            // the parts are consecutive: their nodes are moved at the end of the map, without copies
+            for (auto &part : parts)
+            {
+                while (not part.empty())
+                {
+                    uncompressed_format.insert(uncompressed_format.end(), part.extract(part.begin()));
                 }
             }
+        };
+        if (outside_context(context))
+        {
+            context->execute(build);
         }
-        return result;
+        else
+        {
+            build();
+        }
+    }
+
+    /// @brief uncompress the matrix before a write, according to the conversion policy
+    template <AddMulType T, StorageOrder S>
+    void Matrix<T, S>::implicit_uncompress()
+    {
+        const char *format = format_name(S, compressed, in_compressed_format() and not compressed);
+        if (conversion_policy == ConversionPolicy::Throw)
+        {
+            throw std::runtime_error(std::string("Implicit uncompression of a matrix in ") + format +
+                                     " format (the conversion policy is Throw)");
+        }
+        if (conversion_policy == ConversionPolicy::WarnOnce)
+        {
+            ConversionMonitor::instance().warn_once(format);
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const size_t bytes = compressed_bytes();
+
+        uncompress();
+
+        ConversionStatistics statistics;
+        statistics.uncompressions = 1;
+        statistics.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        statistics.bytes = bytes + uncompressed_format.size() * (sizeof(T) + 2 * sizeof(size_t));
+        conversions += statistics;
+        ConversionMonitor::instance().record(statistics);
+    }
+
+    /// @brief write an element of the compressed matrix in place, or buffer the write
+    /// @param row row index
+    /// @param col column index
+    /// @param value value to set
+    template <AddMulType T, StorageOrder S>
+    void Matrix<T, S>::buffer_write(size_t row, size_t col, const T &value)
+    {
+        ConversionStatistics statistics;
+        if (write_in_place(row, col, value))
+        {
+            // a previous buffered write of the same element is outdated
+            pending_writes.erase({row, col});
+            statistics.in_place_writes = 1;
+        }
+        else
+        {
+            pending_writes[{row, col}] = value;
+            statistics.buffered_writes = 1;
+        }
+        conversions += statistics;
+        ConversionMonitor::instance().record(statistics);
+    }
+
+    /// @brief merge the buffered writes in the uncompressed format
+    template <AddMulType T, StorageOrder S>
+    void Matrix<T, S>::apply_pending_writes()
+    {
+        for (const auto &[index, value] : pending_writes)
+        {
+            if (value != T(0))
+            {
+                uncompressed_format[index] = value;
+            }
+            else
+            {
+                uncompressed_format.erase(index);
+            }
+        }
+        pending_writes.clear();
+    }
+
+    /// @brief check that no write is buffered before reading the compressed format
+    template <AddMulType T, StorageOrder S>
+    void Matrix<T, S>::require_flushed() const
+    {
+        if (not pending_writes.empty())
+        {
+            throw std::runtime_error("The matrix has " + std::to_string(pending_writes.size()) +
+                                     " buffered writes, call flush() first");
+        }
+    }
+
+    /// @brief get the bytes used by each component of the storage
+    /// @return memory usage of the uncompressed and compressed formats
+    template <AddMulType T, StorageOrder S>
+    MemoryUsage Matrix<T, S>::memory_usage() const
+    {
+        MemoryUsage usage;
+        usage.map_nodes = uncompressed_format.size() + pending_writes.size();
+        usage.map = usage.map_nodes * map_node_bytes<typename UncompressedStorage<T, S>::value_type>();
+        vector_usage(compressed_format.inner, usage.inner, usage.slack);
+        vector_usage(compressed_format.outer, usage.outer, usage.slack);
+        vector_usage(compressed_format.values, usage.values, usage.slack);
+        return usage;
+    }
+
+    /// @brief release the memory allocated by the vectors of the compressed formats beyond their size
+    template <AddMulType T, StorageOrder S>
+    void Matrix<T, S>::shrink_to_fit()
+    {
+        compressed_format.inner.shrink_to_fit();
+        compressed_format.outer.shrink_to_fit();
+        compressed_format.values.shrink_to_fit();
     }
 
     template <AddMulType T, StorageOrder S>
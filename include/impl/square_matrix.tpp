@@ -6,6 +6,13 @@
 #include <cerrno>  // for errno
 #include <cassert>
 #include <execution>
+#include <iomanip>
+#include <limits>
+#include <algorithm>
+
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
 
 #include "square_matrix.hpp"
 
@@ -85,83 +92,88 @@ namespace algebra
     {
         if (modified)
             return;
+        if (outside_context(this->context))
+        {
+            return this->context->execute([this]()
+                                          { compress_mod(); });
+        }
+        if (this->rows == 0)
+        {
+            // an empty matrix has no diagonal to store: it is kept in the compressed format
+            compress();
+            return;
+        }
+        ALGEBRA_PROFILE(profile_name("compress_mod", S, true, true));
+        ALGEBRA_TRACE(profile_name("compress_mod", S, true, true));
 
-        // clear the modified compressed matrix
-        compressed_format_mod.values.clear();
-        compressed_format_mod.bind.clear();
-
-        // reserve space for modified compressed structure
-        const size_t size = get_mod_size(); // nnz + extra space for possible zero diagonal elements
-        compressed_format_mod.values.resize(size);
-        compressed_format_mod.bind.resize(size);
-        std::fill(std::execution::par_unseq, compressed_format_mod.values.begin(), compressed_format_mod.values.end(), T(0));
-        std::fill(std::execution::par_unseq, compressed_format_mod.bind.begin(), compressed_format_mod.bind.end(), 0);
-
-        // to store correctly the pointers in the bind vector (that doesn't account for the diagonal elements)
-        size_t off_diag_idx = 0;
+        const size_t size = this->rows;
+        auto &values = compressed_format_mod.values;
+        auto &bind = compressed_format_mod.bind;
+        values.clear();
+        bind.clear();
 
-        if (this->compressed)
+        // store an element of a major index: the diagonal one in its place, the off-diagonal ones in order
+        const auto store = [&](size_t major, size_t minor, const T &value, size_t &position)
         {
-            if constexpr (S == StorageOrder::ColumnMajor)
+            if (minor == major)
             {
-                // iterate over columns of m
-                for (size_t col_idx = 0; col_idx < this->cols; col_idx++)
-                {
-                    // set col pointer
-                    compressed_format_mod.bind[col_idx] = off_diag_idx + this->rows;
-
-                    // iterate over rows of m that are non-zero in the column "col" of m
-                    size_t start = this->compressed_format.inner[col_idx];
-                    size_t end = this->compressed_format.inner[col_idx + 1];
-                    for (size_t j = start; j < end; j++)
-                    {
-                        // get the row index of the non-zero element
-                        size_t row_idx = this->compressed_format.outer[j];
-
-                        // distinguish diagonal and off-diagonal elements
-                        if (row_idx == col_idx)
-                        { // diagonal element
-                            compressed_format_mod.values[row_idx] = this->compressed_format.values[j];
-                        }
-                        else
-                        { // off-diagonal element
-                            compressed_format_mod.values[this->rows + off_diag_idx] = this->compressed_format.values[j];
-                            compressed_format_mod.bind[this->rows + off_diag_idx] = row_idx;
-                            ++off_diag_idx;
-                        }
-                    }
-                }
+                values[major] = value;
             }
             else
             {
-                // iterate over rows of m
-                for (size_t row_idx = 0; row_idx < this->rows; row_idx++)
-                {
-                    // set row pointer
-                    compressed_format_mod.bind[row_idx] = off_diag_idx + this->rows;
+                values[position] = value;
+                bind[position] = minor;
+                ++position;
+            }
+        };
 
-                    // iterate over columns of m that are non-zero in the row "row" of m
-                    size_t start = this->compressed_format.inner[row_idx];
-                    size_t end = this->compressed_format.inner[row_idx + 1];
-                    for (size_t j = start; j < end; j++)
+        if (this->compressed)
+        {
+            const auto &inner = this->compressed_format.inner;
+            const auto &outer = this->compressed_format.outer;
+
+            // count the off-diagonal elements of every major index: the count of a major index is stored after it
+            std::vector<size_t> starts(size + 1, 0);
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, size),
+                              [&](const tbb::blocked_range<size_t> &range)
+                              {
+                                  for (size_t major = range.begin(); major < range.end(); ++major)
+                                  {
+                                      // the indices of every major index are sorted
+                                      const auto first = outer.begin() + inner[major];
+                                      const auto last = outer.begin() + inner[major + 1];
+                                      starts[major + 1] = (last - first) - std::binary_search(first, last, major);
+                                  }
+                              });
+
+            // prefix-sum in place, after the diagonal: starts[major] becomes the first off-diagonal index of the major index
+            starts[0] = size;
+            std::inclusive_scan(std::execution::par, starts.begin(), starts.end(), starts.begin());
+
+            // the arrays are allocated without initialization: every element is written once by the scatter
+            values.resize(starts[size]);
+            bind.resize(starts[size]);
+
+            // scatter the elements of contiguous ranges of major indices in parallel, with the partition of the
+            // parallel kernel (see mod_partition)
+            const RowPartition partition(starts);
+            partition.for_each(
+                [&](size_t first_major, size_t end_major)
+                {
+                    for (size_t major = first_major; major < end_major; ++major)
                     {
-                        // get the col index of the non-zero element
-                        size_t col_idx = this->compressed_format.outer[j];
-
-                        // distinguish diagonal and off-diagonal elements
-                        if (row_idx == col_idx)
-                        { // diagonal element
-                            compressed_format_mod.values[row_idx] = this->compressed_format.values[j];
-                        }
-                        else
-                        { // off-diagonal element
-                            compressed_format_mod.values[this->rows + off_diag_idx] = this->compressed_format.values[j];
-                            compressed_format_mod.bind[this->rows + off_diag_idx] = col_idx;
-                            ++off_diag_idx;
+                        size_t position = starts[major];
+                        bind[major] = position;
+                        values[major] = T(0); // the diagonal elements that are not stored are zero
+                        for (size_t j = inner[major]; j < inner[major + 1]; ++j)
+                        {
+                            store(major, outer[j], this->compressed_format.values[j], position);
                         }
                     }
-                }
-            }
+                });
+
+            // both formats are stored at this point
+            this->track_memory();
 
             // clear the compressed matrix
             this->compressed_format.inner.clear();
@@ -170,58 +182,81 @@ namespace algebra
         }
         else
         {
-            if constexpr (S == StorageOrder::ColumnMajor)
+            // the modified compressed format is built directly from the map, without the compressed format:
+            // the entries of a range of major indices are consecutive in the map
+            const auto major_of = [](const Index &index)
+            { return (S == StorageOrder::ColumnMajor) ? index.col : index.row; };
+            const auto minor_of = [](const Index &index)
+            { return (S == StorageOrder::ColumnMajor) ? index.row : index.col; };
+            const auto first_entry = [this](size_t major)
+            { return this->uncompressed_format.lower_bound((S == StorageOrder::ColumnMajor) ? Index{0, major} : Index{major, 0}); };
+
+            // copy the entries of a range of major indices, setting the pointers of the major indices on the way
+            const auto scatter = [&](size_t first_major, size_t end_major, size_t position)
             {
-
-                for (const auto &it : this->uncompressed_format)
+                size_t major = first_major; // next major index whose pointer is not set
+                const auto start = [&](size_t last)
                 {
-                    if (it.first.col == it.first.row)
-                    { // diagonal element
-                        compressed_format_mod.values[it.first.row] = it.second;
-                    }
-                    else
-                    { // off-diagonal element
-                        compressed_format_mod.values[this->rows + off_diag_idx] = it.second;
-                        compressed_format_mod.bind[this->rows + off_diag_idx] = it.first.row;
-                        ++off_diag_idx;
-                        // set column pointers
-                        if (it.first.col < this->cols - 1)
-                            ++compressed_format_mod.bind[it.first.col + 1];
+                    for (; major <= last; ++major)
+                    {
+                        bind[major] = position;
+                        values[major] = T(0); // the diagonal elements that are not stored are zero
                     }
+                };
+                for (auto it = first_entry(major); it != this->uncompressed_format.end() and major_of(it->first) < end_major; ++it)
+                {
+                    start(major_of(it->first));
+                    store(major_of(it->first), minor_of(it->first), it->second, position);
                 }
-            }
-            else
+                if (major < end_major)
+                {
+                    start(end_major - 1);
+                }
+            };
+
+            const size_t parts = std::min(RowPartition::default_parts(), size);
+            if (parts == 1)
             {
-                for (const auto &it : this->uncompressed_format)
+                // a single thread: the diagonal elements are looked up, instead of counting all the elements
+                size_t diagonal = 0;
+                for (size_t i = 0; i < size; ++i)
                 {
-                    // std::cout << "\nInserting element-> Row: " << it.first.row << ", Col: " << it.first.col << ", Value: " << it.second << std::endl;
-                    if (it.first.col == it.first.row)
-                    { // diagonal element
-                        compressed_format_mod.values[it.first.row] = it.second;
-                    }
-                    else
-                    { // off-diagonal element
-                        // std::cout << "Setting values vector[" << this->rows + off_diag_idx << "] to " << it.second << std::endl;
-                        compressed_format_mod.values[this->rows + off_diag_idx] = it.second;
-                        // std::cout << "Setting bind vector[" << this->rows + off_diag_idx << "] to " << it.first.col << std::endl;
-                        compressed_format_mod.bind[this->rows + off_diag_idx] = it.first.col;
-                        ++off_diag_idx;
-                        if (it.first.row < this->rows - 1)
-                            // set row pointers
-                            ++compressed_format_mod.bind[it.first.row + 1];
-                        // std::cout << "Updating row pointer: " << it.first.row + 1 << " to " << compressed_format_mod.bind[it.first.row + 1] << std::endl;
-                    }
+                    diagonal += this->uncompressed_format.count({i, i});
                 }
+                values.resize(size + this->uncompressed_format.size() - diagonal);
+                bind.resize(values.size());
+                scatter(0, size, size);
             }
-            // std::cout << "Row pointers vector: " << std::endl;
-            for (size_t i = 1; i < this->rows; ++i)
+            else
             {
-                compressed_format_mod.bind[i] += compressed_format_mod.bind[i - 1];
-                compressed_format_mod.bind[i - 1] += this->rows; // add shift of diagonal elements
-                // std::cout << compressed_format_mod.bind[i - 1] << "\t";
+                // count the off-diagonal elements of every major index on uniform ranges of major indices, one
+                // per thread: the count of a major index is stored after it
+                std::vector<size_t> starts(size + 1, 0);
+                tbb::parallel_for(size_t(0), parts, [&](size_t part)
+                                  {
+                                      const size_t end_major = (part + 1) * size / parts;
+                                      for (auto it = first_entry(part * size / parts); it != this->uncompressed_format.end() and major_of(it->first) < end_major; ++it)
+                                      {
+                                          starts[major_of(it->first) + 1] += it->first.row != it->first.col;
+                                      } });
+
+                // prefix-sum in place, after the diagonal: starts[major] becomes the first off-diagonal index of the major index
+                starts[0] = size;
+                std::inclusive_scan(std::execution::par, starts.begin(), starts.end(), starts.begin());
+
+                // the arrays are allocated without initialization: every element is written once by the scatter
+                values.resize(starts[size]);
+                bind.resize(starts[size]);
+
+                // scatter the elements with the partition of the parallel kernel (see mod_partition)
+                const RowPartition partition(starts);
+                partition.for_each([&](size_t first_major, size_t end_major)
+                                   { scatter(first_major, end_major, starts[first_major]); });
             }
-            compressed_format_mod.bind[this->rows - 1] += this->rows;
-            // std::cout << compressed_format_mod.bind[this->rows - 1] << std::endl;
+
+            // both formats are stored at this point
+            this->track_memory();
+
             //  clear the uncompressed matrix
             this->uncompressed_format.clear();
         }
@@ -229,23 +264,79 @@ namespace algebra
         // update flags
         this->compressed = false;
         this->modified = true;
+
+        // release the memory of the compressed format, unless it is recycled
+        this->compact();
         return;
     };
 
-    /// @brief set an element in the matrix (dynamic construction of the matrix)
+    /// @brief get the bytes used by each component of the storage
+    /// @return memory usage of the uncompressed, compressed and modified compressed formats
+    template <AddMulType T, StorageOrder S>
+    MemoryUsage SquareMatrix<T, S>::memory_usage() const
+    {
+        MemoryUsage usage = Matrix<T, S>::memory_usage();
+        vector_usage(compressed_format_mod.values, usage.values, usage.slack);
+        vector_usage(compressed_format_mod.bind, usage.bind, usage.slack);
+        return usage;
+    };
+
+    /// @brief release the memory allocated by the vectors of the compressed formats beyond their size
+    template <AddMulType T, StorageOrder S>
+    void SquareMatrix<T, S>::shrink_to_fit()
+    {
+        Matrix<T, S>::shrink_to_fit();
+        compressed_format_mod.values.shrink_to_fit();
+        compressed_format_mod.bind.shrink_to_fit();
+    };
+
+    /// @brief get the size of the compressed format the matrix is stored in
+    /// @return bytes of the compressed (or modified compressed) arrays
+    template <AddMulType T, StorageOrder S>
+    size_t SquareMatrix<T, S>::compressed_bytes() const
+    {
+        if (modified)
+        {
+            return compressed_format_mod.values.size() * sizeof(T) + compressed_format_mod.bind.size() * sizeof(size_t);
+        }
+        return Matrix<T, S>::compressed_bytes();
+    };
+
+    /// @brief overwrite an existing element of the compressed or modified compressed format
     /// @param row row index
     /// @param col column index
-    /// @param value value to set
+    /// @param value value to set (non-zero, unless it is on the diagonal of the modified format)
+    /// @return true if the element is stored in the compressed format (and has been overwritten)
     template <AddMulType T, StorageOrder S>
-    void SquareMatrix<T, S>::set(size_t row, size_t col, const T &value)
+    bool SquareMatrix<T, S>::write_in_place(size_t row, size_t col, const T &value)
     {
-        if (modified)
+        if (not modified)
         {
-            std::cout << "Matrix is in modified compressed format, uncompressing..." << std::endl;
-            // uncompress the matrix
-            uncompress();
+            return Matrix<T, S>::write_in_place(row, col, value);
         }
-        Matrix<T, S>::set(row, col, value);
+        // the whole diagonal is stored
+        if (row == col)
+        {
+            compressed_format_mod.values[row] = value;
+            return true;
+        }
+        if (value == T(0))
+        {
+            return false;
+        }
+        const size_t major = (S == StorageOrder::ColumnMajor) ? col : row;
+        const size_t minor = (S == StorageOrder::ColumnMajor) ? row : col;
+        const size_t start = compressed_format_mod.bind[major];
+        const size_t end = (major != this->rows - 1) ? compressed_format_mod.bind[major + 1] : compressed_format_mod.values.size();
+        for (size_t j = start; j < end; ++j)
+        {
+            if (compressed_format_mod.bind[j] == minor)
+            {
+                compressed_format_mod.values[j] = value;
+                return true;
+            }
+        }
+        return false;
     };
 
     /// @brief compress the matrix if it is in an uncompressed format
@@ -254,171 +345,77 @@ namespace algebra
     {
         if (this->compressed)
             return;
+        if (outside_context(this->context))
+        {
+            return this->context->execute([this]()
+                                          { compress(); });
+        }
         if (modified)
         {
-            // clear the compressed matrix
-            this->compressed_format.inner.clear();
+            ALGEBRA_PROFILE(profile_name("compress", S, true, true));
+            ALGEBRA_TRACE(profile_name("compress", S, true, true));
+            const size_t size = this->rows;
+            const auto &bind = compressed_format_mod.bind;
+            const auto &values = compressed_format_mod.values;
+
+            // count the elements of every major index: the off-diagonal ones, and the diagonal one if non-zero
+            auto &inner = this->compressed_format.inner;
+            inner.clear();
+            inner.resize(size + 1);
+            inner[0] = 0;
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, size),
+                              [&](const tbb::blocked_range<size_t> &range)
+                              {
+                                  for (size_t major = range.begin(); major < range.end(); ++major)
+                                  {
+                                      const size_t end = (major + 1 < size) ? bind[major + 1] : values.size();
+                                      inner[major + 1] = end - bind[major] + (values[major] != T(0));
+                                  }
+                              });
+
+            // prefix-sum in place: inner[major] becomes the first index of the major index
+            std::inclusive_scan(std::execution::par, inner.begin(), inner.end(), inner.begin());
+
+            // the arrays are allocated without initialization: every element is written once by the scatter
             this->compressed_format.outer.clear();
             this->compressed_format.values.clear();
-
-            // reserve space for the compressed matrix
-            if constexpr (S == StorageOrder::ColumnMajor)
-            {
-                this->compressed_format.inner.resize(this->cols + 1);
-            }
-            else
-            {
-                this->compressed_format.inner.resize(this->rows + 1);
-            }
-            std::fill(std::execution::par_unseq, this->compressed_format.inner.begin(), this->compressed_format.inner.end(), 0);
-            this->compressed_format.outer.resize(this->get_nnz());
-            std::fill(std::execution::par_unseq, this->compressed_format.outer.begin(), this->compressed_format.outer.end(), 0);
-            this->compressed_format.values.resize(this->get_nnz());
-            std::fill(std::execution::par_unseq, this->compressed_format.values.begin(), this->compressed_format.values.end(), T(0));
-
-            // fill the compressed matrix
-            size_t index = 0; // keeps track of nnz elements
-            if constexpr (S == StorageOrder::ColumnMajor)
-            {
-                for (size_t i = 0; i < this->cols - 1; ++i)
+            this->compressed_format.outer.resize(inner[size]);
+            this->compressed_format.values.resize(inner[size]);
+
+            // scatter the elements of contiguous ranges of major indices in parallel, merging the diagonal
+            // element with the sorted off-diagonal ones
+            const RowPartition partition(inner);
+            partition.for_each(
+                [&](size_t first_major, size_t end_major)
                 {
-                    // std::cout << "Col: " << i << std::endl;
-                    bool flag = 0; // flag to check if the diagonal element has been inserted
-                    size_t start = compressed_format_mod.bind[i];
-                    // std::cout << "Col pointer start: " << start << std::endl;
-                    size_t end = compressed_format_mod.bind[i + 1];
-                    // std::cout << "Col pointer end: " << end << std::endl;
-                    for (size_t j = start; j < end; ++j)
+                    for (size_t major = first_major; major < end_major; ++major)
                     {
-                        size_t rowidx = compressed_format_mod.bind[j];
-                        // std::cout << "Row index: " << rowidx << std::endl;
-
-                        // Insert diagonal element if it is not already inserted, !0 and I am after the diagonal
-                        if (not flag and compressed_format_mod.values[i] != T(0) and rowidx > i)
+                        size_t index = inner[major];
+                        bool diagonal = values[major] != T(0); // true until the diagonal element is stored
+                        const size_t end = (major + 1 < size) ? bind[major + 1] : values.size();
+                        for (size_t j = bind[major]; j < end; ++j)
                         {
-                            // std::cout << "Adding diagonal element: " << compressed_format_mod.values[i] << std::endl;
-                            this->compressed_format.values[index] = compressed_format_mod.values[i];
-                            this->compressed_format.outer[index] = i;
+                            if (diagonal and bind[j] > major)
+                            {
+                                this->compressed_format.outer[index] = major;
+                                this->compressed_format.values[index] = values[major];
+                                ++index;
+                                diagonal = false;
+                            }
+                            this->compressed_format.outer[index] = bind[j];
+                            this->compressed_format.values[index] = values[j];
                             ++index;
-                            flag = true;
                         }
-
-                        // Add off-diagonal elements
-                        this->compressed_format.values[index] = compressed_format_mod.values[j];
-                        this->compressed_format.outer[index] = rowidx;
-                        ++index;
-                        // std::cout << "Adding off-diagonal element after diagonal: " << compressed_format_mod.values[j] << std::endl;
-                    }
-                    // if there are no other elements in the col or no elements after the diagonal one, add the diagonal element
-                    if (not flag and compressed_format_mod.values[i] != T(0))
-                    {
-                        // std::cout << "Adding diagonal element: " << compressed_format_mod.values[i] << std::endl;
-                        this->compressed_format.values[index] = compressed_format_mod.values[i];
-                        this->compressed_format.outer[index] = i;
-                        ++index;
-                        // updating the flag is useless here
-                    }
-                    // std::cout << "Index of nnz elements for now: " << index << std::endl;
-                    this->compressed_format.inner[i + 1] = index;
-                }
-                // handle last column
-                size_t i = this->cols - 1;
-                bool flag = 0; // flag to check if the diagonal element has been inserted
-                size_t start = compressed_format_mod.bind[i];
-                size_t end = compressed_format_mod.values.size();
-                for (size_t j = start; j < end; ++j)
-                {
-                    size_t rowidx = compressed_format_mod.bind[j];
-                    // Insert diagonal element if it is not already inserted, !0 and I am after the diagonal
-                    if (not flag and compressed_format_mod.values[i] != T(0) and rowidx > i)
-                    {
-                        this->compressed_format.values[index] = compressed_format_mod.values[i];
-                        this->compressed_format.outer[index] = i;
-                        ++index;
-                        flag = true;
-                    }
-
-                    // Add off-diagonal elements
-                    this->compressed_format.values[index] = compressed_format_mod.values[j];
-                    this->compressed_format.outer[index] = rowidx;
-                    ++index;
-                }
-                if (not flag and compressed_format_mod.values[i] != T(0))
-                {
-                    this->compressed_format.values[index] = compressed_format_mod.values[i];
-                    this->compressed_format.outer[index] = i;
-                    ++index;
-                    // updating the flag is useless here
-                }
-                this->compressed_format.inner[i + 1] = index;
-            }
-            else
-            { // ROWORDER
-                for (size_t i = 0; i < this->rows - 1; ++i)
-                {
-                    bool flag = 0; // flag to check if the diagonal element has been inserted
-                    size_t start = compressed_format_mod.bind[i];
-                    size_t end = compressed_format_mod.bind[i + 1];
-
-                    for (size_t j = start; j < end; ++j)
-                    {
-                        size_t colidx = compressed_format_mod.bind[j];
-
-                        // Insert diagonal element if it is not already inserted, !0 and I am after the diagonal
-                        if (not flag and compressed_format_mod.values[i] != T(0) and colidx > i)
+                        if (diagonal)
                         {
-                            this->compressed_format.values[index] = compressed_format_mod.values[i];
-                            this->compressed_format.outer[index] = i;
-                            ++index;
-                            flag = true;
+                            this->compressed_format.outer[index] = major;
+                            this->compressed_format.values[index] = values[major];
                         }
-
-                        // Add off-diagonal elements
-                        this->compressed_format.values[index] = compressed_format_mod.values[j];
-                        this->compressed_format.outer[index] = colidx;
-                        ++index;
-                    }
-                    // if there are no other elements in the row, add the diagonal element
-                    if (not flag and compressed_format_mod.values[i] != T(0))
-                    {
-                        this->compressed_format.values[index] = compressed_format_mod.values[i];
-                        this->compressed_format.outer[index] = i;
-                        ++index;
-                    }
-                    this->compressed_format.inner[i + 1] = index;
-                }
-                // handle last row
-                size_t i = this->rows - 1;
-                bool flag = 0; // flag to check if the diagonal element has been inserted
-                size_t start = compressed_format_mod.bind[i];
-                size_t end = compressed_format_mod.values.size();
-                for (size_t j = start; j < end; ++j)
-                {
-                    size_t colidx = compressed_format_mod.bind[j];
-
-                    // Insert diagonal element if it is not already inserted, !0 and I am after the diagonal
-                    if (not flag and compressed_format_mod.values[i] != T(0) and colidx > i)
-                    {
-                        this->compressed_format.values[index] = compressed_format_mod.values[i];
-                        this->compressed_format.outer[index] = i;
-                        ++index;
-                        flag = true;
                     }
+                });
 
-                    // Add off-diagonal elements
-                    this->compressed_format.values[index] = compressed_format_mod.values[j];
-                    this->compressed_format.outer[index] = colidx;
-                    ++index;
-                }
-                // if there are no other elements in the row, add the diagonal element
-                if (not flag and compressed_format_mod.values[i] != T(0))
-                {
-                    this->compressed_format.values[index] = compressed_format_mod.values[i];
-                    this->compressed_format.outer[index] = i;
-                    ++index;
-                }
-                this->compressed_format.inner[i + 1] = index;
-            }
+            // both formats are stored at this point
+            this->track_memory();
 
             // clear the modified compressed matrix
             compressed_format_mod.values.clear();
@@ -427,90 +424,92 @@ namespace algebra
             // update the flags
             this->modified = false;
             this->compressed = true;
+
+            // release the memory of the modified compressed format, unless it is recycled
+            this->compact();
             return;
         }
         Matrix<T, S>::compress();
         return;
     };
 
+    /// @brief compress the matrix in the given compressed format
+    /// @param format compressed format (Compressed or ModifiedCompressed)
+    template <AddMulType T, StorageOrder S>
+    void SquareMatrix<T, S>::compress(CompressedFormat format)
+    {
+        if (format == CompressedFormat::ModifiedCompressed)
+        {
+            compress_mod();
+        }
+        else
+        {
+            compress();
+        }
+    };
+
     /// @brief uncompress the matrix if it is in a compressed format
     template <AddMulType T, StorageOrder S>
     void SquareMatrix<T, S>::uncompress()
     {
         if (modified)
         {
-            // clear the uncompressed format
-            this->uncompressed_format.clear();
-
-            // fill the uncompressed matrix
-            if constexpr (S == StorageOrder::ColumnMajor)
-            {
-                for (size_t col_idx = 0; col_idx < this->cols - 1; ++col_idx)
+            ALGEBRA_PROFILE(profile_name("uncompress", S, true, true));
+            ALGEBRA_TRACE(profile_name("uncompress", S, true, true));
+            // starting index of the off-diagonal entries of every major index
+            const size_t size = this->rows;
+            std::vector<size_t> starts(size + 1);
+            std::copy(compressed_format_mod.bind.begin(), compressed_format_mod.bind.begin() + size, starts.begin());
+            starts[size] = compressed_format_mod.values.size();
+
+            // fill the uncompressed matrix in the order of the map: the diagonal element is inserted before
+            // the first off-diagonal one that follows it
+            this->build_uncompressed(
+                starts,
+                [&](size_t first_major, size_t end_major, UncompressedStorage<T, S> &part)
                 {
-                    // add diagonal element
-                    if (compressed_format_mod.values[col_idx] != T(0))
+                    const auto append = [&part](size_t major, size_t minor, const T &value)
                     {
-                        this->uncompressed_format[{col_idx, col_idx}] = compressed_format_mod.values[col_idx];
-                    }
-                    size_t start = compressed_format_mod.bind[col_idx];
-                    size_t end = compressed_format_mod.bind[col_idx + 1];
-                    for (size_t j = start; j < end; ++j)
-                    {
-                        size_t row_idx = compressed_format_mod.bind[j];
-                        this->uncompressed_format[{row_idx, col_idx}] = compressed_format_mod.values[j];
-                    }
-                }
-                // handle last column
-                size_t col_idx = this->cols - 1;
-                // add diagonal element
-                if (compressed_format_mod.values[col_idx] != T(0))
-                {
-                    this->uncompressed_format[{col_idx, col_idx}] = compressed_format_mod.values[col_idx];
-                }
-                size_t start = compressed_format_mod.bind[col_idx];
-                size_t end = compressed_format_mod.values.size();
-                for (size_t j = start; j < end; ++j)
-                {
-                    size_t row_idx = compressed_format_mod.bind[j];
-                    this->uncompressed_format[{row_idx, col_idx}] = compressed_format_mod.values[j];
-                }
-            }
-            else
-            {
-                for (size_t row_idx = 0; row_idx < this->rows - 1; ++row_idx)
-                {
-                    // add diagonal element
-                    if (compressed_format_mod.values[row_idx] != T(0))
-                    {
-                        this->uncompressed_format[{row_idx, row_idx}] = compressed_format_mod.values[row_idx];
-                    }
-                    size_t start = compressed_format_mod.bind[row_idx];
-                    size_t end = compressed_format_mod.bind[row_idx + 1];
-                    for (size_t j = start; j < end; ++j)
+                        if constexpr (S == StorageOrder::ColumnMajor)
+                        {
+                            part.emplace_hint(part.end(), Index{minor, major}, value);
+                        }
+                        else
+                        {
+                            part.emplace_hint(part.end(), Index{major, minor}, value);
+                        }
+                    };
+                    for (size_t major = first_major; major < end_major; ++major)
                     {
-                        size_t col_idx = compressed_format_mod.bind[j];
-                        this->uncompressed_format[{row_idx, col_idx}] = compressed_format_mod.values[j];
+                        const T &diagonal = compressed_format_mod.values[major];
+                        bool pending_diagonal = diagonal != T(0);
+                        for (size_t j = starts[major]; j < starts[major + 1]; ++j)
+                        {
+                            const size_t minor = compressed_format_mod.bind[j];
+                            if (pending_diagonal and minor > major)
+                            {
+                                append(major, major, diagonal);
+                                pending_diagonal = false;
+                            }
+                            append(major, minor, compressed_format_mod.values[j]);
+                        }
+                        if (pending_diagonal)
+                        {
+                            append(major, major, diagonal);
+                        }
                     }
-                }
-                // handle last row
-                size_t row_idx = this->rows - 1;
-                // add diagonal element
-                if (compressed_format_mod.values[row_idx] != T(0))
-                {
-                    this->uncompressed_format[{row_idx, row_idx}] = compressed_format_mod.values[row_idx];
-                }
-                size_t start = compressed_format_mod.bind[row_idx];
-                size_t end = compressed_format_mod.values.size();
-                for (size_t j = start; j < end; ++j)
-                {
-                    size_t col_idx = compressed_format_mod.bind[j];
-                    this->uncompressed_format[{row_idx, col_idx}] = compressed_format_mod.values[j];
-                }
-            }
-            // clear the modified compressed matrix
+                });
+            // both formats are stored at this point
+            this->track_memory();
+
+            // clear the modified compressed matrix and release its memory
             compressed_format_mod.values.clear();
             compressed_format_mod.bind.clear();
             modified = false;
+            this->compact();
+
+            // merge the writes buffered while compressed
+            this->apply_pending_writes();
             return;
         }
         Matrix<T, S>::uncompress();
@@ -524,13 +523,25 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     T SquareMatrix<T, S>::operator()(size_t row, size_t col) const
     {
-        // check if the index is in range
-        if (row >= this->rows or col >= this->cols)
-        {
-            throw std::out_of_range("Index out of range");
-        }
+        this->check_bounds(row, col);
+        return SquareMatrix<T, S>::get_unchecked(row, col);
+    };
+
+    /// @brief get an element, without checking the indices
+    /// @param row row index
+    /// @param col column index
+    /// @return element at (row, col)
+    template <AddMulType T, StorageOrder S>
+    T SquareMatrix<T, S>::get_unchecked(size_t row, size_t col) const
+    {
         if (modified)
         {
+            // the buffered writes are more recent than the modified compressed format
+            auto it = this->pending_writes.find({row, col});
+            if (it != this->pending_writes.end())
+            {
+                return it->second;
+            }
             if (row == col)
             {
                 return compressed_format_mod.values[row];
@@ -565,7 +576,7 @@ namespace algebra
             }
         }
         else
-            return Matrix<T, S>::operator()(row, col);
+            return Matrix<T, S>::get_unchecked(row, col);
     };
 
     /// @brief call operator() non-const version
@@ -575,15 +586,7 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     Proxy<T, S> SquareMatrix<T, S>::operator()(size_t row, size_t col)
     {
-        if (row >= this->rows or col >= this->cols)
-            throw std::out_of_range("Index out of range");
-
-        if (modified or this->compressed)
-        {
-            std::cout << "Matrix is compressed, uncompressing..." << std::endl;
-            uncompress();
-        }
-        return Proxy<T, S>{this->uncompressed_format, row, col};
+        return Matrix<T, S>::operator()(row, col);
     };
 
     /// @brief resize the matrix
@@ -597,6 +600,7 @@ namespace algebra
         this->compressed = false;
         this->modified = false;
         this->uncompressed_format.clear();
+        this->pending_writes.clear();
         this->compressed_format.inner.clear();
         this->compressed_format.outer.clear();
         this->compressed_format.values.clear();
@@ -611,6 +615,12 @@ namespace algebra
     template <NormType N>
     double SquareMatrix<T, S>::norm() const
     {
+        this->require_flushed();
+        if (outside_context(this->context))
+        {
+            return this->context->execute([this]()
+                                          { return norm<N>(); });
+        }
         if (modified)
         {
             if constexpr (N == NormType::One)
@@ -637,7 +647,7 @@ namespace algebra
                         col_sums[i] += std::abs(compressed_format_mod.values[j]);
                     }
                     col_sums[i] += std::abs(compressed_format_mod.values[i]);
-                    return *std::max_element(std::execution::par_unseq, col_sums.begin(), col_sums.end());
+                    return col_sums.empty() ? 0 : *std::max_element(std::execution::par_unseq, col_sums.begin(), col_sums.end());
                 }
                 else
                 {
@@ -663,7 +673,7 @@ namespace algebra
                         col_sums[col] += std::abs(compressed_format_mod.values[j]);
                     }
                     col_sums[i] += std::abs(compressed_format_mod.values[i]);
-                    return *std::max_element(std::execution::par_unseq, col_sums.begin(), col_sums.end());
+                    return col_sums.empty() ? 0 : *std::max_element(std::execution::par_unseq, col_sums.begin(), col_sums.end());
                 }
             }
             else if constexpr (N == NormType::Infinity)
@@ -692,7 +702,7 @@ namespace algebra
                         row_sums[row] += std::abs(compressed_format_mod.values[j]);
                     }
                     row_sums[i] += std::abs(compressed_format_mod.values[i]);
-                    return *std::max_element(std::execution::par_unseq, row_sums.begin(), row_sums.end());
+                    return row_sums.empty() ? 0 : *std::max_element(std::execution::par_unseq, row_sums.begin(), row_sums.end());
                 }
                 else
                 {
@@ -716,7 +726,7 @@ namespace algebra
                         row_sums[i] += std::abs(compressed_format_mod.values[j]);
                     }
                     row_sums[i] += std::abs(compressed_format_mod.values[i]);
-                    return *std::max_element(std::execution::par_unseq, row_sums.begin(), row_sums.end());
+                    return row_sums.empty() ? 0 : *std::max_element(std::execution::par_unseq, row_sums.begin(), row_sums.end());
                 }
             }
             else // Frobenius
@@ -739,6 +749,8 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     void SquareMatrix<T, S>::reader(const std::string &filename)
     {
+        ALGEBRA_PROFILE(profile_name("reader", S, false));
+        ALGEBRA_TRACE(profile_name("reader", S, false));
         std::ifstream file(filename);
         if (not file.is_open())
         {
@@ -787,7 +799,7 @@ namespace algebra
                 T value(real, imag);
                 // I traslate the row and column indices to 0-based format and set the element
                 //  in the matrix
-                set(row - 1, col - 1, value);
+                this->set(row - 1, col - 1, value);
             }
             else
             {
@@ -797,7 +809,70 @@ namespace algebra
                 assert(row <= this->rows and col <= this->cols);
                 // I traslate the row and column indices to 0-based format and set the element
                 //  in the matrix
-                set(row - 1, col - 1, value);
+                this->set(row - 1, col - 1, value);
+            }
+        }
+
+        file.close();
+    };
+
+    template <AddMulType T, StorageOrder S>
+    void SquareMatrix<T, S>::writer(const std::string &filename) const
+    {
+        this->require_flushed();
+        if (not modified)
+        {
+            Matrix<T, S>::writer(filename);
+            return;
+        }
+
+        std::ofstream file(filename);
+        if (not file.is_open())
+        {
+            // more verbose error message
+            throw std::runtime_error("Unable to open file '" + filename + "': " + strerror(errno));
+        }
+
+        // write Matrix Market header and dimensions
+        file << "%%MatrixMarket matrix coordinate " << (is_complex<T>::value ? "complex" : "real") << " general\n";
+        file << this->rows << " " << this->cols << " " << get_nnz() << "\n";
+        file << std::setprecision(std::numeric_limits<AbsReturnType_t<T>>::max_digits10);
+
+        // write one element per line, with 1-based indices
+        auto write = [&file](size_t row, size_t col, const T &value)
+        {
+            file << row + 1 << " " << col + 1 << " ";
+            if constexpr (is_complex<T>::value)
+            {
+                file << value.real() << " " << value.imag() << "\n";
+            }
+            else
+            {
+                file << value << "\n";
+            }
+        };
+
+        const auto &values = compressed_format_mod.values;
+        const auto &bind = compressed_format_mod.bind;
+        for (size_t major = 0; major < this->rows; major++)
+        {
+            // diagonal element (skipped if zero)
+            if (values[major] != T(0))
+            {
+                write(major, major, values[major]);
+            }
+            // off-diagonal elements (the last row/column ends with the arrays)
+            const size_t end = (major + 1 < this->rows) ? bind[major + 1] : values.size();
+            for (size_t j = bind[major]; j < end; j++)
+            {
+                if constexpr (S == StorageOrder::ColumnMajor)
+                {
+                    write(bind[j], major, values[j]);
+                }
+                else
+                {
+                    write(major, bind[j], values[j]);
+                }
             }
         }
 
@@ -834,90 +909,127 @@ namespace algebra
     std::vector<T> operator*(const SquareMatrix<T, S> &m, const std::vector<T> &v)
     {
 
+        m.require_flushed();
         if (m.modified)
         {
             if (v.size() != m.cols)
             {
                 throw std::invalid_argument("Matrix and vector dimensions do not match");
             }
-            std::vector<T> result(m.rows, T(0));
-            if constexpr (S == StorageOrder::ColumnMajor)
-            {
-                size_t col, start, end;
+            ALGEBRA_PROFILE(profile_name("spmv", S, true, true, kernel_name(m.kernel)));
+            ALGEBRA_TRACE(profile_name("spmv", S, true, true, kernel_name(m.kernel)));
+            return m.multiply_mod(v, false);
+        }
+        return static_cast<const Matrix<T, S> &>(m) * v;
+    };
 
-                // off-diagonal elements
-                for (col = 0; col < m.cols - 1; ++col)
-                {
-                    // iterate over non-zero elements in the column "col" of m
-                    start = m.compressed_format_mod.bind[col];
-                    end = m.compressed_format_mod.bind[col + 1];
-                    for (size_t j = start; j < end; ++j)
-                    {
-                        // row index of the non-zero element
-                        size_t row = m.compressed_format_mod.bind[j];
-                        // add off-diagonal elements
-                        result[row] += m.compressed_format_mod.values[j] * v[col];
-                    }
-                }
+    /// @brief multiply the modified compressed format with a std::vector, with the kernel of the matrix
+    /// @param v vector
+    /// @param transpose true for the product of the transpose (TransposeView)
+    /// @return the result of the multiplication
+    template <AddMulType T, StorageOrder S>
+    std::vector<T> SquareMatrix<T, S>::multiply_mod(const std::vector<T> &v, bool transpose) const
+    {
+        if (this->kernel == Kernel::Parallel and outside_context(this->context))
+        {
+            return this->context->execute([&]()
+                                          { return multiply_mod(v, transpose); });
+        }
+        const size_t size = this->rows;
+        const auto &values = compressed_format_mod.values;
+        const auto &bind = compressed_format_mod.bind;
+        std::vector<T> result(size, T(0));
 
-                // handle last column
-                start = m.compressed_format_mod.bind[col];
-                end = m.compressed_format_mod.values.size();
-                for (size_t j = start; j < end; ++j)
-                {
-                    // row index of the non-zero element
-                    size_t row = m.compressed_format_mod.bind[j];
-                    // add off-diagonal elements
-                    result[row] += m.compressed_format_mod.values[j] * v[col];
-                }
+        // end of the off-diagonal elements of a major index
+        const auto end_of = [&](size_t major)
+        { return (major + 1 < size) ? bind[major + 1] : values.size(); };
 
-                // add diagonal elements
-                for (size_t i = 0; i < m.rows; ++i)
+        if ((S == StorageOrder::RowMajor) != transpose)
+        {
+            // the rows of the product are stored contiguously: every entry of the result is a dot product
+            // of its diagonal and off-diagonal elements, computed in a single sweep
+            const auto rows = [&](size_t first_major, size_t end_major)
+            {
+                for (size_t major = first_major; major < end_major; ++major)
                 {
-                    result[i] += m.compressed_format_mod.values[i] * v[i];
+                    T sum = values[major] * v[major];
+                    const size_t end = end_of(major);
+                    for (size_t j = bind[major]; j < end; ++j)
+                    {
+                        sum += values[j] * v[bind[j]];
+                    }
+                    result[major] = sum;
                 }
+            };
+            if (this->kernel == Kernel::Parallel)
+            {
+                // rows are independent: each thread computes the part of the result it wrote in compress_mod
+                mod_partition().for_each(rows);
             }
             else
             {
-                size_t row, start, end;
-
-                // off-diagonal elements
-                for (row = 0; row < m.rows - 1; ++row)
+                rows(0, size);
+            }
+        }
+        else
+        {
+            // the columns of the product are stored contiguously: every column, with its diagonal element, is
+            // scattered into the result (the indices of a column are distinct)
+            const auto columns = [&](size_t first_major, size_t end_major, std::vector<T> &partial)
+            {
+                for (size_t major = first_major; major < end_major; ++major)
                 {
-                    // iterate over non-zero elements in the row "row" of m
-                    start = m.compressed_format_mod.bind[row];
-                    end = m.compressed_format_mod.bind[row + 1];
-                    for (size_t j = start; j < end; ++j)
+                    const T x = v[major];
+                    partial[major] += values[major] * x;
+                    const size_t end = end_of(major);
+                    for (size_t j = bind[major]; j < end; ++j)
                     {
-                        // col index of the non-zero element
-                        size_t col = m.compressed_format_mod.bind[j];
-                        // add off-diagonal elements
-                        result[row] += m.compressed_format_mod.values[j] * v[col];
+                        partial[bind[j]] += values[j] * x;
                     }
                 }
-
-                // handle last row
-                start = m.compressed_format_mod.bind[row];
-                end = m.compressed_format_mod.values.size();
-                for (size_t j = start; j < end; ++j)
-                {
-                    // col index of the non-zero element
-                    size_t col = m.compressed_format_mod.bind[j];
-                    // add off-diagonal elements
-                    result[row] += m.compressed_format_mod.values[j] * v[col];
-                }
-
-                // add diagonal elements
-                for (size_t i = 0; i < m.rows; ++i)
-                {
-                    result[i] += m.compressed_format_mod.values[i] * v[i];
-                }
+            };
+            if (this->kernel == Kernel::Parallel)
+            {
+                // each thread scatters the part of the columns it wrote in compress_mod into its own partial result
+                tbb::enumerable_thread_specific<std::vector<T>> partial_results(size, T(0));
+                mod_partition().for_each([&](size_t first_major, size_t end_major)
+                                         { columns(first_major, end_major, partial_results.local()); });
+
+                // sum the partial results of the threads
+                tbb::parallel_for(
+                    tbb::blocked_range<size_t>(0, size),
+                    [&](const tbb::blocked_range<size_t> &range)
+                    {
+                        for (const auto &partial : partial_results)
+                        {
+                            for (size_t i = range.begin(); i < range.end(); i++)
+                            {
+                                result[i] += partial[i];
+                            }
+                        }
+                    });
+            }
+            else
+            {
+                columns(0, size, result);
             }
-            return result;
         }
-        return static_cast<const Matrix<T, S> &>(m) * v;
+        return result;
     };
 
+    /// @brief partition of the major indices of the modified compressed format
+    /// @return partition balanced on the off-diagonal elements of the major indices
+    template <AddMulType T, StorageOrder S>
+    RowPartition SquareMatrix<T, S>::mod_partition() const
+    {
+        // the starting indices of the off-diagonal elements, followed by their end
+        const size_t size = this->rows;
+        const auto &bind = compressed_format_mod.bind;
+        const size_t end = compressed_format_mod.values.size();
+        return RowPartition(size, [&](size_t major)
+                            { return major < size ? bind[major] : end; });
+    }
+
     /// @brief multiply with another matrix
     /// @param m1 first matrix
     /// @param m2 second matrix
@@ -926,16 +1038,20 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     SquareMatrix<T, S> operator*(const SquareMatrix<T, S> &m1, const SquareMatrix<T, S> &m2)
     {
+        m1.require_flushed();
+        m2.require_flushed();
         if (m1.modified or m2.modified)
         {
             if (not m1.modified or not m2.modified)
             {
-                std::runtime_error("Matrix multiplication between compressed and uncompressed matrix is not supported");
+                throw std::invalid_argument("Matrix multiplication between compressed and uncompressed matrix is not supported");
             }
             if (m1.cols != m2.rows)
             {
                 throw std::invalid_argument("Matrix dimensions do not match");
             }
+            ALGEBRA_PROFILE(profile_name("spgemm", S, true, true, kernel_name(Kernel::Serial)));
+            ALGEBRA_TRACE(profile_name("spgemm", S, true, true, kernel_name(Kernel::Serial)));
             SquareMatrix<T, S> result(m1.rows);
             if constexpr (S == StorageOrder::ColumnMajor)
             {
@@ -950,35 +1066,23 @@ namespace algebra
                     size_t end = m2.compressed_format_mod.bind[col + 1];
                     size_t k;
                     // iterate over rows of m2 (and columns of m1) that are non-zero in the column "col" of m2
-                    for (k = start; k < end - 1; ++k)
+                    for (k = start; k < end; ++k)
                     {
                         // j = row of m2 (or column of m1) that we are currently processing
                         size_t j = m2.compressed_format_mod.bind[k];
 
                         // iterate over rows of m1 that are non-zero in the column j of m1
                         size_t s = m1.compressed_format_mod.bind[j];
-                        size_t e = m1.compressed_format_mod.bind[j + 1];
+                        size_t e = (j + 1 == m1.cols) ? m1.compressed_format_mod.values.size() : m1.compressed_format_mod.bind[j + 1];
                         for (size_t i = s; i < e; ++i)
                         {
                             // row = row of m1 corresponding to the index i
                             size_t row = m1.compressed_format_mod.bind[i];
 
                             // add the product of the non-zero off-diagonal elements to the "result" matrix
-                            result(row, col) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[k];
+                            result.ref_unchecked(row, col) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[k];
                         }
                     }
-                    // handle last column of m1 (last row of m2)
-                    size_t j = m2.compressed_format_mod.bind[k];
-                    size_t s = m1.compressed_format_mod.bind[j];
-                    size_t e = (j + 1 == m1.cols) ? m1.compressed_format_mod.values.size() : m1.compressed_format_mod.bind[j + 1];
-                    for (size_t i = s; i < e; ++i)
-                    {
-                        // row = row of m1 corresponding to the index i
-                        size_t row = m1.compressed_format_mod.bind[i];
-
-                        // add the product of the non-zero off-diagonal elements to the "result" matrix
-                        result(row, col) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[k];
-                    }
 
                     // ADD DIAGONAL ELEMENTS OF m1
                     // iterate over rows of m2 (and columns of m1) that are non-zero in the column "col" of m2
@@ -988,7 +1092,7 @@ namespace algebra
                         size_t j = m2.compressed_format_mod.bind[k];
 
                         // add the product between the diagonal element of m1 and current non-zero element of m2 to the "result" matrix
-                        result(j, col) += m1.compressed_format_mod.values[j] * m2.compressed_format_mod.values[k];
+                        result.ref_unchecked(j, col) += m1.compressed_format_mod.values[j] * m2.compressed_format_mod.values[k];
                     }
                 }
 
@@ -999,35 +1103,23 @@ namespace algebra
                 size_t end = m2.compressed_format_mod.values.size();
                 size_t k;
                 // iterate over rows of m2 (and columns of m1) that are non-zero in the column "col" of m2
-                for (k = start; k < end - 1; ++k)
+                for (k = start; k < end; ++k)
                 {
                     // j = row of m2 (or column of m1) that we are currently processing
                     size_t j = m2.compressed_format_mod.bind[k];
 
                     // iterate over rows of m1 that are non-zero in the column j of m1
                     size_t s = m1.compressed_format_mod.bind[j];
-                    size_t e = m1.compressed_format_mod.bind[j + 1];
+                    size_t e = (j + 1 == m1.cols) ? m1.compressed_format_mod.values.size() : m1.compressed_format_mod.bind[j + 1];
                     for (size_t i = s; i < e; ++i)
                     {
                         // row = row of m1 corresponding to the index i
                         size_t row = m1.compressed_format_mod.bind[i];
 
                         // add the product of the non-zero off-diagonal elements to the "result" matrix
-                        result(row, col) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[k];
+                        result.ref_unchecked(row, col) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[k];
                     }
                 }
-                // handle last column of m1 (last row of m2)
-                size_t j = m2.compressed_format_mod.bind[k];
-                size_t s = m1.compressed_format_mod.bind[j];
-                size_t e = (j + 1 == m1.cols) ? m1.compressed_format_mod.values.size() : m1.compressed_format_mod.bind[j + 1];
-                for (size_t i = s; i < e; ++i)
-                {
-                    // row = row of m1 corresponding to the index i
-                    size_t row = m1.compressed_format_mod.bind[i];
-
-                    // add the product of the non-zero off-diagonal elements to the "result" matrix
-                    result(row, col) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[k];
-                }
 
                 // ADD DIAGONAL ELEMENTS OF m1
                 // iterate over rows of m2 (and columns of m1) that are non-zero in the column "col" of m2
@@ -1037,7 +1129,7 @@ namespace algebra
                     size_t j = m2.compressed_format_mod.bind[k];
 
                     // add the product between the diagonal element of m1 and current non-zero element of m2 to the "result" matrix
-                    result(j, col) += m1.compressed_format_mod.values[j] * m2.compressed_format_mod.values[k];
+                    result.ref_unchecked(j, col) += m1.compressed_format_mod.values[j] * m2.compressed_format_mod.values[k];
                 }
 
                 ////// ADD DIAGONAL ELEMENTS OF m2 //////
@@ -1054,13 +1146,13 @@ namespace algebra
                         size_t row = m1.compressed_format_mod.bind[i];
 
                         // add the product between the diagonal element of m2 and current non-zero element of m1 to the "result" matrix
-                        result(row, col) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[col];
+                        result.ref_unchecked(row, col) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[col];
                     }
                 }
                 // HANDLE LAST COLUMN OF m1
                 // multiply each column of m1 with the diagonal element of m2
-                s = m1.compressed_format_mod.bind[col];
-                e = m1.compressed_format_mod.values.size();
+                size_t s = m1.compressed_format_mod.bind[col];
+                size_t e = m1.compressed_format_mod.values.size();
                 // iterate over the non-zero elements of m1 that are in the column "col"
                 for (size_t i = s; i < e; ++i)
                 {
@@ -1068,7 +1160,7 @@ namespace algebra
                     size_t row = m1.compressed_format_mod.bind[i];
 
                     // add the product between the diagonal element of m2 and current non-zero element of m1 to the "result" matrix
-                    result(row, col) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[col];
+                    result.ref_unchecked(row, col) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[col];
                 }
 
                 ////// ADD PRODUCTS OF DIAGONAL ELEMENTS //////
@@ -1077,7 +1169,7 @@ namespace algebra
                 for (size_t i = 0; i < m1.rows; ++i)
                 {
                     // add the product between the diagonal elements of m1 and m2 to the "result" matrix
-                    result(i, i) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[i];
+                    result.ref_unchecked(i, i) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[i];
                 }
             }
             else
@@ -1093,35 +1185,23 @@ namespace algebra
                     size_t end = m1.compressed_format_mod.bind[row + 1];
                     size_t k;
                     // iterate over columns of m1 (and rows of m2) that are non-zero in the row "row" of m1
-                    for (k = start; k < end - 1; ++k)
+                    for (k = start; k < end; ++k)
                     {
                         // j = column of m1 (or row of m2) that we are currently processing
                         size_t j = m1.compressed_format_mod.bind[k];
 
                         // iterate over columns of m2 that are non-zero in the row j of m2
                         size_t s = m2.compressed_format_mod.bind[j];
-                        size_t e = m2.compressed_format_mod.bind[j + 1];
+                        size_t e = (j + 1 == m2.rows) ? m2.compressed_format_mod.values.size() : m2.compressed_format_mod.bind[j + 1];
                         for (size_t i = s; i < e; ++i)
                         {
                             // col = column of m2 corresponding to the index i
                             size_t col = m2.compressed_format_mod.bind[i];
 
                             // add the product of the non-zero off-diagonal elements to the "result" matrix
-                            result(row, col) += m1.compressed_format_mod.values[k] * m2.compressed_format_mod.values[i];
+                            result.ref_unchecked(row, col) += m1.compressed_format_mod.values[k] * m2.compressed_format_mod.values[i];
                         }
                     }
-                    // handle last row of m2 (last column of m1)
-                    size_t j = m1.compressed_format_mod.bind[k];
-                    size_t s = m2.compressed_format_mod.bind[j];
-                    size_t e = (j + 1 == m2.rows) ? m2.compressed_format_mod.values.size() : m2.compressed_format_mod.bind[j + 1];
-                    for (size_t i = s; i < e; ++i)
-                    {
-                        // col = column of m2 corresponding to the index i
-                        size_t col = m2.compressed_format_mod.bind[i];
-
-                        // add the product of the non-zero off-diagonal elements to the "result" matrix
-                        result(row, col) += m1.compressed_format_mod.values[k] * m2.compressed_format_mod.values[i];
-                    }
 
                     // ADD DIAGONAL ELEMENTS OF m2
                     // iterate over columns of m1 (and rows of m2) that are non-zero in the row "row" of m1
@@ -1131,7 +1211,7 @@ namespace algebra
                         size_t j = m1.compressed_format_mod.bind[k];
 
                         // add the product between the diagonal element of m2 and current non-zero element of m1 to the "result" matrix
-                        result(row, j) += m1.compressed_format_mod.values[k] * m2.compressed_format_mod.values[j];
+                        result.ref_unchecked(row, j) += m1.compressed_format_mod.values[k] * m2.compressed_format_mod.values[j];
                     }
                 }
 
@@ -1142,35 +1222,23 @@ namespace algebra
                 size_t end = m1.compressed_format_mod.values.size();
                 size_t k;
                 // iterate over columns of m1 (and rows of m2) that are non-zero in the row "row" of m1
-                for (k = start; k < end - 1; ++k)
+                for (k = start; k < end; ++k)
                 {
                     // j = column of m1 (or row of m2) that we are currently processing
                     size_t j = m1.compressed_format_mod.bind[k];
 
                     // iterate over columns of m2 that are non-zero in the row j of m2
                     size_t s = m2.compressed_format_mod.bind[j];
-                    size_t e = m2.compressed_format_mod.bind[j + 1];
+                    size_t e = (j + 1 == m2.rows) ? m2.compressed_format_mod.values.size() : m2.compressed_format_mod.bind[j + 1];
                     for (size_t i = s; i < e; ++i)
                     {
                         // col = column of m2 corresponding to the index i
                         size_t col = m2.compressed_format_mod.bind[i];
 
                         // add the product of the non-zero off-diagonal elements to the "result" matrix
-                        result(row, col) += m1.compressed_format_mod.values[k] * m2.compressed_format_mod.values[i];
+                        result.ref_unchecked(row, col) += m1.compressed_format_mod.values[k] * m2.compressed_format_mod.values[i];
                     }
                 }
-                // handle last row of m2 (last column of m1)
-                size_t j = m1.compressed_format_mod.bind[k];
-                size_t s = m2.compressed_format_mod.bind[j];
-                size_t e = (j + 1 == m2.rows) ? m2.compressed_format_mod.values.size() : m2.compressed_format_mod.bind[j + 1];
-                for (size_t i = s; i < e; ++i)
-                {
-                    // col = column of m2 corresponding to the index i
-                    size_t col = m2.compressed_format_mod.bind[i];
-
-                    // add the product of the non-zero off-diagonal elements to the "result" matrix
-                    result(row, col) += m1.compressed_format_mod.values[k] * m2.compressed_format_mod.values[i];
-                }
 
                 // ADD DIAGONAL ELEMENTS OF m2
                 // iterate over columns of m1 (and rows of m2) that are non-zero in the row "row" of m1
@@ -1180,7 +1248,7 @@ namespace algebra
                     size_t j = m1.compressed_format_mod.bind[k];
 
                     // add the product between the diagonal element of m2 and current non-zero element of m1 to the "result" matrix
-                    result(row, j) += m1.compressed_format_mod.values[k] * m2.compressed_format_mod.values[j];
+                    result.ref_unchecked(row, j) += m1.compressed_format_mod.values[k] * m2.compressed_format_mod.values[j];
                 }
 
                 ////// ADD DIAGONAL ELEMENTS OF m1 //////
@@ -1197,13 +1265,13 @@ namespace algebra
                         size_t col = m2.compressed_format_mod.bind[i];
 
                         // add the product between the diagonal element of m1 and current non-zero element of m2 to the "result" matrix
-                        result(row, col) += m1.compressed_format_mod.values[row] * m2.compressed_format_mod.values[i];
+                        result.ref_unchecked(row, col) += m1.compressed_format_mod.values[row] * m2.compressed_format_mod.values[i];
                     }
                 }
                 // HANDLE LAST ROW OF m2
                 // multiply each row of m2 with the diagonal element of m1
-                s = m2.compressed_format_mod.bind[row];
-                e = m2.compressed_format_mod.values.size();
+                size_t s = m2.compressed_format_mod.bind[row];
+                size_t e = m2.compressed_format_mod.values.size();
                 // iterate over the non-zero elements of m2 that are in the row "row"
                 for (size_t i = s; i < e; ++i)
                 {
@@ -1211,7 +1279,7 @@ namespace algebra
                     size_t col = m2.compressed_format_mod.bind[i];
 
                     // add the product between the diagonal element of m1 and current non-zero element of m2 to the "result" matrix
-                    result(row, col) += m1.compressed_format_mod.values[row] * m2.compressed_format_mod.values[i];
+                    result.ref_unchecked(row, col) += m1.compressed_format_mod.values[row] * m2.compressed_format_mod.values[i];
                 }
 
                 ////// ADD PRODUCTS OF DIAGONAL ELEMENTS //////
@@ -1220,7 +1288,7 @@ namespace algebra
                 for (size_t i = 0; i < m1.rows; ++i)
                 {
                     // add the product between the diagonal elements of m1 and m2 to the "result" matrix
-                    result(i, i) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[i];
+                    result.ref_unchecked(i, i) += m1.compressed_format_mod.values[i] * m2.compressed_format_mod.values[i];
                 }
             }
             return result;
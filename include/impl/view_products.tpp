@@ -13,91 +13,27 @@ namespace algebra
     std::vector<T> operator*(const TransposeView<T, S> &m, const std::vector<T> &v)
     {
 
+        m.matrix.require_flushed();
         if (m.matrix.get_rows() != v.size())
         {
             throw std::invalid_argument("Matrix and vector dimensions do not match for multiplication");
         }
-        std::vector<T> result(m.matrix.get_cols(), T(0));
+        ALGEBRA_PROFILE(profile_name("spmv_transpose", S, m.is_compressed(),
+                                     typeid(m.matrix) == typeid(SquareMatrix<T, S>) and
+                                         static_cast<const SquareMatrix<T, S> &>(m.matrix).is_modified()));
+        ALGEBRA_TRACE(profile_name("spmv_transpose", S, m.is_compressed(),
+                                   typeid(m.matrix) == typeid(SquareMatrix<T, S>) and
+                                       static_cast<const SquareMatrix<T, S> &>(m.matrix).is_modified()));
         if (typeid(m.matrix) == typeid(SquareMatrix<T, S>))
         {
-            auto matrix = static_cast<const SquareMatrix<T, S> &>(m.matrix);
+            const auto &matrix = static_cast<const SquareMatrix<T, S> &>(m.matrix);
             if (matrix.is_modified())
             {
-                if constexpr (S == StorageOrder::ColumnMajor)
-                {
-                    size_t col, start, end;
-
-                    // off-diagonal elements
-                    for (col = 0; col < matrix.get_cols() - 1; ++col)
-                    {
-                        // iterate over non-zero elements in the column "col" of m
-                        start = matrix.compressed_format_mod.bind[col];
-                        end = matrix.compressed_format_mod.bind[col + 1];
-                        for (size_t j = start; j < end; ++j)
-                        {
-                            // row index of the non-zero element
-                            size_t row = matrix.compressed_format_mod.bind[j];
-                            // add off-diagonal elements
-                            result[col] += matrix.compressed_format_mod.values[j] * v[row];
-                        }
-                    }
-
-                    // handle last column
-                    start = matrix.compressed_format_mod.bind[col];
-                    end = matrix.compressed_format_mod.values.size();
-                    for (size_t j = start; j < end; ++j)
-                    {
-                        // row index of the non-zero element
-                        size_t row = matrix.compressed_format_mod.bind[j];
-                        // add off-diagonal elements
-                        result[col] += matrix.compressed_format_mod.values[j] * v[row];
-                    }
-
-                    // add diagonal elements
-                    for (size_t i = 0; i < matrix.get_cols(); ++i)
-                    {
-                        result[i] += matrix.compressed_format_mod.values[i] * v[i];
-                    }
-                }
-                else
-                {
-                    size_t row, start, end;
-
-                    // off-diagonal elements
-                    for (row = 0; row < matrix.get_rows() - 1; ++row)
-                    {
-                        // iterate over non-zero elements in the row "row" of m
-                        start = matrix.compressed_format_mod.bind[row];
-                        end = matrix.compressed_format_mod.bind[row + 1];
-                        for (size_t j = start; j < end; ++j)
-                        {
-                            // col index of the non-zero element
-                            size_t col = matrix.compressed_format_mod.bind[j];
-                            // add off-diagonal elements
-                            result[col] += matrix.compressed_format_mod.values[j] * v[row];
-                        }
-                    }
-
-                    // handle last row
-                    start = matrix.compressed_format_mod.bind[row];
-                    end = matrix.compressed_format_mod.values.size();
-                    for (size_t j = start; j < end; ++j)
-                    {
-                        // col index of the non-zero element
-                        size_t col = matrix.compressed_format_mod.bind[j];
-                        // add off-diagonal elements
-                        result[col] += matrix.compressed_format_mod.values[j] * v[row];
-                    }
-
-                    // add diagonal elements
-                    for (size_t i = 0; i < matrix.cols; ++i)
-                    {
-                        result[i] += matrix.compressed_format_mod.values[i] * v[i];
-                    }
-                }
+                return matrix.multiply_mod(v, true);
             }
         }
-        auto matrix = m.matrix;
+        std::vector<T> result(m.matrix.get_cols(), T(0));
+        const auto &matrix = m.matrix;
         if (not matrix.is_compressed())
         {
             for (const auto &it : matrix.uncompressed_format)
@@ -155,6 +91,8 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     Matrix<T, S> operator*(const TransposeView<T, S> &m1, const TransposeView<T, S> &m2)
     {
+        m1.matrix.require_flushed();
+        m2.matrix.require_flushed();
         if (m1.get_cols() != m2.get_rows())
         {
             throw std::invalid_argument("Matrix dimensions do not match for multiplication");
@@ -169,44 +107,37 @@ namespace algebra
 
         const auto *square_matrix1 = dynamic_cast<const SquareMatrix<T, S> *>(&m1.matrix);
         const auto *square_matrix2 = dynamic_cast<const SquareMatrix<T, S> *>(&m2.matrix);
-        if (square_matrix1 && square_matrix2)
+        ALGEBRA_PROFILE(profile_name("spgemm_transpose", S, m1.is_compressed(), square_matrix1 and square_matrix1->is_modified()));
+        ALGEBRA_TRACE(profile_name("spgemm_transpose", S, m1.is_compressed(), square_matrix1 and square_matrix1->is_modified()));
+        const bool modified1 = square_matrix1 and square_matrix1->is_modified();
+        const bool modified2 = square_matrix2 and square_matrix2->is_modified();
+        if (modified1 != modified2)
+        {
+            throw std::invalid_argument("Both matrices must be square and in modified format for this operation");
+        }
+        if (modified1)
         {
-            if (square_matrix1->is_modified() && square_matrix2->is_modified())
+            const auto &matrix1 = static_cast<const SquareMatrix<T, S> &>(m1.matrix);
+            const auto &matrix2 = static_cast<const SquareMatrix<T, S> &>(m2.matrix);
+            if constexpr (S == StorageOrder::ColumnMajor)
             {
-                auto matrix1 = static_cast<const SquareMatrix<T, S> &>(m1.matrix);
-                auto matrix2 = static_cast<const SquareMatrix<T, S> &>(m2.matrix);
-                if constexpr (S == StorageOrder::ColumnMajor)
-                {
-                    size_t col;
+                size_t col;
 
-                    ////// ITERATE OVER COLUMNS OF matrix1 //////
+                ////// ITERATE OVER COLUMNS OF matrix1 //////
 
-                    for (col = 0; col < matrix1.cols - 1; ++col)
+                for (col = 0; col < matrix1.cols - 1; ++col)
+                {
+                    // ADD OFF-DIAGONAL ELEMENTS OF matrix1 AND matrix2
+                    size_t start = matrix1.compressed_format_mod.bind[col];
+                    size_t end = matrix1.compressed_format_mod.bind[col + 1];
+                    size_t k;
+                    // iterate over rows of matrix1 (and columns of matrix2) that are non-zero in the column "col" of matrix1
+                    for (k = start; k < end; ++k)
                     {
-                        // ADD OFF-DIAGONAL ELEMENTS OF matrix1 AND matrix2
-                        size_t start = matrix1.compressed_format_mod.bind[col];
-                        size_t end = matrix1.compressed_format_mod.bind[col + 1];
-                        size_t k;
-                        // iterate over rows of matrix1 (and columns of matrix2) that are non-zero in the column "col" of matrix1
-                        for (k = start; k < end - 1; ++k)
-                        {
-                            // j = row of matrix1 (or column of matrix2) that we are currently processing
-                            size_t j = matrix1.compressed_format_mod.bind[k];
-
-                            // iterate over rows of matrix2 that are non-zero in the column j of matrix2
-                            size_t s = matrix2.compressed_format_mod.bind[j];
-                            size_t e = matrix2.compressed_format_mod.bind[j + 1];
-                            for (size_t i = s; i < e; ++i)
-                            {
-                                // row = row of matrix2 corresponding to the index i
-                                size_t row = matrix2.compressed_format_mod.bind[i];
-
-                                // add the product of the non-zero off-diagonal elements to the "result" matrix
-                                result(col, row) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[k];
-                            }
-                        }
-                        // handle last column of matrix2 (last row of matrix1)
+                        // j = row of matrix1 (or column of matrix2) that we are currently processing
                         size_t j = matrix1.compressed_format_mod.bind[k];
+
+                        // iterate over rows of matrix2 that are non-zero in the column j of matrix2
                         size_t s = matrix2.compressed_format_mod.bind[j];
                         size_t e = (j + 1 == matrix2.cols) ? matrix2.compressed_format_mod.values.size() : matrix2.compressed_format_mod.bind[j + 1];
                         for (size_t i = s; i < e; ++i)
@@ -215,47 +146,35 @@ namespace algebra
                             size_t row = matrix2.compressed_format_mod.bind[i];
 
                             // add the product of the non-zero off-diagonal elements to the "result" matrix
-                            result(col, row) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[k];
-                        }
-
-                        // ADD DIAGONAL ELEMENTS OF matrix2
-                        // iterate over rows of matrix1 (and columns of matrix2) that are non-zero in the column "col" of matrix1
-                        for (k = start; k < end; ++k)
-                        {
-                            // j = row of matrix1 (or column of matrix2) that we are currently processing
-                            size_t j = matrix1.compressed_format_mod.bind[k];
-
-                            // add the product between the diagonal element of matrix2 and current non-zero element of matrix1 to the "result" matrix
-                            result(col, j) += matrix2.compressed_format_mod.values[j] * matrix1.compressed_format_mod.values[k];
+                            result.ref_unchecked(col, row) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[k];
                         }
                     }
 
-                    ////// HANDLE LAST COLUMN OF matrix1 //////
-
-                    // ADD OFF-DIAGONAL ELEMENTS OF matrix1 AND matrix2
-                    size_t start = matrix1.compressed_format_mod.bind[col];
-                    size_t end = matrix1.compressed_format_mod.values.size();
-                    size_t k;
+                    // ADD DIAGONAL ELEMENTS OF matrix2
                     // iterate over rows of matrix1 (and columns of matrix2) that are non-zero in the column "col" of matrix1
-                    for (k = start; k < end - 1; ++k)
+                    for (k = start; k < end; ++k)
                     {
                         // j = row of matrix1 (or column of matrix2) that we are currently processing
                         size_t j = matrix1.compressed_format_mod.bind[k];
 
-                        // iterate over rows of matrix2 that are non-zero in the column j of matrix2
-                        size_t s = matrix2.compressed_format_mod.bind[j];
-                        size_t e = matrix2.compressed_format_mod.bind[j + 1];
-                        for (size_t i = s; i < e; ++i)
-                        {
-                            // row = row of matrix2 corresponding to the index i
-                            size_t row = matrix2.compressed_format_mod.bind[i];
-
-                            // add the product of the non-zero off-diagonal elements to the "result" matrix
-                            result(col, row) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[k];
-                        }
+                        // add the product between the diagonal element of matrix2 and current non-zero element of matrix1 to the "result" matrix
+                        result.ref_unchecked(col, j) += matrix2.compressed_format_mod.values[j] * matrix1.compressed_format_mod.values[k];
                     }
-                    // handle last column of matrix2 (last row of matrix1)
+                }
+
+                ////// HANDLE LAST COLUMN OF matrix1 //////
+
+                // ADD OFF-DIAGONAL ELEMENTS OF matrix1 AND matrix2
+                size_t start = matrix1.compressed_format_mod.bind[col];
+                size_t end = matrix1.compressed_format_mod.values.size();
+                size_t k;
+                // iterate over rows of matrix1 (and columns of matrix2) that are non-zero in the column "col" of matrix1
+                for (k = start; k < end; ++k)
+                {
+                    // j = row of matrix1 (or column of matrix2) that we are currently processing
                     size_t j = matrix1.compressed_format_mod.bind[k];
+
+                    // iterate over rows of matrix2 that are non-zero in the column j of matrix2
                     size_t s = matrix2.compressed_format_mod.bind[j];
                     size_t e = (j + 1 == matrix2.cols) ? matrix2.compressed_format_mod.values.size() : matrix2.compressed_format_mod.bind[j + 1];
                     for (size_t i = s; i < e; ++i)
@@ -264,41 +183,28 @@ namespace algebra
                         size_t row = matrix2.compressed_format_mod.bind[i];
 
                         // add the product of the non-zero off-diagonal elements to the "result" matrix
-                        result(col, row) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[k];
+                        result.ref_unchecked(col, row) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[k];
                     }
+                }
 
-                    // ADD DIAGONAL ELEMENTS OF matrix2
-                    // iterate over rows of matrix1 (and columns of matrix2) that are non-zero in the column "col" of matrix1
-                    for (size_t k = start; k < end; ++k)
-                    {
-                        // j = row of matrix1 (or column of matrix2) that we are currently processing
-                        size_t j = matrix1.compressed_format_mod.bind[k];
-
-                        // add the product between the diagonal element of matrix2 and current non-zero element of matrix1 to the "result" matrix
-                        result(col, j) += matrix2.compressed_format_mod.values[j] * matrix1.compressed_format_mod.values[k];
-                    }
+                // ADD DIAGONAL ELEMENTS OF matrix2
+                // iterate over rows of matrix1 (and columns of matrix2) that are non-zero in the column "col" of matrix1
+                for (size_t k = start; k < end; ++k)
+                {
+                    // j = row of matrix1 (or column of matrix2) that we are currently processing
+                    size_t j = matrix1.compressed_format_mod.bind[k];
 
-                    ////// ADD DIAGONAL ELEMENTS OF matrix1 //////
+                    // add the product between the diagonal element of matrix2 and current non-zero element of matrix1 to the "result" matrix
+                    result.ref_unchecked(col, j) += matrix2.compressed_format_mod.values[j] * matrix1.compressed_format_mod.values[k];
+                }
 
-                    for (col = 0; col < matrix1.cols - 1; ++col)
-                    {
-                        // multiply each column of matrix2 with the diagonal element of matrix1
-                        size_t s = matrix2.compressed_format_mod.bind[col];
-                        size_t e = matrix2.compressed_format_mod.bind[col + 1];
-                        // iterate over the non-zero elements of matrix2 that are in the column "col"
-                        for (size_t i = s; i < e; ++i)
-                        {
-                            // row = row of matrix2 corresponding to the index i
-                            size_t row = matrix2.compressed_format_mod.bind[i];
+                ////// ADD DIAGONAL ELEMENTS OF matrix1 //////
 
-                            // add the product between the diagonal element of matrix1 and current non-zero element of matrix2 to the "result" matrix
-                            result(col, row) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[col];
-                        }
-                    }
-                    // HANDLE LAST COLUMN OF matrix2
+                for (col = 0; col < matrix1.cols - 1; ++col)
+                {
                     // multiply each column of matrix2 with the diagonal element of matrix1
-                    s = matrix2.compressed_format_mod.bind[col];
-                    e = matrix2.compressed_format_mod.values.size();
+                    size_t s = matrix2.compressed_format_mod.bind[col];
+                    size_t e = matrix2.compressed_format_mod.bind[col + 1];
                     // iterate over the non-zero elements of matrix2 that are in the column "col"
                     for (size_t i = s; i < e; ++i)
                     {
@@ -306,142 +212,118 @@ namespace algebra
                         size_t row = matrix2.compressed_format_mod.bind[i];
 
                         // add the product between the diagonal element of matrix1 and current non-zero element of matrix2 to the "result" matrix
-                        result(col, row) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[col];
-                    }
-
-                    ////// ADD PRODUCTS OF DIAGONAL ELEMENTS //////
-
-                    // iterate over the diagonal elements of matrix2 and matrix1
-                    for (size_t i = 0; i < matrix2.rows; ++i)
-                    {
-                        // add the product between the diagonal elements of matrix2 and matrix1 to the "result" matrix
-                        result(i, i) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[i];
+                        result.ref_unchecked(col, row) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[col];
                     }
                 }
-                else
+                // HANDLE LAST COLUMN OF matrix2
+                // multiply each column of matrix2 with the diagonal element of matrix1
+                size_t s = matrix2.compressed_format_mod.bind[col];
+                size_t e = matrix2.compressed_format_mod.values.size();
+                // iterate over the non-zero elements of matrix2 that are in the column "col"
+                for (size_t i = s; i < e; ++i)
                 {
-                    size_t row;
-
-                    ////// ITERATE OVER COLUMNS OF matrix2 //////
-
-                    for (row = 0; row < matrix2.rows - 1; ++row)
-                    {
-                        // ADD OFF-DIAGONAL ELEMENTS OF matrix2 AND matrix1
-                        size_t start = matrix2.compressed_format_mod.bind[row];
-                        size_t end = matrix2.compressed_format_mod.bind[row + 1];
-                        size_t k;
-                        // iterate over columns of matrix2 (and rows of matrix1) that are non-zero in the row "row" of matrix2
-                        for (k = start; k < end - 1; ++k)
-                        {
-                            // j = column of matrix2 (or row of matrix1) that we are currently processing
-                            size_t j = matrix2.compressed_format_mod.bind[k];
-
-                            // iterate over columns of matrix1 that are non-zero in the row j of matrix1
-                            size_t s = matrix1.compressed_format_mod.bind[j];
-                            size_t e = matrix1.compressed_format_mod.bind[j + 1];
-                            for (size_t i = s; i < e; ++i)
-                            {
-                                // col = column of matrix1 corresponding to the index i
-                                size_t col = matrix1.compressed_format_mod.bind[i];
-
-                                // add the product of the non-zero off-diagonal elements to the "result" matrix
-                                result(col, row) += matrix2.compressed_format_mod.values[k] * matrix1.compressed_format_mod.values[i];
-                            }
-                        }
-                        // handle last row of matrix1 (last column of matrix2)
-                        size_t j = matrix2.compressed_format_mod.bind[k];
-                        size_t s = matrix1.compressed_format_mod.bind[j];
-                        size_t e = (j + 1 == matrix1.rows) ? matrix1.compressed_format_mod.values.size() : matrix1.compressed_format_mod.bind[j + 1];
-                        for (size_t i = s; i < e; ++i)
-                        {
-                            // col = column of matrix1 corresponding to the index i
-                            size_t col = matrix1.compressed_format_mod.bind[i];
+                    // row = row of matrix2 corresponding to the index i
+                    size_t row = matrix2.compressed_format_mod.bind[i];
 
-                            // add the product of the non-zero off-diagonal elements to the "result" matrix
-                            result(col, row) += matrix2.compressed_format_mod.values[k] * matrix1.compressed_format_mod.values[i];
-                        }
+                    // add the product between the diagonal element of matrix1 and current non-zero element of matrix2 to the "result" matrix
+                    result.ref_unchecked(col, row) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[col];
+                }
 
-                        // ADD DIAGONAL ELEMENTS OF matrix1
-                        // iterate over columns of matrix2 (and rows of matrix1) that are non-zero in the row "row" of matrix2
-                        for (k = start; k < end; ++k)
-                        {
-                            // j = column of matrix2 (or row of matrix1) that we are currently processing
-                            size_t j = matrix2.compressed_format_mod.bind[k];
+                ////// ADD PRODUCTS OF DIAGONAL ELEMENTS //////
 
-                            // add the product between the diagonal element of matrix1 and current non-zero element of matrix2 to the "result" matrix
-                            result(j, row) += matrix2.compressed_format_mod.values[k] * matrix1.compressed_format_mod.values[j];
-                        }
-                    }
+                // iterate over the diagonal elements of matrix2 and matrix1
+                for (size_t i = 0; i < matrix2.rows; ++i)
+                {
+                    // add the product between the diagonal elements of matrix2 and matrix1 to the "result" matrix
+                    result.ref_unchecked(i, i) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[i];
+                }
+            }
+            else
+            {
+                size_t row;
 
-                    ///// HANDLE LAST ROW OF matrix2 /////
+                ////// ITERATE OVER COLUMNS OF matrix2 //////
 
+                for (row = 0; row < matrix2.rows - 1; ++row)
+                {
                     // ADD OFF-DIAGONAL ELEMENTS OF matrix2 AND matrix1
                     size_t start = matrix2.compressed_format_mod.bind[row];
-                    size_t end = matrix2.compressed_format_mod.values.size();
+                    size_t end = matrix2.compressed_format_mod.bind[row + 1];
                     size_t k;
                     // iterate over columns of matrix2 (and rows of matrix1) that are non-zero in the row "row" of matrix2
-                    for (k = start; k < end - 1; ++k)
+                    for (k = start; k < end; ++k)
                     {
                         // j = column of matrix2 (or row of matrix1) that we are currently processing
                         size_t j = matrix2.compressed_format_mod.bind[k];
 
                         // iterate over columns of matrix1 that are non-zero in the row j of matrix1
                         size_t s = matrix1.compressed_format_mod.bind[j];
-                        size_t e = matrix1.compressed_format_mod.bind[j + 1];
+                        size_t e = (j + 1 == matrix1.rows) ? matrix1.compressed_format_mod.values.size() : matrix1.compressed_format_mod.bind[j + 1];
                         for (size_t i = s; i < e; ++i)
                         {
                             // col = column of matrix1 corresponding to the index i
                             size_t col = matrix1.compressed_format_mod.bind[i];
 
                             // add the product of the non-zero off-diagonal elements to the "result" matrix
-                            result(col, row) += matrix2.compressed_format_mod.values[k] * matrix1.compressed_format_mod.values[i];
+                            result.ref_unchecked(col, row) += matrix2.compressed_format_mod.values[k] * matrix1.compressed_format_mod.values[i];
                         }
                     }
-                    // handle last row of matrix1 (last column of matrix2)
-                    size_t j = matrix2.compressed_format_mod.bind[k];
-                    size_t s = matrix1.compressed_format_mod.bind[j];
-                    size_t e = (j + 1 == matrix1.rows) ? matrix1.compressed_format_mod.values.size() : matrix1.compressed_format_mod.bind[j + 1];
-                    for (size_t i = s; i < e; ++i)
-                    {
-                        // col = column of matrix1 corresponding to the index i
-                        size_t col = matrix1.compressed_format_mod.bind[i];
-
-                        // add the product of the non-zero off-diagonal elements to the "result" matrix
-                        result(col, row) += matrix2.compressed_format_mod.values[k] * matrix1.compressed_format_mod.values[i];
-                    }
 
                     // ADD DIAGONAL ELEMENTS OF matrix1
                     // iterate over columns of matrix2 (and rows of matrix1) that are non-zero in the row "row" of matrix2
-                    for (size_t k = start; k < end; ++k)
+                    for (k = start; k < end; ++k)
                     {
                         // j = column of matrix2 (or row of matrix1) that we are currently processing
                         size_t j = matrix2.compressed_format_mod.bind[k];
 
                         // add the product between the diagonal element of matrix1 and current non-zero element of matrix2 to the "result" matrix
-                        result(j, row) += matrix2.compressed_format_mod.values[k] * matrix1.compressed_format_mod.values[j];
+                        result.ref_unchecked(j, row) += matrix2.compressed_format_mod.values[k] * matrix1.compressed_format_mod.values[j];
                     }
+                }
 
-                    ////// ADD DIAGONAL ELEMENTS OF matrix2 //////
+                ///// HANDLE LAST ROW OF matrix2 /////
 
-                    for (row = 0; row < matrix2.rows - 1; ++row)
+                // ADD OFF-DIAGONAL ELEMENTS OF matrix2 AND matrix1
+                size_t start = matrix2.compressed_format_mod.bind[row];
+                size_t end = matrix2.compressed_format_mod.values.size();
+                size_t k;
+                // iterate over columns of matrix2 (and rows of matrix1) that are non-zero in the row "row" of matrix2
+                for (k = start; k < end; ++k)
+                {
+                    // j = column of matrix2 (or row of matrix1) that we are currently processing
+                    size_t j = matrix2.compressed_format_mod.bind[k];
+
+                    // iterate over columns of matrix1 that are non-zero in the row j of matrix1
+                    size_t s = matrix1.compressed_format_mod.bind[j];
+                    size_t e = (j + 1 == matrix1.rows) ? matrix1.compressed_format_mod.values.size() : matrix1.compressed_format_mod.bind[j + 1];
+                    for (size_t i = s; i < e; ++i)
                     {
-                        // multiply each row of matrix1 with the diagonal element of matrix2
-                        size_t s = matrix1.compressed_format_mod.bind[row];
-                        size_t e = matrix1.compressed_format_mod.bind[row + 1];
-                        // iterate over the non-zero elements of matrix1 that are in the row "row"
-                        for (size_t i = s; i < e; ++i)
-                        {
-                            // col = column of matrix1 corresponding to the index i
-                            size_t col = matrix1.compressed_format_mod.bind[i];
+                        // col = column of matrix1 corresponding to the index i
+                        size_t col = matrix1.compressed_format_mod.bind[i];
 
-                            // add the product between the diagonal element of matrix2 and current non-zero element of matrix1 to the "result" matrix
-                            result(col, row) += matrix2.compressed_format_mod.values[row] * matrix1.compressed_format_mod.values[i];
-                        }
+                        // add the product of the non-zero off-diagonal elements to the "result" matrix
+                        result.ref_unchecked(col, row) += matrix2.compressed_format_mod.values[k] * matrix1.compressed_format_mod.values[i];
                     }
-                    // HANDLE LAST ROW OF matrix1
+                }
+
+                // ADD DIAGONAL ELEMENTS OF matrix1
+                // iterate over columns of matrix2 (and rows of matrix1) that are non-zero in the row "row" of matrix2
+                for (size_t k = start; k < end; ++k)
+                {
+                    // j = column of matrix2 (or row of matrix1) that we are currently processing
+                    size_t j = matrix2.compressed_format_mod.bind[k];
+
+                    // add the product between the diagonal element of matrix1 and current non-zero element of matrix2 to the "result" matrix
+                    result.ref_unchecked(j, row) += matrix2.compressed_format_mod.values[k] * matrix1.compressed_format_mod.values[j];
+                }
+
+                ////// ADD DIAGONAL ELEMENTS OF matrix2 //////
+
+                for (row = 0; row < matrix2.rows - 1; ++row)
+                {
                     // multiply each row of matrix1 with the diagonal element of matrix2
-                    s = matrix1.compressed_format_mod.bind[row];
-                    e = matrix1.compressed_format_mod.values.size();
+                    size_t s = matrix1.compressed_format_mod.bind[row];
+                    size_t e = matrix1.compressed_format_mod.bind[row + 1];
                     // iterate over the non-zero elements of matrix1 that are in the row "row"
                     for (size_t i = s; i < e; ++i)
                     {
@@ -449,23 +331,32 @@ namespace algebra
                         size_t col = matrix1.compressed_format_mod.bind[i];
 
                         // add the product between the diagonal element of matrix2 and current non-zero element of matrix1 to the "result" matrix
-                        result(col, row) += matrix2.compressed_format_mod.values[row] * matrix1.compressed_format_mod.values[i];
+                        result.ref_unchecked(col, row) += matrix2.compressed_format_mod.values[row] * matrix1.compressed_format_mod.values[i];
                     }
+                }
+                // HANDLE LAST ROW OF matrix1
+                // multiply each row of matrix1 with the diagonal element of matrix2
+                size_t s = matrix1.compressed_format_mod.bind[row];
+                size_t e = matrix1.compressed_format_mod.values.size();
+                // iterate over the non-zero elements of matrix1 that are in the row "row"
+                for (size_t i = s; i < e; ++i)
+                {
+                    // col = column of matrix1 corresponding to the index i
+                    size_t col = matrix1.compressed_format_mod.bind[i];
 
-                    ////// ADD PRODUCTS OF DIAGONAL ELEMENTS //////
+                    // add the product between the diagonal element of matrix2 and current non-zero element of matrix1 to the "result" matrix
+                    result.ref_unchecked(col, row) += matrix2.compressed_format_mod.values[row] * matrix1.compressed_format_mod.values[i];
+                }
 
-                    // iterate over the diagonal elements of matrix2 and matrix1
-                    for (size_t i = 0; i < matrix2.rows; ++i)
-                    {
-                        // add the product between the diagonal elements of matrix2 and matrix1 to the "result" matrix
-                        result(i, i) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[i];
-                    }
+                ////// ADD PRODUCTS OF DIAGONAL ELEMENTS //////
+
+                // iterate over the diagonal elements of matrix2 and matrix1
+                for (size_t i = 0; i < matrix2.rows; ++i)
+                {
+                    // add the product between the diagonal elements of matrix2 and matrix1 to the "result" matrix
+                    result.ref_unchecked(i, i) += matrix2.compressed_format_mod.values[i] * matrix1.compressed_format_mod.values[i];
                 }
             }
-            else if (square_matrix1->is_modified() or square_matrix2->is_modified())
-            {
-                throw std::invalid_argument("Both matrices must be square and in modified format for this operation");
-            }
         }
         else if (m1.is_compressed())
         {
@@ -489,7 +380,7 @@ namespace algebra
                             size_t row = matrix2.compressed_format.outer[i];
 
                             // add the product of the non-zero elements to the "result" matrix
-                            result(col, row) += matrix2.compressed_format.values[i] * matrix1.compressed_format.values[k];
+                            result.ref_unchecked(col, row) += matrix2.compressed_format.values[i] * matrix1.compressed_format.values[k];
                         }
                     }
                 }
@@ -512,7 +403,7 @@ namespace algebra
                             size_t col = matrix1.compressed_format.outer[i];
 
                             // add the product of the non-zero elements to the "result" matrix
-                            result(col, row) += matrix2.compressed_format.values[j] * matrix1.compressed_format.values[i];
+                            result.ref_unchecked(col, row) += matrix2.compressed_format.values[j] * matrix1.compressed_format.values[i];
                         }
                     }
                 }
@@ -543,10 +434,13 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     std::vector<T> operator*(const DiagonalView<T, S> &m, const std::vector<T> &v)
     {
+        m.matrix.require_flushed();
         if (m.get_cols() != v.size())
         {
             throw std::invalid_argument("Matrix and vector dimensions do not match for multiplication");
         }
+        ALGEBRA_PROFILE(profile_name("spmv_diagonal", S, m.is_compressed(), m.is_modified()));
+        ALGEBRA_TRACE(profile_name("spmv_diagonal", S, m.is_compressed(), m.is_modified()));
         std::vector<T> result(m.get_rows(), T(0));
         auto &matrix = m.matrix;
         if (matrix.is_modified())
@@ -626,6 +520,8 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     SquareMatrix<T, S> operator*(const DiagonalView<T, S> &m1, const DiagonalView<T, S> &m2)
     {
+        m1.matrix.require_flushed();
+        m2.matrix.require_flushed();
         if (m1.get_cols() != m2.get_rows())
         {
             throw std::invalid_argument("Matrix dimensions do not match for multiplication");
@@ -634,6 +530,8 @@ namespace algebra
         {
             throw std::invalid_argument("Matrix compression formats do not match");
         }
+        ALGEBRA_PROFILE(profile_name("spgemm_diagonal", S, m1.is_compressed(), m1.is_modified()));
+        ALGEBRA_TRACE(profile_name("spgemm_diagonal", S, m1.is_compressed(), m1.is_modified()));
         SquareMatrix<T, S> result(m1.get_rows());
         auto &matrix1 = m1.matrix;
         auto &matrix2 = m2.matrix;
@@ -642,7 +540,7 @@ namespace algebra
             size_t cols = matrix1.get_cols();
             for (size_t i = 0; i < cols; ++i)
             {
-                result(i, i) = matrix1.compressed_format_mod.values[i] * matrix2.compressed_format_mod.values[i];
+                result.ref_unchecked(i, i) = matrix1.compressed_format_mod.values[i] * matrix2.compressed_format_mod.values[i];
             }
         }
         else if (matrix1.is_compressed())
@@ -671,7 +569,7 @@ namespace algebra
                                 if (row == j)
                                 {
                                     // add the product of the non-zero elements to the "result" matrix
-                                    result(row, col) += matrix1.compressed_format.values[i] * matrix2.compressed_format.values[k];
+                                    result.ref_unchecked(row, col) += matrix1.compressed_format.values[i] * matrix2.compressed_format.values[k];
                                 }
                             }
                         }
@@ -702,7 +600,7 @@ namespace algebra
                                 if (col == k)
                                 {
                                     // add the product of the non-zero elements to the "result" matrix
-                                    result(row, col) += matrix1.compressed_format.values[j] * matrix2.compressed_format.values[i];
+                                    result.ref_unchecked(row, col) += matrix1.compressed_format.values[j] * matrix2.compressed_format.values[i];
                                 }
                             }
                         }
@@ -730,6 +628,8 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     Matrix<T, S> operator*(const Matrix<T, S> &m1, const DiagonalView<T, S> &m2)
     {
+        m1.require_flushed();
+        m2.matrix.require_flushed();
         if (m1.get_cols() != m2.get_rows())
         {
             throw std::invalid_argument("Matrix dimensions do not match for multiplication");
@@ -738,6 +638,8 @@ namespace algebra
         {
             throw std::invalid_argument("Matrix compression formats do not match");
         }
+        ALGEBRA_PROFILE(profile_name("spgemm_matrix_diagonal", S, m1.is_compressed(), m2.is_modified()));
+        ALGEBRA_TRACE(profile_name("spgemm_matrix_diagonal", S, m1.is_compressed(), m2.is_modified()));
         Matrix<T, S> result(m1.get_rows(), m2.get_cols());
         auto &matrix2 = m2.matrix;
 
@@ -748,10 +650,24 @@ namespace algebra
                 auto &matrix1 = *square_matrix;
                 if (matrix1.is_modified())
                 {
-                    size_t cols = matrix1.get_cols();
-                    for (size_t i = 0; i < cols; ++i)
-                    {
-                        result(i, i) = matrix1.compressed_format_mod.values[i] * matrix2.compressed_format_mod.values[i];
+                    const auto &values = matrix1.compressed_format_mod.values;
+                    const auto &bind = matrix1.compressed_format_mod.bind;
+                    const auto &diagonal = matrix2.compressed_format_mod.values;
+                    const size_t size = matrix1.get_cols();
+                    // iterate over rows (columns) of matrix1
+                    for (size_t i = 0; i < size; ++i)
+                    {
+                        // scale the diagonal element of matrix1
+                        result.ref_unchecked(i, i) += values[i] * diagonal[i];
+
+                        // scale the off-diagonal elements of the row (column) i of matrix1 by the diagonal element of their column
+                        const size_t end = (i + 1 == size) ? values.size() : bind[i + 1];
+                        for (size_t k = bind[i]; k < end; ++k)
+                        {
+                            const size_t row = (S == StorageOrder::ColumnMajor) ? bind[k] : i;
+                            const size_t col = (S == StorageOrder::ColumnMajor) ? i : bind[k];
+                            result.ref_unchecked(row, col) += values[k] * diagonal[col];
+                        }
                     }
                 }
                 else
@@ -788,7 +704,7 @@ namespace algebra
                                 size_t row = matrix1.compressed_format.outer[i];
 
                                 // add the product of the non-zero elements to the "result" matrix
-                                result(row, col) += matrix1.compressed_format.values[i] * matrix2.compressed_format.values[k];
+                                result.ref_unchecked(row, col) += matrix1.compressed_format.values[i] * matrix2.compressed_format.values[k];
                             }
                         }
                     }
@@ -815,7 +731,7 @@ namespace algebra
                             if (col == k)
                             {
                                 // add the product of the non-zero elements to the "result" matrix
-                                result(row, col) += matrix1.compressed_format.values[j] * matrix2.compressed_format.values[i];
+                                result.ref_unchecked(row, col) += matrix1.compressed_format.values[j] * matrix2.compressed_format.values[i];
                             }
                         }
                     }
@@ -851,6 +767,8 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     Matrix<T, S> operator*(const DiagonalView<T, S> &m1, const Matrix<T, S> &m2)
     {
+        m1.matrix.require_flushed();
+        m2.require_flushed();
         if (m1.get_cols() != m2.get_rows())
         {
             throw std::invalid_argument("Matrix dimensions do not match for multiplication");
@@ -859,6 +777,8 @@ namespace algebra
         {
             throw std::invalid_argument("Matrix compression formats do not match");
         }
+        ALGEBRA_PROFILE(profile_name("spgemm_diagonal_matrix", S, m1.is_compressed(), m1.is_modified()));
+        ALGEBRA_TRACE(profile_name("spgemm_diagonal_matrix", S, m1.is_compressed(), m1.is_modified()));
         Matrix<T, S> result(m1.get_rows(), m2.get_cols());
         auto &matrix1 = m1.matrix;
 
@@ -869,10 +789,24 @@ namespace algebra
                 auto &matrix2 = *square_matrix;
                 if (matrix2.is_modified())
                 {
-                    size_t cols = matrix2.get_cols();
-                    for (size_t i = 0; i < cols; ++i)
-                    {
-                        result(i, i) = matrix1.compressed_format_mod.values[i] * matrix2.compressed_format_mod.values[i];
+                    const auto &diagonal = matrix1.compressed_format_mod.values;
+                    const auto &values = matrix2.compressed_format_mod.values;
+                    const auto &bind = matrix2.compressed_format_mod.bind;
+                    const size_t size = matrix2.get_cols();
+                    // iterate over rows (columns) of matrix2
+                    for (size_t i = 0; i < size; ++i)
+                    {
+                        // scale the diagonal element of matrix2
+                        result.ref_unchecked(i, i) += diagonal[i] * values[i];
+
+                        // scale the off-diagonal elements of the row (column) i of matrix2 by the diagonal element of their row
+                        const size_t end = (i + 1 == size) ? values.size() : bind[i + 1];
+                        for (size_t k = bind[i]; k < end; ++k)
+                        {
+                            const size_t row = (S == StorageOrder::ColumnMajor) ? bind[k] : i;
+                            const size_t col = (S == StorageOrder::ColumnMajor) ? i : bind[k];
+                            result.ref_unchecked(row, col) += diagonal[row] * values[k];
+                        }
                     }
                 }
                 else
@@ -909,7 +843,7 @@ namespace algebra
                             if (row == j)
                             {
                                 // add the product of the non-zero elements to the "result" matrix
-                                result(row, col) += matrix1.compressed_format.values[i] * matrix2.compressed_format.values[k];
+                                result.ref_unchecked(row, col) += matrix1.compressed_format.values[i] * matrix2.compressed_format.values[k];
                             }
                         }
                     }
@@ -936,7 +870,7 @@ namespace algebra
                                 size_t col = matrix2.compressed_format.outer[i];
 
                                 // add the product of the non-zero elements to the "result" matrix
-                                result(row, col) += matrix1.compressed_format.values[j] * matrix2.compressed_format.values[i];
+                                result.ref_unchecked(row, col) += matrix1.compressed_format.values[j] * matrix2.compressed_format.values[i];
                             }
                         }
                     }
@@ -961,7 +895,7 @@ namespace algebra
                     if (it1.first.col == it2.first.row && it1.first.row == it1.first.col)
                     {
                         // add the product of the non-zero elements to the "result" vector
-                        result(it1.first.row, it1.first.col) += it1.second * it2.second;
+                        result(it1.first.row, it2.first.col) += it1.second * it2.second;
                     }
                 }
             }
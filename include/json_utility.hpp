@@ -30,7 +30,7 @@ namespace json_utility
      * @return json The parsed JSON object.
      * @throws std::runtime_error If the file cannot be opened.
      */
-    json read_json(const std::string &filename)
+    inline json read_json(const std::string &filename)
     {
         std::ifstream file(filename);
         if (!file.is_open())
@@ -53,7 +53,7 @@ namespace json_utility
      *
      * @throws std::runtime_error If the file cannot be opened for writing.
      */
-    void save_json(const std::string &filename, const json &data)
+    inline void save_json(const std::string &filename, const json &data)
     {
         std::ofstream file(filename);
         if (!file.is_open())
@@ -0,0 +1,545 @@
+/**
+ * @file loader.hpp
+ * @brief Defines the pipelined loader of Matrix Market files, built on C++20 coroutines.
+ *
+ * Matrix::reader reads the file line by line, inserts every element in the map of the uncompressed format,
+ * and the matrix is compressed afterwards. algebra::load_matrix builds the compressed arrays directly, with
+ * three overlapping stages connected by bounded buffers:
+ * 1. read_chunks: a background thread reads blocks of whole lines, at most LoaderOptions::max_chunks ahead
+ *    of the parser, so that the I/O overlaps with the parsing;
+ * 2. parse_entries: a coroutine parses the lines of a block with `std::from_chars` into a batch of entries;
+ * 3. load_matrix: the entries of every batch are counted per row (column) and appended to coordinate
+ *    arrays while the next blocks are read; at the end they are scattered into the compressed arrays, and
+ *    every row (column) is sorted and merged in parallel.
+ *
+ * The map of the uncompressed format is never built: the memory used is the one of the coordinate arrays
+ * and of the compressed arrays, plus the bounded buffers of the pipeline.
+ * @code{.cpp}
+ * auto m = load_matrix<SquareMatrix<double, StorageOrder::RowMajor>>("data/lnsp_131.mtx");
+ * m.compress_mod(); // m is already compressed (CSR)
+ * @endcode
+ *
+ * The result is the same as the one of reader followed by compress: the duplicated elements keep the last
+ * value in the file, and the elements whose value is zero are not stored.
+ *
+ * @see matrix.hpp
+ */
+#ifndef LOADER_HPP
+#define LOADER_HPP
+
+#include "square_matrix.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <charconv>
+#include <numeric>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <type_traits>
+
+#include <tbb/concurrent_queue.h>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+namespace algebra
+{
+    /**
+     * @brief Lazy sequence of values produced by a coroutine with `co_yield`.
+     *
+     * The coroutine runs until the next `co_yield` every time the iterator is incremented; the exceptions
+     * thrown by the coroutine are rethrown by the iterator.
+     *
+     * @tparam T type of the values
+     */
+    template <typename T>
+    class Generator
+    {
+    public:
+        /**
+         * @brief Promise of the coroutine: holds the last yielded value.
+         */
+        struct promise_type
+        {
+            const T *current = nullptr; /// last yielded value, alive while the coroutine is suspended
+            std::exception_ptr error;   /// exception thrown by the coroutine
+
+            Generator get_return_object() { return Generator(std::coroutine_handle<promise_type>::from_promise(*this)); };
+            std::suspend_always initial_suspend() noexcept { return {}; };
+            std::suspend_always final_suspend() noexcept { return {}; };
+            void return_void() noexcept {};
+            void unhandled_exception() { error = std::current_exception(); };
+
+            /// @brief suspend the coroutine with a value
+            /// @param value yielded value
+            std::suspend_always yield_value(const T &value) noexcept
+            {
+                current = std::addressof(value);
+                return {};
+            }
+        };
+
+        /**
+         * @brief Input iterator over the yielded values.
+         */
+        class iterator
+        {
+        public:
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+
+            iterator() = default;
+            explicit iterator(std::coroutine_handle<promise_type> handle) : handle(handle){};
+
+            const T &operator*() const { return *handle.promise().current; };
+            const T *operator->() const { return handle.promise().current; };
+
+            /// @brief resume the coroutine until the next value
+            iterator &operator++()
+            {
+                resume(handle);
+                return *this;
+            }
+
+            void operator++(int) { ++*this; };
+
+            bool operator==(std::default_sentinel_t) const { return not handle or handle.done(); };
+
+        private:
+            std::coroutine_handle<promise_type> handle; /// coroutine producing the values
+        };
+
+        /// @brief move constructor
+        Generator(Generator &&other) noexcept : handle(std::exchange(other.handle, nullptr)){};
+
+        Generator(const Generator &) = delete;
+        Generator &operator=(const Generator &) = delete;
+
+        /// @brief destructor, destroys the coroutine (and its local variables) if it is suspended
+        ~Generator()
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+        }
+
+        /// @brief start the coroutine
+        /// @return iterator to the first value
+        iterator begin()
+        {
+            resume(handle);
+            return iterator(handle);
+        }
+
+        /// @brief end of the sequence
+        std::default_sentinel_t end() const { return {}; };
+
+    private:
+        std::coroutine_handle<promise_type> handle; /// coroutine producing the values
+
+        explicit Generator(std::coroutine_handle<promise_type> handle) : handle(handle){};
+
+        /// @brief resume a coroutine and rethrow its exception
+        /// @param handle coroutine to resume
+        static void resume(std::coroutine_handle<promise_type> handle)
+        {
+            handle.resume();
+            if (handle.promise().error)
+            {
+                std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+            }
+        }
+    };
+
+    /**
+     * @brief Sizes of the buffers of the loader.
+     */
+    struct LoaderOptions
+    {
+        size_t chunk_bytes = size_t(1) << 20; /// bytes read at once from the file
+        size_t max_chunks = 4;                /// blocks read ahead of the parser at most
+    };
+
+    /**
+     * @brief Size line of a Matrix Market file.
+     */
+    struct MatrixMarketHeader
+    {
+        bool found = false; /// true once the size line is parsed
+        size_t rows = 0;    /// number of rows
+        size_t cols = 0;    /// number of columns
+        size_t nnz = 0;     /// number of entries declared in the file
+    };
+
+    /**
+     * @brief Entry of a Matrix Market file, with 0-based indices.
+     */
+    template <typename T>
+    struct MatrixEntry
+    {
+        size_t row; /// row index
+        size_t col; /// column index
+        T value;    /// value
+    };
+
+    /// @brief read a file in blocks of whole lines, in a background thread
+    /// @param filename name of the file
+    /// @param options size of the blocks and maximum number of blocks read ahead
+    /// @return sequence of the blocks, each ending with a complete line
+    /// @throws std::runtime_error if the file cannot be opened or read
+    inline Generator<std::string> read_chunks(std::string filename, LoaderOptions options = {})
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (not file.is_open())
+        {
+            throw std::runtime_error("Unable to open file '" + filename + "': " + strerror(errno));
+        }
+        const size_t chunk_bytes = std::max<size_t>(options.chunk_bytes, 1);
+
+        // an empty block marks the end of the file
+        tbb::concurrent_bounded_queue<std::string> queue;
+        queue.set_capacity(static_cast<std::ptrdiff_t>(std::max<size_t>(options.max_chunks, 1)));
+        std::atomic<bool> stop = false;
+        std::atomic<bool> finished = false;
+        std::exception_ptr error;
+
+        std::thread reader(
+            [&]()
+            {
+                try
+                {
+                    std::string carry;
+                    while (file and not stop.load(std::memory_order_relaxed))
+                    {
+                        std::string chunk = std::move(carry);
+                        carry.clear();
+                        const size_t size = chunk.size();
+                        chunk.resize(size + chunk_bytes);
+                        file.read(chunk.data() + size, static_cast<std::streamsize>(chunk_bytes));
+                        chunk.resize(size + static_cast<size_t>(file.gcount()));
+                        if (file)
+                        {
+                            // the incomplete last line is moved to the next block
+                            const size_t end = chunk.rfind('\n');
+                            if (end == std::string::npos)
+                            {
+                                carry = std::move(chunk);
+                                continue;
+                            }
+                            carry.assign(chunk, end + 1);
+                            chunk.resize(end + 1);
+                        }
+                        else if (file.bad())
+                        {
+                            throw std::runtime_error("Unable to read file '" + filename + "'");
+                        }
+                        if (not chunk.empty())
+                        {
+                            queue.push(std::move(chunk));
+                        }
+                    }
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+                queue.push(std::string());
+                finished.store(true, std::memory_order_release);
+            });
+
+        // stop the reader also when the sequence is abandoned: the queue is drained until it finishes
+        struct Join
+        {
+            std::thread &reader;
+            tbb::concurrent_bounded_queue<std::string> &queue;
+            std::atomic<bool> &stop;
+            std::atomic<bool> &finished;
+            ~Join()
+            {
+                stop.store(true, std::memory_order_relaxed);
+                std::string discarded;
+                while (not finished.load(std::memory_order_acquire))
+                {
+                    queue.try_pop(discarded);
+                    std::this_thread::yield();
+                }
+                reader.join();
+            }
+        } join{reader, queue, stop, finished};
+
+        std::string chunk;
+        while (true)
+        {
+            queue.pop(chunk);
+            if (chunk.empty())
+            {
+                break;
+            }
+            co_yield chunk;
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /// @brief parse a number from the start of a string
+    /// @param text string to parse, advanced past the number and the following blanks
+    /// @param value parsed number
+    /// @return true if a number is parsed
+    template <typename Number>
+    bool parse_number(std::string_view &text, Number &value)
+    {
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc())
+        {
+            return false;
+        }
+        text.remove_prefix(static_cast<size_t>(end - text.data()));
+        text.remove_prefix(std::min(text.find_first_not_of(" \t\r"), text.size()));
+        return true;
+    }
+
+    /// @brief parse the entries of the blocks of a Matrix Market file
+    /// @tparam T type of the values
+    /// @param chunks blocks of whole lines of the file
+    /// @param header size line of the file, set before the first batch is yielded
+    /// @param filename name of the file (for the error messages)
+    /// @return sequence of the batches of entries of every block
+    /// @throws std::runtime_error if a line is not a valid entry or an index is out of range
+    template <AddMulType T>
+    Generator<std::vector<MatrixEntry<T>>> parse_entries(Generator<std::string> chunks, MatrixMarketHeader &header,
+                                                         std::string filename)
+    {
+        std::vector<MatrixEntry<T>> batch;
+        for (const std::string &chunk : chunks)
+        {
+            batch.clear();
+            std::string_view text(chunk);
+            while (not text.empty())
+            {
+                const size_t end = std::min(text.find('\n'), text.size());
+                std::string_view line = text.substr(0, end);
+                text.remove_prefix(std::min(end + 1, text.size()));
+                line.remove_prefix(std::min(line.find_first_not_of(" \t\r"), line.size()));
+                if (line.empty() or line.front() == '%')
+                {
+                    continue;
+                }
+
+                if (not header.found)
+                {
+                    if (not(parse_number(line, header.rows) and parse_number(line, header.cols) and
+                            parse_number(line, header.nnz)))
+                    {
+                        throw std::runtime_error("Invalid size line in '" + filename + "'");
+                    }
+                    header.found = true;
+                    continue;
+                }
+
+                MatrixEntry<T> entry;
+                bool valid = parse_number(line, entry.row) and parse_number(line, entry.col);
+                if constexpr (is_complex<T>::value)
+                {
+                    typename T::value_type real, imag;
+                    valid = valid and parse_number(line, real) and parse_number(line, imag);
+                    entry.value = T(real, imag);
+                }
+                else
+                {
+                    valid = valid and parse_number(line, entry.value);
+                }
+                if (not valid)
+                {
+                    throw std::runtime_error("Invalid entry in '" + filename + "': " + std::string(line));
+                }
+                if (entry.row == 0 or entry.col == 0 or entry.row > header.rows or entry.col > header.cols)
+                {
+                    throw std::runtime_error("Index out of range in '" + filename + "'");
+                }
+                entry.row--;
+                entry.col--;
+                batch.push_back(entry);
+            }
+            if (not batch.empty())
+            {
+                co_yield batch;
+            }
+        }
+    }
+
+    /**
+     * @brief Type of the elements, storage order and shape of the matrices built by load_matrix.
+     */
+    template <typename M>
+    struct LoadedMatrix;
+
+    template <AddMulType T, StorageOrder S>
+    struct LoadedMatrix<Matrix<T, S>>
+    {
+        using value_type = T;
+        static constexpr StorageOrder storage_order = S;
+        static constexpr bool square = false;
+    };
+
+    template <AddMulType T, StorageOrder S>
+    struct LoadedMatrix<SquareMatrix<T, S>>
+    {
+        using value_type = T;
+        static constexpr StorageOrder storage_order = S;
+        static constexpr bool square = true;
+    };
+
+    /// @brief load a matrix from a Matrix Market file with the pipelined loader
+    /// @tparam M type of the matrix (Matrix or SquareMatrix)
+    /// @param filename name of the file
+    /// @param options sizes of the buffers of the pipeline
+    /// @return the matrix, in compressed format (CSR for RowMajor, CSC for ColumnMajor)
+    /// @throws std::runtime_error if the file cannot be read or parsed
+    /// @throws std::invalid_argument if M is a square matrix and the file is not
+    template <typename M>
+    M load_matrix(const std::string &filename, const LoaderOptions &options = {})
+    {
+        using T = typename LoadedMatrix<M>::value_type;
+        constexpr StorageOrder S = LoadedMatrix<M>::storage_order;
+        ALGEBRA_PROFILE(profile_name("load", S, true));
+        ALGEBRA_TRACE(profile_name("load", S, true));
+
+        // overlapped with the reading and the parsing: count the entries of every major index
+        MatrixMarketHeader header;
+        std::vector<size_t> majors, minors, counts;
+        std::vector<T> values;
+        for (const auto &batch : parse_entries<T>(read_chunks(filename, options), header, filename))
+        {
+            if (counts.empty())
+            {
+                majors.reserve(header.nnz);
+                minors.reserve(header.nnz);
+                values.reserve(header.nnz);
+                counts.assign((S == StorageOrder::ColumnMajor ? header.cols : header.rows) + 1, 0);
+            }
+            for (const auto &entry : batch)
+            {
+                const size_t major = (S == StorageOrder::ColumnMajor) ? entry.col : entry.row;
+                majors.push_back(major);
+                minors.push_back((S == StorageOrder::ColumnMajor) ? entry.row : entry.col);
+                values.push_back(entry.value);
+                counts[major + 1]++;
+            }
+        }
+        if (not header.found)
+        {
+            throw std::runtime_error("Missing size line in '" + filename + "'");
+        }
+        if constexpr (LoadedMatrix<M>::square)
+        {
+            if (header.rows != header.cols)
+            {
+                throw std::invalid_argument("Matrix is not square");
+            }
+        }
+        const size_t major_size = (S == StorageOrder::ColumnMajor) ? header.cols : header.rows;
+        counts.resize(major_size + 1, 0);
+
+        // scatter the entries to their major index, in the order of the file
+        CompressedStorage<T> storage;
+        storage.inner.resize(major_size + 1);
+        std::inclusive_scan(counts.begin(), counts.end(), storage.inner.begin());
+        storage.outer.resize(values.size());
+        storage.values.resize(values.size());
+        std::vector<size_t> next(storage.inner.begin(), storage.inner.end() - 1);
+        for (size_t j = 0; j < values.size(); j++)
+        {
+            const size_t position = next[majors[j]]++;
+            storage.outer[position] = minors[j];
+            storage.values[position] = values[j];
+        }
+        std::vector<size_t>().swap(majors);
+        std::vector<size_t>().swap(minors);
+        std::vector<T>().swap(values);
+
+        // sort every major index by the minor index, keeping the last of the duplicated entries and
+        // dropping the zeros (as Matrix::set does), and count the entries kept
+        std::vector<size_t> kept(major_size);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, major_size), [&](const tbb::blocked_range<size_t> &range)
+                          {
+                              std::vector<size_t> order;
+                              std::vector<size_t> merged_outer;
+                              std::vector<T> merged_values;
+                              for (size_t major = range.begin(); major < range.end(); major++)
+                              {
+                                  const size_t begin = storage.inner[major];
+                                  const size_t end = storage.inner[major + 1];
+                                  bool sorted = true;
+                                  for (size_t j = begin; j < end and sorted; j++)
+                                  {
+                                      sorted = storage.values[j] != T(0) and (j == begin or storage.outer[j - 1] < storage.outer[j]);
+                                  }
+                                  if (sorted)
+                                  {
+                                      kept[major] = end - begin;
+                                      continue;
+                                  }
+                                  order.resize(end - begin);
+                                  std::iota(order.begin(), order.end(), begin);
+                                  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                                                   { return storage.outer[a] < storage.outer[b]; });
+                                  merged_outer.clear();
+                                  merged_values.clear();
+                                  for (size_t k = 0; k < order.size(); k++)
+                                  {
+                                      const size_t j = order[k];
+                                      if ((k + 1 < order.size() and storage.outer[order[k + 1]] == storage.outer[j]) or
+                                          storage.values[j] == T(0))
+                                      {
+                                          continue;
+                                      }
+                                      merged_outer.push_back(storage.outer[j]);
+                                      merged_values.push_back(storage.values[j]);
+                                  }
+                                  std::copy(merged_outer.begin(), merged_outer.end(), storage.outer.begin() + begin);
+                                  std::copy(merged_values.begin(), merged_values.end(), storage.values.begin() + begin);
+                                  kept[major] = merged_outer.size();
+                              } });
+
+        // compact the major indices that lost entries
+        size_t position = 0;
+        for (size_t major = 0; major < major_size; major++)
+        {
+            const size_t begin = storage.inner[major];
+            storage.inner[major] = position;
+            if (position != begin)
+            {
+                std::copy(storage.outer.begin() + begin, storage.outer.begin() + begin + kept[major], storage.outer.begin() + position);
+                std::copy(storage.values.begin() + begin, storage.values.begin() + begin + kept[major], storage.values.begin() + position);
+            }
+            position += kept[major];
+        }
+        storage.inner[major_size] = position;
+        storage.outer.resize(position);
+        storage.values.resize(position);
+        storage.outer.shrink_to_fit();
+        storage.values.shrink_to_fit();
+
+        if constexpr (LoadedMatrix<M>::square)
+        {
+            return M(header.rows, std::move(storage));
+        }
+        else
+        {
+            return M(header.rows, header.cols, std::move(storage));
+        }
+    }
+}
+
+#endif // LOADER_HPP
@@ -19,6 +19,9 @@
  * @see storage.hpp
  * @see proxy.hpp
  * @see abstract_matrix.hpp
+ * @see conversion.hpp
+ * @see numa.hpp
+ * @see execution_context.hpp
  * @see matrix.tpp
  * @see view_products.tpp
  */
@@ -28,6 +31,11 @@
 #include "storage.hpp"
 #include "proxy.hpp"
 #include "abstract_matrix.hpp"
+#include "profiling.hpp"
+#include "tracing.hpp"
+#include "conversion.hpp"
+#include "numa.hpp"
+#include "execution_context.hpp"
 
 #include <vector>
 #include <iostream>
@@ -36,6 +44,7 @@
 #include <type_traits>
 #include <execution>
 #include <cmath>
+#include <stdexcept>
 
 /**
  * @namespace algebra
@@ -58,6 +67,9 @@ namespace algebra
     template <AddMulType T, StorageOrder S>
     class DiagonalView;
 
+    // forward declaration of the SparsityPattern struct
+    struct SparsityPattern;
+
     /**
      * @class Matrix
      * @brief Represents a sparse matrix with configurable storage order and element type.
@@ -90,6 +102,13 @@ namespace algebra
         /// @param cols number of columns
         Matrix(size_t rows, size_t cols) : rows(rows), cols(cols) { this->compressed = false; };
 
+        /// @brief constructor from arrays in compressed format
+        /// @note the constructed matrix is in compressed format and takes ownership of the arrays
+        /// @param rows number of rows
+        /// @param cols number of columns
+        /// @param storage CSR (RowMajor) or CSC (ColumnMajor) arrays, with sorted indices in each row (column)
+        Matrix(size_t rows, size_t cols, CompressedStorage<T> &&storage);
+
         /// @brief default copy constructor
         Matrix(const Matrix &other) = default;
 
@@ -126,8 +145,15 @@ namespace algebra
         /// @param row row index
         /// @param col column index
         /// @param value value to set
+        /// @throws std::out_of_range if the indices are outside the matrix (unless ALGEBRA_BOUNDS_CHECK is 0)
         virtual void set(size_t row, size_t col, const T &value) override;
 
+        /// @brief set an element in the matrix, without checking the indices
+        /// @param row row index, less than the number of rows
+        /// @param col column index, less than the number of columns
+        /// @param value value to set
+        virtual void set_unchecked(size_t row, size_t col, const T &value);
+
         /// @brief check if the matrix is in a compressed format
         /// @return true if the matrix is compressed, false otherwise
         virtual bool is_compressed() const override { return compressed; };
@@ -138,6 +164,65 @@ namespace algebra
         /// @brief compress the matrix in parallel if it is in an uncompressed format
         virtual void compress_parallel();
 
+        /// @brief compress the matrix in the given compressed format
+        /// @param format compressed format (only CompressedFormat::Compressed is available for a general matrix)
+        virtual void compress(CompressedFormat format);
+
+        /// @brief set the kernel used by the products in compressed format
+        /// @param kernel kernel to use (Serial or Parallel)
+        virtual void set_kernel(Kernel kernel) { this->kernel = kernel; };
+
+        /// @brief get the kernel used by the products in compressed format
+        /// @return kernel in use
+        virtual Kernel get_kernel() const { return kernel; };
+
+        /// @brief set the placement of the compressed arrays on the NUMA nodes by compress_parallel
+        /// @param placement placement policy (FirstTouch, Interleaved or Partitioned)
+        virtual void set_placement(Placement placement) { this->placement = placement; };
+
+        /// @brief get the placement of the compressed arrays on the NUMA nodes by compress_parallel
+        /// @return placement policy in use
+        virtual Placement get_placement() const { return placement; };
+
+        /// @brief keep the capacity of the compressed arrays across the conversions between formats
+        /// @param recycle true to reuse the arrays at the next compression, false to release them (default)
+        virtual void set_buffer_recycling(bool recycle) { recycle_buffers = recycle; };
+
+        /// @brief check if the capacity of the compressed arrays is kept across the conversions between formats
+        /// @return true if the arrays are reused at the next compression
+        virtual bool get_buffer_recycling() const { return recycle_buffers; };
+
+        /// @brief set the task arena in which the parallel operations of the matrix run
+        /// @param context execution context (nullptr for the global task arena)
+        virtual void set_execution_context(std::shared_ptr<ExecutionContext> context) { this->context = std::move(context); };
+
+        /// @brief get the task arena in which the parallel operations of the matrix run
+        /// @return execution context in use (nullptr for the global task arena)
+        virtual std::shared_ptr<ExecutionContext> get_execution_context() const { return context; };
+
+        /// @brief set what happens when the matrix is written element by element while compressed
+        /// @param policy conversion policy (Allow, WarnOnce, Throw or Buffer)
+        virtual void set_conversion_policy(ConversionPolicy policy) { conversion_policy = policy; };
+
+        /// @brief get what happens when the matrix is written element by element while compressed
+        /// @return conversion policy in use
+        virtual ConversionPolicy get_conversion_policy() const { return conversion_policy; };
+
+        /// @brief get the counters of the implicit conversions and of the writes while compressed
+        /// @return counters of the matrix, since its construction or the last reset
+        const ConversionStatistics &conversion_statistics() const { return conversions; };
+
+        /// @brief reset the counters of the implicit conversions of the matrix
+        void reset_conversion_statistics() { conversions = ConversionStatistics(); };
+
+        /// @brief get the number of buffered writes (ConversionPolicy::Buffer)
+        /// @return number of writes waiting for the next flush or uncompression
+        size_t get_pending_writes() const { return pending_writes.size(); };
+
+        /// @brief merge the buffered writes in the compressed format the matrix is stored in
+        /// @note the products, the norms and the writer throw std::runtime_error while writes are buffered
+        virtual void flush();
+
         /// @brief uncompress the matrix if it is in a compressed format
         virtual void uncompress() override;
 
@@ -145,14 +230,28 @@ namespace algebra
         /// @param row row index
         /// @param col column index
         /// @return element at (row, col)
+        /// @throws std::out_of_range if the indices are outside the matrix (unless ALGEBRA_BOUNDS_CHECK is 0)
         virtual T operator()(size_t row, size_t col) const override;
 
         /// @brief call operator() non-const version
         /// @param row row index
         /// @param col column index
         /// @return reference to the element at (row, col) with proxy (to avoid storing zero values)
+        /// @throws std::out_of_range if the indices are outside the matrix (unless ALGEBRA_BOUNDS_CHECK is 0)
         virtual Proxy<T, S> operator()(size_t row, size_t col) override;
 
+        /// @brief get an element, without checking the indices (for the loops over known valid indices)
+        /// @param row row index, less than the number of rows
+        /// @param col column index, less than the number of columns
+        /// @return element at (row, col)
+        virtual T get_unchecked(size_t row, size_t col) const;
+
+        /// @brief get a proxy to an element, without checking the indices
+        /// @param row row index, less than the number of rows
+        /// @param col column index, less than the number of columns
+        /// @return reference to the element at (row, col) with proxy (to avoid storing zero values)
+        virtual Proxy<T, S> ref_unchecked(size_t row, size_t col);
+
         /// @brief resize the matrix
         /// @param rows number of rows
         /// @param cols number of columns
@@ -168,6 +267,10 @@ namespace algebra
         /// @param filename input file name
         virtual void reader(const std::string &filename) override;
 
+        /// @brief Function to write a matrix in Matrix Market format
+        /// @param filename output file name
+        virtual void writer(const std::string &filename) const;
+
         /// @brief get the number of rows
         /// @return number of rows
         virtual size_t get_rows() const override { return rows; };
@@ -180,6 +283,20 @@ namespace algebra
         /// @return number of non-zero elements
         virtual size_t get_nnz() const override;
 
+        /// @brief get the bytes used by each component of the storage
+        /// @return memory usage of the uncompressed and compressed formats
+        virtual MemoryUsage memory_usage() const override;
+
+        /// @brief get the maximum of the bytes used by the storage, also during the conversions between formats
+        /// @return peak bytes since the construction or the last reset
+        size_t memory_peak() const { return std::max(peak_memory, memory_usage().total()); };
+
+        /// @brief reset the peak of the bytes used by the storage to the current ones
+        void reset_memory_peak() { peak_memory = 0; };
+
+        /// @brief release the memory allocated by the vectors of the compressed formats beyond their size
+        virtual void shrink_to_fit();
+
         /// @brief multiply with a std::vector
         /// @tparam U type of the vector elements
         /// @tparam V type of the storage order
@@ -200,6 +317,45 @@ namespace algebra
         template <AddMulType U, StorageOrder V>
         friend Matrix<U, V> operator*(const Matrix<U, V> &m1, const Matrix<U, V> &m2);
 
+        /// @brief multiply a temporary matrix with another matrix
+        /// @tparam U type of the matrix elements
+        /// @tparam V type of the storage order
+        /// @param m1 first matrix, a temporary
+        /// @param m2 second matrix
+        /// @return the result of the multiplication
+        /// @note for compressed RowMajor matrices the product is written in the compressed arrays of m1
+        template <AddMulType U, StorageOrder V>
+        friend Matrix<U, V> operator*(Matrix<U, V> &&m1, const Matrix<U, V> &m2);
+
+        /// @brief multiply a matrix with a temporary matrix
+        /// @tparam U type of the matrix elements
+        /// @tparam V type of the storage order
+        /// @param m1 first matrix
+        /// @param m2 second matrix, a temporary
+        /// @return the result of the multiplication
+        /// @note for compressed ColumnMajor matrices the product is written in the compressed arrays of m2
+        template <AddMulType U, StorageOrder V>
+        friend Matrix<U, V> operator*(const Matrix<U, V> &m1, Matrix<U, V> &&m2);
+
+        /// @brief multiply two temporary matrices
+        /// @tparam U type of the matrix elements
+        /// @tparam V type of the storage order
+        /// @param m1 first matrix, a temporary
+        /// @param m2 second matrix, a temporary
+        /// @return the result of the multiplication
+        template <AddMulType U, StorageOrder V>
+        friend Matrix<U, V> operator*(Matrix<U, V> &&m1, Matrix<U, V> &&m2);
+
+        /// @brief multiply two matrices, writing the product in a matrix provided by the caller
+        /// @tparam U type of the matrix elements
+        /// @tparam V type of the storage order
+        /// @param m1 first matrix
+        /// @param m2 second matrix
+        /// @param result matrix overwritten with the product (not one of the operands): for compressed operands
+        ///        the product is compressed in its arrays, whose capacity is reused
+        template <AddMulType U, StorageOrder V>
+        friend void multiply_into(const Matrix<U, V> &m1, const Matrix<U, V> &m2, Matrix<U, V> &result);
+
         /// @brief multiply a TransposeView with a std::vector
         /// @tparam U type of the vector elements
         /// @tparam V type of the storage order
@@ -254,16 +410,124 @@ namespace algebra
         template <AddMulType U, StorageOrder V>
         friend Matrix<U, V> operator*(const DiagonalView<U, V> &m1, const Matrix<U, V> &m2);
 
+        /// @brief analyze the sparsity pattern of a compressed matrix
+        /// @tparam U type of the matrix elements
+        /// @tparam V type of the storage order
+        /// @param m matrix in compressed format
+        /// @return the features of the sparsity pattern
+        template <AddMulType U, StorageOrder V>
+        friend SparsityPattern analyze_pattern(const Matrix<U, V> &m);
+
+        /// @brief count the scalar multiplications of the product between two compressed matrices
+        /// @tparam U type of the matrix elements
+        /// @tparam V type of the storage order
+        /// @param m1 first matrix in compressed format
+        /// @param m2 second matrix in compressed format
+        /// @return number of products between non-zero elements
+        template <AddMulType U, StorageOrder V>
+        friend size_t count_multiplications(const Matrix<U, V> &m1, const Matrix<U, V> &m2);
+
     protected:
-        size_t rows;             /// number of rows
-        size_t cols;             /// number of columns
-        bool compressed = false; /// flag to check if the matrix is compressed
+        size_t rows;                                 /// number of rows
+        size_t cols;                                 /// number of columns
+        bool compressed = false;                     /// flag to check if the matrix is compressed
+        Kernel kernel = Kernel::Serial;              /// kernel used by the products in compressed format
+        Placement placement = Placement::FirstTouch; /// placement of the compressed arrays by compress_parallel
+        std::shared_ptr<ExecutionContext> context;   /// task arena of the parallel operations (nullptr for the global one)
+        bool recycle_buffers = false;                /// keep the capacity of the compressed arrays across the conversions
 
         // storage for the matrix
         // uncompressed matrix
         UncompressedStorage<T, S> uncompressed_format; /// COO format
         // compressed matrix
         CompressedStorage<T> compressed_format; /// CSR or CSC format
+
+        // implicit conversions
+        ConversionPolicy conversion_policy = ConversionMonitor::instance().get_default_policy(); /// policy of the writes while compressed
+        ConversionStatistics conversions;                                                        /// counters of the implicit conversions
+        UncompressedStorage<T, S> pending_writes;                                                /// buffered writes, a zero value erases the element
+
+        // memory accounting
+        size_t peak_memory = 0; /// maximum of the bytes used by the storage, sampled during the conversions
+
+        /// @brief check the indices of an element according to the bounds checking policy
+        /// @param row row index
+        /// @param col column index
+        /// @throws std::out_of_range if the indices are outside the matrix
+        void check_bounds(size_t row, size_t col) const
+        {
+            if constexpr (bounds_checking)
+            {
+                if (row >= rows or col >= cols)
+                {
+                    throw std::out_of_range("Index out of range");
+                }
+            }
+        }
+
+        /// @brief update the peak of the bytes used by the storage with the current ones
+        void track_memory() { peak_memory = std::max(peak_memory, memory_usage().total()); };
+
+        /// @brief release the capacity of the compressed arrays after a conversion, unless it is recycled
+        void compact()
+        {
+            if (not recycle_buffers)
+            {
+                shrink_to_fit();
+            }
+        };
+
+        /// @brief multiply two compressed matrices (Gustavson), writing the product in compressed arrays
+        /// @param m1 first matrix, compressed
+        /// @param m2 second matrix, compressed
+        /// @param product arrays of the product, whose capacity is reused: they can be the arrays of m1 (RowMajor) or m2 (ColumnMajor)
+        static void multiply_compressed(const Matrix &m1, const Matrix &m2, CompressedStorage<T> &product);
+
+        /// @brief multiply two compressed matrices, recycling the compressed arrays of one of them for the product
+        /// @param m1 first matrix, compressed
+        /// @param m2 second matrix, compressed
+        /// @param recycled m1 (RowMajor) or m2 (ColumnMajor), moved into the product
+        /// @return the product in compressed format
+        static Matrix multiply_recycled(const Matrix &m1, const Matrix &m2, Matrix &recycled);
+
+        /// @brief check if the matrix is stored in any compressed format
+        /// @return true if the matrix is compressed
+        virtual bool in_compressed_format() const { return compressed; };
+
+        /// @brief get the size of the compressed format the matrix is stored in
+        /// @return bytes of the compressed arrays
+        virtual size_t compressed_bytes() const;
+
+        /// @brief overwrite an existing element of the compressed format
+        /// @param row row index
+        /// @param col column index
+        /// @param value non-zero value to set
+        /// @return true if the element is stored in the compressed format (and has been overwritten)
+        virtual bool write_in_place(size_t row, size_t col, const T &value);
+
+        /// @brief uncompress the matrix before a write, according to the conversion policy
+        void implicit_uncompress();
+
+        /// @brief rebuild the uncompressed format from the entries of a compressed format
+        /// @tparam Vector type of the starting indices
+        /// @tparam Fill callable with the first and the end major index of a part, and the map to fill
+        /// @param starts starting index of the entries of every major index (major size + 1 entries)
+        /// @param fill function appending the entries of the major indices in order, with the end of the map as hint
+        /// @note the parts of the large matrices are filled in parallel, then their nodes are spliced in order
+        template <typename Vector, typename Fill>
+        void build_uncompressed(const Vector &starts, Fill &&fill);
+
+        /// @brief write an element of the compressed matrix in place, or buffer the write
+        /// @param row row index
+        /// @param col column index
+        /// @param value value to set
+        void buffer_write(size_t row, size_t col, const T &value);
+
+        /// @brief merge the buffered writes in the uncompressed format
+        void apply_pending_writes();
+
+        /// @brief check that no write is buffered before reading the compressed format
+        void require_flushed() const;
     };
 
 }
@@ -271,4 +535,8 @@ namespace algebra
 #include "matrix.tpp"
 #include "view_products.tpp"
 
+// explicit instantiations of the prebuilt library (ALGEBRA_PREBUILT)
+#define ALGEBRA_MATRIX_COMPLETE
+#include "extern_templates.hpp"
+
 #endif // MATRIX_HPP
@@ -27,6 +27,7 @@
 #include "abstract_matrix.hpp"
 
 #include <execution>
+#include <utility>
 
 namespace algebra
 {
@@ -146,6 +147,10 @@ namespace algebra
         /// @return number of non-zero elements
         size_t get_nnz() const override { return matrix.get_nnz(); };
 
+        /// @brief get the bytes used by each component of the storage
+        /// @return memory usage of the underlying matrix (the view does not store any element)
+        MemoryUsage memory_usage() const override { return matrix.memory_usage(); };
+
         /// @brief calculate the norm of the matrix
         /// @tparam N type of the norm (One, Infinity, Frobenius)
         /// @return value of the norm
@@ -263,8 +268,8 @@ namespace algebra
         {
             if (row == col)
             {
-                const auto temp = matrix;
-                return temp(row, col);
+                // const access, so that the matrix is not uncompressed
+                return std::as_const(matrix)(row, col);
             }
             else
             {
@@ -305,23 +310,32 @@ namespace algebra
             size_t sum{0};
             for (size_t i = 0; i < matrix.get_rows(); i++)
             {
-                sum += std::abs(static_cast<T>(matrix(i, i))) > std::numeric_limits<AbsReturnType_t<T>>::epsilon();
+                sum += std::abs(std::as_const(matrix)(i, i)) > std::numeric_limits<AbsReturnType_t<T>>::epsilon();
             }
             return sum;
         };
 
+        /// @brief get the bytes used by each component of the storage
+        /// @return memory usage of the underlying matrix (the view does not store any element)
+        MemoryUsage memory_usage() const override { return matrix.memory_usage(); };
+
         /// @brief calculate the norm of the matrix
         /// @tparam N type of the norm (One, Infinity, Frobenius)
         /// @return value of the norm
         template <NormType N>
         double norm() const
         {
+            if (const auto context = matrix.get_execution_context(); outside_context(context))
+            {
+                return context->execute([this]()
+                                        { return norm<N>(); });
+            }
             if constexpr (N == NormType::Frobenius)
             {
                 double sum{0};
                 for (size_t i = 0; i < matrix.get_rows(); i++)
                 {
-                    sum += std::abs(static_cast<T>(matrix(i, i))) * std::abs(static_cast<T>(matrix(i, i)));
+                    sum += std::abs(std::as_const(matrix)(i, i)) * std::abs(std::as_const(matrix)(i, i));
                 }
                 return std::sqrt(sum);
             }
@@ -330,11 +344,16 @@ namespace algebra
                 std::vector<double> diag(matrix.get_rows(), 0);
                 for (size_t i = 0; i < matrix.get_rows(); i++)
                 {
-                    diag[i] = std::abs(static_cast<T>(matrix(i, i)));
+                    diag[i] = std::abs(std::as_const(matrix)(i, i));
                 }
-                return *std::max_element(std::execution::par_unseq, diag.begin(), diag.end());
+                return diag.empty() ? 0 : *std::max_element(std::execution::par_unseq, diag.begin(), diag.end());
             }
         };
     };
 }
-#endif // MATRIX_VIEWS_HPP
\ No newline at end of file
+
+// explicit instantiations of the prebuilt library (ALGEBRA_PREBUILT)
+#define ALGEBRA_MATRIX_VIEWS_COMPLETE
+#include "extern_templates.hpp"
+
+#endif // MATRIX_VIEWS_HPP
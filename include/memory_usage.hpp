@@ -0,0 +1,281 @@
+/**
+ * @file memory_usage.hpp
+ * @brief Defines the accounting of the memory used by the storage formats of the matrices.
+ *
+ * Every matrix reports the bytes used by each component of its storage with memory_usage():
+ * @code{.cpp}
+ * m.reader("data/lnsp_131.mtx");
+ * m.compress();
+ * MemoryUsage usage = m.memory_usage();
+ * std::cout << usage.values << " bytes of values, " << usage.slack << " bytes of slack" << std::endl;
+ * std::cout << m.memory_peak() << " bytes at most, since the construction" << std::endl;
+ * @endcode
+ * The bytes of the map of the uncompressed format are estimated from the size of its nodes (the
+ * overhead of the memory allocator is not counted), while the ones of the compressed arrays are exact.
+ *
+ * When the library is compiled with `-DALGEBRA_TRACK_ALLOCATIONS`, all the containers of the storage
+ * formats (see storage.hpp) allocate their memory through algebra::TrackingAllocator, which counts the
+ * current and the peak bytes allocated by the storage of all the matrices in algebra::AllocationCounter.
+ * Otherwise they use std::allocator, and the tracking has no overhead at all. The vectors of the compressed
+ * formats always allocate through algebra::AlignedAllocator (cache-line aligned, on huge pages if large,
+ * see huge_pages.hpp), wrapped in algebra::DefaultInitAllocator, that does not zero the elements added by `resize`.
+ *
+ * @see storage.hpp
+ */
+#ifndef MEMORY_USAGE_HPP
+#define MEMORY_USAGE_HPP
+
+#include "huge_pages.hpp"
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace algebra
+{
+    /**
+     * @brief Bytes used by each component of the storage of a matrix.
+     */
+    struct MemoryUsage
+    {
+        size_t map_nodes = 0; /// number of nodes of the maps (uncompressed format and buffered writes)
+        size_t map = 0;       /// bytes of the nodes of the maps (estimated)
+        size_t inner = 0;     /// bytes of the row (column) pointers of the compressed format
+        size_t outer = 0;     /// bytes of the column (row) indices of the compressed format
+        size_t values = 0;    /// bytes of the values of the compressed and modified compressed formats
+        size_t bind = 0;      /// bytes of the pointers and indices of the modified compressed format
+        size_t slack = 0;     /// bytes allocated by the vectors beyond their size
+
+        /// @brief total bytes used by the storage
+        /// @return sum of all the components
+        size_t total() const { return map + inner + outer + values + bind + slack; };
+
+        /// @brief accumulate the usage of other storage
+        /// @param other usage to add
+        /// @return reference to the accumulated usage
+        MemoryUsage &operator+=(const MemoryUsage &other)
+        {
+            map_nodes += other.map_nodes;
+            map += other.map;
+            inner += other.inner;
+            outer += other.outer;
+            values += other.values;
+            bind += other.bind;
+            slack += other.slack;
+            return *this;
+        }
+    };
+
+    /// @brief estimated size of a node of a std::map (red-black tree)
+    /// @tparam Value type of the elements of the map (key-value pairs)
+    /// @return bytes of the node: color, parent, left and right pointers, and the element
+    template <typename Value>
+    constexpr size_t map_node_bytes()
+    {
+        constexpr size_t header = 4 * sizeof(void *);
+        constexpr size_t alignment = alignof(Value) > alignof(void *) ? alignof(Value) : alignof(void *);
+        return (header + sizeof(Value) + alignment - 1) / alignment * alignment;
+    }
+
+    /// @brief bytes used and allocated by a vector
+    /// @tparam Vector type of the vector
+    /// @param vector vector to measure
+    /// @param usage bytes used by the elements of the vector
+    /// @param slack bytes allocated beyond the size of the vector, accumulated
+    template <typename Vector>
+    void vector_usage(const Vector &vector, size_t &usage, size_t &slack)
+    {
+        usage += vector.size() * sizeof(typename Vector::value_type);
+        slack += (vector.capacity() - vector.size()) * sizeof(typename Vector::value_type);
+    }
+
+    /**
+     * @brief Process-wide counters of the memory allocated through algebra::TrackingAllocator.
+     */
+    class AllocationCounter
+    {
+    public:
+        /// @brief get the counter
+        /// @return reference to the counter of the process
+        static AllocationCounter &instance()
+        {
+            static AllocationCounter counter;
+            return counter;
+        }
+
+        /// @brief count an allocation
+        /// @param bytes allocated bytes
+        void allocate(size_t bytes)
+        {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+            const size_t now = current_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            size_t peak = peak_bytes.load(std::memory_order_relaxed);
+            while (now > peak and not peak_bytes.compare_exchange_weak(peak, now, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        /// @brief count a deallocation
+        /// @param bytes deallocated bytes
+        void deallocate(size_t bytes)
+        {
+            deallocations.fetch_add(1, std::memory_order_relaxed);
+            current_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        }
+
+        /// @brief get the bytes currently allocated
+        /// @return allocated bytes not yet deallocated
+        size_t current() const { return current_bytes.load(std::memory_order_relaxed); };
+
+        /// @brief get the maximum of the bytes allocated at the same time
+        /// @return peak bytes since the start of the process or the last reset
+        size_t peak() const { return peak_bytes.load(std::memory_order_relaxed); };
+
+        /// @brief get the number of allocations
+        /// @return number of calls to allocate
+        size_t allocation_count() const { return allocations.load(std::memory_order_relaxed); };
+
+        /// @brief get the number of deallocations
+        /// @return number of calls to deallocate
+        size_t deallocation_count() const { return deallocations.load(std::memory_order_relaxed); };
+
+        /// @brief reset the peak to the bytes currently allocated, and the numbers of calls to zero
+        void reset()
+        {
+            peak_bytes.store(current_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            allocations.store(0, std::memory_order_relaxed);
+            deallocations.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<size_t> current_bytes = 0; /// bytes currently allocated
+        std::atomic<size_t> peak_bytes = 0;    /// maximum of the bytes allocated at the same time
+        std::atomic<size_t> allocations = 0;   /// number of allocations
+        std::atomic<size_t> deallocations = 0; /// number of deallocations
+
+        /// @brief default constructor
+        AllocationCounter() = default;
+    };
+
+    /**
+     * @brief Allocator counting the memory of the storage formats in algebra::AllocationCounter.
+     *
+     * The allocator is stateless, so that all its instances are interchangeable and the containers
+     * can be moved and swapped as with std::allocator.
+     *
+     * @tparam T type of the allocated elements
+     * @tparam Base stateless allocator of the memory
+     */
+    template <typename T, typename Base = std::allocator<T>>
+    struct TrackingAllocator
+    {
+        using value_type = T;
+
+        /// @brief the same allocator for the elements of type U (used by the containers to allocate their nodes)
+        template <typename U>
+        struct rebind
+        {
+            using other = TrackingAllocator<U, typename std::allocator_traits<Base>::template rebind_alloc<U>>;
+        };
+
+        /// @brief default constructor
+        TrackingAllocator() = default;
+
+        /// @brief converting constructor (used by the containers to allocate their nodes)
+        template <typename U, typename B>
+        TrackingAllocator(const TrackingAllocator<U, B> &) noexcept {};
+
+        /// @brief allocate memory for n elements
+        /// @param n number of elements
+        /// @return pointer to the allocated memory
+        T *allocate(size_t n)
+        {
+            T *pointer = Base().allocate(n);
+            AllocationCounter::instance().allocate(n * sizeof(T));
+            return pointer;
+        }
+
+        /// @brief deallocate the memory of n elements
+        /// @param pointer pointer to the memory
+        /// @param n number of elements
+        void deallocate(T *pointer, size_t n) noexcept
+        {
+            AllocationCounter::instance().deallocate(n * sizeof(T));
+            Base().deallocate(pointer, n);
+        }
+
+        /// @brief all the instances are equal
+        template <typename U, typename B>
+        bool operator==(const TrackingAllocator<U, B> &) const noexcept { return true; };
+    };
+
+    /**
+     * @brief Allocator adaptor that default-initializes the elements constructed without arguments.
+     *
+     * With this allocator `resize(n)` leaves the new elements of arithmetic type uninitialized, so that
+     * their pages are not touched until they are written: Matrix::compress_parallel writes every range of
+     * the compressed arrays from the thread that processes it in the parallel products (see numa.hpp).
+     * The callers of `resize(n)` must write all the new elements; `resize(n, value)` and `assign` are unaffected.
+     *
+     * @tparam T type of the allocated elements
+     * @tparam Base allocator of the memory
+     */
+    template <typename T, typename Base = std::allocator<T>>
+    struct DefaultInitAllocator : Base
+    {
+        /// @brief the same adaptor for the elements of type U (used by the containers to allocate their nodes)
+        template <typename U>
+        struct rebind
+        {
+            using other = DefaultInitAllocator<U, typename std::allocator_traits<Base>::template rebind_alloc<U>>;
+        };
+
+        /// @brief default constructor
+        DefaultInitAllocator() = default;
+
+        /// @brief converting constructor
+        template <typename U, typename B>
+        DefaultInitAllocator(const DefaultInitAllocator<U, B> &other) noexcept : Base(static_cast<const B &>(other)){};
+
+        /// @brief default-initialize an element
+        /// @param pointer memory of the element
+        template <typename U>
+        void construct(U *pointer) noexcept(std::is_nothrow_default_constructible_v<U>)
+        {
+            ::new (static_cast<void *>(pointer)) U;
+        }
+
+        /// @brief construct an element from arguments
+        /// @param pointer memory of the element
+        /// @param args arguments of the constructor
+        template <typename U, typename... Args>
+        void construct(U *pointer, Args &&...args)
+        {
+            std::allocator_traits<Base>::construct(static_cast<Base &>(*this), pointer, std::forward<Args>(args)...);
+        }
+    };
+
+#ifdef ALGEBRA_TRACK_ALLOCATIONS
+    /// @brief allocator of the map of the uncompressed format (tracking)
+    template <typename T>
+    using StorageAllocator = TrackingAllocator<T>;
+
+    /// @brief allocator of the vectors of the compressed formats (tracking)
+    template <typename T>
+    using ArrayAllocator = DefaultInitAllocator<T, TrackingAllocator<T, AlignedAllocator<T>>>;
+#else
+    /// @brief allocator of the map of the uncompressed format
+    template <typename T>
+    using StorageAllocator = std::allocator<T>;
+
+    /// @brief allocator of the vectors of the compressed formats
+    template <typename T>
+    using ArrayAllocator = DefaultInitAllocator<T, AlignedAllocator<T>>;
+#endif
+
+}
+
+#endif // MEMORY_USAGE_HPP
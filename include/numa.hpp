@@ -0,0 +1,273 @@
+/**
+ * @file numa.hpp
+ * @brief Defines the partition of the compressed arrays among the threads and their placement on the NUMA nodes.
+ *
+ * Linux places every page of memory on the NUMA node of the thread that writes it first. The compressed
+ * arrays of a matrix are allocated without being zeroed (see algebra::DefaultInitAllocator), and
+ * Matrix::compress_parallel writes the `inner`, `outer` and `values` entries of every range of rows
+ * (columns) from the thread that processes the same range in the parallel products. Both split the
+ * major indices with algebra::RowPartition, balanced on the number of non-zero elements, and run one part
+ * per thread with `tbb::static_partitioner`, that assigns the parts to the threads of the arena in the
+ * same order at every call:
+ * @code{.cpp}
+ * Matrix<double, StorageOrder::RowMajor> m(0, 0);
+ * m.reader("data/lnsp_131.mtx");
+ * m.set_kernel(Kernel::Parallel);
+ * m.set_placement(Placement::Partitioned);
+ * m.compress_parallel(); // the pages of every part are placed on the node of the thread that multiplies it
+ * std::vector<double> y = m * x;
+ * @endcode
+ *
+ * The placement of the pages can be requested explicitly with algebra::Placement:
+ * - FirstTouch: the pages are placed by the first write only;
+ * - Interleaved: the pages are spread round robin over all the nodes with memory, for the matrices that
+ *   are read by all the threads (e.g. the ones multiplied with the serial kernel by different threads);
+ * - Partitioned: the pages of every part are bound to the node of the thread that wrote them, so that they
+ *   are not moved by the automatic NUMA balancing of the kernel when the threads migrate.
+ *
+ * @note The threads keep their parts between the compression and the products only if they do not migrate
+ *       to the other node: pin them with algebra::PinningObserver (topology.hpp).
+ * @note The explicit placement uses the `mbind` system call, available only on Linux; on the other systems,
+ *       and on the machines with a single NUMA node, every placement behaves as Placement::FirstTouch.
+ *
+ * @see topology.hpp
+ * @see memory_usage.hpp
+ */
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include "topology.hpp"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <algorithm>
+
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <tbb/partitioner.h>
+#include <tbb/task_arena.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace algebra
+{
+    /**
+     * @brief Enum class to specify the placement of the pages of the compressed arrays on the NUMA nodes.
+     */
+    enum class Placement
+    {
+        FirstTouch,  /// on the node of the thread that writes them first
+        Interleaved, /// round robin over all the nodes with memory
+        Partitioned  /// bound to the node of the thread that processes them
+    };
+
+    /// @brief name of a placement policy
+    /// @param placement placement policy
+    /// @return name of the policy
+    inline std::string placement_name(Placement placement)
+    {
+        switch (placement)
+        {
+        case Placement::Interleaved:
+            return "interleaved";
+        case Placement::Partitioned:
+            return "partitioned";
+        default:
+            return "first-touch";
+        }
+    }
+
+    /**
+     * @brief Partition of the major indices of compressed arrays into contiguous parts of balanced work.
+     *
+     * The work of a major index is its number of non-zero elements plus one (for the pointer and the
+     * entry of the result), so that the empty rows and the dense rows are both accounted for.
+     */
+    class RowPartition
+    {
+    public:
+        /// @brief split the major indices
+        /// @tparam Vector type of the starting indices
+        /// @param inner starting index of every major index (major size + 1 entries, non-decreasing)
+        /// @param parts number of parts (one per thread of the current task arena by default)
+        template <typename Vector>
+        explicit RowPartition(const Vector &inner, size_t parts = default_parts())
+            : RowPartition(inner.empty() ? 0 : inner.size() - 1, [&inner](size_t major)
+                           { return inner.empty() ? size_t(0) : static_cast<size_t>(inner[major]); }, parts){};
+
+        /// @brief split the major indices, whose starting indices are not stored in a single vector
+        /// @tparam Start callable with signature size_t(size_t major)
+        /// @param major_size number of major indices
+        /// @param start starting index of every major index (defined up to major_size included, non-decreasing)
+        /// @param parts number of parts (one per thread of the current task arena by default)
+        template <typename Start>
+        RowPartition(size_t major_size, Start &&start, size_t parts = default_parts())
+        {
+            parts = std::max<size_t>(1, std::min(parts, major_size));
+            const size_t first = start(0);
+            const auto work = [&](size_t major)
+            { return start(major) - first + major; };
+            const size_t total = work(major_size);
+
+            bounds.assign(parts + 1, major_size);
+            bounds[0] = 0;
+            for (size_t part = 1; part < parts; part++)
+            {
+                // first major index whose preceding work reaches the share of the previous parts
+                const size_t target = total * part / parts;
+                size_t low = bounds[part - 1], high = major_size;
+                while (low < high)
+                {
+                    const size_t middle = low + (high - low) / 2;
+                    if (work(middle) < target)
+                    {
+                        low = middle + 1;
+                    }
+                    else
+                    {
+                        high = middle;
+                    }
+                }
+                bounds[part] = low;
+            }
+        }
+
+        /// @brief get the default number of parts
+        /// @return number of threads of the current task arena
+        static size_t default_parts() { return static_cast<size_t>(tbb::this_task_arena::max_concurrency()); };
+
+        /// @brief get the number of parts
+        /// @return number of parts
+        size_t size() const { return bounds.size() - 1; };
+
+        /// @brief get the first major index of a part
+        /// @param part index of the part
+        /// @return first major index of the part
+        size_t begin(size_t part) const { return bounds[part]; };
+
+        /// @brief get the end of a part
+        /// @param part index of the part
+        /// @return major index after the last one of the part
+        size_t end(size_t part) const { return bounds[part + 1]; };
+
+        /// @brief process the parts in parallel, one per thread, with the same assignment at every call
+        /// @tparam Body callable with the first and the end major index of a part
+        /// @param body function to apply to every part
+        template <typename Body>
+        void for_each(Body &&body) const
+        {
+            tbb::parallel_for(
+                tbb::blocked_range<size_t>(0, size(), 1),
+                [&](const tbb::blocked_range<size_t> &range)
+                {
+                    for (size_t part = range.begin(); part < range.end(); part++)
+                    {
+                        body(bounds[part], bounds[part + 1]);
+                    }
+                },
+                tbb::static_partitioner());
+        }
+
+    private:
+        std::vector<size_t> bounds; /// first major index of every part, followed by the major size
+    };
+
+    /// @brief get the NUMA nodes with memory
+    /// @return node numbers in ascending order (empty if the NUMA topology is unknown)
+    inline const std::vector<int> &memory_nodes()
+    {
+        static const std::vector<int> nodes = []()
+        {
+            std::ifstream file("/sys/devices/system/node/has_memory");
+            std::string list;
+            std::getline(file, list);
+            return CpuTopology::parse_cpulist(list);
+        }();
+        return nodes;
+    }
+
+    /// @brief set the memory policy of the pages completely contained in a range of memory
+    /// @param data start of the range
+    /// @param bytes length of the range
+    /// @param interleave true to interleave the pages over the nodes, false to prefer the first node
+    /// @param nodes NUMA nodes of the policy
+    /// @return true if the policy is set, false if it is not available
+    inline bool set_memory_policy(const void *data, size_t bytes, bool interleave, const std::vector<int> &nodes)
+    {
+#if defined(__linux__) && defined(SYS_mbind)
+        constexpr int preferred = 1;  // MPOL_PREFERRED
+        constexpr int interleaved = 3; // MPOL_INTERLEAVE
+        constexpr unsigned move = 2;  // MPOL_MF_MOVE: move the pages already touched
+        if (nodes.empty())
+        {
+            return false;
+        }
+        // the pages shared with the neighbouring ranges keep their placement
+        const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        const uintptr_t first = (reinterpret_cast<uintptr_t>(data) + page - 1) / page * page;
+        const uintptr_t last = (reinterpret_cast<uintptr_t>(data) + bytes) / page * page;
+        if (last <= first)
+        {
+            return false;
+        }
+        constexpr size_t bits = 8 * sizeof(unsigned long);
+        std::vector<unsigned long> mask(static_cast<size_t>(*std::max_element(nodes.begin(), nodes.end())) / bits + 1, 0);
+        for (const auto &node : nodes)
+        {
+            mask[static_cast<size_t>(node) / bits] |= 1UL << (static_cast<size_t>(node) % bits);
+        }
+        return syscall(SYS_mbind, first, last - first, interleave ? interleaved : preferred, mask.data(),
+                       mask.size() * bits + 1, move) == 0;
+#else
+        (void)data;
+        (void)bytes;
+        (void)interleave;
+        (void)nodes;
+        return false;
+#endif
+    }
+
+    /// @brief get the NUMA node of the calling thread
+    /// @return node of the CPU running the thread (-1 if unknown)
+    inline int current_node()
+    {
+#if defined(__linux__) && defined(SYS_getcpu)
+        unsigned cpu = 0, node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        {
+            return static_cast<int>(node);
+        }
+#endif
+        return -1;
+    }
+
+    /// @brief interleave the pages of an array over all the nodes with memory
+    /// @tparam T type of the elements
+    /// @param data first element
+    /// @param count number of elements
+    /// @return true if the pages are interleaved
+    template <typename T>
+    bool interleave_pages(const T *data, size_t count)
+    {
+        return memory_nodes().size() > 1 and set_memory_policy(data, count * sizeof(T), true, memory_nodes());
+    }
+
+    /// @brief bind the pages of an array to the node of the calling thread
+    /// @tparam T type of the elements
+    /// @param data first element
+    /// @param count number of elements
+    /// @return true if the pages are bound
+    template <typename T>
+    bool bind_pages_here(const T *data, size_t count)
+    {
+        const int node = current_node();
+        return memory_nodes().size() > 1 and node >= 0 and set_memory_policy(data, count * sizeof(T), false, {node});
+    }
+}
+
+#endif // NUMA_HPP
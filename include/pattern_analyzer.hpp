@@ -0,0 +1,245 @@
+/**
+ * @file pattern_analyzer.hpp
+ * @brief Defines the analysis of the sparsity pattern of a compressed matrix.
+ *
+ * This header provides the algebra::SparsityPattern structure, which collects the features of the
+ * sparsity pattern of a matrix that drive the choice of storage format and product kernel, and the
+ * algebra::analyze_pattern function, which computes them from a matrix in compressed (CSR/CSC) format.
+ *
+ * The computed features are:
+ * - the row-length histogram (with power-of-two buckets) and the minimum, maximum and mean row length;
+ * - the lower, upper and total bandwidth;
+ * - the diagonal dominance (fraction of rows whose diagonal entry dominates the off-diagonal ones);
+ * - the block structure (fill ratio of the dense blocks of size 2, 3, 4 and 8 covering the nonzeros);
+ * - the structural and numerical symmetry;
+ * - the number and fraction of occupied diagonals;
+ * - a fingerprint (64-bit FNV-1a hash) of the dimensions and of the compressed index arrays.
+ *
+ * @see Matrix
+ * @see auto_tuner.hpp
+ */
+#ifndef PATTERN_ANALYZER_HPP
+#define PATTERN_ANALYZER_HPP
+
+#include "storage.hpp"
+#include "matrix.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <cstdint>
+
+namespace algebra
+{
+    /**
+     * @brief Features of the sparsity pattern of a matrix.
+     *
+     * All the features are computed by algebra::analyze_pattern with a few linear passes over the
+     * compressed arrays, so that they can be used to select a storage format or a kernel at run time.
+     *
+     * @note The "rows" are always the rows of the matrix, independently of its storage order.
+     */
+    struct SparsityPattern
+    {
+        size_t rows = 0; /// number of rows
+        size_t cols = 0; /// number of columns
+        size_t nnz = 0;  /// number of non-zero elements
+
+        std::vector<size_t> row_length_histogram; /// bucket 0 counts empty rows, bucket k counts rows with length in [2^(k-1), 2^k)
+        size_t min_row_length = 0;                /// minimum number of non-zero elements in a row
+        size_t max_row_length = 0;                /// maximum number of non-zero elements in a row
+        double mean_row_length = 0;               /// mean number of non-zero elements in a row
+
+        size_t lower_bandwidth = 0; /// maximum distance below the diagonal of a non-zero element
+        size_t upper_bandwidth = 0; /// maximum distance above the diagonal of a non-zero element
+        size_t bandwidth = 0;       /// maximum distance from the diagonal of a non-zero element
+
+        double diagonal_dominance = 0; /// fraction of rows with |a_ii| >= sum_{j != i} |a_ij|
+
+        size_t block_size = 1;                             /// largest block size whose blocks are at least half full (1 if none)
+        std::vector<std::pair<size_t, double>> block_fill; /// fill ratio of the dense blocks covering the non-zero elements, per block size
+
+        bool structurally_symmetric = false; /// true if a_ij != 0 iff a_ji != 0
+        bool numerically_symmetric = false;  /// true if a_ij == a_ji for every i, j
+
+        size_t occupied_diagonals = 0;          /// number of diagonals with at least one non-zero element
+        double occupied_diagonals_fraction = 0; /// occupied diagonals over the rows + cols - 1 diagonals of the matrix
+
+        uint64_t fingerprint = 0; /// hash of the dimensions and of the positions of the non-zero elements
+    };
+
+    /// @brief update a 64-bit FNV-1a hash with the bytes of a value
+    /// @param hash current hash
+    /// @param value value to hash
+    /// @return the updated hash
+    inline uint64_t fnv1a(uint64_t hash, size_t value)
+    {
+        for (size_t byte = 0; byte < sizeof(value); byte++)
+        {
+            hash ^= (value >> (8 * byte)) & 0xff;
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    /// @brief analyze the sparsity pattern of a compressed matrix
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order of the matrix
+    /// @param m matrix in compressed (CSR/CSC) format
+    /// @return the features of the sparsity pattern
+    /// @note this function is a friend of the Matrix class, so it can access the private members
+    template <AddMulType T, StorageOrder S>
+    SparsityPattern analyze_pattern(const Matrix<T, S> &m)
+    {
+        if (not m.is_compressed())
+        {
+            throw std::invalid_argument("Pattern analysis requires a matrix in compressed format");
+        }
+
+        const auto &storage = m.compressed_format;
+        const size_t major_size = (S == StorageOrder::ColumnMajor) ? m.cols : m.rows;
+        const size_t minor_size = (S == StorageOrder::ColumnMajor) ? m.rows : m.cols;
+
+        SparsityPattern pattern;
+        pattern.rows = m.rows;
+        pattern.cols = m.cols;
+        pattern.nnz = storage.values.size();
+
+        // single pass over the non-zero elements: row lengths, bandwidth, diagonals and dominance
+        std::vector<size_t> row_lengths(m.rows, 0);
+        std::vector<double> diagonal(m.rows, 0);
+        std::vector<double> off_diagonal(m.rows, 0);
+        std::vector<bool> diagonals(m.rows + m.cols > 0 ? m.rows + m.cols - 1 : 0, false);
+        for (size_t major = 0; major < major_size; major++)
+        {
+            for (size_t j = storage.inner[major]; j < storage.inner[major + 1]; j++)
+            {
+                const size_t row = (S == StorageOrder::ColumnMajor) ? storage.outer[j] : major;
+                const size_t col = (S == StorageOrder::ColumnMajor) ? major : storage.outer[j];
+
+                row_lengths[row]++;
+                if (row > col)
+                {
+                    pattern.lower_bandwidth = std::max(pattern.lower_bandwidth, row - col);
+                    off_diagonal[row] += std::abs(storage.values[j]);
+                }
+                else if (col > row)
+                {
+                    pattern.upper_bandwidth = std::max(pattern.upper_bandwidth, col - row);
+                    off_diagonal[row] += std::abs(storage.values[j]);
+                }
+                else
+                {
+                    diagonal[row] += std::abs(storage.values[j]);
+                }
+                // diagonal offset shifted to be non-negative
+                diagonals[col + m.rows - 1 - row] = true;
+            }
+        }
+        pattern.bandwidth = std::max(pattern.lower_bandwidth, pattern.upper_bandwidth);
+        pattern.occupied_diagonals = std::count(diagonals.begin(), diagonals.end(), true);
+        if (not diagonals.empty())
+        {
+            pattern.occupied_diagonals_fraction = static_cast<double>(pattern.occupied_diagonals) / diagonals.size();
+        }
+
+        // row-length statistics
+        if (m.rows > 0)
+        {
+            pattern.min_row_length = *std::min_element(row_lengths.begin(), row_lengths.end());
+            pattern.max_row_length = *std::max_element(row_lengths.begin(), row_lengths.end());
+            pattern.mean_row_length = static_cast<double>(pattern.nnz) / m.rows;
+
+            size_t dominant_rows = 0;
+            for (size_t row = 0; row < m.rows; row++)
+            {
+                size_t bucket = 0;
+                while ((size_t(1) << bucket) <= row_lengths[row])
+                {
+                    bucket++;
+                }
+                if (bucket >= pattern.row_length_histogram.size())
+                {
+                    pattern.row_length_histogram.resize(bucket + 1, 0);
+                }
+                pattern.row_length_histogram[bucket]++;
+
+                if (diagonal[row] > 0 and diagonal[row] >= off_diagonal[row])
+                {
+                    dominant_rows++;
+                }
+            }
+            pattern.diagonal_dominance = static_cast<double>(dominant_rows) / m.rows;
+        }
+
+        // block structure: count the distinct dense blocks touched by the non-zero elements
+        for (size_t b : {2, 3, 4, 8})
+        {
+            size_t blocks = 0;
+            std::vector<size_t> block_ids;
+            for (size_t block_major = 0; block_major * b < major_size; block_major++)
+            {
+                block_ids.clear();
+                const size_t last = std::min(major_size, (block_major + 1) * b);
+                for (size_t j = storage.inner[block_major * b]; j < storage.inner[last]; j++)
+                {
+                    block_ids.push_back(storage.outer[j] / b);
+                }
+                std::sort(block_ids.begin(), block_ids.end());
+                blocks += std::unique(block_ids.begin(), block_ids.end()) - block_ids.begin();
+            }
+            const double fill = blocks > 0 ? static_cast<double>(pattern.nnz) / (blocks * b * b) : 0;
+            pattern.block_fill.emplace_back(b, fill);
+            if (fill >= 0.5)
+            {
+                pattern.block_size = b;
+            }
+        }
+
+        // fingerprint of the pattern
+        pattern.fingerprint = 0xcbf29ce484222325ULL;
+        pattern.fingerprint = fnv1a(pattern.fingerprint, m.rows);
+        pattern.fingerprint = fnv1a(pattern.fingerprint, m.cols);
+        for (const auto &idx : storage.inner)
+        {
+            pattern.fingerprint = fnv1a(pattern.fingerprint, idx);
+        }
+        for (const auto &idx : storage.outer)
+        {
+            pattern.fingerprint = fnv1a(pattern.fingerprint, idx);
+        }
+
+        // symmetry: compare the compressed arrays with the ones of the transpose (counting sort)
+        if (m.rows == m.cols)
+        {
+            std::vector<size_t> transposed_inner(minor_size + 1, 0);
+            for (const auto &idx : storage.outer)
+            {
+                transposed_inner[idx + 1]++;
+            }
+            for (size_t i = 0; i < minor_size; i++)
+            {
+                transposed_inner[i + 1] += transposed_inner[i];
+            }
+            std::vector<size_t> transposed_outer(pattern.nnz);
+            std::vector<T> transposed_values(pattern.nnz);
+            std::vector<size_t> position(transposed_inner.begin(), transposed_inner.end() - 1);
+            for (size_t major = 0; major < major_size; major++)
+            {
+                for (size_t j = storage.inner[major]; j < storage.inner[major + 1]; j++)
+                {
+                    const size_t p = position[storage.outer[j]]++;
+                    transposed_outer[p] = major;
+                    transposed_values[p] = storage.values[j];
+                }
+            }
+            pattern.structurally_symmetric = (transposed_inner == storage.inner and transposed_outer == storage.outer);
+            pattern.numerically_symmetric = pattern.structurally_symmetric and (transposed_values == storage.values);
+        }
+
+        return pattern;
+    }
+}
+
+#endif // PATTERN_ANALYZER_HPP
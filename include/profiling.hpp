@@ -0,0 +1,397 @@
+/**
+ * @file profiling.hpp
+ * @brief Defines the opt-in instrumentation of the library with hardware performance counters.
+ *
+ * The products, the conversions between formats and the readers are instrumented with the
+ * ALGEBRA_PROFILE macro. When the library is compiled with `-DALGEBRA_ENABLE_PROFILING`, every
+ * instrumented call reads the Linux `perf_event_open` counters of the process before and after its
+ * execution and accumulates, per kernel (e.g. "spmv CSR Parallel"), the number of calls, the wall-clock
+ * time, the cycles, the instructions, the last level cache misses and the branch misses. Otherwise the
+ * macro expands to nothing, and the instrumentation has no overhead at all.
+ *
+ * The counters are opened once per thread (for the TBB workers, the first time they join the task
+ * arena) and the ones of all the threads are summed, so that the parallel kernels are measured as
+ * a whole. The accumulated values are available through algebra::Profiler::instance():
+ * @code{.cpp}
+ * for (const auto &[kernel, profile] : Profiler::instance().report())
+ * {
+ *     std::cout << kernel << ": " << profile.instructions_per_cycle() << " IPC" << std::endl;
+ * }
+ * Profiler::instance().print(std::cout);
+ * @endcode
+ *
+ * @note If the counters cannot be opened (e.g. on systems other than Linux, in virtual machines without
+ *       a virtual PMU or with a restrictive `/proc/sys/kernel/perf_event_paranoid`), only the calls and
+ *       the wall-clock times are accumulated and algebra::Profiler::counters_available returns false.
+ * @note The counters of all the threads are summed, so that the time spent by the TBB workers spinning
+ *       while waiting for work is counted in the kernel running at the same time.
+ *
+ * @see bench/bench.cpp
+ */
+#ifndef PROFILING_HPP
+#define PROFILING_HPP
+
+#include "storage.hpp"
+
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+
+#include <tbb/task_scheduler_observer.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef ALGEBRA_ENABLE_PROFILING
+#define ALGEBRA_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ALGEBRA_PROFILE_CONCAT(a, b) ALGEBRA_PROFILE_CONCAT_IMPL(a, b)
+/// @brief accumulate the counters of the enclosing scope under the given kernel name
+#define ALGEBRA_PROFILE(name) const ::algebra::ProfileScope ALGEBRA_PROFILE_CONCAT(algebra_profile_scope_, __LINE__)(name)
+#else
+/// @brief accumulate the counters of the enclosing scope under the given kernel name (disabled)
+#define ALGEBRA_PROFILE(name)
+#endif
+
+namespace algebra
+{
+    /**
+     * @brief Values of the hardware performance counters.
+     */
+    struct PerfCounterValues
+    {
+        uint64_t cycles = 0;        /// CPU cycles
+        uint64_t instructions = 0;  /// retired instructions
+        uint64_t llc_misses = 0;    /// last level cache misses
+        uint64_t branch_misses = 0; /// mispredicted branches
+
+        /// @brief accumulate other values
+        /// @param other values to add
+        /// @return reference to the updated values
+        PerfCounterValues &operator+=(const PerfCounterValues &other)
+        {
+            cycles += other.cycles;
+            instructions += other.instructions;
+            llc_misses += other.llc_misses;
+            branch_misses += other.branch_misses;
+            return *this;
+        }
+
+        /// @brief difference between two readings of the counters
+        /// @param end later reading
+        /// @param start earlier reading
+        /// @return the counts between the two readings
+        friend PerfCounterValues operator-(const PerfCounterValues &end, const PerfCounterValues &start)
+        {
+            return {end.cycles - start.cycles, end.instructions - start.instructions,
+                    end.llc_misses - start.llc_misses, end.branch_misses - start.branch_misses};
+        }
+    };
+
+    /**
+     * @brief Counters accumulated over all the calls of a kernel.
+     */
+    struct KernelProfile
+    {
+        size_t calls = 0;           /// number of calls
+        double time_ns = 0;         /// total wall-clock time
+        PerfCounterValues counters; /// total counts
+
+        /// @brief get the instructions per cycle
+        /// @return the instructions per cycle (0 if no cycle was counted)
+        double instructions_per_cycle() const
+        {
+            return counters.cycles > 0 ? static_cast<double>(counters.instructions) / counters.cycles : 0;
+        }
+    };
+
+    /**
+     * @brief Group of hardware performance counters of the calling thread.
+     *
+     * The cycles, instructions, cache misses and branch misses of the thread that constructs the object
+     * (in user space only) are counted from its construction, and can be read from any thread.
+     */
+    class PerfCounterGroup
+    {
+    public:
+        /// @brief constructor, opens and starts the counters of the calling thread
+        PerfCounterGroup()
+        {
+#ifdef __linux__
+            const uint64_t events[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                       PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+            for (const auto &event : events)
+            {
+                perf_event_attr attr{};
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = event;
+                attr.disabled = fds.empty(); // the group is started through its leader
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP;
+                const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, fds.empty() ? -1 : fds.front(), 0));
+                if (fd < 0)
+                {
+                    close_all();
+                    return;
+                }
+                fds.push_back(fd);
+            }
+            ioctl(fds.front(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(fds.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+        };
+
+        /// @brief destructor, closes the counters
+        ~PerfCounterGroup() { close_all(); };
+
+        PerfCounterGroup(const PerfCounterGroup &) = delete;
+        PerfCounterGroup &operator=(const PerfCounterGroup &) = delete;
+
+        /// @brief check if the counters are open
+        /// @return true if the counters have been opened successfully
+        bool available() const { return not fds.empty(); };
+
+        /// @brief read the counters
+        /// @return the counts since the construction (zero if the counters are not available)
+        PerfCounterValues read() const
+        {
+            PerfCounterValues values;
+#ifdef __linux__
+            if (available())
+            {
+                uint64_t buffer[1 + 4] = {};
+                if (::read(fds.front(), buffer, sizeof(buffer)) == static_cast<ssize_t>(sizeof(buffer)) and buffer[0] == 4)
+                {
+                    values = {buffer[1], buffer[2], buffer[3], buffer[4]};
+                }
+            }
+#endif
+            return values;
+        };
+
+    private:
+        std::vector<int> fds; /// file descriptors of the counters (the first one is the leader of the group)
+
+        /// @brief close all the open counters
+        void close_all()
+        {
+#ifdef __linux__
+            for (const auto &fd : fds)
+            {
+                close(fd);
+            }
+#endif
+            fds.clear();
+        }
+    };
+
+    /**
+     * @brief Registry of the counters of all the threads and of the profiles of the kernels.
+     *
+     * The profiler is a process-wide singleton, created the first time it is used.
+     */
+    class Profiler
+    {
+    public:
+        /// @brief get the profiler
+        /// @return reference to the profiler of the process
+        static Profiler &instance()
+        {
+            static Profiler profiler;
+            return profiler;
+        }
+
+        /// @brief open the counters of the calling thread, if it has not been done yet
+        void register_thread()
+        {
+            thread_local bool registered = false;
+            if (not registered)
+            {
+                registered = true;
+                auto group = std::make_shared<PerfCounterGroup>();
+                std::lock_guard<std::mutex> lock(mutex);
+                available = available and group->available();
+                groups.push_back(std::move(group));
+            }
+        }
+
+        /// @brief read the counters of all the registered threads
+        /// @return sum of the counts of all the threads
+        PerfCounterValues read()
+        {
+            PerfCounterValues values;
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto &group : groups)
+            {
+                values += group->read();
+            }
+            return values;
+        }
+
+        /// @brief accumulate a call of a kernel
+        /// @param kernel name of the kernel
+        /// @param time_ns wall-clock time of the call
+        /// @param counters counts of the call
+        void record(const std::string &kernel, double time_ns, const PerfCounterValues &counters)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto &profile = profiles[kernel];
+            profile.calls++;
+            profile.time_ns += time_ns;
+            profile.counters += counters;
+        }
+
+        /// @brief get the accumulated profiles
+        /// @return the profile of every kernel called so far
+        std::map<std::string, KernelProfile> report() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return profiles;
+        }
+
+        /// @brief check if the hardware counters are available
+        /// @return true if the counters of all the registered threads could be opened
+        bool counters_available() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return available and not groups.empty();
+        }
+
+        /// @brief discard the accumulated profiles
+        void reset()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            profiles.clear();
+        }
+
+        /// @brief print the accumulated profiles as a table
+        /// @param os output stream
+        void print(std::ostream &os) const
+        {
+            const auto profiles = report();
+            os << std::left << std::setw(32) << "kernel" << std::right << std::setw(8) << "calls"
+               << std::setw(16) << "time/call [ns]" << std::setw(16) << "cycles/call" << std::setw(8) << "IPC"
+               << std::setw(16) << "LLC miss/call" << std::setw(16) << "br. miss/call" << std::endl;
+            for (const auto &[kernel, profile] : profiles)
+            {
+                const double calls = static_cast<double>(profile.calls);
+                os << std::left << std::setw(32) << kernel << std::right << std::setw(8) << profile.calls
+                   << std::fixed << std::setprecision(0) << std::setw(16) << profile.time_ns / calls
+                   << std::setw(16) << profile.counters.cycles / calls
+                   << std::setprecision(2) << std::setw(8) << profile.instructions_per_cycle()
+                   << std::setprecision(0) << std::setw(16) << profile.counters.llc_misses / calls
+                   << std::setw(16) << profile.counters.branch_misses / calls << std::endl;
+            }
+            if (not counters_available())
+            {
+                os << "(hardware counters not available: only calls and times are reported)" << std::endl;
+            }
+        }
+
+    private:
+        /**
+         * @brief Registers the TBB worker threads when they join the task arena.
+         */
+        class WorkerObserver : public tbb::task_scheduler_observer
+        {
+        public:
+            WorkerObserver() { observe(true); };
+            ~WorkerObserver() { observe(false); };
+            void on_scheduler_entry(bool) override { Profiler::instance().register_thread(); };
+        };
+
+        mutable std::mutex mutex;                              /// protects the counters and the profiles
+        std::vector<std::shared_ptr<PerfCounterGroup>> groups; /// counters of every registered thread
+        std::map<std::string, KernelProfile> profiles;         /// accumulated profile of every kernel
+        bool available = true;                                 /// true if all the counters could be opened
+        std::unique_ptr<WorkerObserver> observer;              /// observer of the TBB workers
+        std::once_flag observer_flag;                          /// guards the creation of the observer
+
+        /// @brief default constructor
+        Profiler() = default;
+
+        friend class ProfileScope;
+
+        /// @brief start observing the TBB workers (after the construction of the singleton)
+        void start_observer()
+        {
+            std::call_once(observer_flag, [this]()
+                           { observer = std::make_unique<WorkerObserver>(); });
+        }
+    };
+
+    /**
+     * @brief Accumulates the counters of its lifetime under the name of a kernel (see ALGEBRA_PROFILE).
+     */
+    class ProfileScope
+    {
+    public:
+        /// @brief constructor, reads the counters
+        /// @param kernel name of the kernel
+        explicit ProfileScope(std::string kernel) : kernel(std::move(kernel))
+        {
+            auto &profiler = Profiler::instance();
+            profiler.start_observer();
+            profiler.register_thread();
+            start_counters = profiler.read();
+            start_time = std::chrono::steady_clock::now();
+        };
+
+        /// @brief destructor, reads the counters again and records the difference
+        ~ProfileScope()
+        {
+            auto &profiler = Profiler::instance();
+            const auto stop_time = std::chrono::steady_clock::now();
+            const auto stop_counters = profiler.read();
+            profiler.record(kernel, std::chrono::duration<double, std::nano>(stop_time - start_time).count(),
+                            stop_counters - start_counters);
+        };
+
+        ProfileScope(const ProfileScope &) = delete;
+        ProfileScope &operator=(const ProfileScope &) = delete;
+
+    private:
+        std::string kernel;                               /// name of the kernel
+        PerfCounterValues start_counters;                 /// counters at the beginning of the scope
+        std::chrono::steady_clock::time_point start_time; /// time at the beginning of the scope
+    };
+
+    /// @brief name of a kernel in the profiles
+    /// @param operation name of the operation (e.g. spmv, spgemm, compress)
+    /// @param order storage order of the operand(s)
+    /// @param compressed true if the operand(s) are in compressed format
+    /// @param modified true if the operand(s) are in modified compressed format
+    /// @param kernel kernel of the operation, if it depends on it
+    /// @return the operation followed by the format and the kernel (e.g. "spmv CSR Parallel")
+    inline std::string profile_name(const std::string &operation, StorageOrder order, bool compressed,
+                                    bool modified = false, const char *kernel = nullptr)
+    {
+        std::string name = operation + " " + format_name(order, compressed, modified);
+        if (kernel)
+        {
+            name += std::string(" ") + kernel;
+        }
+        return name;
+    }
+
+    /// @brief name of a kernel of a product in the profiles
+    /// @param kernel kernel of the product
+    /// @return name of the kernel
+    inline const char *kernel_name(Kernel kernel)
+    {
+        return kernel == Kernel::Parallel ? "Parallel" : "Serial";
+    }
+}
+
+#endif // PROFILING_HPP
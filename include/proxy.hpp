@@ -8,6 +8,10 @@
  * The Proxy enforces sparse storage rules by ensuring that zero values are not explicitly stored
  * in the underlying uncompressed storage format. Assignments and arithmetic operations are
  * intercepted to insert, update, or erase elements as appropriate.
+ *
+ * A proxy can also refer to a whole matrix instead of its uncompressed storage: this is how a compressed
+ * matrix with the ConversionPolicy::Buffer policy is written without being uncompressed, since every
+ * access is forwarded to the (virtual) call operator and set method of the matrix.
  * 
  * @copyright
  * Copyright (c) 2024
@@ -22,6 +26,10 @@
 
 namespace algebra
 {
+    // forward declaration of the AbstractMatrix class
+    template <AddMulType T, StorageOrder S>
+    class AbstractMatrix;
+
     /**
      * @brief Proxy class for matrix elements that enforces sparse storage rules.
      * 
@@ -40,7 +48,8 @@ namespace algebra
     class Proxy
     {
     private:
-        UncompressedStorage<T, S> &uncompressed_format; /// reference to the uncompressed storage
+        UncompressedStorage<T, S> *uncompressed_format = nullptr; /// uncompressed storage (if not forwarding to the matrix)
+        AbstractMatrix<T, S> *matrix = nullptr; /// matrix the accesses are forwarded to (if any)
         size_t row; /// row index
         size_t col; /// column index
 
@@ -51,7 +60,16 @@ namespace algebra
         /// @param row 
         /// @param col 
         Proxy(UncompressedStorage<T, S> &uncompressed_format, size_t row, size_t col)
-            : uncompressed_format(uncompressed_format), row(row), col(col)
+            : uncompressed_format(&uncompressed_format), row(row), col(col)
+        {
+        }
+
+        /// @brief Constructor forwarding the accesses to the matrix
+        /// @param matrix matrix to read with operator() const and to write with set
+        /// @param row 
+        /// @param col 
+        Proxy(AbstractMatrix<T, S> &matrix, size_t row, size_t col)
+            : matrix(&matrix), row(row), col(col)
         {
         }
         
@@ -59,15 +77,19 @@ namespace algebra
         /// @return the value of the matrix at (row, col)
         operator T() const
         {
+            if (matrix)
+            {
+                return static_cast<const AbstractMatrix<T, S> &>(*matrix)(row, col);
+            }
             // find the value in the uncompressed format
-            auto it = uncompressed_format.find({row, col});
-            if (it == uncompressed_format.end())
+            auto it = uncompressed_format->find({row, col});
+            if (it == uncompressed_format->end())
             {
                 // if the value is not found, return 0
                 return T(0);
             }
             // if the value is found, return it
-            return uncompressed_format[{row, col}];
+            return it->second;
         }
 
         /// @brief assignment operator
@@ -78,15 +100,20 @@ namespace algebra
         /// @note if the value is not 0, the value is set in the matrix
         Proxy &operator=(T const &val)
         {
+            if (matrix)
+            {
+                matrix->set(row, col, val);
+                return *this;
+            }
             if (val == T(0))
             {
                 // erase the value
-                uncompressed_format.erase({row, col});
+                uncompressed_format->erase({row, col});
             }
             else
             {
                 // set the value
-                uncompressed_format[{row, col}] = val;
+                (*uncompressed_format)[{row, col}] = val;
             }
             return *this;
         }
@@ -100,16 +127,18 @@ namespace algebra
         /// @note if the value is not 0, the value is set in the matrix
         Proxy &operator+=(T const &val)
         {
-            T newv = uncompressed_format[{row, col}] + val;
-            if (newv == T(0))
+            if (matrix)
             {
-                // erase the value
-                uncompressed_format.erase({row, col});
+                matrix->set(row, col, T(*this) + val);
+                return *this;
             }
-            else
+            // a single lookup of the element (inserted as zero if missing)
+            auto it = uncompressed_format->try_emplace({row, col}, T(0)).first;
+            it->second += val;
+            if (it->second == T(0))
             {
-                // set the value
-                uncompressed_format[{row, col}] = newv;
+                // erase the value
+                uncompressed_format->erase(it);
             }
             return *this;
         }
@@ -122,16 +151,18 @@ namespace algebra
         /// @note if the value is not 0, the value is set in the matrix
         Proxy &operator-=(T const &val)
         {
-            T newv = uncompressed_format[{row, col}] - val;
-            if (newv == T(0))
+            if (matrix)
             {
-                // erase the value
-                uncompressed_format.erase({row, col});
+                matrix->set(row, col, T(*this) - val);
+                return *this;
             }
-            else
+            // a single lookup of the element (inserted as zero if missing)
+            auto it = uncompressed_format->try_emplace({row, col}, T(0)).first;
+            it->second -= val;
+            if (it->second == T(0))
             {
-                // set the value
-                uncompressed_format[{row, col}] = newv;
+                // erase the value
+                uncompressed_format->erase(it);
             }
             return *this;
         }
@@ -0,0 +1,338 @@
+/**
+ * @file regression.hpp
+ * @brief Defines the comparison of the benchmark results with a stored baseline (`make regression`).
+ *
+ * The results of two runs of the benchmark suite (two JSON files with the schema of benchmark.hpp) are
+ * matched by matrix, operation, class, format, kernel, storage order and value type. For every pair the
+ * relative change of the mean execution time is estimated together with its confidence interval, from the
+ * mean, the standard deviation and the number of repetitions of both runs (Welch's t interval, with the
+ * degrees of freedom of Welch-Satterthwaite).
+ *
+ * An operation is a regression when the whole confidence interval lies above the threshold, i.e. when it
+ * is slower than the baseline by more than the threshold with the given confidence; it is an improvement
+ * when the whole interval lies below the opposite of the threshold. Operations with fewer repetitions than
+ * RegressionSettings::min_repetitions (at least two) in either run are reported as inconclusive, since their
+ * confidence interval is too wide to be trusted: the benchmark guarantees a minimum number of repetitions
+ * (see algebra::Benchmark) to avoid them. The gate fails also when an operation of the baseline is missing
+ * from the current run, so that a kernel cannot leave the gate silently.
+ *
+ * @code{.cpp}
+ * RegressionReport report = compare_benchmarks(read_json("data/benchmark_baseline.json"),
+ *                                              read_json("data/benchmark.json"));
+ * print_report(std::cout, report);
+ * return report.passed() ? 0 : 1;
+ * @endcode
+ *
+ * @see benchmark.hpp
+ * @see bench/compare.cpp
+ */
+#ifndef REGRESSION_HPP
+#define REGRESSION_HPP
+
+#include "json_utility.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <numbers>
+#include <limits>
+#include <ostream>
+#include <iomanip>
+#include <stdexcept>
+#include <algorithm>
+
+namespace algebra
+{
+    /**
+     * @brief Settings of the comparison with the baseline.
+     */
+    struct RegressionSettings
+    {
+        double threshold = 0.10;    /// minimum relative slowdown considered a regression
+        double confidence = 0.99;   /// confidence level of the intervals
+        size_t min_repetitions = 10; /// minimum number of repetitions in both runs, fewer give an inconclusive verdict
+    };
+
+    /**
+     * @brief Outcome of the comparison of an operation with the baseline.
+     */
+    enum class Verdict
+    {
+        Unchanged,    /// no significant change beyond the threshold
+        Regression,   /// significantly slower than the baseline by more than the threshold
+        Improvement,  /// significantly faster than the baseline by more than the threshold
+        Inconclusive, /// fewer repetitions than the minimum of the settings (or than two, without a confidence interval)
+    };
+
+    /// @brief name of a verdict in the report
+    /// @param verdict verdict to name
+    /// @return name of the verdict
+    inline std::string verdict_name(Verdict verdict)
+    {
+        switch (verdict)
+        {
+        case Verdict::Regression:
+            return "REGRESSION";
+        case Verdict::Improvement:
+            return "improvement";
+        case Verdict::Inconclusive:
+            return "inconclusive";
+        default:
+            return "unchanged";
+        }
+    }
+
+    /**
+     * @brief Comparison of the execution times of an operation with the baseline.
+     */
+    struct TimingComparison
+    {
+        std::string key;          /// identifier of the operation (see benchmark_key)
+        double baseline_mean = 0; /// mean time of the baseline (ns)
+        double current_mean = 0;  /// mean time of the current run (ns)
+        size_t baseline_runs = 0; /// repetitions of the baseline
+        size_t current_runs = 0;  /// repetitions of the current run
+        double change = 0;        /// relative change of the mean time (positive if slower)
+        double lower = 0;         /// lower bound of the confidence interval of the change
+        double upper = 0;         /// upper bound of the confidence interval of the change
+        Verdict verdict = Verdict::Unchanged;
+    };
+
+    /**
+     * @brief Comparison of a benchmark run with the baseline.
+     */
+    struct RegressionReport
+    {
+        RegressionSettings settings;               /// settings of the comparison
+        std::string baseline_machine;              /// machine of the baseline
+        std::string current_machine;               /// machine of the current run
+        std::vector<TimingComparison> comparisons; /// operations present in both runs
+        std::vector<std::string> missing;          /// operations of the baseline not present in the current run
+        std::vector<std::string> added;            /// operations of the current run not present in the baseline
+
+        /// @brief count the operations with a verdict
+        /// @param verdict verdict to count
+        /// @return number of operations with the verdict
+        size_t count(Verdict verdict) const
+        {
+            size_t n = 0;
+            for (const auto &comparison : comparisons)
+            {
+                n += (comparison.verdict == verdict);
+            }
+            return n;
+        }
+
+        /// @brief check the outcome of the gate: an operation of the baseline that is not measured any more
+        ///        (e.g. a kernel that was removed or renamed, or that failed) would otherwise go unnoticed
+        /// @return true if no operation is a regression and every operation of the baseline is measured
+        bool passed() const { return count(Verdict::Regression) == 0 and missing.empty(); };
+    };
+
+    /// @brief quantile of the standard normal distribution
+    /// @param p probability in (0, 1)
+    /// @return x such that P(Z <= x) = p
+    inline double normal_quantile(double p)
+    {
+        if (p <= 0 or p >= 1)
+        {
+            throw std::invalid_argument("The probability must be in (0, 1)");
+        }
+        // bisection on the cumulative distribution function, accurate to machine precision
+        double low = -40, high = 40;
+        for (int i = 0; i < 200 and high - low > 1e-12; i++)
+        {
+            const double middle = 0.5 * (low + high);
+            (0.5 * std::erfc(-middle / std::numbers::sqrt2) < p ? low : high) = middle;
+        }
+        return 0.5 * (low + high);
+    }
+
+    /// @brief quantile of the Student's t distribution
+    /// @param p probability in (0, 1)
+    /// @param df degrees of freedom (positive, not necessarily integer)
+    /// @return t such that P(T <= t) = p
+    inline double student_t_quantile(double p, double df)
+    {
+        if (df <= 0)
+        {
+            throw std::invalid_argument("The degrees of freedom must be positive");
+        }
+        if (df < 2)
+        {
+            // Cauchy distribution: exact for one degree of freedom, conservative up to two
+            return std::tan(std::numbers::pi * (p - 0.5));
+        }
+        if (df < 3)
+        {
+            // exact for two degrees of freedom, conservative up to three
+            return (2 * p - 1) / std::sqrt(2 * p * (1 - p));
+        }
+        // Cornish-Fisher expansion around the normal quantile (error below 1% from ten degrees of freedom)
+        const double z = normal_quantile(p);
+        const double z2 = z * z;
+        return z + z * (z2 + 1) / (4 * df) + z * ((5 * z2 + 16) * z2 + 3) / (96 * df * df) +
+               z * (((3 * z2 + 19) * z2 + 17) * z2 - 15) / (384 * df * df * df);
+    }
+
+    /// @brief identifier of an entry of the "results" array of a benchmark
+    /// @param result entry of the results
+    /// @return matrix, operation, class, format, kernel, storage order and value type of the entry
+    inline std::string benchmark_key(const json_utility::json &result)
+    {
+        std::string key;
+        for (const auto &field : {"matrix", "operation", "class", "format", "kernel", "storage_order", "value_type"})
+        {
+            if (not key.empty())
+            {
+                key += ' ';
+            }
+            key += result.at(field).get<std::string>();
+        }
+        return key;
+    }
+
+    /// @brief compare the execution times of an operation with the baseline
+    /// @param baseline entry of the results of the baseline
+    /// @param current entry of the results of the current run
+    /// @param settings threshold, confidence level and minimum number of repetitions
+    /// @return the comparison, with the confidence interval of the relative change
+    inline TimingComparison compare_timings(const json_utility::json &baseline, const json_utility::json &current,
+                                            const RegressionSettings &settings = {})
+    {
+        TimingComparison comparison;
+        comparison.key = benchmark_key(current);
+        comparison.baseline_mean = baseline.at("time_ns").at("mean").get<double>();
+        comparison.current_mean = current.at("time_ns").at("mean").get<double>();
+        comparison.baseline_runs = baseline.at("repetitions").get<size_t>();
+        comparison.current_runs = current.at("repetitions").get<size_t>();
+        const double baseline_stddev = baseline.at("time_ns").at("stddev").get<double>();
+        const double current_stddev = current.at("time_ns").at("stddev").get<double>();
+
+        const double mean = comparison.baseline_mean;
+        const double difference = comparison.current_mean - mean;
+        comparison.change = difference / mean;
+        const size_t min_runs = std::max<size_t>(settings.min_repetitions, 2);
+        if (comparison.baseline_runs < min_runs or comparison.current_runs < min_runs or mean <= 0)
+        {
+            comparison.lower = -std::numeric_limits<double>::infinity();
+            comparison.upper = std::numeric_limits<double>::infinity();
+            comparison.verdict = Verdict::Inconclusive;
+            return comparison;
+        }
+
+        // Welch's interval of the difference of the means, relative to the mean of the baseline
+        const double baseline_variance = baseline_stddev * baseline_stddev / comparison.baseline_runs;
+        const double current_variance = current_stddev * current_stddev / comparison.current_runs;
+        const double variance = baseline_variance + current_variance;
+        double half_width = 0;
+        if (variance > 0)
+        {
+            const double df = variance * variance /
+                              (baseline_variance * baseline_variance / (comparison.baseline_runs - 1) +
+                               current_variance * current_variance / (comparison.current_runs - 1));
+            half_width = student_t_quantile(0.5 + 0.5 * settings.confidence, df) * std::sqrt(variance);
+        }
+        comparison.lower = (difference - half_width) / mean;
+        comparison.upper = (difference + half_width) / mean;
+
+        if (comparison.lower > settings.threshold)
+        {
+            comparison.verdict = Verdict::Regression;
+        }
+        else if (comparison.upper < -settings.threshold)
+        {
+            comparison.verdict = Verdict::Improvement;
+        }
+        return comparison;
+    }
+
+    /// @brief compare a benchmark run with the baseline
+    /// @param baseline JSON data of the baseline (schema of benchmark.hpp)
+    /// @param current JSON data of the current run (schema of benchmark.hpp)
+    /// @param settings threshold, confidence level and minimum number of repetitions
+    /// @return the comparison of all the operations
+    /// @throws std::invalid_argument if a file does not follow the schema of the benchmark suite
+    inline RegressionReport compare_benchmarks(const json_utility::json &baseline, const json_utility::json &current,
+                                               const RegressionSettings &settings = {})
+    {
+        for (const auto &data : {&baseline, &current})
+        {
+            if (data->value("schema", "") != "sparse-matrix-benchmark")
+            {
+                throw std::invalid_argument("The file does not contain the results of the benchmark suite");
+            }
+        }
+
+        RegressionReport report;
+        report.settings = settings;
+        report.baseline_machine = baseline.value("machine", "");
+        report.current_machine = current.value("machine", "");
+
+        std::map<std::string, const json_utility::json *> reference;
+        for (const auto &result : baseline.at("results"))
+        {
+            reference[benchmark_key(result)] = &result;
+        }
+        for (const auto &result : current.at("results"))
+        {
+            const std::string key = benchmark_key(result);
+            auto it = reference.find(key);
+            if (it == reference.end())
+            {
+                report.added.push_back(key);
+                continue;
+            }
+            report.comparisons.push_back(compare_timings(*it->second, result, settings));
+            reference.erase(it);
+        }
+        for (const auto &[key, result] : reference)
+        {
+            report.missing.push_back(key);
+        }
+        return report;
+    }
+
+    /// @brief print a report of the comparison with the baseline
+    /// @param os output stream
+    /// @param report report to print
+    /// @param all print every operation, not only the regressions and the improvements
+    inline void print_report(std::ostream &os, const RegressionReport &report, bool all = false)
+    {
+        if (report.baseline_machine != report.current_machine)
+        {
+            os << "Warning: the baseline was measured on " << report.baseline_machine << ", the current run on "
+               << report.current_machine << std::endl;
+        }
+        os << "Comparison with the baseline (threshold " << 100 * report.settings.threshold << "%, confidence "
+           << 100 * report.settings.confidence << "%)" << std::endl;
+        for (const auto &comparison : report.comparisons)
+        {
+            if (not all and comparison.verdict != Verdict::Regression and comparison.verdict != Verdict::Improvement)
+            {
+                continue;
+            }
+            os << std::left << std::setw(14) << verdict_name(comparison.verdict) << std::setw(80) << comparison.key
+               << std::right << std::fixed << std::setprecision(0) << std::setw(14) << comparison.baseline_mean
+               << " -> " << std::setw(14) << comparison.current_mean << " ns  " << std::showpos << std::setprecision(1)
+               << std::setw(7) << 100 * comparison.change << "% [" << 100 * comparison.lower << "%, "
+               << 100 * comparison.upper << "%]" << std::noshowpos << std::endl;
+        }
+        for (const auto &key : report.missing)
+        {
+            os << std::left << std::setw(14) << "missing" << key << std::endl;
+        }
+        for (const auto &key : report.added)
+        {
+            os << std::left << std::setw(14) << "new" << key << std::endl;
+        }
+        os << report.comparisons.size() << " operations compared: " << report.count(Verdict::Regression)
+           << " regressions, " << report.count(Verdict::Improvement) << " improvements, "
+           << report.count(Verdict::Inconclusive) << " inconclusive, " << report.missing.size() << " missing"
+           << std::endl;
+        os << (report.passed() ? "PASSED" : "FAILED") << std::endl;
+    }
+}
+
+#endif // REGRESSION_HPP
@@ -0,0 +1,351 @@
+/**
+ * @file roofline.hpp
+ * @brief Defines the cost model of the operations and their position with respect to the memory roofline.
+ *
+ * This header provides:
+ * - algebra::OperationCost and the cost model of the operations, i.e. the floating point operations and the
+ *   compulsory memory traffic of the products and of the norms, computed from the metadata of the operands
+ *   (format, number of rows, columns and non-zero elements, width of the indices and of the values);
+ * - algebra::stream_bandwidth, a STREAM-like probe (copy, scale, add and triad kernels run by all the TBB
+ *   threads) of the sustainable memory bandwidth, and algebra::machine_bandwidth, which runs it once per process;
+ * - algebra::roofline, which turns the cost and the execution time of an operation into the achieved GFLOP/s
+ *   and GB/s, its arithmetic intensity and the fraction of the sustainable bandwidth it achieves.
+ *
+ * Sparse products and norms perform a handful of floating point operations for every byte they read, so
+ * their attainable performance is the arithmetic intensity times the memory bandwidth: a kernel whose
+ * bandwidth fraction is far from 1 is falling off the roofline.
+ * @code{.cpp}
+ * const auto cost = spmv_cost(m);
+ * const auto point = roofline(cost, seconds);
+ * std::cout << point.gbs << " GB/s (" << 100 * point.bandwidth_fraction << "% of STREAM triad)" << std::endl;
+ * @endcode
+ *
+ * @note The memory traffic is the size of the arrays that an ideal implementation has to read and write
+ *       once (e.g. values, indices, input and output vectors for a product); for the COO format it is the
+ *       size of the (row, col, value) triplets, not of the nodes of the std::map.
+ *
+ * @see benchmark.hpp
+ */
+#ifndef ROOFLINE_HPP
+#define ROOFLINE_HPP
+
+#include "storage.hpp"
+#include "matrix.hpp"
+#include "square_matrix.hpp"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+
+#include <unistd.h>
+
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <tbb/partitioner.h>
+#include <tbb/task_arena.h>
+
+namespace algebra
+{
+    /**
+     * @brief Cost of one execution of an operation.
+     */
+    struct OperationCost
+    {
+        double flops = 0; /// floating point operations
+        double bytes = 0; /// compulsory memory traffic in bytes
+    };
+
+    /// @brief floating point operations of a multiply-add of two elements (a scalar multiplication of a product)
+    /// @tparam T type of the matrix elements
+    /// @note a complex multiply-add takes 4 real multiplications and 4 real additions
+    template <AddMulType T>
+    inline constexpr double flops_per_fma = is_complex<T>::value ? 8 : 2;
+
+    /// @brief floating point operations of the accumulation of an element in a norm
+    /// @tparam T type of the matrix elements
+    /// @note an absolute value and a sum for real values; for complex values the squared modulus, its square
+    ///       root and the sum, counted as half a complex multiply-add
+    template <AddMulType T>
+    inline constexpr double flops_per_norm_element = is_complex<T>::value ? flops_per_fma<T> / 2 : flops_per_fma<T>;
+
+    /// @brief count the scalar multiplications of the product between two compressed matrices
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order of the matrices
+    /// @param m1 first matrix (in CSR/CSC format)
+    /// @param m2 second matrix (in CSR/CSC format)
+    /// @return number of products a_ik * b_kj between non-zero elements
+    /// @note this function is a friend of the Matrix class, so it can access the private members
+    template <AddMulType T, StorageOrder S>
+    size_t count_multiplications(const Matrix<T, S> &m1, const Matrix<T, S> &m2)
+    {
+        if (not m1.is_compressed() or not m2.is_compressed())
+        {
+            throw std::invalid_argument("Counting the multiplications requires matrices in compressed format");
+        }
+        if (m1.cols != m2.rows)
+        {
+            throw std::invalid_argument("Matrix dimensions do not match for multiplication");
+        }
+
+        size_t count = 0;
+        if constexpr (S == StorageOrder::ColumnMajor)
+        {
+            // every b_kj multiplies the non-zero elements of the column k of m1
+            for (const auto &k : m2.compressed_format.outer)
+            {
+                count += m1.compressed_format.inner[k + 1] - m1.compressed_format.inner[k];
+            }
+        }
+        else
+        {
+            // every a_ik multiplies the non-zero elements of the row k of m2
+            for (const auto &k : m1.compressed_format.outer)
+            {
+                count += m2.compressed_format.inner[k + 1] - m2.compressed_format.inner[k];
+            }
+        }
+        return count;
+    }
+
+    /// @brief size of the arrays of a matrix representation
+    /// @tparam T type of the matrix elements
+    /// @param format name of the format (COO, CSR, CSC, MSR or MSC)
+    /// @param major_size number of rows (CSR) or columns (CSC)
+    /// @param entries number of stored elements (for MSR and MSC, the whole diagonal plus the off-diagonal non-zero elements)
+    /// @return size in bytes
+    template <AddMulType T>
+    double storage_bytes(const std::string &format, size_t major_size, size_t entries)
+    {
+        if (format == "COO")
+        {
+            return static_cast<double>(entries) * (sizeof(T) + 2 * sizeof(size_t));
+        }
+        if (format == "MSR" or format == "MSC")
+        {
+            return static_cast<double>(entries) * (sizeof(T) + sizeof(size_t));
+        }
+        return static_cast<double>(entries) * (sizeof(T) + sizeof(size_t)) + (major_size + 1.0) * sizeof(size_t);
+    }
+
+    /// @brief cost of the product between a matrix and a vector
+    /// @tparam T type of the matrix elements
+    /// @param matrix_bytes size of the arrays of the matrix
+    /// @param rows number of rows
+    /// @param cols number of columns
+    /// @param multiplications number of scalar multiplications
+    /// @return flops and compulsory memory traffic
+    template <AddMulType T>
+    OperationCost spmv_cost(double matrix_bytes, size_t rows, size_t cols, size_t multiplications)
+    {
+        return {flops_per_fma<T> * multiplications, matrix_bytes + static_cast<double>(rows + cols) * sizeof(T)};
+    }
+
+    /// @brief cost of the product between two matrices
+    /// @tparam T type of the matrix elements
+    /// @param m1_bytes size of the arrays of the first matrix
+    /// @param m2_bytes size of the arrays of the second matrix
+    /// @param result_bytes size of the arrays of the result
+    /// @param multiplications number of scalar multiplications
+    /// @return flops and compulsory memory traffic
+    template <AddMulType T>
+    OperationCost spgemm_cost(double m1_bytes, double m2_bytes, double result_bytes, size_t multiplications)
+    {
+        return {flops_per_fma<T> * multiplications, m1_bytes + m2_bytes + result_bytes};
+    }
+
+    /// @brief format a matrix is currently stored in
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order
+    /// @param m matrix
+    /// @return COO, CSR, CSC, MSR or MSC
+    template <AddMulType T, StorageOrder S>
+    std::string format_name(const Matrix<T, S> &m)
+    {
+        const auto *square = dynamic_cast<const SquareMatrix<T, S> *>(&m);
+        return format_name(S, m.is_compressed(), square and square->is_modified());
+    }
+
+    /// @brief size of the arrays of a matrix in its current format
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order
+    /// @param m matrix
+    /// @return size in bytes
+    template <AddMulType T, StorageOrder S>
+    double storage_bytes(const Matrix<T, S> &m)
+    {
+        const std::string format = format_name(m);
+        const size_t major_size = (S == StorageOrder::ColumnMajor) ? m.get_cols() : m.get_rows();
+        if (format == "MSR" or format == "MSC")
+        {
+            // the whole diagonal is stored, including its zero elements
+            return storage_bytes<T>(format, major_size, static_cast<const SquareMatrix<T, S> &>(m).get_mod_size());
+        }
+        return storage_bytes<T>(format, major_size, m.get_nnz());
+    }
+
+    /// @brief cost of the product between a matrix and a vector
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order
+    /// @param m matrix (in any format)
+    /// @return flops and compulsory memory traffic
+    template <AddMulType T, StorageOrder S>
+    OperationCost spmv_cost(const Matrix<T, S> &m)
+    {
+        return spmv_cost<T>(storage_bytes(m), m.get_rows(), m.get_cols(), m.get_nnz());
+    }
+
+    /// @brief cost of the product between two matrices
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order
+    /// @param m1 first matrix (in CSR/CSC format)
+    /// @param m2 second matrix (in CSR/CSC format)
+    /// @return flops and compulsory memory traffic
+    /// @note the size of the result is bounded by the number of multiplications (no cancellation), so the
+    ///       traffic is an upper bound for products whose partial results overlap
+    template <AddMulType T, StorageOrder S>
+    OperationCost spgemm_cost(const Matrix<T, S> &m1, const Matrix<T, S> &m2)
+    {
+        const size_t multiplications = count_multiplications(m1, m2);
+        const size_t major_size = (S == StorageOrder::ColumnMajor) ? m2.get_cols() : m1.get_rows();
+        const size_t result_entries = std::min(multiplications, m1.get_rows() * m2.get_cols());
+        return spgemm_cost<T>(storage_bytes(m1), storage_bytes(m2),
+                              storage_bytes<T>(format_name(S, true), major_size, result_entries), multiplications);
+    }
+
+    /// @brief cost of a norm (One, Infinity or Frobenius) of a matrix
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order
+    /// @param m matrix (in any format)
+    /// @return flops (see flops_per_norm_element) and compulsory memory traffic
+    template <AddMulType T, StorageOrder S>
+    OperationCost norm_cost(const Matrix<T, S> &m)
+    {
+        return {flops_per_norm_element<T> * m.get_nnz(), storage_bytes(m)};
+    }
+
+    /**
+     * @brief Sustainable memory bandwidth measured by the STREAM kernels (in GB/s).
+     *
+     * The bytes of every kernel are counted as in STREAM: 16 bytes per element for copy (c = a) and
+     * scale (b = q c), 24 bytes per element for add (c = a + b) and triad (a = b + q c).
+     */
+    struct StreamBandwidth
+    {
+        double copy = 0;     /// bandwidth of the copy kernel
+        double scale = 0;    /// bandwidth of the scale kernel
+        double add = 0;      /// bandwidth of the add kernel
+        double triad = 0;    /// bandwidth of the triad kernel
+        size_t elements = 0; /// number of elements of every array
+        int threads = 0;     /// number of threads
+    };
+
+    /// @brief default size of the arrays of the STREAM probe
+    /// @return four times the size of the last level cache (in elements), and at least 2^22 elements
+    inline size_t stream_elements()
+    {
+        long cache = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+        cache = std::max(cache, sysconf(_SC_LEVEL3_CACHE_SIZE));
+#endif
+#ifdef _SC_LEVEL2_CACHE_SIZE
+        cache = std::max(cache, sysconf(_SC_LEVEL2_CACHE_SIZE));
+#endif
+        return std::max(size_t(1) << 22, 4 * static_cast<size_t>(std::max(cache, 0L)) / sizeof(double));
+    }
+
+    /// @brief measure the sustainable memory bandwidth with the STREAM kernels
+    /// @param elements number of elements of every array (three arrays of doubles are allocated)
+    /// @param repetitions number of runs of every kernel (the best one is taken)
+    /// @return the bandwidth of every kernel
+    inline StreamBandwidth stream_bandwidth(size_t elements = stream_elements(), size_t repetitions = 5)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        // the arrays are initialized in parallel, so that the pages are placed near the threads using them
+        std::unique_ptr<double[]> a(new double[elements]), b(new double[elements]), c(new double[elements]);
+        tbb::affinity_partitioner partitioner;
+        auto parallel = [&](auto &&kernel)
+        {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, elements), [&](const tbb::blocked_range<size_t> &range)
+                              {
+                                  for (size_t i = range.begin(); i < range.end(); i++)
+                                  {
+                                      kernel(i);
+                                  } },
+                              partitioner);
+        };
+        parallel([&](size_t i)
+                 { a[i] = 1.0, b[i] = 2.0, c[i] = 0.0; });
+
+        const double q = 3.0;
+        auto best = [&](auto &&kernel, double bytes_per_element)
+        {
+            double best_seconds = 0;
+            for (size_t r = 0; r < repetitions; r++)
+            {
+                const auto start = Clock::now();
+                parallel(kernel);
+                const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                if (r == 0 or seconds < best_seconds)
+                {
+                    best_seconds = seconds;
+                }
+            }
+            return best_seconds > 0 ? bytes_per_element * elements / best_seconds * 1e-9 : 0;
+        };
+
+        StreamBandwidth bandwidth;
+        bandwidth.elements = elements;
+        bandwidth.threads = tbb::this_task_arena::max_concurrency();
+        bandwidth.copy = best([&](size_t i)
+                              { c[i] = a[i]; }, 2 * sizeof(double));
+        bandwidth.scale = best([&](size_t i)
+                               { b[i] = q * c[i]; }, 2 * sizeof(double));
+        bandwidth.add = best([&](size_t i)
+                             { c[i] = a[i] + b[i]; }, 3 * sizeof(double));
+        bandwidth.triad = best([&](size_t i)
+                               { a[i] = b[i] + q * c[i]; }, 3 * sizeof(double));
+        return bandwidth;
+    }
+
+    /// @brief sustainable memory bandwidth of the machine
+    /// @return the bandwidth measured by the STREAM probe the first time this function is called
+    inline const StreamBandwidth &machine_bandwidth()
+    {
+        static const StreamBandwidth bandwidth = stream_bandwidth();
+        return bandwidth;
+    }
+
+    /**
+     * @brief Position of an execution of an operation with respect to the memory roofline.
+     */
+    struct RooflinePoint
+    {
+        double gflops = 0;               /// achieved GFLOP/s
+        double gbs = 0;                  /// achieved GB/s
+        double arithmetic_intensity = 0; /// flops per byte of compulsory memory traffic
+        double attainable_gflops = 0;    /// GFLOP/s attainable at the peak bandwidth (intensity times bandwidth)
+        double bandwidth_fraction = 0;   /// achieved GB/s over the peak bandwidth
+    };
+
+    /// @brief place an execution of an operation on the memory roofline
+    /// @param cost cost of the operation
+    /// @param seconds execution time
+    /// @param peak_gbs sustainable memory bandwidth (by default the STREAM triad bandwidth of the machine)
+    /// @return achieved performance, arithmetic intensity and fraction of the peak bandwidth
+    inline RooflinePoint roofline(const OperationCost &cost, double seconds, double peak_gbs = machine_bandwidth().triad)
+    {
+        RooflinePoint point;
+        point.gflops = seconds > 0 ? cost.flops / seconds * 1e-9 : 0;
+        point.gbs = seconds > 0 ? cost.bytes / seconds * 1e-9 : 0;
+        point.arithmetic_intensity = cost.bytes > 0 ? cost.flops / cost.bytes : 0;
+        point.attainable_gflops = point.arithmetic_intensity * peak_gbs;
+        point.bandwidth_fraction = peak_gbs > 0 ? point.gbs / peak_gbs : 0;
+        return point;
+    }
+}
+
+#endif // ROOFLINE_HPP
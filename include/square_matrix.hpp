@@ -84,6 +84,15 @@ namespace algebra
             this->modified = false;
         };
 
+        /// @brief constructor from arrays in compressed format
+        /// @note the constructed matrix is in compressed format and takes ownership of the arrays
+        /// @param size number of rows and columns
+        /// @param storage CSR (RowMajor) or CSC (ColumnMajor) arrays, with sorted indices in each row (column)
+        SquareMatrix(size_t size, CompressedStorage<T> &&storage) : Matrix<T, S>(size, size, std::move(storage))
+        {
+            this->modified = false;
+        };
+
         /// @brief default copy constructor
         /// @param other matrix to copy
         SquareMatrix(const SquareMatrix &other) = default;
@@ -99,6 +108,13 @@ namespace algebra
             this->modified = false;
         };
 
+        /// @brief constructor from a temporary matrix, whose storage is moved
+        /// @param other matrix to move
+        SquareMatrix(Matrix<T, S> &&other) : Matrix<T, S>(std::move(require_square(other)))
+        {
+            this->modified = false;
+        };
+
         /// @brief constructor from a TransposeView
         /// @param view TransposeView to construct the matrix from
         SquareMatrix(const TransposeView<T, S> &view);
@@ -131,17 +147,16 @@ namespace algebra
         virtual bool is_modified() const { return modified; };
 
         /// @brief compress the matrix in modified format
+        /// @note a 0x0 matrix is compressed in the compressed format instead, since it has no diagonal
         virtual void compress_mod();
 
-        /// @brief set an element in the matrix (dynamic construction of the matrix)
-        /// @param row row index
-        /// @param col column index
-        /// @param value value to set
-        virtual void set(size_t row, size_t col, const T &value) override;
-
         /// @brief compress the matrix if it is in an uncompressed format
         virtual void compress() override;
 
+        /// @brief compress the matrix in the given compressed format
+        /// @param format compressed format (Compressed or ModifiedCompressed)
+        virtual void compress(CompressedFormat format) override;
+
         /// @brief uncompress the matrix if it is in a compressed format
         virtual void uncompress() override;
 
@@ -157,6 +172,12 @@ namespace algebra
         /// @return reference to the element at (row, col) with proxy (to avoid setting zero values)
         virtual Proxy<T, S> operator()(size_t row, size_t col) override;
 
+        /// @brief get an element, without checking the indices
+        /// @param row row index, less than the size
+        /// @param col column index, less than the size
+        /// @return element at (row, col)
+        virtual T get_unchecked(size_t row, size_t col) const override;
+
         /// @brief resize the matrix
         /// @param rows number of rows
         /// @param cols number of columns
@@ -174,6 +195,10 @@ namespace algebra
         /// @param filename input file name
         virtual void reader(const std::string &filename) override;
 
+        /// @brief Function to write a matrix in Matrix Market format
+        /// @param filename output file name
+        virtual void writer(const std::string &filename) const override;
+
         /// @brief get the size of the modified compressed matrix: it comprehends also possible zero elements in the diagonal
         /// @return size of the modified compressed matrix vectors
         virtual const size_t get_mod_size() const;
@@ -182,6 +207,13 @@ namespace algebra
         /// @return number of non-zero elements
         virtual size_t get_nnz() const override;
 
+        /// @brief get the bytes used by each component of the storage
+        /// @return memory usage of the uncompressed, compressed and modified compressed formats
+        virtual MemoryUsage memory_usage() const override;
+
+        /// @brief release the memory allocated by the vectors of the compressed formats beyond their size
+        virtual void shrink_to_fit() override;
+
         /// @brief multiply with a std::vector
         /// @tparam U type of the vector elements
         /// @tparam T type of the storage order
@@ -256,11 +288,50 @@ namespace algebra
         template <AddMulType U, StorageOrder V>
         friend Matrix<U, V> operator*(const DiagonalView<U, V> &m1, const Matrix<U, V> &m2);
 
+    protected:
+        /// @brief check if the matrix is stored in any compressed format
+        /// @return true if the matrix is compressed or modified compressed
+        virtual bool in_compressed_format() const override { return this->compressed or modified; };
+
+        /// @brief get the size of the compressed format the matrix is stored in
+        /// @return bytes of the compressed (or modified compressed) arrays
+        virtual size_t compressed_bytes() const override;
+
+        /// @brief overwrite an existing element of the compressed or modified compressed format
+        /// @param row row index
+        /// @param col column index
+        /// @param value value to set (non-zero, unless it is on the diagonal of the modified format)
+        /// @return true if the element is stored in the compressed format (and has been overwritten)
+        virtual bool write_in_place(size_t row, size_t col, const T &value) override;
+
     private:
         bool modified = false; /// flag to check if the matrix is in modified compressed format
 
         // storage for the matrix
         ModifiedCompressedStorage<T> compressed_format_mod; /// MSR or MSC format
+
+        /// @brief multiply the modified compressed format with a std::vector, with the kernel of the matrix
+        /// @param v vector
+        /// @param transpose true for the product of the transpose (TransposeView)
+        /// @return the result of the multiplication
+        std::vector<T> multiply_mod(const std::vector<T> &v, bool transpose) const;
+
+        /// @brief partition of the major indices of the modified compressed format, balanced on the off-diagonal
+        ///        elements: the parts written by each thread in compress_mod and read by the parallel kernel
+        /// @return partition with one part per thread of the current task arena
+        RowPartition mod_partition() const;
+
+        /// @brief check that a matrix is square before moving it
+        /// @param other matrix to check
+        /// @return reference to the matrix
+        static Matrix<T, S> &require_square(Matrix<T, S> &other)
+        {
+            if (other.get_rows() != other.get_cols())
+            {
+                throw std::runtime_error("Matrix is not square");
+            }
+            return other;
+        }
     };
 
 };
@@ -268,4 +339,8 @@ namespace algebra
 #include "square_matrix.tpp"
 #include "view_products.tpp"
 
-#endif // SQUARE_MATRIX_HPP
\ No newline at end of file
+// explicit instantiations of the prebuilt library (ALGEBRA_PREBUILT)
+#define ALGEBRA_SQUARE_MATRIX_COMPLETE
+#include "extern_templates.hpp"
+
+#endif // SQUARE_MATRIX_HPP
@@ -11,9 +11,14 @@
  * @details
  * The main components of this file are:
  * - @ref algebra::StorageOrder : Enum for specifying matrix storage order.
+ * - @ref algebra::CompressedFormat : Enum for specifying the compressed representation of a matrix.
+ * - @ref algebra::Kernel : Enum for specifying the kernel used by the products of a compressed matrix.
+ * - @ref algebra::ConversionPolicy : Enum for specifying what happens when a compressed matrix is written.
+ * - @ref algebra::bounds_checking : Compile-time policy of the index checks of the element accessors (ALGEBRA_BOUNDS_CHECK).
  * - @ref algebra::is_complex : Type trait to detect std::complex types.
  * - @ref algebra::AbsReturnType : Type trait to determine the return type of std::abs.
  * - @ref algebra::AddMulType : Concept for types supporting addition, multiplication, and absolute value.
+ * - @ref algebra::StorageVector : Alias for the vectors of the compressed formats (see memory_usage.hpp and huge_pages.hpp).
  * - @ref algebra::CompressedStorage : Structure for compressed sparse matrix storage (CSR/CSC).
  * - @ref algebra::ModifiedCompressedStorage : Structure for modified compressed storage with explicit diagonal.
  * - @ref algebra::Index : Struct representing a matrix index (row, col).
@@ -35,6 +40,17 @@
 #include <concepts>
 #include <complex>
 
+#include "memory_usage.hpp"
+
+// the element accessors check the indices, unless ALGEBRA_BOUNDS_CHECK is 0 (default in release builds, with NDEBUG)
+#ifndef ALGEBRA_BOUNDS_CHECK
+#ifdef NDEBUG
+#define ALGEBRA_BOUNDS_CHECK 0
+#else
+#define ALGEBRA_BOUNDS_CHECK 1
+#endif
+#endif
+
 namespace algebra
 {
     /**
@@ -51,6 +67,73 @@ namespace algebra
         ColumnMajor
     };
 
+    /**
+     * @enum CompressedFormat
+     * @brief Enum class to specify the compressed representation of a matrix.
+     *
+     * - Compressed: CSR (RowMajor) or CSC (ColumnMajor) format.
+     * - ModifiedCompressed: MSR (RowMajor) or MSC (ColumnMajor) format, available only for square matrices.
+     */
+    enum class CompressedFormat
+    {
+        Compressed,
+        ModifiedCompressed
+    };
+
+    /**
+     * @enum Kernel
+     * @brief Enum class to specify the kernel used by the products of a compressed matrix.
+     *
+     * - Serial: the compressed arrays are traversed by a single thread.
+     * - Parallel: the compressed arrays are partitioned among the TBB worker threads.
+     */
+    enum class Kernel
+    {
+        Serial,
+        Parallel
+    };
+
+    /**
+     * @enum ConversionPolicy
+     * @brief Enum class to specify what happens when a compressed matrix is written element by element.
+     *
+     * - Allow: the matrix is uncompressed silently.
+     * - WarnOnce: the matrix is uncompressed, and the first implicit conversion of the process prints a warning.
+     * - Throw: std::runtime_error is thrown, the matrix must be uncompressed explicitly.
+     * - Buffer: the existing elements are overwritten in place, the other writes are buffered until
+     *   the matrix is flushed or uncompressed.
+     */
+    enum class ConversionPolicy
+    {
+        Allow,
+        WarnOnce,
+        Throw,
+        Buffer
+    };
+
+    /// @brief true if operator() and set() throw std::out_of_range for the indices outside the matrix
+    /// @note with `-DALGEBRA_BOUNDS_CHECK=0` (or NDEBUG) the indices are not checked, as with the *_unchecked accessors
+    inline constexpr bool bounds_checking = ALGEBRA_BOUNDS_CHECK;
+
+    /// @brief name of the format a matrix is stored in
+    /// @param order storage order of the matrix
+    /// @param compressed true if the matrix is in compressed format
+    /// @param modified true if the matrix is in modified compressed format
+    /// @return COO, CSR, CSC, MSR or MSC
+    inline const char *format_name(StorageOrder order, bool compressed, bool modified = false)
+    {
+        const bool column_major = (order == StorageOrder::ColumnMajor);
+        if (modified)
+        {
+            return column_major ? "MSC" : "MSR";
+        }
+        if (compressed)
+        {
+            return column_major ? "CSC" : "CSR";
+        }
+        return "COO";
+    }
+
     /// @brief check if the type is a complex number
     /// @tparam T type to check
     /// @note primary template is false for all types
@@ -97,14 +180,19 @@ namespace algebra
         { std::abs(a) } -> std::convertible_to<AbsReturnType_t<T>>;
     };
 
+    /// @brief vector of the compressed formats
+    /// @tparam T type of the elements
+    template <typename T>
+    using StorageVector = std::vector<T, ArrayAllocator<T>>;
+
     /// @brief matrix storage in compressed format
     /// @tparam T type of the matrix elements
     template <AddMulType T>
     struct CompressedStorage
     {
-        std::vector<size_t> inner; // Starting index for each row (for CSR) or column (for CSC)
-        std::vector<size_t> outer; // Column (for CSR) or row (for CSC) indices of non-zero elements
-        std::vector<T> values;     // Non-zero values
+        StorageVector<size_t> inner; // Starting index for each row (for CSR) or column (for CSC)
+        StorageVector<size_t> outer; // Column (for CSR) or row (for CSC) indices of non-zero elements
+        StorageVector<T> values;     // Non-zero values
     };
 
     /// @brief matrix storage in modified compressed format
@@ -113,11 +201,11 @@ namespace algebra
     struct ModifiedCompressedStorage
     {
         // let nnz = number of non-zero elements, considering the whole principal diagonal NON-zero
-        std::vector<T> values;
+        StorageVector<T> values;
         // from 0 to n-1-> diagonal elements
         // from n to nnz-1 -> off-diagonal elements in row or column major order
 
-        std::vector<size_t> bind;
+        StorageVector<size_t> bind;
         // from 0 to n-1 -> row or column pointer
         //(cumulative sum of nnz that are OFF the diagonal up to that row/col + size of matrix(first n elements are the diagonal ones))
         // from n to nnz - 1 -> column or row index of the off-diagonal elements
@@ -170,7 +258,7 @@ namespace algebra
     /// @brief matrix storage in uncompressed format
     /// @tparam T type of the matrix elements
     template <AddMulType T, StorageOrder S = StorageOrder::RowMajor>
-    using UncompressedStorage = std::map<Index, T, typename ComparatorSelector<S>::type>;
+    using UncompressedStorage = std::map<Index, T, typename ComparatorSelector<S>::type, StorageAllocator<std::pair<const Index, T>>>;
 
 }
 #endif // STORAGE_HPP
\ No newline at end of file
@@ -316,7 +316,7 @@ namespace algebra
 
         if (typeid(m) == typeid(SquareMatrix<T, S>))
         {
-            auto sm = static_cast<const SquareMatrix<T, S> &>(m);
+            auto &sm = static_cast<SquareMatrix<T, S> &>(m);
             sm.compress_mod();
             // Do the matrix - vector product
             auto result = sm * v;
@@ -327,10 +327,10 @@ namespace algebra
         }
         else if (typeid(m) == typeid(TransposeView<T, S>))
         {
-            auto tm = static_cast<const TransposeView<T, S> &>(m);
+            auto &tm = static_cast<TransposeView<T, S> &>(m);
             if (typeid(tm.matrix) == typeid(SquareMatrix<T, S>))
             {
-                auto sm = static_cast<const SquareMatrix<T, S> &>(tm.matrix);
+                auto &sm = static_cast<SquareMatrix<T, S> &>(tm.matrix);
                 sm.compress_mod();
             }
             else
@@ -346,7 +346,7 @@ namespace algebra
         }
         else if (typeid(m) == typeid(DiagonalView<T, S>))
         {
-            auto dm = static_cast<const DiagonalView<T, S> &>(m);
+            auto &dm = static_cast<DiagonalView<T, S> &>(m);
             dm.compress();
             // Do the matrix - vector product
             auto result = dm * v;
@@ -358,7 +358,7 @@ namespace algebra
         else
         {
             m.compress();
-            auto mm = static_cast<const Matrix<T, S> &>(m);
+            const auto &mm = static_cast<const Matrix<T, S> &>(m);
             // Do the matrix - vector product
             auto result = mm * v;
             // Do the matrix - matrix product
@@ -369,6 +369,30 @@ namespace algebra
         m.uncompress();
     }
 
+    /// @brief readable name of the dynamic type of a matrix
+    /// @tparam T type of the matrix elements
+    /// @tparam S type of the storage order (RowMajor or ColumnMajor)
+    /// @param m matrix
+    /// @return name of the class and of the storage order, e.g. "SquareMatrix<RowMajor>"
+    template <AddMulType T, StorageOrder S>
+    std::string type_name(const AbstractMatrix<T, S> &m)
+    {
+        const std::string order = (S == StorageOrder::ColumnMajor) ? "<ColumnMajor>" : "<RowMajor>";
+        if (typeid(m) == typeid(SquareMatrix<T, S>))
+        {
+            return "SquareMatrix" + order;
+        }
+        else if (typeid(m) == typeid(TransposeView<T, S>))
+        {
+            return "TransposeView" + order;
+        }
+        else if (typeid(m) == typeid(DiagonalView<T, S>))
+        {
+            return "DiagonalView" + order;
+        }
+        return "Matrix" + order;
+    }
+
     /// @brief test the execution time of matrix-matrix and matrix-vector products
     /// @tparam S type of the storage order (RowMajor or ColumnMajor)
     /// @param matrix_names vector of matrix names
@@ -440,10 +464,11 @@ namespace algebra
         MyTimePoint start, stop;
         std::string filename = "data/execution_time.json";
         json time_info = read_json(filename);
+        const std::string key = matrix_name + " " + type_name(testMatrix);
 
         if (typeid(testMatrix) == typeid(SquareMatrix<T, S>))
         {
-            auto testSquareMatrix = static_cast<SquareMatrix<T, S> &>(testMatrix);
+            auto &testSquareMatrix = static_cast<SquareMatrix<T, S> &>(testMatrix);
 
             testSquareMatrix.compress_mod();
 
@@ -451,13 +476,13 @@ namespace algebra
             res1 = testSquareMatrix * testSquareMatrix;
             stop = MyClock::now();
             auto time_span_mu = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (compressed_format_matrix_matrix_product_mus)"] = time_span_mu.count();
+            time_info[key + " (compressed_format_matrix_matrix_product_mus)"] = time_span_mu.count();
 
             start = MyClock::now();
             res3 = testSquareMatrix * vec;
             stop = MyClock::now();
             auto time_span_n = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (compressed_format_matrix_vector_product_ns)"] = time_span_n.count();
+            time_info[key + " (compressed_format_matrix_vector_product_ns)"] = time_span_n.count();
 
             testSquareMatrix.uncompress();
 
@@ -465,17 +490,17 @@ namespace algebra
             res2 = testSquareMatrix * testSquareMatrix;
             stop = MyClock::now();
             auto time_span_mu_uncompressed = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (uncompressed_format_matrix_matrix_product_mus)"] = time_span_mu_uncompressed.count();
+            time_info[key + " (uncompressed_format_matrix_matrix_product_mus)"] = time_span_mu_uncompressed.count();
 
             start = MyClock::now();
             res4 = testSquareMatrix * vec;
             stop = MyClock::now();
             auto time_span_n_uncompressed = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (uncompressed_format_matrix_vector_product_ns)"] = time_span_n_uncompressed.count();
+            time_info[key + " (uncompressed_format_matrix_vector_product_ns)"] = time_span_n_uncompressed.count();
         }
         else if (typeid(testMatrix) == typeid(TransposeView<T, S>))
         {
-            auto testTransposeView = static_cast<TransposeView<T, S> &>(testMatrix);
+            auto &testTransposeView = static_cast<TransposeView<T, S> &>(testMatrix);
 
             testTransposeView.compress();
 
@@ -483,13 +508,13 @@ namespace algebra
             res1 = testTransposeView * testTransposeView;
             stop = MyClock::now();
             auto time_span_mu = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (compressed_format_matrix_matrix_product_mus)"] = time_span_mu.count();
+            time_info[key + " (compressed_format_matrix_matrix_product_mus)"] = time_span_mu.count();
 
             start = MyClock::now();
             res3 = testTransposeView * vec;
             stop = MyClock::now();
             auto time_span_n = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (compressed_format_matrix_vector_product_ns)"] = time_span_n.count();
+            time_info[key + " (compressed_format_matrix_vector_product_ns)"] = time_span_n.count();
 
             testTransposeView.uncompress();
 
@@ -497,17 +522,17 @@ namespace algebra
             res2 = testTransposeView * testTransposeView;
             stop = MyClock::now();
             auto time_span_mu_uncompressed = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (uncompressed_format_matrix_matrix_product_mus)"] = time_span_mu_uncompressed.count();
+            time_info[key + " (uncompressed_format_matrix_matrix_product_mus)"] = time_span_mu_uncompressed.count();
 
             start = MyClock::now();
             res4 = testTransposeView * vec;
             stop = MyClock::now();
             auto time_span_n_uncompressed = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (uncompressed_format_matrix_vector_product_ns)"] = time_span_n_uncompressed.count();
+            time_info[key + " (uncompressed_format_matrix_vector_product_ns)"] = time_span_n_uncompressed.count();
         }
         else if (typeid(testMatrix) == typeid(DiagonalView<T, S>))
         {
-            auto testDiagonalView = static_cast<DiagonalView<T, S> &>(testMatrix);
+            auto &testDiagonalView = static_cast<DiagonalView<T, S> &>(testMatrix);
 
             testDiagonalView.compress();
 
@@ -515,13 +540,13 @@ namespace algebra
             res1 = testDiagonalView * testDiagonalView;
             stop = MyClock::now();
             auto time_span_mu = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (compressed_format_matrix_matrix_product_mus)"] = time_span_mu.count();
+            time_info[key + " (compressed_format_matrix_matrix_product_mus)"] = time_span_mu.count();
 
             start = MyClock::now();
             res3 = testDiagonalView * vec;
             stop = MyClock::now();
             auto time_span_n = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (compressed_format_matrix_vector_product_ns)"] = time_span_n.count();
+            time_info[key + " (compressed_format_matrix_vector_product_ns)"] = time_span_n.count();
 
             testDiagonalView.uncompress();
 
@@ -529,13 +554,13 @@ namespace algebra
             res2 = testDiagonalView * testDiagonalView;
             stop = MyClock::now();
             auto time_span_mu_uncompressed = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (uncompressed_format_matrix_matrix_product_mus)"] = time_span_mu_uncompressed.count();
+            time_info[key + " (uncompressed_format_matrix_matrix_product_mus)"] = time_span_mu_uncompressed.count();
 
             start = MyClock::now();
             res4 = testDiagonalView * vec;
             stop = MyClock::now();
             auto time_span_n_uncompressed = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (uncompressed_format_matrix_vector_product_ns)"] = time_span_n_uncompressed.count();
+            time_info[key + " (uncompressed_format_matrix_vector_product_ns)"] = time_span_n_uncompressed.count();
         }
         else
         {
@@ -551,13 +576,13 @@ namespace algebra
             res1 = (*dynamicMatrix) * (*dynamicMatrix);
             stop = MyClock::now();
             auto time_span_mu = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (compressed_format_matrix_matrix_product_mus)"] = time_span_mu.count();
+            time_info[key + " (compressed_format_matrix_matrix_product_mus)"] = time_span_mu.count();
 
             start = MyClock::now();
             res3 = (*dynamicMatrix) * vec;
             stop = MyClock::now();
             auto time_span_n = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (compressed_format_matrix_vector_product_ns)"] = time_span_n.count();
+            time_info[key + " (compressed_format_matrix_vector_product_ns)"] = time_span_n.count();
 
             dynamicMatrix->uncompress();
 
@@ -565,13 +590,13 @@ namespace algebra
             res2 = (*dynamicMatrix) * (*dynamicMatrix);
             stop = MyClock::now();
             auto time_span_mu_uncompressed = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (uncompressed_format_matrix_matrix_product_mus)"] = time_span_mu_uncompressed.count();
+            time_info[key + " (uncompressed_format_matrix_matrix_product_mus)"] = time_span_mu_uncompressed.count();
 
             start = MyClock::now();
             res4 = (*dynamicMatrix) * vec;
             stop = MyClock::now();
             auto time_span_n_uncompressed = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start);
-            time_info[matrix_name + " " + typeid(testMatrix).name() + " (uncompressed_format_matrix_vector_product_ns)"] = time_span_n_uncompressed.count();
+            time_info[key + " (uncompressed_format_matrix_vector_product_ns)"] = time_span_n_uncompressed.count();
         }
 
         // save json
@@ -580,8 +605,8 @@ namespace algebra
         // Print execution times and speedups
         std::cout << std::endl;
 
-        int compressed_matrix_vector_time = time_info[matrix_name + " " + typeid(testMatrix).name() + " (compressed_format_matrix_vector_product_ns)"];
-        int uncompressed_matrix_vector_time = time_info[matrix_name + " " + typeid(testMatrix).name() + " (uncompressed_format_matrix_vector_product_ns)"];
+        int compressed_matrix_vector_time = time_info[key + " (compressed_format_matrix_vector_product_ns)"];
+        int uncompressed_matrix_vector_time = time_info[key + " (uncompressed_format_matrix_vector_product_ns)"];
 
         std::cout << "Compressed format matrix-vector product time: " << compressed_matrix_vector_time << " ns" << std::endl;
         std::cout << "Uncompressed format matrix-vector product time: " << uncompressed_matrix_vector_time << " ns" << std::endl;
@@ -590,8 +615,8 @@ namespace algebra
 
         std::cout << std::endl;
 
-        int compressed_matrix_matrix_time = time_info[matrix_name + " " + typeid(testMatrix).name() + " (compressed_format_matrix_matrix_product_mus)"];
-        int uncompressed_matrix_matrix_time = time_info[matrix_name + " " + typeid(testMatrix).name() + " (uncompressed_format_matrix_matrix_product_mus)"];
+        int compressed_matrix_matrix_time = time_info[key + " (compressed_format_matrix_matrix_product_mus)"];
+        int uncompressed_matrix_matrix_time = time_info[key + " (uncompressed_format_matrix_matrix_product_mus)"];
 
         std::cout << "Compressed format matrix-matrix product time: " << compressed_matrix_matrix_time << " µs" << std::endl;
         std::cout << "Uncompressed format matrix-matrix product time: " << uncompressed_matrix_matrix_time << " µs" << std::endl;
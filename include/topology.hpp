@@ -0,0 +1,264 @@
+/**
+ * @file topology.hpp
+ * @brief Defines the detection of the NUMA topology of the machine and the pinning of the TBB worker threads.
+ *
+ * This header provides:
+ * - algebra::CpuTopology, the CPUs available to the process grouped by NUMA node (read from
+ *   `/sys/devices/system/node`), with the orders in which the threads are placed by each policy;
+ * - algebra::Pinning, the thread placement policies: None (the scheduler of the operating system decides),
+ *   Compact (fill a NUMA node before moving to the next one) and Scatter (round robin over the NUMA nodes);
+ * - algebra::PinningObserver, a `tbb::task_scheduler_observer` that pins every thread entering the task
+ *   arena to a CPU according to a policy.
+ *
+ * On a 2-socket machine the Compact policy keeps the threads (and the memory they touch first) on one
+ * socket as long as possible, while the Scatter policy spreads them to use the memory bandwidth of both.
+ *
+ * @note Pinning is implemented with `sched_setaffinity` and is available only on Linux; on the other
+ *       systems every policy behaves as Pinning::None.
+ *
+ * @see bench/scaling.cpp
+ */
+#ifndef TOPOLOGY_HPP
+#define TOPOLOGY_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <stdexcept>
+
+#include <tbb/task_scheduler_observer.h>
+#include <tbb/task_arena.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace algebra
+{
+    /**
+     * @brief Enum class to specify the placement of the threads on the CPUs.
+     */
+    enum class Pinning
+    {
+        None,    /// threads are not pinned
+        Compact, /// consecutive threads on the CPUs of the same NUMA node
+        Scatter  /// consecutive threads on CPUs of different NUMA nodes
+    };
+
+    /// @brief name of a pinning policy
+    /// @param pinning pinning policy
+    /// @return name of the policy
+    inline std::string pinning_name(Pinning pinning)
+    {
+        switch (pinning)
+        {
+        case Pinning::Compact:
+            return "compact";
+        case Pinning::Scatter:
+            return "scatter";
+        default:
+            return "none";
+        }
+    }
+
+    /**
+     * @brief CPUs available to the process, grouped by NUMA node.
+     */
+    struct CpuTopology
+    {
+        std::vector<std::vector<int>> nodes; /// CPUs of every NUMA node (only the nodes with available CPUs)
+
+        /// @brief parse a list of CPUs in the format of the kernel (e.g. "0-3,8,10-11")
+        /// @param list list of CPUs
+        /// @return CPU numbers in ascending order
+        static std::vector<int> parse_cpulist(const std::string &list)
+        {
+            std::vector<int> cpus;
+            std::stringstream stream(list);
+            std::string range;
+            while (std::getline(stream, range, ','))
+            {
+                if (range.find_first_of("0123456789") == std::string::npos)
+                {
+                    continue;
+                }
+                const size_t dash = range.find('-');
+                const int first = std::stoi(range.substr(0, dash));
+                const int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; cpu++)
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+            return cpus;
+        }
+
+        /// @brief detect the topology of the machine
+        /// @return the CPUs available to the process grouped by NUMA node (a single node if the NUMA topology is unknown)
+        static CpuTopology detect()
+        {
+            std::vector<int> available;
+#ifdef __linux__
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+            {
+                for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+                {
+                    if (CPU_ISSET(cpu, &mask))
+                    {
+                        available.push_back(cpu);
+                    }
+                }
+            }
+#endif
+            if (available.empty())
+            {
+                for (int cpu = 0; cpu < tbb::this_task_arena::max_concurrency(); cpu++)
+                {
+                    available.push_back(cpu);
+                }
+            }
+
+            CpuTopology topology;
+            const std::filesystem::path root("/sys/devices/system/node");
+            std::vector<std::pair<int, std::filesystem::path>> node_dirs;
+            std::error_code error;
+            for (const auto &entry : std::filesystem::directory_iterator(root, error))
+            {
+                const std::string name = entry.path().filename().string();
+                if (name.rfind("node", 0) == 0 and name.size() > 4 and
+                    name.find_first_not_of("0123456789", 4) == std::string::npos)
+                {
+                    node_dirs.emplace_back(std::stoi(name.substr(4)), entry.path());
+                }
+            }
+            std::sort(node_dirs.begin(), node_dirs.end());
+            for (const auto &[id, dir] : node_dirs)
+            {
+                std::ifstream file(dir / "cpulist");
+                std::string list;
+                std::getline(file, list);
+                std::vector<int> cpus;
+                for (const auto &cpu : parse_cpulist(list))
+                {
+                    if (std::binary_search(available.begin(), available.end(), cpu))
+                    {
+                        cpus.push_back(cpu);
+                    }
+                }
+                if (not cpus.empty())
+                {
+                    topology.nodes.push_back(std::move(cpus));
+                }
+            }
+            if (topology.nodes.empty())
+            {
+                topology.nodes.push_back(available);
+            }
+            return topology;
+        }
+
+        /// @brief get the number of available CPUs
+        /// @return number of CPUs over all the NUMA nodes
+        size_t size() const
+        {
+            size_t count = 0;
+            for (const auto &node : nodes)
+            {
+                count += node.size();
+            }
+            return count;
+        }
+
+        /// @brief order in which the threads are placed on the CPUs
+        /// @param pinning pinning policy (Compact or Scatter)
+        /// @return the CPU of the i-th thread at position i
+        std::vector<int> placement(Pinning pinning) const
+        {
+            std::vector<int> order;
+            if (pinning == Pinning::Scatter)
+            {
+                // round robin over the NUMA nodes
+                for (size_t i = 0; order.size() < size(); i++)
+                {
+                    for (const auto &node : nodes)
+                    {
+                        if (i < node.size())
+                        {
+                            order.push_back(node[i]);
+                        }
+                    }
+                }
+            }
+            else
+            {
+                for (const auto &node : nodes)
+                {
+                    order.insert(order.end(), node.begin(), node.end());
+                }
+            }
+            return order;
+        }
+    };
+
+    /**
+     * @brief Pins the threads of the current task arena according to a policy while it is alive.
+     *
+     * The i-th thread of the arena (as numbered by `tbb::this_task_arena::current_thread_index`) is pinned to
+     * the i-th CPU of CpuTopology::placement. With Pinning::None the threads get back the affinity of the
+     * whole set of available CPUs, which undoes the pinning of a previous observer.
+     */
+    class PinningObserver : public tbb::task_scheduler_observer
+    {
+    public:
+        /// @brief constructor, starts observing the current task arena
+        /// @param topology topology of the machine
+        /// @param pinning pinning policy
+        PinningObserver(const CpuTopology &topology, Pinning pinning)
+            : pinning(pinning), cpus(topology.placement(pinning))
+        {
+            observe(true);
+        };
+
+        /// @brief destructor, stops observing
+        ~PinningObserver() { observe(false); };
+
+        /// @brief pin a thread entering the arena
+        /// @param worker true for a worker thread, false for the main thread
+        void on_scheduler_entry(bool worker) override
+        {
+            (void)worker;
+#ifdef __linux__
+            if (cpus.empty())
+            {
+                return;
+            }
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            if (pinning == Pinning::None)
+            {
+                for (const auto &cpu : cpus)
+                {
+                    CPU_SET(cpu, &mask);
+                }
+            }
+            else
+            {
+                const int index = tbb::this_task_arena::current_thread_index();
+                CPU_SET(cpus[static_cast<size_t>(index < 0 ? 0 : index) % cpus.size()], &mask);
+            }
+            sched_setaffinity(0, sizeof(mask), &mask);
+#endif
+        }
+
+    private:
+        Pinning pinning;       /// pinning policy
+        std::vector<int> cpus; /// CPU of every thread index
+    };
+}
+
+#endif // TOPOLOGY_HPP
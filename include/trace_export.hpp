@@ -0,0 +1,72 @@
+/**
+ * @file trace_export.hpp
+ * @brief Defines the export of the spans recorded by algebra::Tracer in the Chrome trace event format.
+ *
+ * The exported JSON can be opened with `chrome://tracing` or with the Perfetto UI (https://ui.perfetto.dev),
+ * which show the spans of every thread on a timeline. Every span is a complete event ("ph": "X") with
+ * times in microseconds, and every thread is named through a metadata event:
+ * @code{.json}
+ * {
+ *     "displayTimeUnit": "ns",
+ *     "traceEvents": [
+ *         { "name": "thread_name", "ph": "M", "pid": 1234, "tid": 0, "args": { "name": "thread 0" } },
+ *         { "name": "spmv CSR Parallel", "cat": "algebra", "ph": "X", "ts": 12.345, "dur": 6.789, "pid": 1234, "tid": 0 }
+ *     ]
+ * }
+ * @endcode
+ *
+ * @see tracing.hpp
+ * @see json_utility.hpp
+ */
+#ifndef TRACE_EXPORT_HPP
+#define TRACE_EXPORT_HPP
+
+#include "tracing.hpp"
+#include "json_utility.hpp"
+
+#include <string>
+
+#include <unistd.h>
+
+namespace algebra
+{
+    /// @brief convert the spans recorded by the tracer to the Chrome trace event format
+    /// @param tracer tracer whose spans are exported
+    /// @return JSON object with the "traceEvents" array
+    inline json_utility::json chrome_trace(const Tracer &tracer = Tracer::instance())
+    {
+        using json = json_utility::json;
+        const auto pid = static_cast<long>(getpid());
+
+        json events = json::array();
+        for (size_t thread = 0; thread < tracer.threads(); thread++)
+        {
+            events.push_back({{"name", "thread_name"},
+                              {"ph", "M"},
+                              {"pid", pid},
+                              {"tid", thread},
+                              {"args", {{"name", "thread " + std::to_string(thread)}}}});
+        }
+        for (const auto &event : tracer.events())
+        {
+            events.push_back({{"name", event.name},
+                              {"cat", "algebra"},
+                              {"ph", "X"},
+                              {"ts", event.start_ns * 1e-3},
+                              {"dur", event.duration_ns * 1e-3},
+                              {"pid", pid},
+                              {"tid", event.thread}});
+        }
+        return {{"displayTimeUnit", "ns"}, {"traceEvents", events}};
+    }
+
+    /// @brief save the spans recorded by the tracer in the Chrome trace event format
+    /// @param filename output JSON file
+    /// @param tracer tracer whose spans are exported
+    inline void save_chrome_trace(const std::string &filename, const Tracer &tracer = Tracer::instance())
+    {
+        json_utility::save_json(filename, chrome_trace(tracer));
+    }
+}
+
+#endif // TRACE_EXPORT_HPP
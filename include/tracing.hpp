@@ -0,0 +1,263 @@
+/**
+ * @file tracing.hpp
+ * @brief Defines the opt-in tracing of the operations of the library with thread-local ring buffers.
+ *
+ * The readers, the conversions between formats and the products are instrumented with the
+ * ALGEBRA_TRACE macro. When the library is compiled with `-DALGEBRA_ENABLE_TRACING`, every instrumented
+ * call records a span (name, start time, duration) in a ring buffer owned by the calling thread, while
+ * tracing is enabled at run time through algebra::Tracer:
+ * @code{.cpp}
+ * Tracer::instance().enable();
+ * m.reader("data/lnsp_131.mtx");
+ * m.compress();
+ * auto v = m * x;
+ * Tracer::instance().disable();
+ * save_chrome_trace("trace.json"); // see trace_export.hpp
+ * @endcode
+ * Otherwise the macro expands to nothing, and the instrumentation has no overhead at all. While tracing
+ * is compiled in but disabled, every instrumented call costs a relaxed atomic load.
+ *
+ * Every ring buffer keeps the most recent spans of its thread (algebra::Tracer::set_capacity), so that
+ * tracing can stay enabled for a long time with bounded memory. The spans of all the threads are
+ * collected on demand by algebra::Tracer::events, and can be exported in the Chrome trace event format
+ * (readable by `chrome://tracing` and by Perfetto) with trace_export.hpp.
+ *
+ * @see trace_export.hpp
+ */
+#ifndef TRACING_HPP
+#define TRACING_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+#ifdef ALGEBRA_ENABLE_TRACING
+#define ALGEBRA_TRACE_CONCAT_IMPL(a, b) a##b
+#define ALGEBRA_TRACE_CONCAT(a, b) ALGEBRA_TRACE_CONCAT_IMPL(a, b)
+/// @brief record the enclosing scope as a span with the given name (evaluated only if tracing is enabled)
+#define ALGEBRA_TRACE(name) const ::algebra::TraceScope ALGEBRA_TRACE_CONCAT(algebra_trace_scope_, __LINE__)([&]() { return std::string(name); })
+#else
+/// @brief record the enclosing scope as a span with the given name (disabled)
+#define ALGEBRA_TRACE(name)
+#endif
+
+namespace algebra
+{
+    /**
+     * @brief Span of an operation executed by a thread.
+     */
+    struct TraceEvent
+    {
+        std::string name;         /// name of the operation
+        uint64_t start_ns = 0;    /// start time, from the creation of the tracer
+        uint64_t duration_ns = 0; /// duration
+        size_t thread = 0;        /// identifier of the thread (in order of registration)
+    };
+
+    /**
+     * @brief Ring buffer of the most recent spans of a thread.
+     */
+    class TraceBuffer
+    {
+    public:
+        /// @brief constructor
+        /// @param capacity maximum number of spans kept
+        /// @param thread identifier of the thread owning the buffer
+        TraceBuffer(size_t capacity, size_t thread) : events(capacity), thread(thread) {};
+
+        /// @brief record a span, overwriting the oldest one if the buffer is full
+        /// @param name name of the operation
+        /// @param start_ns start time
+        /// @param duration_ns duration
+        void push(std::string &&name, uint64_t start_ns, uint64_t duration_ns)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (events.empty())
+            {
+                return;
+            }
+            auto &event = events[next];
+            event.name = std::move(name);
+            event.start_ns = start_ns;
+            event.duration_ns = duration_ns;
+            event.thread = thread;
+            next = (next + 1) % events.size();
+            size = std::min(size + 1, events.size());
+        }
+
+        /// @brief copy the spans in the buffer
+        /// @param output vector where the spans are appended, from the oldest to the newest
+        void collect(std::vector<TraceEvent> &output) const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const size_t first = (next + events.size() - size) % std::max<size_t>(events.size(), 1);
+            for (size_t i = 0; i < size; i++)
+            {
+                output.push_back(events[(first + i) % events.size()]);
+            }
+        }
+
+        /// @brief discard all the spans
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            next = 0;
+            size = 0;
+        }
+
+    private:
+        mutable std::mutex mutex;       /// protects the buffer from a concurrent collection
+        std::vector<TraceEvent> events; /// storage of the ring buffer
+        size_t next = 0;                /// position of the next span
+        size_t size = 0;                /// number of spans in the buffer
+        size_t thread;                  /// identifier of the thread owning the buffer
+    };
+
+    /**
+     * @brief Registry of the trace buffers of all the threads.
+     *
+     * The tracer is a process-wide singleton, created the first time it is used. Tracing is disabled
+     * until algebra::Tracer::enable is called.
+     */
+    class Tracer
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /// @brief get the tracer
+        /// @return reference to the tracer of the process
+        static Tracer &instance()
+        {
+            static Tracer tracer;
+            return tracer;
+        }
+
+        /// @brief start recording spans
+        void enable() { on.store(true, std::memory_order_relaxed); };
+
+        /// @brief stop recording spans (the recorded ones are kept)
+        void disable() { on.store(false, std::memory_order_relaxed); };
+
+        /// @brief check if spans are being recorded
+        /// @return true if tracing is enabled
+        bool enabled() const { return on.load(std::memory_order_relaxed); };
+
+        /// @brief set the number of spans kept by the buffers of the threads registered from now on
+        /// @param capacity maximum number of spans per thread
+        void set_capacity(size_t capacity)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->capacity = capacity;
+        }
+
+        /// @brief get the buffer of the calling thread, creating it the first time
+        /// @return reference to the buffer of the calling thread
+        TraceBuffer &local_buffer()
+        {
+            thread_local std::shared_ptr<TraceBuffer> buffer = [this]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                buffers.push_back(std::make_shared<TraceBuffer>(capacity, buffers.size()));
+                return buffers.back();
+            }();
+            return *buffer;
+        }
+
+        /// @brief nanoseconds elapsed since the creation of the tracer
+        /// @return the current time of the trace
+        uint64_t now() const
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count());
+        }
+
+        /// @brief collect the spans of all the threads
+        /// @return the spans in the buffers, grouped by thread and from the oldest to the newest
+        std::vector<TraceEvent> events() const
+        {
+            std::vector<TraceEvent> output;
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto &buffer : buffers)
+            {
+                buffer->collect(output);
+            }
+            return output;
+        }
+
+        /// @brief get the number of threads that recorded at least one span
+        /// @return number of registered threads
+        size_t threads() const
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return buffers.size();
+        }
+
+        /// @brief discard the spans of all the threads
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto &buffer : buffers)
+            {
+                buffer->clear();
+            }
+        }
+
+    private:
+        std::atomic<bool> on = false;                      /// true if spans are being recorded
+        const Clock::time_point epoch = Clock::now();      /// origin of the time of the spans
+        mutable std::mutex mutex;                          /// protects the registry of the buffers
+        std::vector<std::shared_ptr<TraceBuffer>> buffers; /// buffers of all the threads
+        size_t capacity = size_t(1) << 16;                 /// number of spans kept by every new buffer
+
+        /// @brief default constructor
+        Tracer() = default;
+    };
+
+    /**
+     * @brief Records its lifetime as a span of the calling thread, if tracing is enabled (see ALGEBRA_TRACE).
+     */
+    class TraceScope
+    {
+    public:
+        /// @brief constructor, reads the start time if tracing is enabled
+        /// @tparam Name type of the callable returning the name of the span
+        /// @param name callable returning the name of the span (called only if tracing is enabled)
+        template <typename Name>
+        explicit TraceScope(Name &&name)
+        {
+            auto &tracer = Tracer::instance();
+            if (tracer.enabled())
+            {
+                active = true;
+                this->name = name();
+                start_ns = tracer.now();
+            }
+        };
+
+        /// @brief destructor, records the span
+        ~TraceScope()
+        {
+            if (active)
+            {
+                auto &tracer = Tracer::instance();
+                const uint64_t stop_ns = tracer.now();
+                tracer.local_buffer().push(std::move(name), start_ns, stop_ns - start_ns);
+            }
+        };
+
+        TraceScope(const TraceScope &) = delete;
+        TraceScope &operator=(const TraceScope &) = delete;
+
+    private:
+        bool active = false;   /// true if the span is recorded
+        std::string name;      /// name of the span
+        uint64_t start_ns = 0; /// start time of the span
+    };
+}
+
+#endif // TRACING_HPP
@@ -0,0 +1,238 @@
+/**
+ * @file tuning_cache.hpp
+ * @brief Defines a persistent on-disk cache of the decisions taken by the AutoTuner.
+ *
+ * Tuning a matrix costs a few benchmark runs per candidate representation, which adds up to seconds when
+ * many operators are loaded at startup. The algebra::TuningCache class stores every decision in a local
+ * JSON file (through json_utility.hpp), so that later runs on the same machine reuse it instantly.
+ *
+ * The decisions are grouped by machine (CPU model and number of threads) and by matrix type (value type
+ * and storage order), and are looked up:
+ * 1) by fingerprint, i.e. for a matrix with exactly the same sparsity pattern;
+ * 2) by pattern class, i.e. for a matrix with similar features (size, row length, bandwidth, symmetry
+ *    and block structure, bucketed on a logarithmic scale).
+ *
+ * The file has the following layout:
+ * @code{.json}
+ * {
+ *     "version": 1,
+ *     "machines": {
+ *         "<cpu model> (<threads> threads)": {
+ *             "<value type> <storage order>": {
+ *                 "fingerprints": { "<hex fingerprint>": { "format": "...", "kernel": "...", "spmv_time_ns": ... } },
+ *                 "classes": { "<pattern class>": { "format": "...", "kernel": "...", "spmv_time_ns": ... } }
+ *             }
+ *         }
+ *     }
+ * }
+ * @endcode
+ *
+ * @see auto_tuner.hpp
+ * @see json_utility.hpp
+ */
+#ifndef TUNING_CACHE_HPP
+#define TUNING_CACHE_HPP
+
+#include "storage.hpp"
+#include "matrix.hpp"
+#include "pattern_analyzer.hpp"
+#include "auto_tuner.hpp"
+#include "json_utility.hpp"
+
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <optional>
+#include <cmath>
+
+#include <tbb/task_arena.h>
+
+namespace algebra
+{
+    // (de)serialization of the enums stored in the cache
+    NLOHMANN_JSON_SERIALIZE_ENUM(CompressedFormat, {{CompressedFormat::Compressed, "Compressed"},
+                                                    {CompressedFormat::ModifiedCompressed, "ModifiedCompressed"}})
+    NLOHMANN_JSON_SERIALIZE_ENUM(Kernel, {{Kernel::Serial, "Serial"},
+                                          {Kernel::Parallel, "Parallel"}})
+
+    /**
+     * @brief Persistent cache of the representations chosen by the AutoTuner.
+     *
+     * The cache file is read once at construction (a missing or unreadable file yields an empty cache)
+     * and rewritten every time a new decision is stored.
+     */
+    class TuningCache
+    {
+    public:
+        using json = json_utility::json;
+
+        /// @brief constructor
+        /// @param filename path of the JSON file backing the cache
+        explicit TuningCache(const std::string &filename = "data/tuning_cache.json") : filename(filename)
+        {
+            try
+            {
+                cache = json_utility::read_json(filename);
+            }
+            catch (const std::exception &)
+            {
+                cache = json::object();
+            }
+            if (not cache.is_object() or cache.value("version", 0) != version)
+            {
+                cache = {{"version", version}, {"machines", json::object()}};
+            }
+        };
+
+        /// @brief look up the decision for a matrix
+        /// @tparam T type of the matrix elements
+        /// @tparam S storage order of the matrix
+        /// @param pattern sparsity pattern of the matrix
+        /// @return the cached decision, first by fingerprint and then by pattern class, if any
+        template <AddMulType T, StorageOrder S>
+        std::optional<TuningDecision> find(const SparsityPattern &pattern) const
+        {
+            const json::json_pointer entry_ptr = entry_pointer<T, S>();
+            if (not cache.contains(entry_ptr))
+            {
+                return std::nullopt;
+            }
+            const auto &entry = cache.at(entry_ptr);
+            for (const auto &[group, key] : {std::pair{"fingerprints", fingerprint_key(pattern)},
+                                             std::pair{"classes", class_key(pattern)}})
+            {
+                if (entry.contains(group) and entry.at(group).contains(key))
+                {
+                    const auto &record = entry.at(group).at(key);
+                    TuningDecision decision;
+                    decision.format = record.at("format").template get<CompressedFormat>();
+                    decision.kernel = record.at("kernel").template get<Kernel>();
+                    decision.pattern = pattern;
+                    return decision;
+                }
+            }
+            return std::nullopt;
+        }
+
+        /// @brief store a decision and save the cache file
+        /// @tparam T type of the matrix elements
+        /// @tparam S storage order of the matrix
+        /// @param decision decision taken by the tuner (with the pattern of the tuned matrix)
+        template <AddMulType T, StorageOrder S>
+        void store(const TuningDecision &decision)
+        {
+            double time = 0;
+            for (const auto &candidate : decision.candidates)
+            {
+                if (candidate.format == decision.format and candidate.kernel == decision.kernel)
+                {
+                    time = candidate.spmv_time_ns;
+                }
+            }
+            const json record = {{"format", decision.format}, {"kernel", decision.kernel}, {"spmv_time_ns", time}};
+
+            auto &entry = cache[entry_pointer<T, S>()];
+            entry["fingerprints"][fingerprint_key(decision.pattern)] = record;
+            entry["classes"][class_key(decision.pattern)] = record;
+            json_utility::save_json(filename, cache);
+        }
+
+        /// @brief remove all the decisions and save the (empty) cache file
+        void clear()
+        {
+            cache["machines"] = json::object();
+            json_utility::save_json(filename, cache);
+        }
+
+        /// @brief identify the machine the library is running on
+        /// @return CPU model and number of threads available to the current task arena
+        static std::string machine_key()
+        {
+            static const std::string cpu_model = []()
+            {
+                std::ifstream cpuinfo("/proc/cpuinfo");
+                std::string line;
+                while (std::getline(cpuinfo, line))
+                {
+                    if (line.rfind("model name", 0) == 0 and line.find(':') != std::string::npos)
+                    {
+                        return line.substr(line.find(':') + 2);
+                    }
+                }
+                return std::string("unknown cpu");
+            }();
+            return cpu_model + " (" + std::to_string(tbb::this_task_arena::max_concurrency()) + " threads)";
+        }
+
+    private:
+        static constexpr int version = 1; /// version of the layout of the cache file
+
+        std::string filename; /// path of the JSON file backing the cache
+        json cache;           /// content of the cache
+
+        /// @brief position of the decisions of a matrix type for the current machine
+        /// @tparam T type of the matrix elements
+        /// @tparam S storage order of the matrix
+        /// @return JSON pointer to the entry
+        template <AddMulType T, StorageOrder S>
+        static json::json_pointer entry_pointer()
+        {
+            std::string type = (is_complex<T>::value ? "complex" : "real") + std::to_string(8 * sizeof(T));
+            type += (S == StorageOrder::ColumnMajor) ? " ColumnMajor" : " RowMajor";
+            return json::json_pointer("/machines") / machine_key() / type;
+        }
+
+        /// @brief key of a matrix with exactly the given pattern
+        /// @param pattern sparsity pattern of the matrix
+        /// @return the hexadecimal fingerprint of the pattern
+        static std::string fingerprint_key(const SparsityPattern &pattern)
+        {
+            std::ostringstream key;
+            key << std::hex << pattern.fingerprint;
+            return key.str();
+        }
+
+        /// @brief key of the matrices with features similar to the given pattern
+        /// @param pattern sparsity pattern of the matrix
+        /// @return the bucketed features of the pattern
+        static std::string class_key(const SparsityPattern &pattern)
+        {
+            auto log2_bucket = [](double x)
+            { return static_cast<int>(std::floor(std::log2(x + 1))); };
+            const double relative_bandwidth = pattern.rows > 0 ? static_cast<double>(pattern.bandwidth) / pattern.rows : 0;
+
+            std::ostringstream key;
+            key << "rows~2^" << log2_bucket(pattern.rows)
+                << " len~2^" << log2_bucket(pattern.mean_row_length)
+                << " bw~" << static_cast<int>(std::ceil(10 * relative_bandwidth)) << "/10"
+                << (pattern.rows == pattern.cols ? " square" : " rectangular")
+                << (pattern.structurally_symmetric ? " symmetric" : "")
+                << " block" << pattern.block_size;
+            return key.str();
+        }
+    };
+
+    /// @brief compress a matrix in the representation cached for it, tuning it on a cache miss
+    /// @tparam T type of the matrix elements
+    /// @tparam S storage order of the matrix
+    /// @param m matrix to compress
+    /// @param cache cache of the decisions (updated on a miss)
+    /// @param tuner tuner used on a cache miss
+    /// @return the decision applied to the matrix
+    template <AddMulType T, StorageOrder S>
+    TuningDecision compress_auto(Matrix<T, S> &m, TuningCache &cache, const AutoTuner &tuner = AutoTuner())
+    {
+        m.compress(CompressedFormat::Compressed);
+        auto decision = cache.find<T, S>(analyze_pattern(m));
+        if (not decision)
+        {
+            decision = tuner.tune(m);
+            cache.store<T, S>(*decision);
+        }
+        m.compress(decision->format);
+        m.set_kernel(decision->kernel);
+        return *decision;
+    }
+}
+
+#endif // TUNING_CACHE_HPP
@@ -0,0 +1,367 @@
+/**
+ * @file workflow.hpp
+ * @brief Defines the workflows: graphs of operations on matrices and vectors, scheduled with `tbb::flow`.
+ *
+ * An algebra::Workflow describes a computation made of several operations as a directed acyclic graph:
+ * every operation is a node of a `tbb::flow::graph`, whose inputs are the results of other nodes (or
+ * values given with input()). When the workflow runs, every node starts as soon as all its inputs are
+ * available, so that the independent branches run concurrently on the TBB worker threads:
+ * @code{.cpp}
+ * Workflow workflow; // m1, m2: SquareMatrix<double, StorageOrder::RowMajor>, v: std::vector<double>
+ * auto a = workflow.input(std::move(m1));
+ * auto b = workflow.input(std::move(m2));
+ * auto x = workflow.input(std::move(v));
+ * auto c = workflow.multiply(a, b);           // C = A * B
+ * auto y = workflow.multiply(c, x);           // y = C * x
+ * auto z = workflow.transpose_multiply(a, y); // z = A^T * y
+ * auto f = workflow.norm<NormType::Frobenius>(a); // concurrent with the products
+ * workflow.run();
+ * std::cout << z.get()[0] << ' ' << f.get() << std::endl;
+ * @endcode
+ *
+ * Any other function becomes a node with add(): its arguments are the results of the input nodes, as
+ * const references. The results are held by the workflow, and the result of an operation is released as
+ * soon as its last consumer completes, so that the memory of the intermediate values (C in the example)
+ * is reused by the following operations. The results without consumers, and the ones marked with
+ * Node::keep(), are kept until the workflow is destroyed.
+ *
+ * The first exception thrown by an operation is rethrown by run(), after all the other operations have
+ * completed: the operations that depend on it, directly or through other operations, are skipped and
+ * their results are not available, while the independent branches run to the end. The nodes run in the
+ * execution context given to the constructor, if any (see execution_context.hpp).
+ *
+ * @note The operations of the same node run concurrently with the other nodes that read the same inputs:
+ *       the functions must not modify their arguments.
+ * @note The graph must not be modified while run() is in progress. It can run again after the end: the
+ *       inputs are kept and the operations are computed again.
+ *
+ * @see async.hpp
+ * @see execution_context.hpp
+ */
+#ifndef WORKFLOW_HPP
+#define WORKFLOW_HPP
+
+#include "matrix_views.hpp"
+#include "execution_context.hpp"
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <type_traits>
+
+#include <tbb/flow_graph.h>
+
+namespace algebra
+{
+    /**
+     * @brief Result of an operation of a workflow, shared by the node and its consumers.
+     */
+    struct WorkflowSlot
+    {
+        std::atomic<size_t> pending = 0;  /// consumers that have not completed yet in the current run
+        std::atomic<bool> failed = false; /// true if the operation, or one it depends on, has thrown in the current run
+        size_t consumers = 0;             /// operations that read the result
+        bool operation = false;           /// true for the results of the operations, false for the inputs
+        bool kept = false;                /// true if the result is kept after its last consumer
+
+        virtual ~WorkflowSlot() = default;
+
+        /// @brief release the result
+        virtual void release() = 0;
+    };
+
+    /**
+     * @brief Handle to a value of a workflow: an input, or the result of an operation.
+     *
+     * @tparam T type of the value
+     */
+    template <typename T>
+    class Node
+    {
+    public:
+        using value_type = T;
+
+        /// @brief check if the value is available
+        /// @return true if the value is an input, or if it has been computed and not released
+        bool ready() const { return slot->value != nullptr; };
+
+        /// @brief get the value
+        /// @return reference to the value, held by the workflow
+        /// @throws std::runtime_error if the value is not computed yet, or it was released after its last consumer
+        const T &get() const
+        {
+            if (not slot->value)
+            {
+                throw std::runtime_error("Workflow value not available: not computed yet, or released after its last consumer (see Node::keep())");
+            }
+            return *slot->value;
+        }
+
+        /// @brief keep the value after its last consumer, to read it after the run
+        /// @return reference to the node
+        const Node &keep() const
+        {
+            slot->kept = true;
+            return *this;
+        }
+
+    private:
+        friend class Workflow;
+
+        /**
+         * @brief Storage of the value.
+         */
+        struct Slot : WorkflowSlot
+        {
+            std::shared_ptr<T> value; /// value, nullptr if not available
+
+            void release() override { value.reset(); };
+        };
+
+        std::shared_ptr<Slot> slot; /// value of the node
+        size_t index;               /// index of the operation computing the value (npos for the inputs)
+
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        Node(std::shared_ptr<Slot> slot, size_t index) : slot(std::move(slot)), index(index){};
+    };
+
+    /**
+     * @brief Graph of operations on matrices and vectors, run concurrently with `tbb::flow`.
+     */
+    class Workflow
+    {
+    public:
+        /// @brief constructor
+        /// @param context execution context of the operations (nullptr for the global task arena)
+        explicit Workflow(std::shared_ptr<ExecutionContext> context = nullptr) : context(std::move(context))
+        {
+            // the graph runs its nodes in the task arena where it is created
+            const auto create = [this]()
+            {
+                graph = std::make_unique<tbb::flow::graph>();
+                start = std::make_unique<tbb::flow::broadcast_node<tbb::flow::continue_msg>>(*graph);
+            };
+            if (outside_context(this->context))
+            {
+                this->context->execute(create);
+            }
+            else
+            {
+                create();
+            }
+        }
+
+        /// @brief the nodes refer to the workflow: it cannot be copied
+        Workflow(const Workflow &) = delete;
+
+        /// @brief the nodes refer to the workflow: it cannot be copied
+        Workflow &operator=(const Workflow &) = delete;
+
+        /// @brief add an input value, shared with the caller
+        /// @tparam T type of the value
+        /// @param value pointer to the value (not modified by the workflow)
+        /// @return node of the value
+        template <typename T>
+        Node<T> input(std::shared_ptr<T> value)
+        {
+            auto slot = std::make_shared<typename Node<T>::Slot>();
+            slot->value = std::move(value);
+            return Node<T>(std::move(slot), Node<T>::npos);
+        }
+
+        /// @brief add an input value, moved (or copied) into the workflow
+        /// @tparam T type of the value
+        /// @param value input value
+        /// @return node of the value
+        template <typename T>
+        Node<std::decay_t<T>> input(T &&value)
+        {
+            return input(std::make_shared<std::decay_t<T>>(std::forward<T>(value)));
+        }
+
+        /// @brief add an operation
+        /// @tparam F callable with the values of the inputs, as const references
+        /// @tparam Args types of the values of the inputs
+        /// @param function operation, returning its result by value
+        /// @param inputs nodes of the arguments of the operation
+        /// @return node of the result
+        template <typename F, typename... Args>
+        auto add(F &&function, const Node<Args> &...inputs)
+        {
+            using R = std::decay_t<std::invoke_result_t<F &, const Args &...>>;
+            static_assert(not std::is_void_v<R>, "The operations of a workflow must return a value");
+
+            auto slot = std::make_shared<typename Node<R>::Slot>();
+            slot->operation = true;
+            (inputs.slot->consumers++, ...);
+            slots.push_back(slot);
+
+            const size_t index = nodes.size();
+            nodes.push_back(std::make_unique<tbb::flow::continue_node<tbb::flow::continue_msg>>(
+                *graph,
+                [this, slot, function = std::forward<F>(function), input_slots = std::make_tuple(inputs.slot...)](const tbb::flow::continue_msg &)
+                {
+                    // an operation is skipped if one of its inputs was not computed, the other branches go on
+                    const bool skipped = std::apply([](const auto &...values)
+                                                    { return (values->failed.load(std::memory_order_acquire) or ...); },
+                                                    input_slots);
+                    if (skipped)
+                    {
+                        fail(*slot, nullptr);
+                    }
+                    else
+                    {
+                        try
+                        {
+                            slot->value = std::apply([&](const auto &...values)
+                                                     { return std::make_shared<R>(function(*values->value...)); },
+                                                     input_slots);
+                        }
+                        catch (...)
+                        {
+                            fail(*slot, std::current_exception());
+                        }
+                    }
+                    // the last consumer releases the results of the operations
+                    std::apply([this](const auto &...values)
+                               { (consumed(*values), ...); },
+                               input_slots);
+                    return tbb::flow::continue_msg();
+                }));
+
+            bool source = true;
+            ((inputs.index != Node<Args>::npos ? (tbb::flow::make_edge(*nodes[inputs.index], *nodes[index]), source = false) : false), ...);
+            if (source)
+            {
+                tbb::flow::make_edge(*start, *nodes[index]);
+            }
+            return Node<R>(std::move(slot), index);
+        }
+
+        /// @brief add a product: matrix by vector (SpMV) or matrix by matrix (SpGEMM)
+        /// @param left node of the matrix (or view)
+        /// @param right node of the vector or of the matrix
+        /// @return node of the product
+        template <typename L, typename R>
+        auto multiply(const Node<L> &left, const Node<R> &right)
+        {
+            return add([](const L &m, const R &x)
+                       { return m * x; },
+                       left, right);
+        }
+
+        /// @brief add a product of the transpose of a matrix (through a TransposeView)
+        /// @param left node of the matrix
+        /// @param right node of the vector or of the matrix
+        /// @return node of the product
+        template <typename L, typename R>
+        auto transpose_multiply(const Node<L> &left, const Node<R> &right)
+        {
+            return add([](const L &m, const R &x)
+                       {
+                           // the view only reads the matrix
+                           return TransposeView(const_cast<L &>(m)) * x; },
+                       left, right);
+        }
+
+        /// @brief add a norm of a matrix
+        /// @tparam N type of norm (One, Infinity or Frobenius)
+        /// @param matrix node of the matrix
+        /// @return node of the norm
+        template <NormType N, typename M>
+        Node<double> norm(const Node<M> &matrix)
+        {
+            return add([](const M &m)
+                       { return m.template norm<N>(); },
+                       matrix);
+        }
+
+        /// @brief run all the operations, the independent ones concurrently, and wait for them
+        /// @throws the first exception thrown by an operation (the operations that depend on it are skipped)
+        void run()
+        {
+            for (const auto &slot : slots)
+            {
+                slot->pending.store(slot->consumers, std::memory_order_relaxed);
+                slot->failed.store(false, std::memory_order_relaxed);
+            }
+            released_count.store(0, std::memory_order_relaxed);
+            error = nullptr;
+
+            const auto execute = [this]()
+            {
+                start->try_put(tbb::flow::continue_msg());
+                graph->wait_for_all();
+            };
+            if (outside_context(context))
+            {
+                context->execute(execute);
+            }
+            else
+            {
+                execute();
+            }
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+
+        /// @brief get the number of operations
+        /// @return number of nodes of the graph
+        size_t size() const { return nodes.size(); };
+
+        /// @brief get the number of results released during the last run
+        /// @return number of intermediate results freed after their last consumer
+        size_t released() const { return released_count.load(std::memory_order_relaxed); };
+
+    private:
+        std::shared_ptr<ExecutionContext> context;                                       /// execution context of the operations
+        std::unique_ptr<tbb::flow::graph> graph;                                         /// graph of the operations
+        std::unique_ptr<tbb::flow::broadcast_node<tbb::flow::continue_msg>> start;       /// predecessor of the operations without operation inputs
+        std::vector<std::unique_ptr<tbb::flow::continue_node<tbb::flow::continue_msg>>> nodes; /// one node per operation
+        std::vector<std::shared_ptr<WorkflowSlot>> slots;                                /// results of the operations
+        std::atomic<size_t> released_count = 0;                                          /// results released in the current run
+        std::mutex error_mutex;                                                          /// protects error
+        std::exception_ptr error;                                                        /// first exception of the current run
+
+        /// @brief mark the result of an operation as failed, and record the first exception of the run
+        /// @param slot result of the operation, whose value of a previous run is released
+        /// @param exception exception thrown by the operation (nullptr if it was skipped)
+        void fail(WorkflowSlot &slot, std::exception_ptr exception)
+        {
+            slot.release();
+            slot.failed.store(true, std::memory_order_release);
+            if (exception)
+            {
+                std::lock_guard lock(error_mutex);
+                if (not error)
+                {
+                    error = exception;
+                }
+            }
+        }
+
+        /// @brief mark an input of an operation as read, and release it after its last consumer
+        /// @param slot result read by the operation
+        void consumed(WorkflowSlot &slot)
+        {
+            if (not slot.operation)
+            {
+                return;
+            }
+            if (slot.pending.fetch_sub(1, std::memory_order_acq_rel) == 1 and not slot.kept)
+            {
+                slot.release();
+                released_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    };
+}
+
+#endif // WORKFLOW_HPP
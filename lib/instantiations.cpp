@@ -0,0 +1,16 @@
+/**
+ * @file instantiations.cpp
+ * @brief Explicit instantiations of the prebuilt library (`make lib` builds `lib/libalgebra.a`).
+ *
+ * The classes, the norms and the products are instantiated for the element types and storage orders of
+ * ALGEBRA_FOR_EACH_INSTANTIATION. The programs compiled with `-DALGEBRA_PREBUILT` declare them as
+ * `extern template` (see extern_templates.hpp) and link this library instead of compiling them again.
+ */
+#include "matrix.hpp"
+#include "square_matrix.hpp"
+#include "matrix_views.hpp"
+
+namespace algebra
+{
+    ALGEBRA_FOR_EACH_INSTANTIATION(ALGEBRA_DEFINE_INSTANTIATIONS)
+}
@@ -28,6 +28,9 @@
 #include "json_utility.hpp"
 #include "square_matrix.hpp"
 #include "test.hpp"
+#ifdef ALGEBRA_ENABLE_TRACING
+#include "trace_export.hpp"
+#endif
 
 #include <random>
 #include <iostream>
@@ -39,6 +42,10 @@ using namespace json_utility;
 
 int main()
 {
+#ifdef ALGEBRA_ENABLE_TRACING
+    Tracer::instance().enable();
+#endif
+
     // Test with a 5x5 matrix
     std::cout << "------------------------------------" << std::endl;
     std::cout << "Test with a 5x5 real matrix" << std::endl;
@@ -94,5 +101,17 @@ int main()
         }
     }
 
+#ifdef ALGEBRA_ENABLE_PROFILING
+    std::cout << std::endl;
+    std::cout << "Hardware counters per kernel" << std::endl;
+    Profiler::instance().print(std::cout);
+#endif
+
+#ifdef ALGEBRA_ENABLE_TRACING
+    Tracer::instance().disable();
+    save_chrome_trace("data/trace.json");
+    std::cout << "Trace saved in data/trace.json" << std::endl;
+#endif
+
     return 0;
 }
\ No newline at end of file